@@ -0,0 +1,55 @@
+﻿#include "AllocationCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Перед блоком хранится его размер, чтобы operator delete знал, сколько вычесть
+namespace {
+    std::atomic<std::size_t> allocationCount{ 0 };
+    std::atomic<std::size_t> liveBytes{ 0 };
+    std::atomic<std::size_t> peakBytes{ 0 };
+    constexpr std::size_t ALLOCATION_HEADER = alignof(std::max_align_t);
+}
+
+void* operator new(std::size_t size) {
+    void* block = std::malloc(size + ALLOCATION_HEADER);
+    if (!block) throw std::bad_alloc();
+    *static_cast<std::size_t*>(block) = size;
+    ++allocationCount;
+    const std::size_t live = liveBytes += size;
+    std::size_t peak = peakBytes;
+    while (live > peak && !peakBytes.compare_exchange_weak(peak, live)) {}
+    return static_cast<char*>(block) + ALLOCATION_HEADER;
+}
+
+void operator delete(void* p) noexcept {
+    if (!p) return;
+    void* block = static_cast<char*>(p) - ALLOCATION_HEADER;
+    liveBytes -= *static_cast<std::size_t*>(block);
+    std::free(block);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    operator delete(p);
+}
+
+namespace mc {
+    AllocationScope::AllocationScope() : allocations_(allocationCount), live_(liveBytes) {
+        peakBytes = live_;
+    }
+
+    std::size_t AllocationScope::Allocations() const {
+        return allocationCount - allocations_;
+    }
+
+    std::size_t AllocationScope::PeakBytes() const {
+        const std::size_t peak = peakBytes;
+        return peak > live_ ? peak - live_ : 0;
+    }
+
+    std::size_t AllocationScope::KeptBytes() const {
+        const std::size_t live = liveBytes;
+        return live > live_ ? live - live_ : 0;
+    }
+}
@@ -0,0 +1,27 @@
+﻿#pragma once
+
+#include <cstddef>
+
+// Счетчики выделений памяти для замеров mcbench. Глобальные operator new/delete подменяет
+// AllocationCounter.cpp, который собирается только в mcbench: mccore, mctool и окно
+// работают со штатным распределителем
+namespace mc {
+    // Выделения с момента создания замера: число, пик и сколько осталось занято.
+    // Замеры идут друг за другом: новый замер сбрасывает пик
+    class AllocationScope {
+    public:
+        AllocationScope();
+
+        AllocationScope(const AllocationScope&) = delete;
+        AllocationScope& operator=(const AllocationScope&) = delete;
+
+        std::size_t Allocations() const;
+        std::size_t PeakBytes() const;
+        // Занято сверх начала замера; 0, если освобождено больше, чем выделено
+        std::size_t KeptBytes() const;
+
+    private:
+        std::size_t allocations_;
+        std::size_t live_;
+    };
+}
@@ -0,0 +1,2903 @@
+﻿// Режимы mcbench: прежний код против нового на больших данных. Отчет печатается в stdout,
+// расхождение результатов со сверкой - исключение (код возврата 1)
+#include "BenchModes.h"
+#include "AllocationCounter.h"
+#include "CartesianProduct.h"
+#include "CaseFold.h"
+#include "CsvReader.h"
+#include "DictCache.h"
+#include "Dictionary.h"
+#include "DictionaryLoader.h"
+#include "DictionaryReloader.h"
+#include "DuplicateDetector.h"
+#include "Encoding.h"
+#include "FilterEngine.h"
+#include "LastRecord.h"
+#include "LoginAllocator.h"
+#include "MappedFile.h"
+#include "MigrationDiff.h"
+#include "MigrationParser.h"
+#include "MigrationRow.h"
+#include "MigrationSort.h"
+#include "MigrationValidator.h"
+#include "MigrationWriter.h"
+#include "PrefixIndex.h"
+#include "RowGenerator.h"
+#include "TextRope.h"
+#include "Trace.h"
+#include "TrigramIndex.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <clocale>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cwctype>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    int RunParseBench(mc::Args& args) {
+        std::string path;
+        std::string_view simd = "all";
+        long long repeat = 3;
+
+        std::string_view option;
+        while (args.Next(option)) {
+            if (option == "--simd") simd = args.Value(option);
+            else if (option == "--repeat") repeat = mc::ParseInt(args.Value(option), option);
+            else if (path.empty() && option.substr(0, 2) != "--") path = option;
+            else throw std::runtime_error("Неизвестный параметр: " + std::string(option));
+        }
+        if (path.empty()) throw std::runtime_error("Не указан файл");
+
+        std::vector<mc::SimdLevel> levels;
+        for (mc::SimdLevel level : { mc::SimdLevel::Scalar, mc::SimdLevel::Sse2, mc::SimdLevel::Avx2 }) {
+            if (static_cast<int>(level) > static_cast<int>(mc::DetectSimdLevel())) continue;
+            if (simd == "all" || simd == mc::SimdLevelName(level)) levels.push_back(level);
+        }
+        if (levels.empty()) throw std::runtime_error("Вариант недоступен: " + std::string(simd));
+
+        const mc::MappedFile file(path);
+        for (mc::SimdLevel level : levels) {
+            double best = 0;
+            std::uint64_t records = 0;
+            std::uint64_t fields = 0;
+            for (long long pass = 0; pass < std::max(1LL, repeat); ++pass) {
+                const auto start = std::chrono::steady_clock::now();
+                mc::RecordReader reader(file.View(), level);
+                mc::Record record;
+                records = 0;
+                fields = 0;
+                while (reader.Next(record)) {
+                    ++records;
+                    fields += record.fieldCount;
+                }
+                const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                if (best == 0 || seconds < best) best = seconds;
+            }
+            std::printf("%-7s записей: %llu, полей: %llu, %.3f с, %.2f ГБ/с\n", mc::SimdLevelName(level),
+                static_cast<unsigned long long>(records), static_cast<unsigned long long>(fields),
+                best, best > 0 ? file.Size() / best / 1e9 : 0.0);
+        }
+        return 0;
+    }
+
+    // Прежний фильтр FilterComboBox: перебор всего списка
+    bool StartsWithCaseInsensitive(const std::wstring& str, const std::wstring& prefix) {
+        if (prefix.empty()) return true;
+        if (str.length() < prefix.length()) return false;
+
+        return std::equal(prefix.begin(), prefix.end(), str.begin(), [](wchar_t ch1, wchar_t ch2) {
+            return towupper(ch1) == towupper(ch2);
+            });
+    }
+
+    int RunPrefixBench(mc::Args& args) {
+        size_t size = 1000000;
+        size_t queries = 200;
+
+        std::string_view option;
+        while (args.Next(option)) {
+            if (option == "--size") size = static_cast<size_t>(mc::ParseInt(args.Value(option), option));
+            else if (option == "--queries") queries = static_cast<size_t>(mc::ParseInt(args.Value(option), option));
+            else throw std::runtime_error("Неизвестный параметр: " + std::string(option));
+        }
+        if (size == 0) throw std::runtime_error("Пустой словарь");
+
+        std::mt19937 rng(42);
+        const std::vector<std::wstring> items = mc::MakeDictionary(size, rng);
+
+        auto start = std::chrono::steady_clock::now();
+        mc::PrefixIndex index;
+        index.Build(std::vector<std::wstring_view>(items.begin(), items.end()));
+        std::printf("Словарь: %zu строк, построение индекса: %.1f мс\n", size, mc::ElapsedMicros(start) / 1000);
+
+        // Набор слова по буквам (в нижнем регистре), как в CBN_EDITUPDATE
+        std::uniform_int_distribution<size_t> pick(0, size - 1);
+        std::vector<std::wstring> typed;
+        for (size_t q = 0; q < queries; ++q) {
+            std::wstring word = items[pick(rng)].substr(0, 6);
+            for (wchar_t& ch : word) ch = static_cast<wchar_t>(towlower(ch));
+            for (size_t len = 1; len <= word.size(); ++len) typed.push_back(word.substr(0, len));
+        }
+
+        double linear = 0, fresh = 0, incremental = 0;
+        size_t linearMatches = 0, indexMatches = 0;
+        mc::PrefixCursor cursor;
+        for (const std::wstring& prefix : typed) {
+            start = std::chrono::steady_clock::now();
+            for (const auto& item : items) {
+                if (StartsWithCaseInsensitive(item, prefix)) ++linearMatches;
+            }
+            linear += mc::ElapsedMicros(start);
+
+            start = std::chrono::steady_clock::now();
+            indexMatches += index.Find(mc::FoldCase(prefix)).Size();
+            fresh += mc::ElapsedMicros(start);
+
+            start = std::chrono::steady_clock::now();
+            cursor.Update(index, prefix);
+            incremental += mc::ElapsedMicros(start);
+        }
+        if (linearMatches != indexMatches) {
+            throw std::runtime_error("Результаты индекса расходятся с перебором");
+        }
+
+        const double n = static_cast<double>(typed.size());
+        std::printf("Нажатий: %zu, совпадений: %zu\n", typed.size(), indexMatches);
+        std::printf("перебор          %10.2f мкс/нажатие\n", linear / n);
+        std::printf("индекс           %10.2f мкс/нажатие\n", fresh / n);
+        std::printf("индекс + сужение %10.2f мкс/нажатие\n", incremental / n);
+        return 0;
+    }
+
+    void PrintLatency(const char* name, std::vector<double>& micros, size_t matches) {
+        std::sort(micros.begin(), micros.end());
+        double total = 0;
+        for (double value : micros) total += value;
+        std::printf("%-10s среднее %8.1f мкс, p50 %8.1f мкс, p99 %8.1f мкс, совпадений %zu\n", name,
+            total / micros.size(), micros[micros.size() / 2], micros[micros.size() * 99 / 100], matches);
+    }
+
+    int RunTrigramBench(mc::Args& args) {
+        size_t size = 1000000;
+        size_t queries = 1000;
+        size_t top = 200;
+
+        std::string_view option;
+        while (args.Next(option)) {
+            if (option == "--size") size = static_cast<size_t>(mc::ParseInt(args.Value(option), option));
+            else if (option == "--queries") queries = static_cast<size_t>(mc::ParseInt(args.Value(option), option));
+            else if (option == "--top") top = static_cast<size_t>(mc::ParseInt(args.Value(option), option));
+            else throw std::runtime_error("Неизвестный параметр: " + std::string(option));
+        }
+        if (size == 0 || queries == 0) throw std::runtime_error("Пустой словарь или нет запросов");
+
+        std::mt19937 rng(7);
+        const std::vector<std::wstring> items = mc::MakeDictionary(size, rng);
+
+        auto start = std::chrono::steady_clock::now();
+        mc::TrigramIndex index;
+        index.Build(std::vector<std::wstring_view>(items.begin(), items.end()));
+        std::printf("Словарь: %zu строк, построение индекса: %.1f мс\n", size, mc::ElapsedMicros(start) / 1000);
+
+        // Фрагменты из середины строк (как часть фамилии) и они же с опечаткой
+        std::uniform_int_distribution<size_t> pick(0, size - 1);
+        std::uniform_int_distribution<int> letter(0, 25);
+        std::vector<std::wstring> substrings;
+        std::vector<std::wstring> typos;
+        while (substrings.size() < queries) {
+            const std::wstring& item = items[pick(rng)];
+            const size_t length = 4 + substrings.size() % 4;
+            if (item.size() < length + 2) continue;
+            std::wstring fragment = item.substr(1 + substrings.size() % (item.size() - length - 1), length);
+            substrings.push_back(fragment);
+            fragment[fragment.size() / 2] = static_cast<wchar_t>(L'a' + letter(rng));
+            typos.push_back(std::move(fragment));
+        }
+
+        std::vector<mc::Match> matches;
+        for (const auto mode : { mc::MatchMode::Substring, mc::MatchMode::Fuzzy }) {
+            const std::vector<std::wstring>& queryList = mode == mc::MatchMode::Substring ? substrings : typos;
+            std::vector<double> micros;
+            size_t found = 0;
+            for (const std::wstring& query : queryList) {
+                start = std::chrono::steady_clock::now();
+                index.Search(query, mode, top, matches);
+                micros.push_back(mc::ElapsedMicros(start));
+                found += matches.size();
+            }
+            PrintLatency(mode == mc::MatchMode::Substring ? "подстрока" : "нечеткий", micros, found);
+        }
+
+        // Одна-две буквы из конца строки: индекс читает готовый список лучших строк. Первые 50
+        // запросов сверяются с ранжированием всех строк
+        std::vector<double> micros;
+        size_t found = 0;
+        for (size_t q = 0; q < queries; ++q) {
+            const std::wstring& item = items[pick(rng)];
+            const std::wstring query = item.substr(item.size() - 1 - q % 2);
+            start = std::chrono::steady_clock::now();
+            index.Search(query, mc::MatchMode::Substring, top, matches);
+            micros.push_back(mc::ElapsedMicros(start));
+            found += matches.size();
+            if (q >= 50) continue;
+
+            const std::wstring folded = mc::FoldCase(query);
+            std::vector<std::pair<std::uint32_t, std::uint32_t>> expected;
+            for (std::uint32_t i = 0; i < size; ++i) {
+                const std::wstring text = mc::FoldCase(items[i]);
+                const size_t pos = text.find(folded);
+                if (pos == std::wstring::npos) continue;
+                const bool wordStart = pos > 0 && (text[pos - 1] == L' ' || text[pos - 1] == L'_' || text[pos - 1] == L'-');
+                const std::uint32_t place = pos == 0 ? 0 : wordStart ? 1 : 2;
+                expected.emplace_back((place << 24) | static_cast<std::uint32_t>(text.size()), i);
+            }
+            std::sort(expected.begin(), expected.end());
+            expected.resize(std::min(expected.size(), top));
+            bool same = matches.size() == expected.size();
+            for (size_t i = 0; same && i < matches.size(); ++i) {
+                same = matches[i].score == expected[i].first && matches[i].item == expected[i].second;
+            }
+            if (!same) throw std::runtime_error("Короткий запрос: лучшие совпадения не совпали с полным ранжированием");
+        }
+        PrintLatency("короткий", micros, found);
+        // Короткий запрос - не больше topK строк из списка, если topK помещается в список
+        if (top <= mc::TrigramIndex::SHORT_POSTINGS && micros[micros.size() * 99 / 100] > 1000) {
+            throw std::runtime_error("Короткий запрос: p99 больше 1 мс");
+        }
+        return 0;
+    }
+
+    // Локаль с таблицами Unicode, в которой towupper приводит и кириллицу (в локали "C" - только ASCII)
+    const char* SetUnicodeLocale() {
+        for (const char* name : { "C.UTF-8", "en_US.UTF-8", "ru_RU.UTF-8", ".UTF8" }) {
+            if (std::setlocale(LC_CTYPE, name)) return name;
+        }
+        return nullptr;
+    }
+
+    // Словарь, похожий на position.txt: слова кириллицей с заглавной буквы, изредка "№" и тире
+    std::vector<std::wstring> MakeCyrillicDictionary(size_t size, std::mt19937& rng) {
+        static const wchar_t lower[] = L"абвгдеёжзийклмнопрстуфхцчшщъыьэюя";
+        static const wchar_t upper[] = L"АБВГДЕЁЖЗИЙКЛМНОПРСТУФХЦЧШЩЪЫЬЭЮЯ";
+        const int letters = static_cast<int>(std::size(lower)) - 1;
+        std::uniform_int_distribution<int> length(3, 12);
+        std::uniform_int_distribution<int> words(1, 4);
+        std::uniform_int_distribution<int> letter(0, letters - 1);
+        std::uniform_int_distribution<int> rare(0, 15);
+        std::vector<std::wstring> items;
+        items.reserve(size);
+        for (size_t i = 0; i < size; ++i) {
+            std::wstring item;
+            const int n = words(rng);
+            for (int word = 0; word < n; ++word) {
+                if (word) item += rare(rng) == 0 ? L" — " : L" ";
+                const int chars = length(rng);
+                item += word == 0 ? upper[letter(rng)] : lower[letter(rng)];
+                for (int c = 1; c < chars; ++c) item += lower[letter(rng)];
+            }
+            if (rare(rng) == 0) item += L" № " + std::to_wstring(i);
+            items.push_back(std::move(item));
+        }
+        return items;
+    }
+
+    int RunFoldBench(mc::Args& args) {
+        std::vector<std::string> files;
+        size_t size = 200000;
+        size_t queries = 50;
+
+        std::string_view option;
+        while (args.Next(option)) {
+            if (option == "--size") size = static_cast<size_t>(mc::ParseInt(args.Value(option), option));
+            else if (option == "--queries") queries = static_cast<size_t>(mc::ParseInt(args.Value(option), option));
+            else if (option.substr(0, 2) != "--") files.emplace_back(option);
+            else throw std::runtime_error("Неизвестный параметр: " + std::string(option));
+        }
+        if (queries == 0) throw std::runtime_error("Нет запросов");
+
+        // Таблицы против towupper: в локали Unicode совпадают символ в символ
+        size_t tableChars = 0, cLocaleDiffers = 0;
+        std::vector<wchar_t> cLocale;
+        for (std::uint32_t ch = 0; ch < 0x500; ++ch) {
+            if (ch >= mc::detail::FOLD_LATIN_END && ch < mc::detail::FOLD_CYRILLIC_BEGIN) continue;
+            cLocale.push_back(static_cast<wchar_t>(towupper(static_cast<wint_t>(ch))));
+        }
+        const char* locale = SetUnicodeLocale();
+        if (!locale) throw std::runtime_error("Нет локали UTF-8 для сверки с towupper");
+        for (std::uint32_t ch = 0; ch < 0x500; ++ch) {
+            if (ch >= mc::detail::FOLD_LATIN_END && ch < mc::detail::FOLD_CYRILLIC_BEGIN) continue;
+            const wchar_t expected = static_cast<wchar_t>(towupper(static_cast<wint_t>(ch)));
+            if (mc::FoldChar(static_cast<wchar_t>(ch)) != expected) {
+                throw std::runtime_error("Таблица расходится с towupper на U+" + std::to_string(ch));
+            }
+            if (cLocale[tableChars] != expected) ++cLocaleDiffers;
+            ++tableChars;
+        }
+        std::printf("Таблицы: %zu символов совпадают с towupper (%s); в локали C towupper не приводит %zu из них\n",
+            tableChars, locale, cLocaleDiffers);
+
+        // Словари из файлов как есть, плюс сгенерированные латиницей и кириллицей
+        std::vector<std::wstring> items;
+        size_t fileItems = 0;
+        for (const std::string& path : files) {
+            mc::Dictionary dictionary;
+            if (!dictionary.Load(path)) throw std::runtime_error("Ошибка открытия файла: " + path);
+            for (size_t i = 0; i < dictionary.Size(); ++i) items.emplace_back(dictionary[i]);
+            fileItems += dictionary.Size();
+        }
+        std::mt19937 rng(11);
+        for (std::wstring& item : mc::MakeDictionary(size / 2, rng)) items.push_back(std::move(item));
+        for (std::wstring& item : MakeCyrillicDictionary(size - size / 2, rng)) items.push_back(std::move(item));
+        if (items.empty()) throw std::runtime_error("Пустой словарь");
+        size_t chars = 0;
+        for (const std::wstring& item : items) chars += item.size();
+
+        // Набор начала строки в нижнем регистре и фрагменты из середины строк
+        std::uniform_int_distribution<size_t> pick(0, items.size() - 1);
+        std::vector<std::wstring> prefixes, needles;
+        for (size_t q = 0; q < queries; ++q) {
+            std::wstring word = items[pick(rng)].substr(0, 6);
+            for (wchar_t& ch : word) ch = static_cast<wchar_t>(towlower(ch));
+            for (size_t len = 1; len <= word.size(); ++len) prefixes.push_back(word.substr(0, len));
+            const std::wstring& item = items[pick(rng)];
+            const size_t length = std::min<size_t>(3, item.size());
+            needles.push_back(item.substr(item.size() / 2 - std::min(item.size() / 2, length / 2), length));
+        }
+
+        // Прежнее сравнение - эталон для префиксов, найденное подстрокой сверяется с find по приведенной строке
+        std::vector<std::uint8_t> expected;
+        expected.reserve(prefixes.size() * items.size());
+        auto start = std::chrono::steady_clock::now();
+        for (const std::wstring& prefix : prefixes) {
+            for (const std::wstring& item : items) expected.push_back(StartsWithCaseInsensitive(item, prefix));
+        }
+        const double legacyMicros = mc::ElapsedMicros(start);
+        std::vector<std::wstring> folded(items.size());
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < items.size(); ++i) {
+            folded[i].resize(items[i].size());
+            for (size_t c = 0; c < items[i].size(); ++c) folded[i][c] = static_cast<wchar_t>(towupper(items[i][c]));
+        }
+        const double legacyFoldMicros = mc::ElapsedMicros(start);
+        std::setlocale(LC_CTYPE, "C");
+
+        std::printf("Строк: %zu (из файлов %zu), символов: %zu, префиксов: %zu, фрагментов: %zu\n",
+            items.size(), fileItems, chars, prefixes.size(), needles.size());
+        const double comparisons = static_cast<double>(prefixes.size()) * items.size();
+        const double scans = static_cast<double>(needles.size()) * items.size();
+        std::printf("%-7s %9.2f нс/сравнение, приведение %.2f нс/символ (towupper)\n",
+            "прежнее", legacyMicros * 1000 / comparisons, legacyFoldMicros * 1000 / chars);
+
+        std::vector<std::wstring> foldedPrefixes, foldedNeedles;
+        for (const std::wstring& prefix : prefixes) foldedPrefixes.push_back(mc::FoldCase(prefix));
+        for (const std::wstring& needle : needles) foldedNeedles.push_back(mc::FoldCase(needle));
+
+        // Замер без сверки; результаты сверяются после
+        std::vector<wchar_t> foldedAll(chars);
+        std::vector<std::uint8_t> startsWith(expected.size());
+        std::vector<size_t> positions(needles.size() * items.size());
+        for (const auto level : { mc::SimdLevel::Scalar, mc::SimdLevel::Sse2, mc::SimdLevel::Avx2 }) {
+            if (static_cast<int>(level) > static_cast<int>(mc::DetectSimdLevel())) break;
+            const mc::CaseFoldKernels& kernels = mc::GetCaseFoldKernels(level);
+
+            start = std::chrono::steady_clock::now();
+            size_t offset = 0;
+            for (const std::wstring& item : items) {
+                kernels.fold(foldedAll.data() + offset, item.data(), item.size());
+                offset += item.size();
+            }
+            const double foldMicros = mc::ElapsedMicros(start);
+
+            size_t k = 0;
+            start = std::chrono::steady_clock::now();
+            for (const std::wstring& prefix : foldedPrefixes) {
+                for (const std::wstring& item : items) {
+                    startsWith[k++] = kernels.startsWith(item.data(), item.size(), prefix.data(), prefix.size());
+                }
+            }
+            const double compareMicros = mc::ElapsedMicros(start);
+
+            k = 0;
+            start = std::chrono::steady_clock::now();
+            for (const std::wstring& needle : foldedNeedles) {
+                for (const std::wstring& item : items) {
+                    positions[k++] = kernels.find(item.data(), item.size(), needle.data(), needle.size());
+                }
+            }
+            const double findMicros = mc::ElapsedMicros(start);
+
+            offset = 0;
+            for (const std::wstring& f : folded) {
+                if (!std::equal(f.begin(), f.end(), foldedAll.begin() + offset)) {
+                    throw std::runtime_error("Приведение расходится с towupper");
+                }
+                offset += f.size();
+            }
+            if (startsWith != expected) throw std::runtime_error("Сравнение расходится с прежним");
+            size_t found = 0;
+            k = 0;
+            for (const std::wstring& needle : foldedNeedles) {
+                for (const std::wstring& f : folded) {
+                    if (positions[k++] != f.find(needle)) throw std::runtime_error("Поиск расходится с find");
+                    found += positions[k - 1] != std::wstring::npos;
+                }
+            }
+            const size_t matches = static_cast<size_t>(std::count(startsWith.begin(), startsWith.end(), 1));
+
+            std::printf("%-7s %9.2f нс/сравнение, приведение %.2f нс/символ, подстрока %.2f нс/строка, совпадений %zu/%zu\n",
+                mc::SimdLevelName(level), compareMicros * 1000 / comparisons, foldMicros * 1000 / chars,
+                findMicros * 1000 / scans, matches, found);
+        }
+        return 0;
+    }
+
+    // Эталон для режима encoding, независимый от Encoding.cpp. В CP1251 из текста стенда есть
+    // ASCII, А-я, Ё, ё, № и тире; остальное - '?'
+    bool InCp1251(char32_t cp) {
+        return cp < 0x80 || (cp >= 0x410 && cp <= 0x44F) || cp == 0x401 || cp == 0x451 || cp == 0x2116 || cp == 0x2014;
+    }
+
+    void AppendReference(std::string& out, char32_t cp, mc::TextEncoding encoding) {
+        const auto put16 = [&](char32_t unit) {
+            const char high = static_cast<char>(unit >> 8);
+            const char low = static_cast<char>(unit & 0xFF);
+            out += encoding == mc::TextEncoding::Utf16Be ? high : low;
+            out += encoding == mc::TextEncoding::Utf16Be ? low : high;
+        };
+        switch (encoding) {
+        case mc::TextEncoding::Utf8:
+            if (cp < 0x80) {
+                out += static_cast<char>(cp);
+            }
+            else if (cp < 0x800) {
+                out += static_cast<char>(0xC0 | (cp >> 6));
+                out += static_cast<char>(0x80 | (cp & 0x3F));
+            }
+            else if (cp < 0x10000) {
+                out += static_cast<char>(0xE0 | (cp >> 12));
+                out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (cp & 0x3F));
+            }
+            else {
+                out += static_cast<char>(0xF0 | (cp >> 18));
+                out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+                out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (cp & 0x3F));
+            }
+            break;
+        case mc::TextEncoding::Utf16Le:
+        case mc::TextEncoding::Utf16Be:
+            if (cp >= 0x10000) {
+                put16(0xD800 + ((cp - 0x10000) >> 10));
+                put16(0xDC00 + ((cp - 0x10000) & 0x3FF));
+            }
+            else {
+                put16(cp);
+            }
+            break;
+        case mc::TextEncoding::Cp1251:
+            if (cp < 0x80) out += static_cast<char>(cp);
+            else if (cp >= 0x410 && cp <= 0x44F) out += static_cast<char>(cp - 0x350);
+            else if (cp == 0x401) out += '\xA8';
+            else if (cp == 0x451) out += '\xB8';
+            else if (cp == 0x2116) out += '\xB9';
+            else if (cp == 0x2014) out += '\x97';
+            else out += '?';
+            break;
+        }
+    }
+
+    void PushWide(std::vector<wchar_t>& out, char32_t cp) {
+        if (sizeof(wchar_t) == 2 && cp >= 0x10000) {
+            out.push_back(static_cast<wchar_t>(0xD800 + ((cp - 0x10000) >> 10)));
+            out.push_back(static_cast<wchar_t>(0xDC00 + ((cp - 0x10000) & 0x3FF)));
+        }
+        else {
+            out.push_back(static_cast<wchar_t>(cp));
+        }
+    }
+
+    // Выгрузка HR: строки кириллицей и латиницей вперемешку, изредка символ вне BMP
+    // (суррогатная пара в UTF-16). Замер - лучший из repeat, ГБ/с по входным байтам;
+    // каждый уровень сверяется с эталоном, неверный ввод - с посимвольным ядром
+    int RunEncodingBench(mc::Args& args) {
+        size_t lines = 200000;
+        int repeat = 5;
+        std::filesystem::path base = std::filesystem::temp_directory_path();
+
+        std::string_view option;
+        while (args.Next(option)) {
+            if (option == "--lines") lines = static_cast<size_t>(mc::ParseInt(args.Value(option), option));
+            else if (option == "--repeat") repeat = static_cast<int>(mc::ParseInt(args.Value(option), option));
+            else if (option == "--dir") base = std::string(args.Value(option));
+            else throw std::runtime_error("Неизвестный параметр: " + std::string(option));
+        }
+        if (lines == 0 || repeat < 1) throw std::runtime_error("Нет строк для замера");
+
+        std::mt19937 rng(21);
+        const std::vector<std::wstring> cyrillic = MakeCyrillicDictionary(lines / 2 + 1, rng);
+        const std::vector<std::wstring> latin = mc::MakeDictionary(lines / 2 + 1, rng);
+        std::u32string text;
+        for (size_t i = 0; i < lines; ++i) {
+            // Латинские строки с табельным номером и почтой - длинные участки ASCII
+            const std::wstring line = i % 2 ? latin[i / 2] + L";" + std::to_wstring(100000 + i) + L";user" + std::to_wstring(i) + L"@example.com"
+                                            : cyrillic[i / 2];
+            for (const wchar_t ch : line) text += static_cast<char32_t>(ch);
+            if (i % 500 == 499) text += U" \U0001F600";
+            text += U'\n';
+        }
+
+        const mc::TextEncoding encodings[] = { mc::TextEncoding::Utf8, mc::TextEncoding::Cp1251,
+            mc::TextEncoding::Utf16Le, mc::TextEncoding::Utf16Be };
+        std::string encoded[4];
+        std::vector<wchar_t> unicode, cp1251;
+        for (const char32_t cp : text) {
+            for (int e = 0; e < 4; ++e) AppendReference(encoded[e], cp, encodings[e]);
+            PushWide(unicode, cp);
+            PushWide(cp1251, InCp1251(cp) ? cp : U'?');
+        }
+        const auto expected = [&](int e) -> const std::vector<wchar_t>& { return e == 1 ? cp1251 : unicode; };
+
+        // Определение кодировки: без BOM, с BOM и по оборванному началу файла
+        for (int e = 0; e < 4; ++e) {
+            const mc::DetectedEncoding plain = mc::DetectEncoding(encoded[e]);
+            const mc::DetectedEncoding head = mc::DetectEncoding(std::string_view(encoded[e]).substr(0, 4097), false);
+            if (plain.encoding != encodings[e] || plain.bomBytes != 0 || head.encoding != encodings[e]) {
+                throw std::runtime_error(std::string("Кодировка не определена: ") + mc::EncodingName(encodings[e]));
+            }
+        }
+        for (const auto& [bom, encoding] : { std::pair<std::string, mc::TextEncoding>{ "\xEF\xBB\xBF", mc::TextEncoding::Utf8 },
+                 { "\xFF\xFE", mc::TextEncoding::Utf16Le }, { "\xFE\xFF", mc::TextEncoding::Utf16Be } }) {
+            const mc::DetectedEncoding detected = mc::DetectEncoding(bom + "abc");
+            if (detected.encoding != encoding || detected.bomBytes != bom.size()) throw std::runtime_error("BOM не распознан");
+        }
+
+        // Неверный ввод: случайные байты с вкраплением верных последовательностей
+        std::string junk;
+        std::uniform_int_distribution<int> byte(0, 255);
+        for (size_t i = 0; i < (size_t(1) << 16); ++i) {
+            if (i % 7 == 0) junk += encoded[0].substr(i % (encoded[0].size() - 40), 40);
+            junk += static_cast<char>(i % 3 ? byte(rng) : byte(rng) & 0x7F);
+        }
+        const mc::EncodingKernels& scalar = mc::GetEncodingKernels(mc::SimdLevel::Scalar);
+        std::vector<wchar_t> junkExpected(junk.size() + 1), junkActual(junk.size() + 1);
+        const mc::Utf8Decoded junkDecoded = scalar.utf8ToWide(junk.data(), junk.size(), junkExpected.data(), junkExpected.size());
+        junkExpected.resize(junkDecoded.written);
+        if (junkDecoded.read != junk.size() || junkDecoded.invalid == 0) throw std::runtime_error("Неверный ввод не распознан");
+
+        const auto best = [&](const auto& run) {
+            double micros = 0;
+            for (int r = 0; r < repeat; ++r) {
+                const auto start = std::chrono::steady_clock::now();
+                run();
+                const double elapsed = mc::ElapsedMicros(start);
+                if (r == 0 || elapsed < micros) micros = elapsed;
+            }
+            return micros;
+        };
+        const auto gbps = [](size_t bytes, double micros) { return micros > 0 ? bytes / micros / 1000 : 0.0; };
+
+        std::printf("Строк: %zu, UTF-8 %.1f МБ, CP1251 %.1f МБ, UTF-16 %.1f МБ\n", lines, encoded[0].size() / 1048576.0,
+            encoded[1].size() / 1048576.0, encoded[2].size() / 1048576.0);
+        std::printf("%-7s %8s %8s %8s %8s %8s %8s  ГБ/с\n", "", "check", "UTF-8", "CP1251", "UTF-16LE", "UTF-16BE", "->UTF-8");
+
+        std::vector<wchar_t> wide(unicode.size() + 1);
+        std::string utf8(encoded[0].size() + 4 * 32, '\0');
+        for (const auto level : { mc::SimdLevel::Scalar, mc::SimdLevel::Sse2, mc::SimdLevel::Avx2 }) {
+            if (static_cast<int>(level) > static_cast<int>(mc::DetectSimdLevel())) break;
+            const mc::EncodingKernels& kernels = mc::GetEncodingKernels(level);
+
+            mc::Utf8Decoded check;
+            const double checkMicros = best([&] { check = kernels.checkUtf8(encoded[0].data(), encoded[0].size()); });
+            if (check.invalid != 0) throw std::runtime_error("Верный UTF-8 отвергнут");
+
+            double decodeMicros[4];
+            for (int e = 0; e < 4; ++e) {
+                const std::string& in = encoded[e];
+                size_t written = 0;
+                decodeMicros[e] = best([&] {
+                    switch (encodings[e]) {
+                    case mc::TextEncoding::Utf8:
+                        written = kernels.utf8ToWide(in.data(), in.size(), wide.data(), wide.size()).written;
+                        break;
+                    case mc::TextEncoding::Cp1251:
+                        written = kernels.cp1251ToWide(in.data(), in.size(), wide.data());
+                        break;
+                    default:
+                        written = kernels.utf16ToWide(in.data(), in.size(), encodings[e] == mc::TextEncoding::Utf16Be, wide.data());
+                        break;
+                    }
+                });
+                const std::vector<wchar_t>& reference = expected(e);
+                if (written != reference.size() || !std::equal(reference.begin(), reference.end(), wide.begin())) {
+                    throw std::runtime_error(std::string("Перекодирование расходится с эталоном: ") + mc::EncodingName(encodings[e]));
+                }
+            }
+
+            size_t utf8Size = 0;
+            const double encodeMicros = best([&] { utf8Size = kernels.wideToUtf8(unicode.data(), unicode.size(), &utf8[0]); });
+            if (std::string_view(utf8.data(), utf8Size) != encoded[0]) throw std::runtime_error("UTF-8 расходится с эталоном");
+
+            const mc::Utf8Decoded junkCheck = kernels.checkUtf8(junk.data(), junk.size());
+            const mc::Utf8Decoded junkLevel = kernels.utf8ToWide(junk.data(), junk.size(), junkActual.data(), junkActual.size());
+            if (junkLevel.written != junkExpected.size() || junkLevel.invalid != junkDecoded.invalid ||
+                junkLevel.multibyte != junkDecoded.multibyte || junkCheck.invalid != junkDecoded.invalid ||
+                !std::equal(junkExpected.begin(), junkExpected.end(), junkActual.begin())) {
+                throw std::runtime_error("Неверный UTF-8 разобран не так, как посимвольно");
+            }
+
+            std::printf("%-7s %8.2f %8.2f %8.2f %8.2f %8.2f %8.2f\n", mc::SimdLevelName(level), gbps(encoded[0].size(), checkMicros),
+                gbps(encoded[0].size(), decodeMicros[0]), gbps(encoded[1].size(), decodeMicros[1]),
+                gbps(encoded[2].size(), decodeMicros[2]), gbps(encoded[3].size(), decodeMicros[3]),
+                gbps(unicode.size() * sizeof(wchar_t), encodeMicros));
+        }
+
+        // Доля перекодирования в загрузке словаря (чтение, разметка строк, индексы) и
+        // потоковое чтение CSV малыми блоками: пары и символы на границах блоков
+        const std::filesystem::path dir = base / "mcbench_encoding_bench";
+        std::filesystem::create_directories(dir);
+        for (int e = 0; e < 4; ++e) {
+            const std::filesystem::path path = dir / (std::string(mc::EncodingName(encodings[e])) + ".txt");
+            {
+                std::ofstream file(path, std::ios::binary);
+                file << encoded[e];
+            }
+            std::vector<wchar_t> decoded;
+            const double decodeMicros = best([&] {
+                decoded.clear();
+                if (mc::DecodeText(encoded[e], decoded) != encodings[e]) throw std::runtime_error("DecodeText: неверная кодировка");
+            });
+            if (decoded != expected(e)) throw std::runtime_error("DecodeText расходится с эталоном");
+            const double loadMicros = best([&] {
+                mc::LoadedDictionary dictionary;
+                dictionary.Load(path, false);
+                if (dictionary.items.Size() != lines) throw std::runtime_error("Словарь загружен не полностью");
+            });
+
+            std::string utf8Expected;
+            for (const char32_t cp : text) AppendReference(utf8Expected, e == 1 && !InCp1251(cp) ? U'?' : cp, mc::TextEncoding::Utf8);
+            std::string converted = encoded[e];
+            mc::ConvertToUtf8(converted);
+            if (converted != utf8Expected) throw std::runtime_error("ConvertToUtf8 расходится с эталоном");
+
+            std::FILE* in = std::fopen(path.string().c_str(), "rb");
+            if (!in) throw std::runtime_error("Ошибка открытия файла: " + path.string());
+            std::string joined;
+            try {
+                mc::CsvReader reader(in, '\t', 4096);
+                std::vector<std::string_view> fields;
+                while (reader.Next(fields)) {
+                    joined.append(fields[0]);
+                    joined += '\n';
+                }
+                if (reader.Encoding() != encodings[e]) throw std::runtime_error("CsvReader: неверная кодировка");
+            }
+            catch (...) {
+                std::fclose(in);
+                throw;
+            }
+            std::fclose(in);
+            if (joined != converted) throw std::runtime_error("CsvReader расходится с ConvertToUtf8");
+
+            std::printf("%-8s загрузка словаря %7.1f мс, из них перекодирование %6.2f мс (%.1f%%)\n",
+                mc::EncodingName(encodings[e]), loadMicros / 1000, decodeMicros / 1000, decodeMicros * 100 / loadMicros);
+        }
+        std::filesystem::remove_all(dir);
+        return 0;
+    }
+
+    // Прежний ReadFileToVector: getline, перекодирование каждой строки, push_back без reserve
+    std::vector<std::wstring> LegacyReadFileToVector(const std::string& filename) {
+        std::vector<std::wstring> items;
+        std::ifstream file(filename, std::ios::binary);
+        if (!file.is_open()) return items;
+
+        char bom[3] = { 0 };
+        file.read(bom, 3);
+        if (bom[0] != '\xEF' || bom[1] != '\xBB' || bom[2] != '\xBF') {
+            file.seekg(0);
+        }
+
+        std::string line;
+        while (std::getline(file, line)) {
+            if (!line.empty()) {
+                line.erase(std::remove(line.begin(), line.end(), '\r'), line.end());
+                std::wstring wline = mc::Utf8ToWide(line);
+                items.push_back(wline);
+            }
+        }
+        return items;
+    }
+
+    struct LoadStats {
+        double millis;
+        std::size_t allocations;
+        std::size_t peakBytes;
+        std::size_t keptBytes;
+        std::size_t lines;
+    };
+
+    template <class Load>
+    LoadStats MeasureLoad(Load load) {
+        const mc::AllocationScope memory;
+        const auto start = std::chrono::steady_clock::now();
+        auto result = load();
+        LoadStats stats{};
+        stats.millis = mc::ElapsedMicros(start) / 1000;
+        stats.allocations = memory.Allocations();
+        stats.peakBytes = memory.PeakBytes();
+        stats.keptBytes = memory.KeptBytes();
+        stats.lines = result.size();
+        return stats;
+    }
+
+    int RunDictBench(mc::Args& args) {
+        std::string path;
+        size_t lines = 1000000;
+        std::filesystem::path dir = std::filesystem::temp_directory_path();
+
+        std::string_view option;
+        while (args.Next(option)) {
+            if (option == "--file") path = args.Value(option);
+            else if (option == "--lines") lines = static_cast<size_t>(mc::ParseInt(args.Value(option), option));
+            else if (option == "--dir") dir = std::string(args.Value(option));
+            else throw std::runtime_error("Неизвестный параметр: " + std::string(option));
+        }
+
+        bool temporary = false;
+        if (path.empty()) {
+            // Похоже на fullname.txt: кириллица, BOM, CRLF
+            path = (dir / "mcbench_dict_bench.txt").string();
+            temporary = true;
+            std::ofstream file(path, std::ios::binary);
+            std::mt19937 rng(11);
+            std::uniform_int_distribution<int> length(4, 12);
+            std::uniform_int_distribution<int> letter(0, 31);
+            file << "\xEF\xBB\xBF";
+            for (size_t i = 0; i < lines; ++i) {
+                std::wstring item;
+                for (int word = 0; word < 3; ++word) {
+                    if (word) item += L' ';
+                    const int n = length(rng);
+                    item += static_cast<wchar_t>(0x410 + letter(rng));
+                    for (int c = 1; c < n; ++c) item += static_cast<wchar_t>(0x430 + letter(rng));
+                }
+                file << mc::WideToUtf8(item) << "\r\n";
+            }
+        }
+
+        const LoadStats legacy = MeasureLoad([&] { return LegacyReadFileToVector(path); });
+        const LoadStats pooled = MeasureLoad([&] {
+            mc::Dictionary dictionary;
+            dictionary.Load(path);
+            return dictionary.Views();
+        });
+        // Views() выше добавляет свой вектор; память самого словаря - отдельно
+        const mc::AllocationScope memory;
+        mc::Dictionary dictionary;
+        dictionary.Load(path);
+        const std::size_t dictionaryBytes = memory.KeptBytes();
+
+        if (temporary) std::remove(path.c_str());
+        // Прежний вариант оставлял пустые записи для строк из одного '\r'
+        std::printf("vector<wstring>  %8.1f мс, строк %8zu, выделений %9zu, пик %8.1f МБ, остается %8.1f МБ\n",
+            legacy.millis, legacy.lines, legacy.allocations, legacy.peakBytes / 1048576.0, legacy.keptBytes / 1048576.0);
+        std::printf("Dictionary       %8.1f мс, строк %8zu, выделений %9zu, пик %8.1f МБ, остается %8.1f МБ\n",
+            pooled.millis, pooled.lines, pooled.allocations, pooled.peakBytes / 1048576.0, dictionaryBytes / 1048576.0);
+        return 0;
+    }
+
+    void WriteDictionaryFile(const std::filesystem::path& path, size_t lines, std::mt19937& rng) {
+        std::ofstream file(path, std::ios::binary);
+        for (const auto& item : mc::MakeDictionary(lines, rng)) {
+            file << mc::WideToUtf8(item) << "\r\n";
+        }
+    }
+
+    int RunLoadBench(mc::Args& args) {
+        size_t files = mc::COLUMN_COUNT;
+        size_t lines = 500000;
+        unsigned threads = 0;
+        std::filesystem::path base = std::filesystem::temp_directory_path();
+
+        std::string_view option;
+        while (args.Next(option)) {
+            if (option == "--files") files = static_cast<size_t>(mc::ParseInt(args.Value(option), option));
+            else if (option == "--lines") lines = static_cast<size_t>(mc::ParseInt(args.Value(option), option));
+            else if (option == "--threads") threads = static_cast<unsigned>(mc::ParseInt(args.Value(option), option));
+            else if (option == "--dir") base = std::string(args.Value(option));
+            else throw std::runtime_error("Неизвестный параметр: " + std::string(option));
+        }
+        if (files == 0) throw std::runtime_error("Нет словарей");
+
+        // Словари разного размера: от lines строк до небольших справочников
+        const std::filesystem::path dir = base / "mcbench_load_bench";
+        std::filesystem::create_directories(dir);
+        std::vector<std::filesystem::path> paths;
+        std::mt19937 rng(5);
+        for (size_t i = 0; i < files; ++i) {
+            paths.push_back(dir / ("dict" + std::to_string(i) + ".txt"));
+            WriteDictionaryFile(paths.back(), std::max<size_t>(10, lines >> i), rng);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        double sequentialFirst = 0;
+        for (size_t i = 0; i < files; ++i) {
+            mc::LoadedDictionary dictionary;
+            dictionary.Load(paths[i], false);
+            if (i == 0) sequentialFirst = mc::ElapsedMicros(start) / 1000;
+        }
+        const double sequentialTotal = mc::ElapsedMicros(start) / 1000;
+
+        // Параллельно: время готовности каждого слота
+        std::vector<double> readyAt(files, 0);
+        std::mutex mutex;
+        start = std::chrono::steady_clock::now();
+        {
+            mc::DictionaryLoader loader;
+            loader.Start(paths, [&](size_t slot) {
+                std::lock_guard<std::mutex> lock(mutex);
+                readyAt[slot] = mc::ElapsedMicros(start) / 1000;
+            }, threads, false);
+            loader.Wait();
+        }
+        const double parallelTotal = mc::ElapsedMicros(start) / 1000;
+        const double parallelFirst = *std::min_element(readyAt.begin(), readyAt.end());
+
+        std::filesystem::remove_all(dir);
+
+        // По очереди первый доступный список - первый в comboBoxFiles, остальные ждут окна
+        std::printf("Словарей: %zu, строк в самом большом: %zu\n", files, lines);
+        std::printf("по очереди     первый готов %8.1f мс, окно после %8.1f мс\n", sequentialFirst, sequentialTotal);
+        std::printf("параллельно    первый готов %8.1f мс, все готовы %8.1f мс, окно сразу\n", parallelFirst, parallelTotal);
+        for (size_t i = 0; i < files; ++i) {
+            std::printf("  слот %2zu готов через %8.1f мс\n", i, readyAt[i]);
+        }
+        return 0;
+    }
+
+    // Выгрузка файла из страничного кэша ОС, чтобы измерить холодное открытие
+    bool EvictFromPageCache(const std::filesystem::path& path) {
+#ifdef _WIN32
+        (void)path;
+        return false;
+#else
+        const int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        fdatasync(fd);
+        const bool evicted = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+        close(fd);
+        return evicted;
+#endif
+    }
+
+    int RunCacheBench(mc::Args& args) {
+        std::string path;
+        size_t lines = 1000000;
+        int repeat = 3;
+        std::filesystem::path dir = std::filesystem::temp_directory_path();
+
+        std::string_view option;
+        while (args.Next(option)) {
+            if (option == "--file") path = args.Value(option);
+            else if (option == "--lines") lines = static_cast<size_t>(mc::ParseInt(args.Value(option), option));
+            else if (option == "--repeat") repeat = std::max(1, static_cast<int>(mc::ParseInt(args.Value(option), option)));
+            else if (option == "--dir") dir = std::string(args.Value(option));
+            else throw std::runtime_error("Неизвестный параметр: " + std::string(option));
+        }
+
+        bool temporary = false;
+        if (path.empty()) {
+            path = (dir / "mcbench_cache_bench.txt").string();
+            temporary = true;
+            std::mt19937 rng(13);
+            WriteDictionaryFile(path, lines, rng);
+        }
+        const std::filesystem::path cachePath = mc::CachePathFor(path);
+        std::filesystem::remove(cachePath);
+
+        double legacy = 1e300, parse = 1e300, cold = 1e300, warm = 1e300;
+        size_t items = 0;
+        bool evicted = true;
+        for (int pass = 0; pass < repeat; ++pass) {
+            auto start = std::chrono::steady_clock::now();
+            items = LegacyReadFileToVector(path).size();
+            legacy = std::min(legacy, mc::ElapsedMicros(start) / 1000);
+
+            // Полный разбор и индексация, как без кэша
+            start = std::chrono::steady_clock::now();
+            {
+                mc::LoadedDictionary dictionary;
+                dictionary.Load(path, false);
+            }
+            parse = std::min(parse, mc::ElapsedMicros(start) / 1000);
+
+            if (pass == 0) {
+                mc::LoadedDictionary dictionary;
+                dictionary.Load(path);
+            }
+
+            evicted = EvictFromPageCache(cachePath) && evicted;
+            start = std::chrono::steady_clock::now();
+            {
+                mc::LoadedDictionary dictionary;
+                dictionary.Load(path);
+                if (!dictionary.fromCache) throw std::runtime_error("Кэш не открылся: " + cachePath.string());
+            }
+            cold = std::min(cold, mc::ElapsedMicros(start) / 1000);
+
+            start = std::chrono::steady_clock::now();
+            {
+                mc::LoadedDictionary dictionary;
+                dictionary.Load(path);
+            }
+            warm = std::min(warm, mc::ElapsedMicros(start) / 1000);
+        }
+
+        // Первое обращение к страницам тоже входит во время: ищем по отображенному индексу
+        mc::LoadedDictionary dictionary;
+        dictionary.Load(path);
+        std::vector<mc::Match> matches;
+        const auto start = std::chrono::steady_clock::now();
+        dictionary.trigrams.Search(L"SON", mc::MatchMode::Substring, 200, matches);
+        const double firstSearch = mc::ElapsedMicros(start);
+
+        const std::uintmax_t cacheBytes = std::filesystem::file_size(cachePath);
+        if (temporary) std::filesystem::remove(path);
+        std::filesystem::remove(cachePath);
+
+        std::printf("Строк: %zu, размер .mcdict %.1f МБ\n", items, cacheBytes / 1048576.0);
+        std::printf("vector<wstring>            %8.2f мс\n", legacy);
+        std::printf("разбор + индексы           %8.2f мс\n", parse);
+        std::printf(".mcdict холодный%s %8.2f мс\n", evicted ? "          " : " (в кэше ОС)", cold);
+        std::printf(".mcdict теплый             %8.2f мс\n", warm);
+        std::printf("первый поиск по .mcdict    %8.1f мкс\n", firstSearch);
+        return 0;
+    }
+
+    // Прежний UpdateTextBox: склейка wstring и wstringstream ради нулей в суффиксе
+    std::wstring LegacyFormatRow(int currentId, std::wstring loginBase, int loginCounter,
+        const std::vector<std::wstring>& combos, const std::vector<std::wstring>& extras) {
+        const size_t underscorePos = loginBase.find_last_of(L'_');
+        if (underscorePos != std::wstring::npos &&
+            loginBase.length() - underscorePos == 3 &&
+            iswdigit(loginBase[underscorePos + 1]) &&
+            iswdigit(loginBase[underscorePos + 2])) {
+            loginBase = loginBase.substr(0, underscorePos);
+        }
+
+        std::wstringstream loginSuffix;
+        loginSuffix << L"_" << std::setw(2) << std::setfill(L'0') << loginCounter;
+        const std::wstring fullLogin = loginBase + loginSuffix.str();
+
+        std::wstring result = std::to_wstring(currentId) + L";" + fullLogin + L";";
+        for (size_t i = 0; i < combos.size(); ++i) {
+            result += combos[i];
+            if (i < combos.size() - 1 || !extras.empty()) {
+                result += L";";
+            }
+        }
+        for (size_t i = 0; i < extras.size(); ++i) {
+            result += extras[i];
+            if (i < extras.size() - 1) {
+                result += L";";
+            }
+        }
+        return result;
+    }
+
+    std::vector<std::wstring> LegacySplitString(const std::wstring& input, wchar_t delimiter) {
+        std::vector<std::wstring> result;
+        std::wstringstream ss(input);
+        std::wstring item;
+        while (std::getline(ss, item, delimiter)) {
+            result.push_back(item);
+        }
+        return result;
+    }
+
+    int RunRowBench(mc::Args& args) {
+        size_t rows = 1000000;
+
+        std::string_view option;
+        while (args.Next(option)) {
+            if (option == "--rows") rows = static_cast<size_t>(mc::ParseInt(args.Value(option), option));
+            else throw std::runtime_error("Неизвестный параметр: " + std::string(option));
+        }
+
+        std::vector<std::wstring> combos;
+        std::mt19937 rng(19);
+        for (const std::wstring& item : mc::MakeDictionary(mc::COLUMN_COUNT, rng)) combos.push_back(item);
+        const std::vector<std::wstring> extras = { L"note" };
+        const std::wstring login = L"desk_07";
+
+        mc::Row<wchar_t> row;
+        row.loginBase = mc::StripLoginSuffix<wchar_t>(login);
+        for (size_t i = 0; i < mc::COLUMN_COUNT; ++i) row.columns[i] = combos[i];
+        row.extras[0] = extras[0];
+        row.extraCount = extras.size();
+
+        // Обе реализации должны давать одинаковые записи
+        wchar_t buffer[4096];
+        for (long long id : { 1LL, 9LL, 10LL, 99LL, 100LL, 123456789LL }) {
+            row.id = id;
+            row.loginCounter = id;
+            const size_t length = mc::FormatRow(row, buffer, std::size(buffer));
+            if (std::wstring_view(buffer, length) != LegacyFormatRow(static_cast<int>(id), login, static_cast<int>(id), combos, extras)) {
+                throw std::runtime_error("Записи не совпадают для id " + std::to_string(id));
+            }
+        }
+
+        size_t checksum = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < rows; ++i) {
+            checksum += LegacyFormatRow(static_cast<int>(i + 1), login, static_cast<int>(i + 1), combos, extras).size();
+        }
+        const double legacyFormat = mc::ElapsedMicros(start);
+
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < rows; ++i) {
+            row.id = static_cast<long long>(i + 1);
+            row.loginCounter = row.id;
+            checksum += mc::FormatRow(row, buffer, std::size(buffer));
+        }
+        const double schemaFormat = mc::ElapsedMicros(start);
+
+        // Разбор: кольцо заранее собранных записей
+        std::vector<std::wstring> lines;
+        for (size_t i = 0; i < 1024; ++i) {
+            lines.push_back(LegacyFormatRow(static_cast<int>(i * 7919 + 1), login, static_cast<int>(i % 100), combos, extras));
+        }
+
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < rows; ++i) {
+            const std::vector<std::wstring> parts = LegacySplitString(lines[i % lines.size()], L';');
+            const std::wstring loginBase(mc::StripLoginSuffix<wchar_t>(parts[1]));
+            checksum += static_cast<size_t>(std::stoi(parts[0])) + loginBase.size() + parts.size();
+        }
+        const double legacyParse = mc::ElapsedMicros(start);
+
+        start = std::chrono::steady_clock::now();
+        mc::Row<wchar_t> parsed;
+        for (size_t i = 0; i < rows; ++i) {
+            mc::ParseRow<wchar_t>(lines[i % lines.size()], parsed);
+            checksum += static_cast<size_t>(parsed.id) + parsed.loginBase.size() + parsed.extraCount;
+        }
+        const double schemaParse = mc::ElapsedMicros(start);
+
+        const auto rate = [&](double micros) { return rows / (micros / 1e6) / 1e6; };
+        std::printf("Записей: %zu, длина записи %zu символов (контрольная сумма %zu)\n", rows, mc::RowLength(row), checksum);
+        std::printf("форматирование  прежнее %7.2f млн/с, по схеме %7.2f млн/с (x%.1f)\n",
+            rate(legacyFormat), rate(schemaFormat), legacyFormat / schemaFormat);
+        std::printf("разбор          прежний %7.2f млн/с, по схеме %7.2f млн/с (x%.1f)\n",
+            rate(legacyParse), rate(schemaParse), legacyParse / schemaParse);
+        return 0;
+    }
+
+    int RunRopeBench(mc::Args& args) {
+        size_t rows = 1000000;
+        size_t window = 1000;
+
+        std::string_view option;
+        while (args.Next(option)) {
+            if (option == "--rows") rows = static_cast<size_t>(mc::ParseInt(args.Value(option), option));
+            else if (option == "--window") window = static_cast<size_t>(mc::ParseInt(args.Value(option), option));
+            else throw std::runtime_error("Неизвестный параметр: " + std::string(option));
+        }
+
+        // Записи как в окне: "Добавить запись" с заполненными колонками
+        std::mt19937 rng(23);
+        const std::vector<std::wstring> combos = mc::MakeDictionary(mc::COLUMN_COUNT, rng);
+        mc::Row<wchar_t> row;
+        row.loginBase = L"desk";
+        for (size_t i = 0; i < mc::COLUMN_COUNT; ++i) row.columns[i] = combos[i];
+        wchar_t buffer[4096];
+        const auto makeRow = [&](size_t i) {
+            row.id = static_cast<long long>(i + 1);
+            row.loginCounter = row.id;
+            return std::wstring_view(buffer, mc::FormatRow(row, buffer, std::size(buffer)));
+        };
+
+        // Сначала одна непрерывная строка (так текст хранит поле EDIT), затем блочный буфер
+        struct AppendStats { double millis, worstMicros; std::size_t peakBytes; };
+        const auto measure = [&](auto&& append) {
+            const mc::AllocationScope memory;
+            AppendStats stats{ 0, 0, 0 };
+            const auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < rows; ++i) {
+                const std::wstring_view text = makeRow(i);
+                const auto rowStart = std::chrono::steady_clock::now();
+                append(i, text);
+                stats.worstMicros = std::max(stats.worstMicros, mc::ElapsedMicros(rowStart));
+            }
+            stats.millis = mc::ElapsedMicros(start) / 1000;
+            stats.peakBytes = memory.PeakBytes();
+            return stats;
+        };
+
+        AppendStats flat;
+        std::size_t flatSize = 0;
+        {
+            std::wstring text;
+            flat = measure([&](size_t i, std::wstring_view line) {
+                if (i) text += L"\r\n";
+                text += line;
+            });
+            flatSize = text.size();
+        }
+
+        mc::TextRope rope;
+        const AppendStats chunked = measure([&](size_t i, std::wstring_view line) {
+            if (i) rope.Append(L"\r\n");
+            rope.Append(line);
+        });
+
+        // Проверка содержимого: число строк, начала строк и текст выборочных строк
+        if (rope.Size() != flatSize || rope.LineCount() != rows) {
+            throw std::runtime_error("Размер буфера не совпадает");
+        }
+        std::uniform_int_distribution<size_t> pick(0, rows - 1);
+        for (int check = 0; check < 1000; ++check) {
+            const size_t line = pick(rng);
+            const size_t end = line + 1 < rows ? rope.LineStart(line + 1) - 2 : rope.Size();
+            if (rope.Substr(rope.LineStart(line), end - rope.LineStart(line)) != makeRow(line)) {
+                throw std::runtime_error("Строка " + std::to_string(line) + " не совпадает");
+            }
+        }
+
+        // Правка поля: хвост буфера отбрасывается и заменяется текстом поля
+        {
+            mc::TextRope edited;
+            edited.Append(rope.Substr(0, rope.Size()));
+            const size_t keep = rows / 2;
+            const size_t cut = keep == 0 ? 0 : edited.LineStart(keep) - 2;
+            edited.Truncate(cut);
+            if (edited.Size() != cut || edited.LineCount() != keep) throw std::runtime_error("Усечение буфера неверно");
+            if (keep) edited.Append(L"\r\n");
+            edited.Append(L"правка");
+            if (edited.LineCount() != keep + 1 || edited.Substr(edited.LineStart(keep), 6) != L"правка") {
+                throw std::runtime_error("Добавление после усечения неверно");
+            }
+        }
+
+        // Окно из последних строк (обновление поля) и выгрузка произвольного диапазона
+        auto start = std::chrono::steady_clock::now();
+        const size_t first = rows > window ? rows - window : 0;
+        const std::wstring tail = rope.Substr(rope.LineStart(first), rope.Size() - rope.LineStart(first));
+        const double windowMicros = mc::ElapsedMicros(start);
+
+        const size_t rangeLines = std::min<size_t>(rows, 100000);
+        const size_t rangeFirst = (rows - rangeLines) / 2;
+        const size_t rangeEnd = rangeFirst + rangeLines < rows ? rope.LineStart(rangeFirst + rangeLines) : rope.Size();
+        std::vector<wchar_t> exported(rangeEnd - rope.LineStart(rangeFirst));
+        start = std::chrono::steady_clock::now();
+        rope.Copy(rope.LineStart(rangeFirst), exported.size(), exported.data());
+        const double exportMicros = mc::ElapsedMicros(start);
+
+        std::printf("Записей: %zu, символов: %zu\n", rows, rope.Size());
+        std::printf("wstring     %8.1f мс, худшее добавление %9.1f мкс, пик %8.1f МБ\n",
+            flat.millis, flat.worstMicros, flat.peakBytes / 1048576.0);
+        std::printf("TextRope    %8.1f мс, худшее добавление %9.1f мкс, пик %8.1f МБ\n",
+            chunked.millis, chunked.worstMicros, chunked.peakBytes / 1048576.0);
+        std::printf("окно %zu строк: %.1f мкс (%zu символов); выгрузка %zu строк: %.1f мкс\n",
+            rows - first, windowMicros, tail.size(), rangeLines, exportMicros);
+        return 0;
+    }
+
+    std::uint64_t HashFile(const std::filesystem::path& path, std::size_t skip) {
+        std::string bytes;
+        mc::ReadWholeFile(path, bytes);
+        return mc::HashBytes(std::string_view(bytes).substr(std::min(skip, bytes.size())));
+    }
+
+    int RunWriteBench(mc::Args& args) {
+        std::uint64_t megabytes = 256;
+        size_t batch = 10000;
+        std::uint64_t syncMegabytes = 64;
+        std::filesystem::path dir = std::filesystem::temp_directory_path();
+
+        std::string_view option;
+        while (args.Next(option)) {
+            if (option == "--mb") megabytes = static_cast<std::uint64_t>(mc::ParseInt(args.Value(option), option));
+            else if (option == "--batch") batch = std::max<size_t>(1, static_cast<size_t>(mc::ParseInt(args.Value(option), option)));
+            else if (option == "--sync-mb") syncMegabytes = static_cast<std::uint64_t>(mc::ParseInt(args.Value(option), option));
+            else if (option == "--dir") dir = std::string(args.Value(option));
+            else throw std::runtime_error("Неизвестный параметр: " + std::string(option));
+        }
+
+        // Записи заранее в памяти, как в окне: пишутся по одной
+        mc::RowTemplate tmpl;
+        std::mt19937 rng(29);
+        for (const std::wstring& item : mc::MakeDictionary(mc::COLUMN_COUNT, rng)) tmpl.fields.push_back({ mc::WideToUtf8(item) });
+        std::string block;
+        mc::FormatRows(block, tmpl, 0, 65536, "\r\n");
+        std::vector<std::string_view> rows;
+        for (size_t start = 0; start < block.size();) {
+            const size_t end = block.find('\n', start) + 1;
+            rows.push_back(std::string_view(block).substr(start, end - start));
+            start = end;
+        }
+        const std::uint64_t target = megabytes << 20;
+
+        const auto run = [&](auto&& writeRow, auto&& endBatch) {
+            std::uint64_t written = 0;
+            for (size_t i = 0; written < target; ++i) {
+                const std::string_view row = rows[i % rows.size()];
+                writeRow(row);
+                written += row.size();
+                if ((i + 1) % batch == 0) endBatch();
+            }
+            return written;
+        };
+
+        const std::filesystem::path basePath = dir / "mcbench_write_bench_ofstream.txt";
+        auto start = std::chrono::steady_clock::now();
+        std::uint64_t total = 0;
+        {
+            std::ofstream out(basePath, std::ios::binary | std::ios::trunc);
+            total = run([&](std::string_view row) { out.write(row.data(), static_cast<std::streamsize>(row.size())); },
+                [&] { out.flush(); });
+            out.close();
+            if (!out) throw std::runtime_error("Ошибка записи в файл: " + basePath.string());
+        }
+        const double baseMillis = mc::ElapsedMicros(start) / 1000;
+        const std::uint64_t baseHash = HashFile(basePath, 0);
+        std::filesystem::remove(basePath);
+
+        std::printf("Объем: %.0f МБ, пакет %zu записей\n", total / 1048576.0, batch);
+        std::printf("%-13s %8.1f мс, %8.1f МБ/с  без fsync\n", "std::ofstream", baseMillis, total / 1048576.0 / (baseMillis / 1000));
+
+        struct Case { const char* name; mc::SyncPolicy sync; };
+        const Case cases[] = {
+            { "fsync при закрытии", mc::SyncPolicy::OnClose },
+            { "fsync после пакета", mc::SyncPolicy::EveryBatch },
+            { "fsync по объему", mc::SyncPolicy::EveryBytes },
+        };
+        for (const bool ring : { true, false }) {
+            for (const Case& item : cases) {
+                mc::WriterOptions options;
+                options.sync = item.sync;
+                options.syncBytes = syncMegabytes << 20;
+                options.truncate = true;
+                options.bom = true;
+                options.useIoUring = ring;
+
+                const std::filesystem::path path = dir / "mcbench_write_bench_writer.txt";
+                start = std::chrono::steady_clock::now();
+                std::string backend;
+                {
+                    mc::MigrationWriter writer(path, options);
+                    backend = writer.Backend();
+                    run([&](std::string_view row) { writer.Write(row); }, [&] { writer.EndBatch(); });
+                    writer.Close();
+                }
+                const double millis = mc::ElapsedMicros(start) / 1000;
+                if (HashFile(path, 3) != baseHash) throw std::runtime_error("Содержимое файла не совпадает: " + backend);
+                std::filesystem::remove(path);
+
+                std::printf("%-13s %8.1f мс, %8.1f МБ/с  %s\n", backend.c_str(), millis, total / 1048576.0 / (millis / 1000), item.name);
+            }
+            if (!ring) break;
+        }
+        return 0;
+    }
+
+    int RunResumeBench(mc::Args& args) {
+        std::uint64_t maxRows = 4000000;
+        std::filesystem::path dir = std::filesystem::temp_directory_path();
+
+        std::string_view option;
+        while (args.Next(option)) {
+            if (option == "--rows") maxRows = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(mc::ParseInt(args.Value(option), option)));
+            else if (option == "--dir") dir = std::string(args.Value(option));
+            else throw std::runtime_error("Неизвестный параметр: " + std::string(option));
+        }
+
+        mc::RowTemplate tmpl;
+        std::mt19937 rng(31);
+        for (const std::wstring& item : mc::MakeDictionary(mc::COLUMN_COUNT, rng)) tmpl.fields.push_back({ mc::WideToUtf8(item) });
+        const std::filesystem::path path = dir / "mcbench_resume_bench.txt";
+
+        std::printf("   записей        МБ     все строки          хвост\n");
+        for (std::uint64_t rows = std::min<std::uint64_t>(10000, maxRows);; rows = std::min(rows * 10, maxRows)) {
+            // Файл как из окна: BOM, записи через "\r\n" и пустая строка в конце
+            {
+                std::FILE* out = std::fopen(path.string().c_str(), "wb");
+                if (!out) throw std::runtime_error("Ошибка открытия файла: " + path.string());
+                mc::GenerateOptions options;
+                options.rowCount = rows;
+                std::fputs("\xEF\xBB\xBF", out);
+                mc::GenerateRows(out, tmpl, options);
+                std::fputs("\r\n", out);
+                if (std::fclose(out) != 0) throw std::runtime_error("Ошибка записи в файл: " + path.string());
+            }
+            const long long expectedId = tmpl.startId + static_cast<long long>(rows) - 1;
+
+            // Прежний путь: все строки в вектор, разбирается последняя
+            auto start = std::chrono::steady_clock::now();
+            std::vector<std::wstring> lines = LegacyReadFileToVector(path.string());
+            while (!lines.empty() && lines.back().empty()) lines.pop_back();
+            mc::Row<wchar_t> legacyRow;
+            if (lines.empty() || !mc::ParseRow(std::wstring_view(lines.back()), legacyRow)) {
+                throw std::runtime_error("Последняя запись не разобрана");
+            }
+            const double legacyMillis = mc::ElapsedMicros(start) / 1000;
+
+            start = std::chrono::steady_clock::now();
+            std::wstring wide;
+            mc::TextEncoding encoding;
+            if (!mc::ReadLastRecord(path, wide, encoding)) throw std::runtime_error("Ошибка чтения файла: " + path.string());
+            mc::Row<wchar_t> row;
+            if (!mc::ParseRow(std::wstring_view(wide), row)) throw std::runtime_error("Последняя запись не разобрана");
+            const double tailMillis = mc::ElapsedMicros(start) / 1000;
+
+            if (legacyRow.id != expectedId || row.id != expectedId || row.loginBase != legacyRow.loginBase ||
+                row.loginCounter != legacyRow.loginCounter) {
+                throw std::runtime_error("Записи не совпадают");
+            }
+            std::printf("%10llu %9.1f %11.2f мс %11.3f мс\n", static_cast<unsigned long long>(rows),
+                std::filesystem::file_size(path) / 1048576.0, legacyMillis, tailMillis);
+            if (rows == maxRows) break;
+        }
+
+        // Файлы в других кодировках: запись перекодируется, кодировка определяется по BOM или содержимому.
+        // Маленький блок проверяет рост хвоста и четное начало блока в UTF-16
+        const std::u32string records = U"1;ivanov_01;Иванов Пётр;Отдел кадров\r\n2;ёжикова_02;Ёжикова Анна;Бухгалтерия\r\n\r\n";
+        const std::u32string last = U"2;ёжикова_02;Ёжикова Анна;Бухгалтерия";
+        std::vector<wchar_t> expected;
+        for (const char32_t cp : last) PushWide(expected, cp);
+        const std::pair<const char*, mc::TextEncoding> variants[] = {
+            { "\xEF\xBB\xBF", mc::TextEncoding::Utf8 }, { "", mc::TextEncoding::Cp1251 },
+            { "\xFF\xFE", mc::TextEncoding::Utf16Le }, { "\xFE\xFF", mc::TextEncoding::Utf16Be }, { "", mc::TextEncoding::Utf16Le } };
+        for (const auto& [bom, encoding] : variants) {
+            std::string bytes = bom;
+            for (const char32_t cp : records) AppendReference(bytes, cp, encoding);
+            std::ofstream(path, std::ios::binary | std::ios::trunc).write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+            for (const std::size_t block : { std::size_t(5), std::size_t(64 * 1024) }) {
+                std::wstring record;
+                mc::TextEncoding detected;
+                if (!mc::ReadLastRecord(path, record, detected, block) || detected != encoding ||
+                    record != std::wstring(expected.begin(), expected.end())) {
+                    throw std::runtime_error(std::string("Последняя запись в ") + mc::EncodingName(encoding) + " прочитана неверно");
+                }
+            }
+        }
+        std::printf("последняя запись в UTF-8, CP1251, UTF-16LE/BE (с BOM и без): совпадает\n");
+        std::filesystem::remove(path);
+        return 0;
+    }
+
+    int RunValidateBench(mc::Args& args) {
+        std::uint64_t rows = 10000000;
+        size_t dictSize = 1000;
+        unsigned threadsMax = std::max(1u, std::thread::hardware_concurrency());
+        std::filesystem::path dir = std::filesystem::temp_directory_path();
+
+        std::string_view option;
+        while (args.Next(option)) {
+            if (option == "--rows") rows = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(mc::ParseInt(args.Value(option), option)));
+            else if (option == "--dict-size") dictSize = std::max<size_t>(1, static_cast<size_t>(mc::ParseInt(args.Value(option), option)));
+            else if (option == "--threads-max") threadsMax = std::max(1u, static_cast<unsigned>(mc::ParseInt(args.Value(option), option)));
+            else if (option == "--dir") dir = std::string(args.Value(option));
+            else throw std::runtime_error("Неизвестный параметр: " + std::string(option));
+        }
+
+        // Словари колонок и файл из их значений; в каждой BAD_EVERY-й записи одно значение не из словаря
+        constexpr std::uint64_t BAD_EVERY = 100000;
+        std::mt19937 rng(37);
+        mc::MigrationValidator validator;
+        std::vector<std::vector<std::string>> values(mc::COLUMN_COUNT);
+        for (size_t i = 0; i < mc::COLUMN_COUNT; ++i) {
+            for (const std::wstring& item : mc::MakeDictionary(dictSize, rng)) {
+                values[i].push_back(mc::WideToUtf8(item));
+                validator.Column(i).Insert(values[i].back());
+            }
+        }
+
+        const std::filesystem::path path = dir / "mcbench_validate_bench.txt";
+        std::vector<std::uint64_t> badLines;
+        {
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            if (!out.is_open()) throw std::runtime_error("Ошибка открытия файла: " + path.string());
+            out.write("\xEF\xBB\xBF", 3);
+            std::uniform_int_distribution<size_t> pick(0, dictSize - 1);
+            std::string block;
+            for (std::uint64_t row = 0; row < rows; ++row) {
+                const long long id = static_cast<long long>(row) + 1;
+                const size_t head = block.size();
+                block.resize(head + mc::RowHeadLength(id, std::string_view("user"), id));
+                mc::WriteRowHead(&block[head], id, std::string_view("user"), id);
+                for (size_t i = 0; i < mc::COLUMN_COUNT; ++i) {
+                    if (i) block += ';';
+                    if ((row + 1) % BAD_EVERY == 0 && i == row / BAD_EVERY % mc::COLUMN_COUNT) block += "Not In Dictionary";
+                    else block += values[i][pick(rng)];
+                }
+                block += "\r\n";
+                if ((row + 1) % BAD_EVERY == 0) badLines.push_back(row + 1);
+                if (block.size() >= (1 << 20)) {
+                    out.write(block.data(), static_cast<std::streamsize>(block.size()));
+                    block.clear();
+                }
+            }
+            out.write(block.data(), static_cast<std::streamsize>(block.size()));
+            if (!out.flush()) throw std::runtime_error("Ошибка записи в файл: " + path.string());
+        }
+
+        const mc::MappedFile file(path);
+        const double megabytes = file.Size() / 1048576.0;
+        std::printf("Записей: %llu, %.0f МБ, словари по %zu строк, ядер: %u\n", static_cast<unsigned long long>(rows),
+            megabytes, dictSize, std::max(1u, std::thread::hardware_concurrency()));
+
+        // Прежний подход: std::unordered_set в одном потоке
+        std::vector<std::unordered_set<std::string_view>> sets(mc::COLUMN_COUNT);
+        for (size_t i = 0; i < mc::COLUMN_COUNT; ++i) sets[i].insert(values[i].begin(), values[i].end());
+        auto start = std::chrono::steady_clock::now();
+        std::uint64_t baseErrors = 0;
+        {
+            mc::RecordReader reader(file.View());
+            mc::Record record;
+            while (reader.Next(record)) {
+                for (size_t i = 0; i < mc::COLUMN_COUNT; ++i) {
+                    const std::string_view value = record.Field(mc::FIRST_DICTIONARY_COLUMN + i);
+                    baseErrors += !value.empty() && sets[i].find(value) == sets[i].end();
+                }
+            }
+        }
+        const double baseMillis = mc::ElapsedMicros(start) / 1000;
+        if (baseErrors != badLines.size()) throw std::runtime_error("Число ошибок не совпадает: unordered_set");
+        std::printf("%-22s %9.1f мс %8.0f МБ/с\n", "unordered_set, 1 поток", baseMillis, megabytes / (baseMillis / 1000));
+
+        double oneThread = 0;
+        for (unsigned threads = 1;; threads = std::min(threads * 2, threadsMax)) {
+            mc::ValidationOptions options;
+            options.threads = threads;
+            options.maxErrors = badLines.size();
+            start = std::chrono::steady_clock::now();
+            const mc::ValidationResult result = validator.Validate(file.View(), options);
+            const double millis = mc::ElapsedMicros(start) / 1000;
+            if (threads == 1) oneThread = millis;
+
+            if (result.records != rows || result.errorCount != badLines.size()) {
+                throw std::runtime_error("Число записей или ошибок не совпадает");
+            }
+            for (size_t i = 0; i < badLines.size(); ++i) {
+                if (result.errors[i].line != badLines[i] || result.errors[i].kind != mc::ValidationErrorKind::UnknownValue) {
+                    throw std::runtime_error("Неверный номер строки ошибки");
+                }
+            }
+            std::printf("плоские множества, %2u %9.1f мс %8.0f МБ/с  x%.2f\n", threads, millis,
+                megabytes / (millis / 1000), oneThread / millis);
+            if (threads == threadsMax) break;
+        }
+        std::filesystem::remove(path);
+        return 0;
+    }
+
+    int RunDupBench(mc::Args& args) {
+        std::uint64_t rows = 20000000;
+        std::uint64_t dups = 1000;
+        size_t memoryMb = 64;
+        std::filesystem::path dir = std::filesystem::temp_directory_path();
+
+        std::string_view option;
+        while (args.Next(option)) {
+            if (option == "--rows") rows = static_cast<std::uint64_t>(mc::ParseInt(args.Value(option), option));
+            else if (option == "--dups") dups = static_cast<std::uint64_t>(mc::ParseInt(args.Value(option), option));
+            else if (option == "--memory-mb") memoryMb = static_cast<size_t>(mc::ParseInt(args.Value(option), option));
+            else if (option == "--dir") dir = std::string(args.Value(option));
+            else throw std::runtime_error("Неизвестный параметр: " + std::string(option));
+        }
+        const std::uint64_t step = dups ? rows / (dups + 1) : rows + 1;
+        if (step < 3) throw std::runtime_error("Слишком много повторов для такого числа записей");
+
+        // Записи с уникальными id и логинами; в каждой step-й записи id взят из предыдущей,
+        // а логин - из записи на две раньше
+        const std::filesystem::path path = dir / "mcbench_dup_bench.txt";
+        {
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            if (!out.is_open()) throw std::runtime_error("Ошибка открытия файла: " + path.string());
+            std::string block;
+            for (std::uint64_t row = 0; row < rows; ++row) {
+                const bool duplicate = row > 0 && row % step == 0 && row / step <= dups;
+                const long long id = static_cast<long long>(duplicate ? row : row + 1);
+                const long long login = static_cast<long long>(duplicate ? row - 1 : row + 1);
+                const size_t head = block.size();
+                block.resize(head + mc::RowHeadLength(id, std::string_view("user"), login));
+                mc::WriteRowHead(&block[head], id, std::string_view("user"), login);
+                block += "ACCOUNTANT;MSK\r\n";
+                if (block.size() >= (1 << 20)) {
+                    out.write(block.data(), static_cast<std::streamsize>(block.size()));
+                    block.clear();
+                }
+            }
+            out.write(block.data(), static_cast<std::streamsize>(block.size()));
+            if (!out.flush()) throw std::runtime_error("Ошибка записи в файл: " + path.string());
+        }
+
+        const mc::MappedFile file(path);
+        std::printf("Записей: %llu, %.0f МБ, повторов: %llu\n", static_cast<unsigned long long>(rows),
+            file.Size() / 1048576.0, static_cast<unsigned long long>(dups));
+
+        const auto check = [&](const std::vector<mc::DuplicateGroup>& groups, std::uint64_t distance) {
+            if (groups.size() != dups) return false;
+            for (size_t i = 0; i < groups.size(); ++i) {
+                const std::uint64_t line = (i + 1) * step + 1;
+                if (groups[i].lines.size() != 2 || groups[i].lines[0] != line - distance || groups[i].lines[1] != line) return false;
+            }
+            return true;
+        };
+
+        const std::pair<const char*, size_t> runs[] = {
+            { "в памяти", size_t(3) << 30 },
+            { "с выгрузкой", memoryMb << 20 },
+        };
+        for (const auto& [name, limit] : runs) {
+            mc::DuplicateOptions options;
+            options.memoryBytes = limit;
+            options.spillDir = dir;
+            const mc::AllocationScope memory;
+            const auto start = std::chrono::steady_clock::now();
+            const mc::DuplicateReport report = mc::FindDuplicates(file.View(), options);
+            const double seconds = mc::ElapsedMicros(start) / 1e6;
+            if (report.records != rows || !check(report.ids, 1) || !check(report.logins, 2)) {
+                throw std::runtime_error(std::string("Найдены не те повторы: ") + name);
+            }
+            std::printf("%7.2f с, пик памяти %7.1f МБ, на диск %7.1f МБ  %s\n", seconds,
+                memory.PeakBytes() / 1048576.0, report.spillBytes / 1048576.0, name);
+        }
+        std::filesystem::remove(path);
+        return 0;
+    }
+
+    // Новый файл - прежний, в котором каждая removeEvery-я запись удалена, каждая changeEvery-я
+    // получила другую должность, а после каждой addEvery-й вставлена запись с новым id (нечетным,
+    // поэтому оба файла упорядочены). Все способы сравнения должны найти ровно эти записи
+    int RunDiffBench(mc::Args& args) {
+        std::uint64_t rows = 5000000;
+        size_t memoryMb = 64;
+        std::filesystem::path dir = std::filesystem::temp_directory_path();
+
+        std::string_view option;
+        while (args.Next(option)) {
+            if (option == "--rows") rows = static_cast<std::uint64_t>(mc::ParseInt(args.Value(option), option));
+            else if (option == "--memory-mb") memoryMb = static_cast<size_t>(mc::ParseInt(args.Value(option), option));
+            else if (option == "--dir") dir = std::string(args.Value(option));
+            else throw std::runtime_error("Неизвестный параметр: " + std::string(option));
+        }
+
+        constexpr std::uint64_t removeEvery = 97, changeEvery = 89, addEvery = 101;
+        const auto writeRow = [](std::string& block, long long id, const char* position) {
+            const size_t head = block.size();
+            block.resize(head + mc::RowHeadLength(id, std::string_view("user"), id));
+            mc::WriteRowHead(&block[head], id, std::string_view("user"), id);
+            block += "ACCOUNTANT;HEAD;Ivanov Ivan;";
+            block += position;
+            block += ";IT;NO\r\n";
+        };
+        const std::filesystem::path oldPath = dir / "mcbench_diff_old.txt";
+        const std::filesystem::path newPath = dir / "mcbench_diff_new.txt";
+        std::uint64_t added = 0, removed = 0, changed = 0;
+        {
+            std::ofstream oldOut(oldPath, std::ios::binary | std::ios::trunc);
+            std::ofstream newOut(newPath, std::ios::binary | std::ios::trunc);
+            if (!oldOut.is_open() || !newOut.is_open()) throw std::runtime_error("Ошибка создания файлов в " + dir.string());
+            std::string oldBlock, newBlock;
+            for (std::uint64_t row = 1; row <= rows; ++row) {
+                const long long id = static_cast<long long>(row * 2);
+                writeRow(oldBlock, id, "ENGINEER");
+                if (row % removeEvery == 0) ++removed;
+                else if (row % changeEvery == 0) {
+                    writeRow(newBlock, id, "LEAD ENGINEER");
+                    ++changed;
+                }
+                else writeRow(newBlock, id, "ENGINEER");
+                if (row % addEvery == 0) {
+                    writeRow(newBlock, id + 1, "TRAINEE");
+                    ++added;
+                }
+                if (oldBlock.size() >= (1 << 20)) {
+                    oldOut.write(oldBlock.data(), static_cast<std::streamsize>(oldBlock.size()));
+                    newOut.write(newBlock.data(), static_cast<std::streamsize>(newBlock.size()));
+                    oldBlock.clear();
+                    newBlock.clear();
+                }
+            }
+            oldOut.write(oldBlock.data(), static_cast<std::streamsize>(oldBlock.size()));
+            newOut.write(newBlock.data(), static_cast<std::streamsize>(newBlock.size()));
+            if (!oldOut.flush() || !newOut.flush()) throw std::runtime_error("Ошибка записи файлов в " + dir.string());
+        }
+
+        const mc::MappedFile oldFile(oldPath);
+        const mc::MappedFile newFile(newPath);
+        const double megabytes = (oldFile.Size() + newFile.Size()) / 1048576.0;
+        std::printf("Записей: %llu, файлы %.0f МБ, добавлено %llu, удалено %llu, изменено %llu\n",
+            static_cast<unsigned long long>(rows), megabytes, static_cast<unsigned long long>(added),
+            static_cast<unsigned long long>(removed), static_cast<unsigned long long>(changed));
+
+        const std::uint64_t positionBit = std::uint64_t(1) << (mc::FIRST_DICTIONARY_COLUMN + mc::ColumnIndex("position"));
+        struct Run {
+            const char* name;
+            mc::DiffMethod method;
+            size_t memory;
+            mc::DiffMethod expected;
+        };
+        const Run runs[] = {
+            { "hash", mc::DiffMethod::Hash, size_t(3) << 30, mc::DiffMethod::Hash },
+            { "merge", mc::DiffMethod::Merge, 0, mc::DiffMethod::Merge },
+            { "auto с лимитом", mc::DiffMethod::Auto, memoryMb << 20, mc::DiffMethod::Merge },
+        };
+        std::uint64_t reference = 0;
+        for (const Run& run : runs) {
+            mc::DiffOptions options;
+            options.method = run.method;
+            options.memoryBytes = run.memory;
+            // Сумма хешей не зависит от порядка записей: способы сверяются между собой
+            std::uint64_t checksum = 0;
+            bool wrongField = false;
+            const mc::AllocationScope memory;
+            const auto start = std::chrono::steady_clock::now();
+            const mc::DiffStats stats = mc::DiffMigrations(oldFile.View(), newFile.View(), [&](const mc::DiffEntry& entry) {
+                checksum += mc::HashString(entry.id) * (static_cast<std::uint64_t>(entry.kind) + 1) + entry.oldLine * 31 + entry.newLine;
+                wrongField |= entry.kind == mc::DiffKind::Changed && entry.changedFields != positionBit;
+            }, options);
+            const double seconds = mc::ElapsedMicros(start) / 1e6;
+            if (stats.added != added || stats.removed != removed || stats.changed != changed || wrongField ||
+                stats.oldRecords != rows || stats.method != run.expected || (reference && checksum != reference)) {
+                throw std::runtime_error(std::string("Неверный результат сравнения: ") + run.name);
+            }
+            reference = checksum;
+            std::printf("%7.2f с, %7.1f МБ/с, пик памяти %7.1f МБ  %s\n", seconds, megabytes / seconds,
+                memory.PeakBytes() / 1048576.0, run.name);
+        }
+
+        // Неупорядоченный файл и повтор id: слияние отказывается, хеш-соединение сравнивает
+        const std::string sorted = "1;a_01;x\n2;b_01;x\n3;c_01;x\n";
+        const std::string shuffled = "2;b_01;x\n1;a_01;y\n3;c_01;x\n";
+        const std::string duplicate = "1;a_01;x\n1;a_02;x\n";
+        mc::DiffOptions merge;
+        merge.method = mc::DiffMethod::Merge;
+        const auto throws = [](const auto& run) {
+            try {
+                run();
+            }
+            catch (const std::runtime_error&) {
+                return true;
+            }
+            return false;
+        };
+        if (!throws([&] { mc::DiffMigrations(sorted, shuffled, nullptr, merge); }) ||
+            !throws([&] { mc::DiffMigrations(sorted, duplicate, nullptr); }) ||
+            mc::DiffMigrations(sorted, shuffled, nullptr).changed != 1) {
+            throw std::runtime_error("Неупорядоченный файл или повтор id обработан неверно");
+        }
+
+        // Повтор id большего файла, которого нет в меньшем: оба способа отказываются одинаково
+        const std::string small = "1;a_01;x\n";
+        const std::string repeated = "1;a_01;x\n5;e_01;x\n5;e_01;y\n7;g_01;x\n";
+        std::string messages[2];
+        for (const mc::DiffMethod method : { mc::DiffMethod::Hash, mc::DiffMethod::Merge }) {
+            mc::DiffOptions options;
+            options.method = method;
+            try {
+                mc::DiffMigrations(small, repeated, [](const mc::DiffEntry&) {}, options);
+            }
+            catch (const std::runtime_error& e) {
+                messages[method == mc::DiffMethod::Merge] = e.what();
+            }
+        }
+        if (messages[0].empty() || messages[0] != messages[1]) {
+            throw std::runtime_error("Повтор id в большем файле: hash \"" + messages[0] + "\", merge \"" + messages[1] + "\"");
+        }
+
+        std::filesystem::remove(oldPath);
+        std::filesystem::remove(newPath);
+        return 0;
+    }
+
+    // Файл в несколько раз больше лимита памяти: id - случайная перестановка 1..rows, роль - одна
+    // из восьми, последнее поле - номер записи в исходном файле. После сортировки по id идут
+    // подряд 1..rows; после сортировки по роли номера внутри одной роли возрастают (устойчивость).
+    // Сортировка по роли с fan-in 4 сливает серии в несколько проходов. Для сравнения - весь файл
+    // в памяти через std::stable_sort
+    int RunSortBench(mc::Args& args) {
+        std::uint64_t rows = 4000000;
+        size_t memoryMb = 32;
+        unsigned threads = 0;
+        std::filesystem::path dir = std::filesystem::temp_directory_path();
+
+        std::string_view option;
+        while (args.Next(option)) {
+            if (option == "--rows") rows = static_cast<std::uint64_t>(mc::ParseInt(args.Value(option), option));
+            else if (option == "--memory-mb") memoryMb = static_cast<size_t>(mc::ParseInt(args.Value(option), option));
+            else if (option == "--threads") threads = static_cast<unsigned>(mc::ParseInt(args.Value(option), option));
+            else if (option == "--dir") dir = std::string(args.Value(option));
+            else throw std::runtime_error("Неизвестный параметр: " + std::string(option));
+        }
+
+        static constexpr std::string_view roles[] = { "ACCOUNTANT", "ADMIN", "AUDITOR", "CLERK", "ENGINEER", "MANAGER", "OPERATOR", "TRAINEE" };
+        const std::filesystem::path inPath = dir / "mcbench_sort_in.txt";
+        const std::filesystem::path outPath = dir / "mcbench_sort_out.txt";
+        // Сумма хешей строк не зависит от порядка: результат - перестановка исходных записей
+        std::uint64_t checksum = 0;
+        {
+            std::vector<std::uint32_t> ids(rows);
+            for (std::uint64_t i = 0; i < rows; ++i) ids[i] = static_cast<std::uint32_t>(i + 1);
+            std::mt19937 rng(42);
+            std::shuffle(ids.begin(), ids.end(), rng);
+            std::ofstream out(inPath, std::ios::binary | std::ios::trunc);
+            if (!out.is_open()) throw std::runtime_error("Ошибка создания файла: " + inPath.string());
+            std::string block;
+            for (std::uint64_t row = 0; row < rows; ++row) {
+                const long long id = ids[row];
+                const size_t head = block.size();
+                block.resize(head + mc::RowHeadLength(id, std::string_view("user"), id));
+                mc::WriteRowHead(&block[head], id, std::string_view("user"), id);
+                block += roles[rng() % std::size(roles)];
+                block += ";HEAD;Ivanov Ivan;ENGINEER;IT;NO;";
+                block += std::to_string(row);
+                checksum += mc::HashString(std::string_view(block).substr(head));
+                block += "\r\n";
+                if (block.size() >= (1 << 20)) {
+                    out.write(block.data(), static_cast<std::streamsize>(block.size()));
+                    block.clear();
+                }
+            }
+            out.write(block.data(), static_cast<std::streamsize>(block.size()));
+            if (!out.flush()) throw std::runtime_error("Ошибка записи в файл: " + inPath.string());
+        }
+
+        const size_t roleColumn = mc::FIRST_DICTIONARY_COLUMN + mc::ColumnIndex("role");
+        const size_t seqColumn = mc::FIRST_DICTIONARY_COLUMN + 6;
+        const auto fieldNumber = [](std::string_view field) {
+            return static_cast<std::uint64_t>(std::strtoull(std::string(field).c_str(), nullptr, 10));
+        };
+        // Порядок результата; false - ключи не по возрастанию или нарушена устойчивость
+        const auto verify = [&](std::string_view sorted, size_t column) {
+            mc::RecordReader reader(sorted);
+            mc::Record record;
+            std::uint64_t count = 0, sum = 0, previousSeq = 0;
+            std::string previousKey;
+            while (reader.Next(record)) {
+                sum += mc::HashString(record.text);
+                const std::string_view key = record.Field(column);
+                const std::uint64_t seq = fieldNumber(record.Field(seqColumn));
+                if (column == 0 && fieldNumber(key) != count + 1) return false;
+                if (column != 0 && count > 0 && (key < previousKey || (key == previousKey && seq <= previousSeq))) return false;
+                previousKey.assign(key);
+                previousSeq = seq;
+                ++count;
+            }
+            return count == rows && sum == checksum;
+        };
+
+        const mc::MappedFile input(inPath);
+        const double megabytes = input.Size() / 1048576.0;
+        std::printf("Записей: %llu, файл %.0f МБ, лимит памяти %zu МБ\n", static_cast<unsigned long long>(rows), megabytes, memoryMb);
+        struct Run {
+            const char* name;
+            size_t column;
+            size_t fanIn;
+        };
+        const Run runs[] = {
+            { "по id", 0, 256 },
+            { "по роли, fan-in 4", roleColumn, 4 },
+        };
+        for (const Run& run : runs) {
+            mc::SortOptions options;
+            options.column = run.column;
+            options.memoryBytes = memoryMb << 20;
+            options.threads = threads;
+            options.maxFanIn = run.fanIn;
+            options.spillDir = dir;
+            const mc::AllocationScope memory;
+            const auto start = std::chrono::steady_clock::now();
+            const mc::SortStats stats = mc::SortMigration(input.View(), outPath, options);
+            const double seconds = mc::ElapsedMicros(start) / 1e6;
+            const double peak = memory.PeakBytes() / 1048576.0;
+            const mc::MappedFile output(outPath);
+            if (stats.records != rows || !verify(output.View(), run.column)) {
+                throw std::runtime_error(std::string("Неверный порядок после сортировки ") + run.name);
+            }
+            std::printf("%7.2f с, %7.1f МБ/с, пик памяти %7.1f МБ, серий %4zu, слияний %zu, на диск %6.0f МБ  %s\n",
+                seconds, megabytes / seconds, peak, stats.runs, stats.mergePasses, stats.spillBytes / 1048576.0, run.name);
+        }
+
+        {
+            const mc::AllocationScope memory;
+            const auto start = std::chrono::steady_clock::now();
+            std::vector<std::string_view> lines;
+            mc::RecordReader reader(input.View());
+            mc::Record record;
+            while (reader.Next(record)) lines.push_back(record.text);
+            std::stable_sort(lines.begin(), lines.end(), [](std::string_view a, std::string_view b) {
+                return mc::CompareIds(a.substr(0, a.find(';')), b.substr(0, b.find(';'))) < 0;
+            });
+            mc::WriterOptions writerOptions;
+            writerOptions.truncate = true;
+            mc::MigrationWriter out(outPath, writerOptions);
+            for (std::string_view line : lines) {
+                out.Write(line);
+                out.Write("\r\n");
+            }
+            out.Close();
+            const double seconds = mc::ElapsedMicros(start) / 1e6;
+            std::printf("%7.2f с, %7.1f МБ/с, пик памяти %7.1f МБ  весь файл в памяти, по id\n",
+                seconds, megabytes / seconds, memory.PeakBytes() / 1048576.0);
+        }
+
+        std::filesystem::remove(inPath);
+        std::filesystem::remove(outPath);
+        return 0;
+    }
+
+    // Файл с логинами с суффиксом и без, строками через '\n' и '\r\n', пустыми строками и BOM.
+    // Перенумерация кусками при разном числе потоков и размере кусков должна побайтно совпасть
+    // с RenumberRows по всему файлу одним проходом
+    int RunRenumberBench(mc::Args& args) {
+        std::uint64_t rows = 3000000;
+        unsigned threadsMax = std::max(1u, std::thread::hardware_concurrency());
+        std::filesystem::path dir = std::filesystem::temp_directory_path();
+
+        std::string_view option;
+        while (args.Next(option)) {
+            if (option == "--rows") rows = static_cast<std::uint64_t>(mc::ParseInt(args.Value(option), option));
+            else if (option == "--threads-max") threadsMax = static_cast<unsigned>(mc::ParseInt(args.Value(option), option));
+            else if (option == "--dir") dir = std::string(args.Value(option));
+            else throw std::runtime_error("Неизвестный параметр: " + std::string(option));
+        }
+
+        static constexpr std::string_view logins[] = { "ivanov_07", "petrov", "sidorova_1", "user_42", "a_b_99", "_13", "" };
+        const std::filesystem::path inPath = dir / "mcbench_renumber_in.txt";
+        const std::filesystem::path outPath = dir / "mcbench_renumber_out.txt";
+        {
+            std::ofstream out(inPath, std::ios::binary | std::ios::trunc);
+            if (!out.is_open()) throw std::runtime_error("Ошибка создания файла: " + inPath.string());
+            std::string block = "\xEF\xBB\xBF";
+            for (std::uint64_t row = 0; row < rows; ++row) {
+                block += std::to_string(row * 7 + 3);
+                block += ';';
+                block += logins[row % std::size(logins)];
+                if (row % 11 != 5) block += ";ACCOUNTANT;HEAD;Ivanov Ivan;ENGINEER;IT;NO";
+                block += row % 3 == 0 ? "\n" : "\r\n";
+                if (row % 1000 == 999) block += "\r\n";
+                if (block.size() >= (1 << 20)) {
+                    out.write(block.data(), static_cast<std::streamsize>(block.size()));
+                    block.clear();
+                }
+            }
+            out.write(block.data(), static_cast<std::streamsize>(block.size()));
+            if (!out.flush()) throw std::runtime_error("Ошибка записи в файл: " + inPath.string());
+        }
+
+        const mc::MappedFile input(inPath);
+        const double megabytes = input.Size() / 1048576.0;
+        constexpr long long startId = 100000, loginCounter = 5;
+        std::string reference;
+        auto start = std::chrono::steady_clock::now();
+        const std::uint64_t records = mc::RenumberRows(reference, input.View().substr(3), startId, loginCounter, "\r\n");
+        const double sequential = mc::ElapsedMicros(start) / 1e6;
+        const std::uint64_t expected = mc::HashBytes(reference);
+        std::printf("Записей: %llu, файл %.0f МБ\n", static_cast<unsigned long long>(records), megabytes);
+        std::printf("%7.2f с, %7.1f МБ/с  один проход в памяти\n", sequential, megabytes / sequential);
+        {
+            // Первая запись: новый id, логин без прежнего суффикса с новым
+            const std::string first = reference.substr(0, reference.find('\r'));
+            if (first != "100000;ivanov_05;ACCOUNTANT;HEAD;Ivanov Ivan;ENGINEER;IT;NO") {
+                throw std::runtime_error("Неверная перенумерация: " + first);
+            }
+        }
+        reference.clear();
+        reference.shrink_to_fit();
+
+        struct Run {
+            unsigned threads;
+            std::size_t chunkBytes;
+        };
+        std::vector<Run> runs;
+        for (unsigned threads = 1; threads <= threadsMax; threads *= 2) runs.push_back({ threads, std::size_t(4) << 20 });
+        if (threadsMax & (threadsMax - 1)) runs.push_back({ threadsMax, std::size_t(4) << 20 });
+        runs.push_back({ threadsMax, 1000 });
+        for (const Run& run : runs) {
+            mc::RenumberOptions options;
+            options.startId = startId;
+            options.loginCounter = loginCounter;
+            options.threads = run.threads;
+            options.chunkBytes = run.chunkBytes;
+            start = std::chrono::steady_clock::now();
+            const mc::RenumberStats stats = mc::RenumberMigration(input.View(), outPath, options);
+            const double seconds = mc::ElapsedMicros(start) / 1e6;
+            if (stats.records != records || HashFile(outPath, 3) != expected) {
+                throw std::runtime_error("Перенумерация кусками не совпала с последовательной");
+            }
+            std::printf("%7.2f с, %7.1f МБ/с, кусков %6zu, потоков: %u\n", seconds, megabytes / seconds, stats.chunks, run.threads);
+        }
+
+        std::filesystem::remove(inPath);
+        std::filesystem::remove(outPath);
+        return 0;
+    }
+
+    // Занятые логины - основы user0..userN с суффиксами, выбранными случайно из вдвое большего
+    // числа, чем в среднем логинов на основу: занято около 40% суффиксов, часть - трехзначные.
+    // LoginSet сравнивается с std::unordered_set<std::string> (загрузка, память, проверка занятых
+    // и свободных логинов), затем выдаются свободные логины по случайным основам. Все выданные
+    // должны быть свободны, не повторяться и разбираться обратно в основу и счетчик
+    int RunLoginBench(mc::Args& args) {
+        std::uint64_t existing = 5000000;
+        std::uint64_t count = 1000000;
+        size_t bases = 20000;
+
+        std::string_view option;
+        while (args.Next(option)) {
+            if (option == "--existing") existing = static_cast<std::uint64_t>(mc::ParseInt(args.Value(option), option));
+            else if (option == "--count") count = static_cast<std::uint64_t>(mc::ParseInt(args.Value(option), option));
+            else if (option == "--bases") bases = static_cast<size_t>(mc::ParseInt(args.Value(option), option));
+            else throw std::runtime_error("Неизвестный параметр: " + std::string(option));
+        }
+        if (bases == 0) throw std::runtime_error("Нужна хотя бы одна основа логина");
+
+        std::mt19937 rng(42);
+        std::vector<std::string> baseNames(bases);
+        for (size_t b = 0; b < bases; ++b) baseNames[b] = "user" + std::to_string(b);
+        const long long suffixRange = std::max<long long>(2, static_cast<long long>(existing / bases * 2));
+        const auto appendLogin = [](std::string& out, std::string_view base, long long counter) {
+            out += base;
+            out += '_';
+            const size_t start = out.size();
+            out.resize(start + mc::IntLength(counter, mc::LOGIN_SUFFIX_WIDTH));
+            mc::WriteInt(&out[start], counter, mc::LOGIN_SUFFIX_WIDTH);
+        };
+        // Запросы: занятые - каждый stride-й логин списка вразброс, свободные - с суффиксом за пределами списка
+        constexpr size_t queryCount = 500000;
+        const std::uint64_t stride = std::max<std::uint64_t>(1, existing / queryCount);
+        std::vector<std::string> takenQueries, freeQueries;
+        std::string list;
+        for (std::uint64_t i = 0; i < existing; ++i) {
+            const size_t start = list.size();
+            appendLogin(list, baseNames[rng() % bases], 1 + static_cast<long long>(rng() % suffixRange));
+            if (i % stride == 0 && takenQueries.size() < queryCount) takenQueries.push_back(list.substr(start));
+            list += '\n';
+        }
+        while (freeQueries.size() < queryCount) {
+            std::string login;
+            appendLogin(login, baseNames[rng() % bases], suffixRange + 1 + static_cast<long long>(rng() % 1000000));
+            freeQueries.push_back(login);
+        }
+        std::shuffle(takenQueries.begin(), takenQueries.end(), rng);
+        const auto lookupNanos = [&](const std::vector<std::string>& queries, const auto& contains, size_t& found) {
+            found = 0;
+            if (queries.empty()) return 0.0;
+            const auto start = std::chrono::steady_clock::now();
+            for (const std::string& login : queries) found += contains(login);
+            return mc::ElapsedMicros(start) * 1000 / queries.size();
+        };
+
+        auto start = std::chrono::steady_clock::now();
+        mc::LoginSet taken;
+        double setMemory;
+        {
+            const mc::AllocationScope memory;
+            taken.Assign(list);
+            setMemory = memory.KeptBytes() / 1048576.0;
+        }
+        const double setLoad = mc::ElapsedMicros(start) / 1e6;
+
+        start = std::chrono::steady_clock::now();
+        std::unordered_set<std::string> reference;
+        double referenceMemory;
+        {
+            const mc::AllocationScope memory;
+            for (std::string_view rest = list; !rest.empty();) {
+                const size_t end = rest.find('\n');
+                reference.emplace(rest.substr(0, end));
+                rest.remove_prefix(end + 1);
+            }
+            referenceMemory = memory.KeptBytes() / 1048576.0;
+        }
+        const double referenceLoad = mc::ElapsedMicros(start) / 1e6;
+        if (taken.Size() != reference.size()) throw std::runtime_error("LoginSet и unordered_set разошлись");
+
+        size_t takenFound = 0, freeFound = 0;
+        const auto setContains = [&](const std::string& login) { return taken.Contains(login); };
+        const double setTaken = lookupNanos(takenQueries, setContains, takenFound);
+        const double setFree = lookupNanos(freeQueries, setContains, freeFound);
+        if (takenFound != takenQueries.size() || freeFound != 0) throw std::runtime_error("LoginSet ошибся при проверке");
+        const auto referenceContains = [&](const std::string& login) { return reference.count(login) != 0; };
+        const double referenceTaken = lookupNanos(takenQueries, referenceContains, takenFound);
+        const double referenceFree = lookupNanos(freeQueries, referenceContains, freeFound);
+        if (takenFound != takenQueries.size() || freeFound != 0) throw std::runtime_error("unordered_set ошибся при проверке");
+        size_t falsePositives = 0;
+        for (const std::string& login : freeQueries) falsePositives += taken.Filter().MayContain(mc::HashString(login));
+
+        std::printf("Занятых логинов: %llu (разных %zu), основ %zu\n", static_cast<unsigned long long>(existing),
+            taken.Size(), bases);
+        std::printf("LoginSet       %6.2f с, %7.1f МБ, занятый %6.1f нс, свободный %6.1f нс  (загрузка, память, проверка)\n",
+            setLoad, setMemory, setTaken, setFree);
+        std::printf("unordered_set  %6.2f с, %7.1f МБ, занятый %6.1f нс, свободный %6.1f нс\n",
+            referenceLoad, referenceMemory, referenceTaken, referenceFree);
+        std::printf("Ложных срабатываний фильтра: %.2f%%\n", 100.0 * falsePositives / freeQueries.size());
+
+        // Выдача: логины копятся подряд, проверяются после замера
+        std::vector<long long> counters(bases, 1);
+        std::vector<std::uint32_t> owners(count);
+        std::vector<long long> issued(count);
+        std::string logins;
+        mc::LoginAllocator allocator(taken);
+        start = std::chrono::steady_clock::now();
+        for (std::uint64_t i = 0; i < count; ++i) {
+            const std::uint32_t b = static_cast<std::uint32_t>(rng() % bases);
+            owners[i] = b;
+            logins += allocator.Next(baseNames[b], counters[b]);
+            logins += '\n';
+            issued[i] = counters[b] - 1;
+        }
+        const double allocation = mc::ElapsedMicros(start) / 1e6;
+
+        std::uint64_t wide = 0, i = 0;
+        for (std::string_view rest = logins; !rest.empty(); ++i) {
+            const std::string_view login = rest.substr(0, rest.find('\n'));
+            rest.remove_prefix(login.size() + 1);
+            if (!reference.emplace(login).second || mc::StripLoginSuffix(login) != baseNames[owners[i]] ||
+                mc::LoginSuffixCounter(login) != issued[i]) {
+                throw std::runtime_error("Выдан занятый или неразбираемый логин: " + std::string(login));
+            }
+            wide += issued[i] > 99;
+        }
+        std::printf("Выдано %llu логинов за %.2f с (%.1f млн/с), пропущено занятых %llu, с суффиксом больше 99: %llu\n",
+            static_cast<unsigned long long>(count), allocation, count / allocation / 1e6,
+            static_cast<unsigned long long>(allocator.Skipped()), static_cast<unsigned long long>(wide));
+        return 0;
+    }
+
+    int RunProductBench(mc::Args& args) {
+        size_t columnCount = 4;
+        size_t valueCount = 32;
+        std::filesystem::path dir = std::filesystem::temp_directory_path();
+
+        std::string_view option;
+        while (args.Next(option)) {
+            if (option == "--columns") columnCount = std::min(mc::COLUMN_COUNT, static_cast<size_t>(mc::ParseInt(args.Value(option), option)));
+            else if (option == "--values") valueCount = std::max<size_t>(1, static_cast<size_t>(mc::ParseInt(args.Value(option), option)));
+            else if (option == "--dir") dir = std::string(args.Value(option));
+            else throw std::runtime_error("Неизвестный параметр: " + std::string(option));
+        }
+
+        // Первые columnCount колонок перебираются, остальные заданы одним значением
+        mc::RowTemplate tmpl;
+        std::mt19937 rng(41);
+        for (size_t i = 0; i < mc::COLUMN_COUNT; ++i) {
+            std::vector<std::string> values;
+            for (const std::wstring& item : mc::MakeDictionary(i < columnCount ? valueCount : 1, rng)) {
+                values.push_back(mc::WideToUtf8(item));
+            }
+            tmpl.fields.push_back(std::move(values));
+        }
+        const std::uint64_t rows = mc::CartesianProduct(tmpl.fields).Size();
+
+        const auto measure = [&](const char* name, const std::filesystem::path& path, auto&& generate) {
+            const mc::AllocationScope memory;
+            const auto start = std::chrono::steady_clock::now();
+            generate(path);
+            const double seconds = mc::ElapsedMicros(start) / 1e6;
+            std::printf("%7.2f с, пик памяти %8.1f МБ  %s\n", seconds, memory.PeakBytes() / 1048576.0, name);
+            const std::uint64_t hash = HashFile(path, 0);
+            std::filesystem::remove(path);
+            return hash;
+        };
+        std::printf("Сочетаний: %llu (колонок: %zu, значений в каждой: %zu)\n", static_cast<unsigned long long>(rows), columnCount, valueCount);
+
+        // Прежний подход: вложенными циклами строится вся матрица сочетаний, затем записи
+        const std::uint64_t eagerHash = measure("все сочетания в памяти", dir / "mcbench_product_eager.txt",
+            [&](const std::filesystem::path& path) {
+                std::vector<std::vector<std::string>> matrix(1);
+                for (const std::vector<std::string>& column : tmpl.fields) {
+                    std::vector<std::vector<std::string>> next;
+                    next.reserve(matrix.size() * column.size());
+                    for (const std::vector<std::string>& prefix : matrix) {
+                        for (const std::string& value : column) {
+                            next.push_back(prefix);
+                            next.back().push_back(value);
+                        }
+                    }
+                    matrix.swap(next);
+                }
+                std::string text;
+                for (size_t row = 0; row < matrix.size(); ++row) {
+                    const long long n = tmpl.startId + static_cast<long long>(row);
+                    const size_t head = text.size();
+                    text.resize(head + mc::RowHeadLength(n, std::string_view(tmpl.loginBase), n));
+                    mc::WriteRowHead(&text[head], n, std::string_view(tmpl.loginBase), n);
+                    for (size_t i = 0; i < matrix[row].size(); ++i) {
+                        if (i) text += ';';
+                        text += matrix[row][i];
+                    }
+                    text += "\r\n";
+                }
+                std::ofstream out(path, std::ios::binary | std::ios::trunc);
+                out.write(text.data(), static_cast<std::streamsize>(text.size()));
+                if (!out.flush()) throw std::runtime_error("Ошибка записи в файл: " + path.string());
+            });
+
+        const std::uint64_t lazyHash = measure("ленивый перебор по блокам", dir / "mcbench_product_lazy.txt",
+            [&](const std::filesystem::path& path) {
+                std::FILE* out = std::fopen(path.string().c_str(), "wb");
+                if (!out) throw std::runtime_error("Ошибка открытия файла: " + path.string());
+                try {
+                    mc::GenerateRows(out, tmpl, mc::GenerateOptions());
+                }
+                catch (...) {
+                    std::fclose(out);
+                    throw;
+                }
+                if (std::fclose(out) != 0) throw std::runtime_error("Ошибка записи в файл: " + path.string());
+            });
+
+        if (eagerHash != lazyHash) throw std::runtime_error("Содержимое файлов не совпадает");
+        return 0;
+    }
+
+    int RunJoinBench(mc::Args& args) {
+        std::uint64_t rows = 2000000;
+        std::filesystem::path dir = std::filesystem::temp_directory_path();
+
+        std::string_view option;
+        while (args.Next(option)) {
+            if (option == "--rows") rows = static_cast<std::uint64_t>(mc::ParseInt(args.Value(option), option));
+            else if (option == "--dir") dir = std::string(args.Value(option));
+            else throw std::runtime_error("Неизвестный параметр: " + std::string(option));
+        }
+
+        // Выгрузка HR: заголовок, часть ФИО в кавычках с запятой и кавычками внутри
+        const auto fullname = [](std::uint64_t i) {
+            return i % 10 == 0 ? "Petrov \"" + std::to_string(i) + "\", Petr" : "Ivanov" + std::to_string(i) + " Ivan";
+        };
+        const std::filesystem::path inPath = dir / "mcbench_join_bench.csv";
+        {
+            std::ofstream out(inPath, std::ios::binary | std::ios::trunc);
+            if (!out.is_open()) throw std::runtime_error("Ошибка открытия файла: " + inPath.string());
+            std::string block = "\xEF\xBB\xBFФИО,Табельный номер,Отдел\r\n";
+            for (std::uint64_t i = 0; i < rows; ++i) {
+                const std::string name = fullname(i);
+                if (name.find(',') != std::string::npos) {
+                    block += '"';
+                    for (const char ch : name) block.append(ch == '"' ? 2 : 1, ch);
+                    block += '"';
+                }
+                else {
+                    block += name;
+                }
+                block += ',' + std::to_string(100000 + i) + ",HR\r\n";
+                if (block.size() >= (1 << 20)) {
+                    out.write(block.data(), static_cast<std::streamsize>(block.size()));
+                    block.clear();
+                }
+            }
+            out.write(block.data(), static_cast<std::streamsize>(block.size()));
+            if (!out.flush()) throw std::runtime_error("Ошибка записи в файл: " + inPath.string());
+        }
+        const std::filesystem::path outPath = dir / "mcbench_join_bench.txt";
+        const double inMegabytes = std::filesystem::file_size(inPath) / 1048576.0;
+
+        // Предел скорости: те же блоки чтения и тот же писатель без разбора
+        auto start = std::chrono::steady_clock::now();
+        {
+            std::FILE* in = std::fopen(inPath.string().c_str(), "rb");
+            if (!in) throw std::runtime_error("Ошибка открытия файла: " + inPath.string());
+            mc::WriterOptions options;
+            options.truncate = true;
+            mc::MigrationWriter writer(outPath, options);
+            std::string buffer(1 << 20, '\0');
+            for (size_t read; (read = std::fread(&buffer[0], 1, buffer.size(), in)) > 0;) {
+                writer.Write(std::string_view(buffer.data(), read));
+            }
+            std::fclose(in);
+            writer.Close();
+        }
+        const double copySeconds = mc::ElapsedMicros(start) / 1e6;
+
+        mc::RowTemplate tmpl;
+        tmpl.fields.assign(mc::COLUMN_COUNT, {});
+        tmpl.fields[mc::ColumnIndex("role")] = { "ACCOUNTANT" };
+        tmpl.fields[mc::ColumnIndex("region")] = { "MOSCOW" };
+        std::vector<int> sources(mc::COLUMN_COUNT, -1);
+        sources[mc::ColumnIndex("fullname")] = 0;
+        sources[mc::ColumnIndex("personalNumber")] = 1;
+
+        const mc::AllocationScope memory;
+        start = std::chrono::steady_clock::now();
+        std::uint64_t count = 0;
+        std::uint64_t outBytes = 0;
+        {
+            std::FILE* in = std::fopen(inPath.string().c_str(), "rb");
+            if (!in) throw std::runtime_error("Ошибка открытия файла: " + inPath.string());
+            mc::WriterOptions options;
+            options.truncate = true;
+            mc::MigrationWriter writer(outPath, options);
+            mc::CsvReader reader(in);
+            std::vector<std::string_view> header;
+            reader.Next(header);
+            count = mc::JoinRows(reader, tmpl, sources, writer);
+            std::fclose(in);
+            writer.Close();
+            outBytes = writer.BytesWritten();
+        }
+        const double joinSeconds = mc::ElapsedMicros(start) / 1e6;
+        const double peak = memory.PeakBytes() / 1048576.0;
+
+        // Проверка: id подряд, ФИО и табельный номер на своих местах
+        {
+            const mc::MappedFile file(outPath);
+            mc::RecordReader reader(file.View());
+            mc::Record record;
+            std::uint64_t i = 0;
+            for (; reader.Next(record); ++i) {
+                if (record.Field(0) != std::to_string(i + 1) || record.Field(mc::FIRST_DICTIONARY_COLUMN + mc::ColumnIndex("fullname")) != fullname(i) ||
+                    record.Field(mc::FIRST_DICTIONARY_COLUMN + mc::ColumnIndex("personalNumber")) != std::to_string(100000 + i)) {
+                    throw std::runtime_error("Неверная запись " + std::to_string(i + 1));
+                }
+            }
+            if (i != rows || count != rows) throw std::runtime_error("Число записей не совпадает");
+        }
+        std::filesystem::remove(inPath);
+        std::filesystem::remove(outPath);
+
+        std::printf("Людей: %llu, выгрузка %.1f МБ, результат %.1f МБ\n", static_cast<unsigned long long>(rows),
+            inMegabytes, outBytes / 1048576.0);
+        std::printf("%7.2f с, чтение %7.1f МБ/с, запись %7.1f МБ/с  копирование выгрузки\n",
+            copySeconds, inMegabytes / copySeconds, inMegabytes / copySeconds);
+        std::printf("%7.2f с, чтение %7.1f МБ/с, запись %7.1f МБ/с  слияние (пик памяти %.1f МБ)\n",
+            joinSeconds, inMegabytes / joinSeconds, outBytes / 1048576.0 / joinSeconds, peak);
+        return 0;
+    }
+
+    // Набор в одном списке, как в окне: запросы уходят в FilterEngine, уведомления о готовности
+    // копятся в очереди (PostMessage), окно забирает результат через Take. Каждый отданный результат
+    // должен быть от последнего нажатия и совпадать с синхронным поиском по отдельной копии словаря
+    int RunFilterBench(mc::Args& args) {
+        size_t size = 1000000;
+        size_t words = 50;
+        int intervalMs = 0;
+        bool substring = false;
+
+        std::string_view option;
+        while (args.Next(option)) {
+            if (option == "--size") size = static_cast<size_t>(mc::ParseInt(args.Value(option), option));
+            else if (option == "--words") words = static_cast<size_t>(mc::ParseInt(args.Value(option), option));
+            else if (option == "--interval-ms") intervalMs = static_cast<int>(mc::ParseInt(args.Value(option), option));
+            else if (option == "--substring") substring = true;
+            else throw std::runtime_error("Неизвестный параметр: " + std::string(option));
+        }
+        if (size == 0) throw std::runtime_error("Пустой словарь");
+
+        std::mt19937 rng(42);
+        const std::vector<std::wstring> items = mc::MakeDictionary(size, rng);
+        std::string utf8;
+        for (const std::wstring& item : items) {
+            mc::AppendWideAsUtf8(item, utf8);
+            utf8 += '\n';
+        }
+        const auto load = [&] {
+            auto dictionary = std::make_shared<mc::LoadedDictionary>();
+            dictionary->items.Assign(utf8);
+            const std::vector<std::wstring_view> views = dictionary->items.Views();
+            dictionary->index.Build(views);
+            dictionary->trigrams.Build(views);
+            dictionary->opened = true;
+            return dictionary;
+        };
+        const mc::DictionarySnapshot dictionary = load();
+        const auto reference = load();
+
+        // Слова: начало строки (префикс) или кусок из середины (подстрока), в нижнем регистре
+        std::uniform_int_distribution<size_t> pick(0, size - 1);
+        std::vector<std::wstring> typed;
+        for (size_t w = 0; w < words; ++w) {
+            const std::wstring& item = items[pick(rng)];
+            std::wstring word = substring ? item.substr(std::min<size_t>(2, item.size() - 1), 5) : item.substr(0, 6);
+            for (wchar_t& ch : word) ch = static_cast<wchar_t>(towlower(ch));
+            typed.push_back(std::move(word));
+        }
+
+        std::mutex mailboxMutex;
+        std::condition_variable mailboxReady;
+        std::deque<size_t> mailbox;
+        mc::FilterEngine engine;
+        engine.Start(1, [&](size_t slot, std::uint64_t) {
+            {
+                std::lock_guard<std::mutex> lock(mailboxMutex);
+                mailbox.push_back(slot);
+            }
+            mailboxReady.notify_one();
+        });
+
+        struct Delivered {
+            std::wstring text;
+            std::vector<std::uint32_t> items;
+        };
+        std::vector<Delivered> delivered;
+        std::vector<double> submitMicros;
+        std::vector<double> finalLatency;
+        std::uint64_t latest = 0;
+        std::wstring latestText;
+        size_t keystrokes = 0;
+
+        // Разбор очереди уведомлений, как цикл сообщений окна: ждет до deadline, пока очередь пуста.
+        // true, если пришел результат последнего нажатия
+        const auto drain = [&](std::chrono::steady_clock::time_point deadline) {
+            std::unique_lock<std::mutex> lock(mailboxMutex);
+            mailboxReady.wait_until(lock, deadline, [&] { return !mailbox.empty(); });
+            std::deque<size_t> messages;
+            messages.swap(mailbox);
+            lock.unlock();
+
+            bool gotLatest = false;
+            for (const size_t slot : messages) {
+                mc::FilterResult result;
+                if (!engine.Take(slot, result)) continue;
+                if (result.generation != latest || result.text != latestText) {
+                    throw std::runtime_error("Отдан устаревший результат");
+                }
+                delivered.push_back({ result.text, std::move(result.items) });
+                gotLatest = true;
+            }
+            return gotLatest;
+        };
+
+        const auto typingStart = std::chrono::steady_clock::now();
+        for (const std::wstring& word : typed) {
+            std::chrono::steady_clock::time_point lastKey;
+            for (size_t len = 1; len <= word.size(); ++len) {
+                // Пауза между нажатиями - это время окна на разбор уведомлений
+                if (len > 1) {
+                    const auto next = lastKey + std::chrono::milliseconds(intervalMs);
+                    do drain(next); while (std::chrono::steady_clock::now() < next);
+                }
+                lastKey = std::chrono::steady_clock::now();
+                mc::FilterQuery query;
+                query.dictionary = dictionary;
+                query.text = word.substr(0, len);
+                query.substring = substring;
+                latestText = query.text;
+                latest = engine.Submit(std::move(query));
+                submitMicros.push_back(mc::ElapsedMicros(lastKey));
+                ++keystrokes;
+            }
+            // Слово набрано: результат последнего нажатия обязан прийти
+            const auto deadline = lastKey + std::chrono::seconds(30);
+            while (!drain(deadline)) {
+                if (std::chrono::steady_clock::now() >= deadline) throw std::runtime_error("Результат последнего нажатия не пришел");
+            }
+            finalLatency.push_back(mc::ElapsedMicros(lastKey));
+        }
+        const double typingSeconds = mc::ElapsedMicros(typingStart) / 1e6;
+        const mc::FilterStats stats = engine.Stats();
+        engine.Stop();
+
+        // Сверка с синхронным поиском; его время - сколько окно стояло бы на каждом нажатии
+        std::vector<double> syncMicros;
+        std::vector<std::uint32_t> expected;
+        std::vector<mc::Match> ranked;
+        mc::PrefixCursor cursor;
+        const auto search = [&](const std::wstring& text) {
+            expected.clear();
+            if (substring) {
+                reference->trigrams.Search(text, mc::MatchMode::Substring, 200, ranked);
+                if (ranked.empty()) reference->trigrams.Search(text, mc::MatchMode::Fuzzy, 200, ranked);
+                for (const mc::Match& match : ranked) expected.push_back(match.item);
+            }
+            else {
+                reference->index.CollectItems(cursor.Update(reference->index, text), expected);
+            }
+        };
+        for (const std::wstring& word : typed) {
+            for (size_t len = 1; len <= word.size(); ++len) {
+                const auto start = std::chrono::steady_clock::now();
+                search(word.substr(0, len));
+                syncMicros.push_back(mc::ElapsedMicros(start));
+            }
+        }
+        for (const Delivered& result : delivered) {
+            cursor.Reset();
+            search(result.text);
+            if (result.items != expected) throw std::runtime_error("Результат фильтра расходится с синхронным поиском");
+        }
+
+        const auto mean = [](const std::vector<double>& v) {
+            double sum = 0;
+            for (double x : v) sum += x;
+            return v.empty() ? 0.0 : sum / v.size();
+        };
+        const auto maxOf = [](const std::vector<double>& v) { return v.empty() ? 0.0 : *std::max_element(v.begin(), v.end()); };
+        std::printf("Словарь: %zu строк, слов: %zu, нажатий: %zu за %.2f с (%s)\n", size, words, keystrokes, typingSeconds,
+            substring ? "подстрока" : "префикс");
+        std::printf("Запросов: %llu, отдано: %llu, пропущено до начала: %llu, прервано: %llu, устарело к отдаче: %llu\n",
+            static_cast<unsigned long long>(stats.submitted), static_cast<unsigned long long>(stats.completed),
+            static_cast<unsigned long long>(stats.skipped), static_cast<unsigned long long>(stats.cancelled),
+            static_cast<unsigned long long>(stats.stale));
+        std::printf("Окно занято на нажатии: синхронно %.1f мкс в среднем (макс. %.1f), с FilterEngine %.1f мкс (макс. %.1f)\n",
+            mean(syncMicros), maxOf(syncMicros), mean(submitMicros), maxOf(submitMicros));
+        std::printf("От последнего нажатия слова до результата: %.1f мкс в среднем (макс. %.1f)\n",
+            mean(finalLatency), maxOf(finalLatency));
+        std::printf("Показано окном: %zu, отброшено при Take как устаревшие: %llu; все показанные совпали с синхронным поиском\n",
+            delivered.size(), static_cast<unsigned long long>(stats.completed - delivered.size()));
+        return 0;
+    }
+
+    // Длительность события i потока t в режиме trace: 1..100 мкс, восстанавливается по началу события
+    std::uint64_t TraceBenchDuration(std::uint64_t thread, std::uint64_t i) {
+        std::uint64_t x = (thread << 32 | i) * 0x9E3779B97F4A7C15ull;
+        x ^= x >> 29;
+        return 1000 + x % 99000;
+    }
+
+    // Проверяет события "bench.worker" одной выгрузки; возвращает их число
+    std::uint64_t CheckTraceJson(const std::string& json) {
+        std::uint64_t checked = 0;
+        for (size_t pos = 0; (pos = json.find("{\"name\":\"bench.worker\"", pos)) != std::string::npos;) {
+            const size_t ts = json.find("\"ts\":", pos);
+            const size_t dur = json.find("\"dur\":", pos);
+            if (ts == std::string::npos || dur == std::string::npos) throw std::runtime_error("Неполное событие трассы");
+            // Начало события: поток * 1e9 мкс + номер события
+            const auto start = static_cast<std::uint64_t>(std::strtod(json.c_str() + ts + 5, nullptr));
+            const auto micros = static_cast<std::uint64_t>(std::strtod(json.c_str() + dur + 6, nullptr) * 1000 + 0.5);
+            if (micros != TraceBenchDuration(start / 1000000000, start % 1000000000)) {
+                throw std::runtime_error("Событие трассы прочитано частично");
+            }
+            ++checked;
+            pos = dur;
+        }
+        return checked;
+    }
+
+    int RunTraceBench(mc::Args& args) {
+        unsigned threads = 4;
+        std::uint64_t events = 1000000;
+
+        std::string_view option;
+        while (args.Next(option)) {
+            if (option == "--threads") threads = static_cast<unsigned>(mc::ParseInt(args.Value(option), option));
+            else if (option == "--events") events = static_cast<std::uint64_t>(mc::ParseInt(args.Value(option), option));
+            else throw std::runtime_error("Неизвестный параметр: " + std::string(option));
+        }
+        if (threads == 0 || events == 0) throw std::runtime_error("Нужен хотя бы один поток и одно событие");
+
+        static const mc::TraceSpan scopeSpan("bench.scope");
+        static const mc::TraceSpan workerSpan("bench.worker");
+
+        // Цена участка в горячем пути: выключенная трассировка - одна проверка флага
+        constexpr int SCOPES = 10000000;
+        double scopeNanos[2] = {};
+        for (int enabled = 0; enabled < 2; ++enabled) {
+            mc::EnableTracing(enabled != 0);
+            const auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < SCOPES; ++i) {
+                mc::TraceScope trace(scopeSpan);
+            }
+            scopeNanos[enabled] = mc::ElapsedMicros(start) * 1000 / SCOPES;
+        }
+
+        // Потоки пишут события с известной длительностью, выгрузка в это время читает кольца
+        // Кольцо завершившегося потока достается следующему, поэтому потоки ждут друг друга
+        // после первого события: к выгрузке у каждого свое кольцо
+        std::atomic<unsigned> running{ threads };
+        std::atomic<unsigned> started{ 0 };
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                const std::uint64_t base = (t + std::uint64_t(1)) * 1000000000000ull;
+                for (std::uint64_t i = 0; i < events; ++i) {
+                    const std::uint64_t start = base + i * 1000;
+                    mc::RecordTraceEvent(workerSpan, start, start + TraceBenchDuration(t + 1, i));
+                    if (i == 0) {
+                        ++started;
+                        while (started < threads) std::this_thread::yield();
+                    }
+                }
+                --running;
+            });
+        }
+        std::uint64_t exports = 0;
+        std::uint64_t checked = 0;
+        double exportMicros = 0;
+        while (running > 0) {
+            const auto start = std::chrono::steady_clock::now();
+            const std::string json = mc::ChromeTraceJson();
+            exportMicros += mc::ElapsedMicros(start);
+            checked += CheckTraceJson(json);
+            ++exports;
+        }
+        const std::uint64_t last = CheckTraceJson(mc::ChromeTraceJson());
+        for (std::thread& worker : workers) worker.join();
+        mc::EnableTracing(false);
+        if (last != std::min<std::uint64_t>(events, mc::TRACE_RING_EVENTS) * threads) {
+            throw std::runtime_error("В выгрузке после остановки не все события колец: " + std::to_string(last));
+        }
+
+        // Перцентили по гистограмме против точных по всем длительностям
+        std::vector<std::uint64_t> durations;
+        durations.reserve(static_cast<size_t>(threads * events));
+        for (unsigned t = 0; t < threads; ++t) {
+            for (std::uint64_t i = 0; i < events; ++i) durations.push_back(TraceBenchDuration(t + 1, i));
+        }
+        std::sort(durations.begin(), durations.end());
+        const auto exact = [&](std::uint64_t per1000) {
+            const size_t rank = std::max<size_t>(1, (durations.size() * per1000 + 999) / 1000);
+            return durations[rank - 1] / 1000.0;
+        };
+        mc::TraceSpanStats stats;
+        for (const mc::TraceSpanStats& s : mc::TraceSummary()) {
+            if (s.name == "bench.worker") stats = s;
+        }
+        if (stats.count != durations.size()) {
+            throw std::runtime_error("В гистограмме " + std::to_string(stats.count) + " событий вместо " +
+                std::to_string(durations.size()));
+        }
+        const double p50 = exact(500), p99 = exact(990);
+        if (std::abs(stats.p50Micros - p50) > p50 / 16 || std::abs(stats.p99Micros - p99) > p99 / 16 ||
+            stats.maxMicros != durations.back() / 1000.0) {
+            throw std::runtime_error("Перцентили гистограммы расходятся с точными");
+        }
+
+        std::printf("Участок: %.1f нс выключен, %.1f нс включен\n", scopeNanos[0], scopeNanos[1]);
+        std::printf("Потоков: %u, событий: %llu, выгрузок во время записи: %llu (%.1f мс в среднем), проверено событий: %llu\n",
+            threads, static_cast<unsigned long long>(threads * events), static_cast<unsigned long long>(exports),
+            exports ? exportMicros / exports / 1000 : 0.0, static_cast<unsigned long long>(checked));
+        std::printf("p50 %.2f мкс (точно %.2f), p99 %.2f мкс (точно %.2f), макс. %.2f мкс\n",
+            stats.p50Micros, p50, stats.p99Micros, p99, stats.maxMicros);
+        return 0;
+    }
+
+    // Сохранение как в редакторе: временный файл и переименование
+    void ReplaceFile(const std::filesystem::path& path, const std::string& bytes) {
+        std::filesystem::path temp = path;
+        temp += ".new";
+        {
+            std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+            file << bytes;
+        }
+        std::filesystem::rename(temp, path);
+    }
+
+    int RunReloadBench(mc::Args& args) {
+        size_t files = 4;
+        size_t lines = 200000;
+        int edits = 5;
+        int quiet = 50;
+        std::filesystem::path base = std::filesystem::temp_directory_path();
+
+        std::string_view option;
+        while (args.Next(option)) {
+            if (option == "--files") files = static_cast<size_t>(mc::ParseInt(args.Value(option), option));
+            else if (option == "--lines") lines = static_cast<size_t>(mc::ParseInt(args.Value(option), option));
+            else if (option == "--edits") edits = static_cast<int>(mc::ParseInt(args.Value(option), option));
+            else if (option == "--quiet") quiet = static_cast<int>(mc::ParseInt(args.Value(option), option));
+            else if (option == "--dir") base = std::string(args.Value(option));
+            else throw std::runtime_error("Неизвестный параметр: " + std::string(option));
+        }
+        if (files == 0) throw std::runtime_error("Нет словарей");
+
+        const std::filesystem::path dir = base / "mcbench_reload_bench";
+        std::filesystem::remove_all(dir);
+        std::filesystem::create_directories(dir);
+        std::vector<std::filesystem::path> paths;
+        std::mt19937 rng(17);
+        for (size_t i = 0; i < files; ++i) {
+            paths.push_back(dir / ("dict" + std::to_string(i) + ".txt"));
+            WriteDictionaryFile(paths.back(), lines, rng);
+        }
+
+        mc::DictionaryStore store(files);
+        for (size_t i = 0; i < files; ++i) {
+            auto loaded = std::make_shared<mc::LoadedDictionary>();
+            loaded->Load(paths[i]);
+            store.PublishInitial(i, std::move(loaded));
+        }
+
+        std::mutex mutex;
+        std::condition_variable reloaded;
+        std::vector<size_t> reloads(files, 0);
+        size_t lastAdded = 0;
+        size_t lastRemoved = 0;
+        std::chrono::steady_clock::time_point reloadedAt;
+
+        mc::DictionaryReloader reloader(store);
+        reloader.Start(paths, [&](size_t slot, const mc::DictionaryDiff& diff) {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++reloads[slot];
+            lastAdded = diff.added.size();
+            lastRemoved = diff.removed.size();
+            reloadedAt = std::chrono::steady_clock::now();
+            reloaded.notify_all();
+        }, std::chrono::milliseconds(quiet));
+
+        // Поиск по всем словарям без остановки, пока идут правки
+        std::atomic<bool> done{ false };
+        size_t queries = 0;
+        double slowest = 0;
+        double total = 0;
+        std::thread reader([&] {
+            const std::wstring prefixes[] = { L"S", L"SM", L"JO", L"A", L"MA" };
+            while (!done) {
+                for (size_t slot = 0; slot < files; ++slot) {
+                    const auto start = std::chrono::steady_clock::now();
+                    const mc::DictionarySnapshot snapshot = store.Snapshot(slot);
+                    snapshot->index.Find(prefixes[queries % 5]);
+                    const double micros = mc::ElapsedMicros(start);
+                    slowest = std::max(slowest, micros);
+                    total += micros;
+                    ++queries;
+                }
+            }
+        });
+
+        // Правится только первый словарь: остальные не должны перечитываться
+        std::string bytes;
+        mc::ReadWholeFile(paths[0], bytes);
+        std::vector<double> latencies;
+        for (int edit = 0; edit < edits; ++edit) {
+            bytes += "Added" + std::to_string(edit) + " Person\r\n";
+            std::unique_lock<std::mutex> lock(mutex);
+            const size_t before = reloads[0];
+            lock.unlock();
+
+            const auto start = std::chrono::steady_clock::now();
+            ReplaceFile(paths[0], bytes);
+
+            lock.lock();
+            if (!reloaded.wait_for(lock, std::chrono::seconds(10), [&] { return reloads[0] > before; })) {
+                throw std::runtime_error("Словарь не перечитан после правки");
+            }
+            latencies.push_back(std::chrono::duration<double, std::milli>(reloadedAt - start).count());
+        }
+
+        // Перестановка строк без изменения состава: новый снимок с пустой разницей
+        const std::string lastLine = "Added" + std::to_string(edits - 1) + " Person\r\n";
+        bool reorderPublished = edits == 0;
+        if (edits > 0) {
+            bytes = lastLine + bytes.substr(0, bytes.size() - lastLine.size());
+            std::unique_lock<std::mutex> lock(mutex);
+            const size_t before = reloads[0];
+            lock.unlock();
+            ReplaceFile(paths[0], bytes);
+            lock.lock();
+            if (!reloaded.wait_for(lock, std::chrono::seconds(10), [&] { return reloads[0] > before; })) {
+                throw std::runtime_error("Перестановка строк не опубликована");
+            }
+            reorderPublished = lastAdded == 0 && lastRemoved == 0 &&
+                store.Snapshot(0)->items[0] == mc::Utf8ToWide(lastLine.substr(0, lastLine.size() - 2));
+            if (!reorderPublished) throw std::runtime_error("Снимок после перестановки строк неверен");
+        }
+
+        // Сохранение без изменений: файл перечитывается, но новый снимок не публикуется
+        const size_t readsBefore = reloader.ReadCount();
+        ReplaceFile(paths[0], bytes);
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (reloader.ReadCount() == readsBefore && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(quiet));
+
+        done = true;
+        reader.join();
+        reloader.Stop();
+        const size_t finalSize = store.Snapshot(0)->items.Size();
+        std::filesystem::remove_all(dir);
+
+        size_t otherReloads = 0;
+        for (size_t i = 1; i < files; ++i) otherReloads += reloads[i];
+        double average = 0;
+        for (double latency : latencies) average += latency;
+        average /= std::max<size_t>(1, latencies.size());
+
+        std::printf("Словарей: %zu по %zu строк, правок: %d, пауза %d мс\n", files, lines, edits, quiet);
+        std::printf("правка -> новый снимок  среднее %8.1f мс, макс %8.1f мс (включая паузу)\n",
+            average, latencies.empty() ? 0.0 : *std::max_element(latencies.begin(), latencies.end()));
+        std::printf("строк в словаре %zu; перестановка строк: %s\n", finalSize,
+            reorderPublished ? "снимок заменен, разница пуста" : "не проверялась");
+        const size_t expected = static_cast<size_t>(edits) + (edits > 0 ? 1 : 0);
+        std::printf("снимков: правленый %zu, остальные %zu; сохранение без изменений: %s\n", reloads[0], otherReloads,
+            reloads[0] == expected ? "снимок не заменен" : "снимок заменен");
+        std::printf("поиск во время правок: %zu запросов, среднее %.2f мкс, макс %.1f мкс\n",
+            queries, total / std::max<size_t>(1, queries), slowest);
+        return 0;
+    }
+
+    constexpr mc::BenchMode modes[] = {
+        { "parse", RunParseBench },
+        { "prefix", RunPrefixBench },
+        { "trigram", RunTrigramBench },
+        { "dict", RunDictBench },
+        { "load", RunLoadBench },
+        { "cache", RunCacheBench },
+        { "row", RunRowBench },
+        { "rope", RunRopeBench },
+        { "write", RunWriteBench },
+        { "resume", RunResumeBench },
+        { "validate", RunValidateBench },
+        { "dup", RunDupBench },
+        { "diff", RunDiffBench },
+        { "sort", RunSortBench },
+        { "renumber", RunRenumberBench },
+        { "login", RunLoginBench },
+        { "product", RunProductBench },
+        { "join", RunJoinBench },
+        { "filter", RunFilterBench },
+        { "trace", RunTraceBench },
+        { "fold", RunFoldBench },
+        { "encoding", RunEncodingBench },
+        { "reload", RunReloadBench },
+    };
+}
+
+namespace mc {
+    std::vector<std::wstring> MakeDictionary(std::size_t size, std::mt19937& rng) {
+        std::uniform_int_distribution<int> length(4, 12);
+        std::uniform_int_distribution<int> letter(0, 25);
+        std::vector<std::wstring> items;
+        items.reserve(size);
+        for (std::size_t i = 0; i < size; ++i) {
+            std::wstring item;
+            for (int word = 0; word < 2; ++word) {
+                if (word) item += L' ';
+                const int n = length(rng);
+                item += static_cast<wchar_t>(L'A' + letter(rng));
+                for (int c = 1; c < n; ++c) item += static_cast<wchar_t>(L'a' + letter(rng));
+            }
+            items.push_back(std::move(item));
+        }
+        return items;
+    }
+
+    const BenchMode* FindBenchMode(std::string_view name) {
+        for (const BenchMode& mode : modes) {
+            if (name == mode.name) return &mode;
+        }
+        return nullptr;
+    }
+
+    void PrintBenchModes() {
+        std::fprintf(stderr,
+            "Режимы (mcbench <режим> [параметры]):\n"
+            "\n"
+            "parse FILE - разбор файла миграции через mmap, скорость в ГБ/с\n"
+            "  --simd all|scalar|sse2|avx2   вариант поиска разделителей (по умолчанию all)\n"
+            "  --repeat N            число проходов, берется лучший (по умолчанию 3)\n"
+            "\n"
+            "prefix - фильтр выпадающего списка: перебор против индекса префиксов\n"
+            "  --size N              размер словаря (по умолчанию 1000000)\n"
+            "  --queries N           число набираемых слов (по умолчанию 200)\n"
+            "\n"
+            "trigram - поиск по подстроке и нечеткий поиск по индексу триграмм\n"
+            "  --size N              размер словаря (по умолчанию 1000000)\n"
+            "  --queries N           число запросов (по умолчанию 1000)\n"
+            "  --top N               сколько лучших совпадений возвращать (по умолчанию 200)\n"
+            "\n"
+            "dict - загрузка словаря: прежний vector<wstring> против единого буфера строк\n"
+            "  --file FILE           словарь (по умолчанию создается временный)\n"
+            "  --lines N             строк во временном словаре (по умолчанию 1000000)\n"
+            "  --dir DIR             каталог для временного словаря (по умолчанию временный)\n"
+            "\n"
+            "load - загрузка набора словарей: по очереди против параллельной\n"
+            "  --files N             число словарей (по умолчанию 14, как comboBoxFiles)\n"
+            "  --lines N             строк в самом большом словаре (по умолчанию 500000)\n"
+            "  --threads N           потоков загрузки (по умолчанию по числу ядер)\n"
+            "  --dir DIR             каталог для словарей (по умолчанию временный)\n"
+            "\n"
+            "cache - открытие словаря: разбор .txt против отображения .mcdict\n"
+            "  --file FILE           словарь (по умолчанию создается временный)\n"
+            "  --lines N             строк во временном словаре (по умолчанию 1000000)\n"
+            "  --repeat N            число проходов, берется лучший (по умолчанию 3)\n"
+            "  --dir DIR             каталог для временного словаря и его .mcdict (по умолчанию временный)\n"
+            "\n"
+            "row - форматирование и разбор записи: прежний код против схемы колонок\n"
+            "  --rows N              число записей (по умолчанию 1000000)\n"
+            "\n"
+            "rope - накопление записей окна: одна строка wstring против блочного буфера\n"
+            "  --rows N              число записей (по умолчанию 1000000)\n"
+            "  --window N            строк в видимом окне (по умолчанию 1000)\n"
+            "\n"
+            "write - запись файла миграции: std::ofstream против MigrationWriter\n"
+            "  --mb N                объем в МБ (по умолчанию 256)\n"
+            "  --batch N             записей в пакете (по умолчанию 10000)\n"
+            "  --sync-mb N           для политики по объему (по умолчанию 64)\n"
+            "  --dir DIR             каталог для файлов (по умолчанию временный)\n"
+            "\n"
+            "resume - продолжение файла миграции: чтение всех строк против чтения хвоста\n"
+            "  --rows N              записей в самом большом файле (по умолчанию 4000000)\n"
+            "  --dir DIR             каталог для файлов (по умолчанию временный)\n"
+            "\n"
+            "validate - проверка файла миграции: std::unordered_set против плоских множеств\n"
+            "  и масштабирование по потокам\n"
+            "  --rows N              записей в файле (по умолчанию 10000000)\n"
+            "  --dict-size N         строк в каждом словаре (по умолчанию 1000)\n"
+            "  --threads-max N       до скольких потоков проверять (по умолчанию по числу ядер)\n"
+            "  --dir DIR             каталог для файла (по умолчанию временный)\n"
+            "\n"
+            "dup - поиск повторов в памяти и с выгрузкой разделов на диск\n"
+            "  --rows N              записей в файле (по умолчанию 20000000)\n"
+            "  --dups N              вставленных повторов id и логинов (по умолчанию 1000)\n"
+            "  --memory-mb N         лимит для прогона с выгрузкой (по умолчанию 64)\n"
+            "  --dir DIR             каталог для файла и разделов (по умолчанию временный)\n"
+            "\n"
+            "diff - сравнение файлов миграции хеш-соединением и слиянием\n"
+            "  --rows N              записей в прежнем файле (по умолчанию 5000000)\n"
+            "  --memory-mb N         лимит для прогона auto, при котором выбирается слияние (по умолчанию 64)\n"
+            "  --dir DIR             каталог для файлов (по умолчанию временный)\n"
+            "\n"
+            "sort - внешняя сортировка файла в несколько раз больше лимита памяти\n"
+            "  --rows N              записей в файле (по умолчанию 4000000)\n"
+            "  --memory-mb N         лимит памяти (по умолчанию 32)\n"
+            "  --threads N           потоков (по умолчанию по числу ядер)\n"
+            "  --dir DIR             каталог для файлов и серий (по умолчанию временный)\n"
+            "\n"
+            "renumber - перенумерация кусками в несколько потоков против одного прохода\n"
+            "  --rows N              записей в файле (по умолчанию 3000000)\n"
+            "  --threads-max N       до скольких потоков проверять (по умолчанию по числу ядер)\n"
+            "  --dir DIR             каталог для файлов (по умолчанию временный)\n"
+            "\n"
+            "login - проверка занятых логинов (фильтр Блума + StringSet против unordered_set) и выдача свободных\n"
+            "  --existing N          занятых логинов (по умолчанию 5000000)\n"
+            "  --bases N             разных основ (по умолчанию 20000)\n"
+            "  --count N             сколько логинов выдать (по умолчанию 1000000)\n"
+            "\n"
+            "product - перебор сочетаний: все сочетания в памяти против ленивого перебора по блокам\n"
+            "  --columns N           колонок с несколькими значениями (по умолчанию 4)\n"
+            "  --values N            значений в каждой (по умолчанию 32, итого 32^4 записей)\n"
+            "  --dir DIR             каталог для файлов (по умолчанию временный)\n"
+            "\n"
+            "join - записи по выгрузке людей против простого копирования выгрузки\n"
+            "  --rows N              людей в выгрузке (по умолчанию 2000000)\n"
+            "  --dir DIR             каталог для файлов (по умолчанию временный)\n"
+            "\n"
+            "filter - фильтр списка в фоновом потоке: быстрый набор с отменой устаревших запросов\n"
+            "  --size N              строк в словаре (по умолчанию 1000000)\n"
+            "  --words N             набираемых слов (по умолчанию 50)\n"
+            "  --interval-ms N       пауза между нажатиями (по умолчанию 0 - быстрее поиска)\n"
+            "  --substring           поиск по части строки вместо префикса\n"
+            "\n"
+            "trace - трассировка: цена участка и проверка колец, пока потоки пишут, а выгрузка читает\n"
+            "  --threads N           пишущих потоков (по умолчанию 4)\n"
+            "  --events N            событий на поток (по умолчанию 1000000)\n"
+            "\n"
+            "fold [FILE...] - приведение регистра и сравнение без учета регистра: прежний towupper\n"
+            "  против таблиц и блоков SSE2/AVX2 на словарях из файлов и сгенерированных строках\n"
+            "  --size N              сгенерированных строк (по умолчанию 200000)\n"
+            "  --queries N           набираемых слов и фрагментов (по умолчанию 50)\n"
+            "\n"
+            "encoding - определение кодировки и перекодирование UTF-8, CP1251 и UTF-16 по уровням\n"
+            "  SSE2/AVX2 (ГБ/с) со сверкой с эталоном, доля перекодирования в загрузке словаря\n"
+            "  --lines N             строк выгрузки (по умолчанию 200000)\n"
+            "  --repeat N            повторов замера, берется лучший (по умолчанию 5)\n"
+            "  --dir DIR             каталог для файлов (по умолчанию временный)\n"
+            "\n"
+            "reload - горячая перезагрузка: правка одного словаря при непрерывном поиске\n"
+            "  --files N             число словарей (по умолчанию 4)\n"
+            "  --lines N             строк в каждом словаре (по умолчанию 200000)\n"
+            "  --edits N             число правок (по умолчанию 5)\n"
+            "  --quiet MS            пауза после последнего изменения (по умолчанию 50)\n"
+            "  --dir DIR             каталог для словарей (по умолчанию временный)\n");
+    }
+}
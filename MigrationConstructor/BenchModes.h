@@ -0,0 +1,24 @@
+﻿#pragma once
+
+#include "CommandArgs.h"
+
+#include <cstddef>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Режимы mcbench: сравнение прежнего кода с новым на больших данных
+namespace mc {
+    struct BenchMode {
+        const char* name;
+        int (*run)(Args&);
+    };
+
+    // nullptr, если режима нет
+    const BenchMode* FindBenchMode(std::string_view name);
+    void PrintBenchModes();
+
+    // Словарь, похожий на fullname.txt: "Фамилия Имя" латиницей случайной длины
+    std::vector<std::wstring> MakeDictionary(std::size_t size, std::mt19937& rng);
+}
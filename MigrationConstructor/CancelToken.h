@@ -0,0 +1,27 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Кооперативная отмена долгого поиска: запрос устарел, когда последнее поколение
+// его источника ушло вперед. Поиск сверяется с ним раз в CANCEL_CHECK_STEP шагов
+namespace mc {
+    constexpr std::size_t CANCEL_CHECK_STEP = 4096;
+
+    class CancelToken {
+    public:
+        // Без источника поколений - никогда не отменяется
+        CancelToken() = default;
+        CancelToken(const std::atomic<std::uint64_t>& latest, std::uint64_t generation)
+            : latest_(&latest), generation_(generation) {}
+
+        bool Cancelled() const {
+            return latest_ && latest_->load(std::memory_order_relaxed) != generation_;
+        }
+
+    private:
+        const std::atomic<std::uint64_t>* latest_ = nullptr;
+        std::uint64_t generation_ = 0;
+    };
+}
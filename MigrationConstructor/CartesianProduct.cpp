@@ -0,0 +1,30 @@
+﻿#include "CartesianProduct.h"
+
+#include <limits>
+#include <stdexcept>
+
+namespace mc {
+    CartesianProduct::CartesianProduct(const std::vector<std::vector<std::string>>& columns)
+        : columns_(&columns) {
+        for (std::size_t i = 0; i < columns.size(); ++i) {
+            const std::uint64_t radix = Radix(i);
+            if (size_ > std::numeric_limits<std::uint64_t>::max() / radix) {
+                throw std::runtime_error("Слишком много сочетаний значений");
+            }
+            size_ *= radix;
+        }
+    }
+
+    CartesianProduct::Iterator::Iterator(const CartesianProduct& product, std::uint64_t index)
+        : product_(&product), index_(index),
+        digits_(product.ColumnCount()), values_(product.ColumnCount()) {
+        // Разложение номера по смешанному основанию, начиная с последней колонки
+        std::uint64_t rest = index % product.Size();
+        for (std::size_t i = digits_.size(); i-- > 0;) {
+            const std::uint64_t radix = product.Radix(i);
+            digits_[i] = static_cast<std::size_t>(rest % radix);
+            rest /= radix;
+            values_[i] = product.Value(i, digits_[i]);
+        }
+    }
+}
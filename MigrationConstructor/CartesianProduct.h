@@ -0,0 +1,88 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Декартово произведение значений колонок без построения всех сочетаний. Номер сочетания
+// раскладывается по смешанному основанию (быстрее всех меняется последняя колонка),
+// поэтому перебор можно начать с любого номера и делить диапазон между потоками
+namespace mc {
+    class CartesianProduct {
+    public:
+        // columns должны жить дольше объекта. Пустой список значений колонки считается одним пустым значением.
+        // Бросает std::runtime_error, если число сочетаний не помещается в 64 бита
+        explicit CartesianProduct(const std::vector<std::vector<std::string>>& columns);
+
+        std::uint64_t Size() const { return size_; }
+        std::size_t ColumnCount() const { return columns_->size(); }
+
+        class Iterator {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = std::vector<std::string_view>;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const value_type*;
+            using reference = const value_type&;
+
+            Iterator() = default;
+            Iterator(const CartesianProduct& product, std::uint64_t index);
+
+            // Значения колонок текущего сочетания
+            reference operator*() const { return values_; }
+            pointer operator->() const { return &values_; }
+            std::uint64_t Index() const { return index_; }
+
+            // Как одометр: меняются только колонки, которые перешли через край.
+            // После последнего сочетания перебор начинается заново
+            Iterator& operator++() {
+                ++index_;
+                for (std::size_t i = digits_.size(); i-- > 0;) {
+                    if (++digits_[i] < product_->Radix(i)) {
+                        values_[i] = product_->Value(i, digits_[i]);
+                        return *this;
+                    }
+                    digits_[i] = 0;
+                    values_[i] = product_->Value(i, 0);
+                }
+                return *this;
+            }
+
+            Iterator operator++(int) {
+                Iterator copy = *this;
+                ++*this;
+                return copy;
+            }
+
+            bool operator==(const Iterator& other) const { return index_ == other.index_; }
+            bool operator!=(const Iterator& other) const { return index_ != other.index_; }
+
+        private:
+            const CartesianProduct* product_ = nullptr;
+            std::uint64_t index_ = 0;
+            std::vector<std::size_t> digits_;
+            std::vector<std::string_view> values_;
+        };
+
+        Iterator begin() const { return Iterator(*this, 0); }
+        Iterator end() const { return Iterator(*this, size_); }
+        // Номер сочетания берется по модулю Size()
+        Iterator At(std::uint64_t index) const { return Iterator(*this, index); }
+
+    private:
+        std::size_t Radix(std::size_t column) const {
+            const std::size_t size = (*columns_)[column].size();
+            return size == 0 ? 1 : size;
+        }
+        std::string_view Value(std::size_t column, std::size_t digit) const {
+            const std::vector<std::string>& values = (*columns_)[column];
+            return values.empty() ? std::string_view() : std::string_view(values[digit]);
+        }
+
+        const std::vector<std::vector<std::string>>* columns_;
+        std::uint64_t size_ = 1;
+    };
+}
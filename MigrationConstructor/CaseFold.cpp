@@ -0,0 +1,257 @@
+﻿#include "CaseFold.h"
+
+#include <climits>
+#include <cwchar>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define MC_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__)
+#define MC_TARGET(name) __attribute__((target(name)))
+#else
+#define MC_TARGET(name)
+#endif
+
+// Символ в векторе занимает 2 байта (Windows) или 4 (Linux)
+#if WCHAR_MAX > 0xFFFF
+#define MC_LANES(op) op##epi32
+#else
+#define MC_LANES(op) op##epi16
+#endif
+
+namespace mc {
+    namespace {
+        constexpr std::size_t NPOS = std::wstring_view::npos;
+
+        // Маска movemask_epi8 с одним битом на символ - младшим байтом
+        constexpr std::uint32_t LANE_BITS = sizeof(wchar_t) == 2 ? 0x55555555u : 0x11111111u;
+
+        void FoldScalar(wchar_t* out, const wchar_t* text, std::size_t size) {
+            for (std::size_t i = 0; i < size; ++i) out[i] = FoldChar(text[i]);
+        }
+
+        bool EqualFoldedScalar(const wchar_t* text, const wchar_t* folded, std::size_t size) {
+            for (std::size_t i = 0; i < size; ++i) {
+                if (FoldChar(text[i]) != folded[i]) return false;
+            }
+            return true;
+        }
+
+        bool StartsWithScalar(const wchar_t* text, std::size_t textSize, const wchar_t* prefix, std::size_t prefixSize) {
+            return textSize >= prefixSize && EqualFoldedScalar(text, prefix, prefixSize);
+        }
+
+        std::size_t FindScalarFrom(const wchar_t* text, std::size_t textSize, std::size_t from,
+            const wchar_t* needle, std::size_t needleSize) {
+            for (std::size_t pos = from; pos + needleSize <= textSize; ++pos) {
+                if (FoldChar(text[pos]) == needle[0] && EqualFoldedScalar(text + pos + 1, needle + 1, needleSize - 1)) {
+                    return pos;
+                }
+            }
+            return NPOS;
+        }
+
+        std::size_t FindScalar(const wchar_t* text, std::size_t textSize, const wchar_t* needle, std::size_t needleSize) {
+            if (needleSize == 0) return 0;
+            return FindScalarFrom(text, textSize, 0, needle, needleSize);
+        }
+
+#ifdef MC_X86
+        // Символы c из [lo, hi]. Сравнение знаковое: символы 16-битного wchar_t от U+8000
+        // становятся отрицательными и ни в один диапазон не попадают
+        MC_TARGET("sse2")
+        inline __m128i InRangeSse2(__m128i c, int lo, int hi) {
+            return _mm_and_si128(MC_LANES(_mm_cmpgt_)(c, MC_LANES(_mm_set1_)(lo - 1)),
+                MC_LANES(_mm_cmplt_)(c, MC_LANES(_mm_set1_)(hi + 1)));
+        }
+
+        // false - в блоке есть символы вне ASCII и основной кириллицы, блок приводится по таблицам
+        MC_TARGET("sse2")
+        inline bool FoldVectorSse2(__m128i c, __m128i& out) {
+            const __m128i simple = _mm_or_si128(InRangeSse2(c, 0, 0x7F), InRangeSse2(c, 0x400, 0x45F));
+            if (_mm_movemask_epi8(simple) != 0xFFFF) return false;
+            const __m128i lower = _mm_or_si128(InRangeSse2(c, 'a', 'z'), InRangeSse2(c, 0x430, 0x44F));
+            const __m128i lowerExt = InRangeSse2(c, 0x450, 0x45F);
+            const __m128i delta = _mm_or_si128(_mm_and_si128(lower, MC_LANES(_mm_set1_)(0x20)),
+                _mm_and_si128(lowerExt, MC_LANES(_mm_set1_)(0x50)));
+            out = MC_LANES(_mm_sub_)(c, delta);
+            return true;
+        }
+
+        constexpr std::size_t SSE2_LANES = 16 / sizeof(wchar_t);
+
+        MC_TARGET("sse2")
+        void FoldSse2(wchar_t* out, const wchar_t* text, std::size_t size) {
+            std::size_t i = 0;
+            for (; i + SSE2_LANES <= size; i += SSE2_LANES) {
+                __m128i folded;
+                if (FoldVectorSse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i)), folded)) {
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), folded);
+                }
+                else {
+                    FoldScalar(out + i, text + i, SSE2_LANES);
+                }
+            }
+            FoldScalar(out + i, text + i, size - i);
+        }
+
+        MC_TARGET("sse2")
+        bool StartsWithSse2(const wchar_t* text, std::size_t textSize, const wchar_t* prefix, std::size_t prefixSize) {
+            if (textSize < prefixSize) return false;
+            // В фильтре списка большинство строк отсеивается на первом символе
+            if (prefixSize != 0 && FoldChar(text[0]) != prefix[0]) return false;
+            std::size_t i = 0;
+            for (; i + SSE2_LANES <= prefixSize; i += SSE2_LANES) {
+                __m128i folded;
+                if (!FoldVectorSse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i)), folded)) {
+                    if (!EqualFoldedScalar(text + i, prefix + i, SSE2_LANES)) return false;
+                    continue;
+                }
+                const __m128i expected = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prefix + i));
+                if (_mm_movemask_epi8(MC_LANES(_mm_cmpeq_)(folded, expected)) != 0xFFFF) return false;
+            }
+            return EqualFoldedScalar(text + i, prefix + i, prefixSize - i);
+        }
+
+        // Кандидаты - позиции, где приведенный символ равен первому символу needle
+        MC_TARGET("sse2")
+        std::size_t FindSse2(const wchar_t* text, std::size_t textSize, const wchar_t* needle, std::size_t needleSize) {
+            if (needleSize == 0) return 0;
+            if (needleSize > textSize) return NPOS;
+            const std::size_t last = textSize - needleSize;
+            const __m128i first = MC_LANES(_mm_set1_)(needle[0]);
+            std::size_t i = 0;
+            for (; i + SSE2_LANES <= textSize && i <= last; i += SSE2_LANES) {
+                std::uint32_t candidates = 0;
+                __m128i folded;
+                if (FoldVectorSse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i)), folded)) {
+                    candidates = static_cast<std::uint32_t>(_mm_movemask_epi8(MC_LANES(_mm_cmpeq_)(folded, first))) & LANE_BITS;
+                }
+                else {
+                    for (std::size_t k = 0; k < SSE2_LANES; ++k) {
+                        if (FoldChar(text[i + k]) == needle[0]) candidates |= 1u << (k * sizeof(wchar_t));
+                    }
+                }
+                while (candidates) {
+                    const std::size_t pos = i + CountTrailingZeros(candidates) / sizeof(wchar_t);
+                    if (pos > last) return NPOS;
+                    if (StartsWithSse2(text + pos + 1, textSize - pos - 1, needle + 1, needleSize - 1)) return pos;
+                    candidates &= candidates - 1;
+                }
+            }
+            return FindScalarFrom(text, textSize, i, needle, needleSize);
+        }
+
+        MC_TARGET("avx2")
+        inline __m256i InRangeAvx2(__m256i c, int lo, int hi) {
+            return _mm256_and_si256(MC_LANES(_mm256_cmpgt_)(c, MC_LANES(_mm256_set1_)(lo - 1)),
+                MC_LANES(_mm256_cmpgt_)(MC_LANES(_mm256_set1_)(hi + 1), c));
+        }
+
+        MC_TARGET("avx2")
+        inline bool FoldVectorAvx2(__m256i c, __m256i& out) {
+            const __m256i simple = _mm256_or_si256(InRangeAvx2(c, 0, 0x7F), InRangeAvx2(c, 0x400, 0x45F));
+            if (static_cast<std::uint32_t>(_mm256_movemask_epi8(simple)) != 0xFFFFFFFFu) return false;
+            const __m256i lower = _mm256_or_si256(InRangeAvx2(c, 'a', 'z'), InRangeAvx2(c, 0x430, 0x44F));
+            const __m256i lowerExt = InRangeAvx2(c, 0x450, 0x45F);
+            const __m256i delta = _mm256_or_si256(_mm256_and_si256(lower, MC_LANES(_mm256_set1_)(0x20)),
+                _mm256_and_si256(lowerExt, MC_LANES(_mm256_set1_)(0x50)));
+            out = MC_LANES(_mm256_sub_)(c, delta);
+            return true;
+        }
+
+        constexpr std::size_t AVX2_LANES = 32 / sizeof(wchar_t);
+
+        MC_TARGET("avx2")
+        void FoldAvx2(wchar_t* out, const wchar_t* text, std::size_t size) {
+            std::size_t i = 0;
+            for (; i + AVX2_LANES <= size; i += AVX2_LANES) {
+                __m256i folded;
+                if (FoldVectorAvx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + i)), folded)) {
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), folded);
+                }
+                else {
+                    FoldScalar(out + i, text + i, AVX2_LANES);
+                }
+            }
+            // Хвост короче блока AVX2 - половиной ширины
+            FoldSse2(out + i, text + i, size - i);
+        }
+
+        MC_TARGET("avx2")
+        bool StartsWithAvx2(const wchar_t* text, std::size_t textSize, const wchar_t* prefix, std::size_t prefixSize) {
+            if (textSize < prefixSize) return false;
+            // В фильтре списка большинство строк отсеивается на первом символе
+            if (prefixSize != 0 && FoldChar(text[0]) != prefix[0]) return false;
+            std::size_t i = 0;
+            for (; i + AVX2_LANES <= prefixSize; i += AVX2_LANES) {
+                __m256i folded;
+                if (!FoldVectorAvx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + i)), folded)) {
+                    if (!EqualFoldedScalar(text + i, prefix + i, AVX2_LANES)) return false;
+                    continue;
+                }
+                const __m256i expected = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(prefix + i));
+                if (static_cast<std::uint32_t>(_mm256_movemask_epi8(MC_LANES(_mm256_cmpeq_)(folded, expected))) != 0xFFFFFFFFu) {
+                    return false;
+                }
+            }
+            return StartsWithSse2(text + i, textSize - i, prefix + i, prefixSize - i);
+        }
+
+        MC_TARGET("avx2")
+        std::size_t FindAvx2(const wchar_t* text, std::size_t textSize, const wchar_t* needle, std::size_t needleSize) {
+            if (needleSize == 0) return 0;
+            if (needleSize > textSize) return NPOS;
+            const std::size_t last = textSize - needleSize;
+            const __m256i first = MC_LANES(_mm256_set1_)(needle[0]);
+            std::size_t i = 0;
+            for (; i + AVX2_LANES <= textSize && i <= last; i += AVX2_LANES) {
+                std::uint32_t candidates = 0;
+                __m256i folded;
+                if (FoldVectorAvx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + i)), folded)) {
+                    candidates = static_cast<std::uint32_t>(_mm256_movemask_epi8(MC_LANES(_mm256_cmpeq_)(folded, first))) & LANE_BITS;
+                }
+                else {
+                    for (std::size_t k = 0; k < AVX2_LANES; ++k) {
+                        if (FoldChar(text[i + k]) == needle[0]) candidates |= 1u << (k * sizeof(wchar_t));
+                    }
+                }
+                while (candidates) {
+                    const std::size_t pos = i + CountTrailingZeros(candidates) / sizeof(wchar_t);
+                    if (pos > last) return NPOS;
+                    if (StartsWithAvx2(text + pos + 1, textSize - pos - 1, needle + 1, needleSize - 1)) return pos;
+                    candidates &= candidates - 1;
+                }
+            }
+            const std::size_t pos = FindSse2(text + i, textSize - i, needle, needleSize);
+            return pos == NPOS ? NPOS : i + pos;
+        }
+#endif
+
+        const CaseFoldKernels SCALAR_KERNELS = { FoldScalar, StartsWithScalar, FindScalar };
+#ifdef MC_X86
+        const CaseFoldKernels SSE2_KERNELS = { FoldSse2, StartsWithSse2, FindSse2 };
+        const CaseFoldKernels AVX2_KERNELS = { FoldAvx2, StartsWithAvx2, FindAvx2 };
+#endif
+    }
+
+    const CaseFoldKernels& GetCaseFoldKernels(SimdLevel level) {
+        if (static_cast<int>(level) > static_cast<int>(DetectSimdLevel())) {
+            level = DetectSimdLevel();
+        }
+        switch (level) {
+#ifdef MC_X86
+        case SimdLevel::Avx2: return AVX2_KERNELS;
+        case SimdLevel::Sse2: return SSE2_KERNELS;
+#endif
+        default: return SCALAR_KERNELS;
+        }
+    }
+
+    const CaseFoldKernels& CaseFold() {
+        static const CaseFoldKernels& kernels = GetCaseFoldKernels(DetectSimdLevel());
+        return kernels;
+    }
+}
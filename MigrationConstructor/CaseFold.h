@@ -0,0 +1,113 @@
+﻿#pragma once
+
+#include "DelimiterScan.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cwctype>
+#include <string>
+#include <string_view>
+
+// Приведение регистра для фильтра выпадающих списков: верхний регистр по Unicode.
+// Латиница (U+0000-U+017F) и кириллица (U+0400-U+04FF) приводятся по таблицам и не зависят
+// от локали процесса, остальные символы - через towupper. Строки обрабатываются блоками
+// SSE2/AVX2, пока в блоке только ASCII и основная кириллица (U+0400-U+045F)
+namespace mc {
+    namespace detail {
+        constexpr std::uint32_t FOLD_LATIN_END = 0x180;
+        constexpr std::uint32_t FOLD_CYRILLIC_BEGIN = 0x400;
+        constexpr std::uint32_t FOLD_CYRILLIC_SIZE = 0x100;
+
+        struct FoldTables {
+            std::uint16_t latin[FOLD_LATIN_END];
+            std::uint16_t cyrillic[FOLD_CYRILLIC_SIZE];
+
+            constexpr FoldTables() : latin(), cyrillic() {
+                for (std::uint32_t ch = 0; ch < FOLD_LATIN_END; ++ch) latin[ch] = static_cast<std::uint16_t>(FoldLatin(ch));
+                for (std::uint32_t i = 0; i < FOLD_CYRILLIC_SIZE; ++i) {
+                    cyrillic[i] = static_cast<std::uint16_t>(FoldCyrillic(FOLD_CYRILLIC_BEGIN + i));
+                }
+            }
+
+            // ASCII, Latin-1, Latin Extended-A
+            static constexpr std::uint32_t FoldLatin(std::uint32_t ch) {
+                if (ch >= 'a' && ch <= 'z') return ch - 0x20;
+                if (ch == 0xB5) return 0x39C;                       // µ -> греческая Μ
+                if (ch >= 0xE0 && ch <= 0xFE && ch != 0xF7) return ch - 0x20;
+                if (ch == 0xFF) return 0x178;
+                if (ch == 0x131) return 'I';                        // ı
+                if (ch == 0x17F) return 'S';                        // ſ
+                // Пары "заглавная, строчная": в 0100-0137 и 014A-0177 строчные нечетные,
+                // в 0139-0148 и 0179-017E - четные
+                if (((ch >= 0x100 && ch <= 0x137) || (ch >= 0x14A && ch <= 0x177)) && (ch & 1)) return ch - 1;
+                if (((ch >= 0x139 && ch <= 0x148) || (ch >= 0x179 && ch <= 0x17E)) && !(ch & 1)) return ch - 1;
+                return ch;
+            }
+
+            static constexpr std::uint32_t FoldCyrillic(std::uint32_t ch) {
+                if (ch >= 0x430 && ch <= 0x44F) return ch - 0x20;   // а-я
+                if (ch >= 0x450 && ch <= 0x45F) return ch - 0x50;   // ѐ-џ, в том числе ё
+                if (ch == 0x4CF) return 0x4C0;
+                if (((ch >= 0x460 && ch <= 0x481) || (ch >= 0x48A && ch <= 0x4BF) || (ch >= 0x4D0 && ch <= 0x4FF)) && (ch & 1)) {
+                    return ch - 1;
+                }
+                if (ch >= 0x4C1 && ch <= 0x4CE && !(ch & 1)) return ch - 1;
+                return ch;
+            }
+        };
+
+        inline constexpr FoldTables FOLD_TABLES{};
+    }
+
+    inline wchar_t FoldChar(wchar_t ch) {
+        const auto code = static_cast<std::uint32_t>(ch);
+        if (code < detail::FOLD_LATIN_END) return static_cast<wchar_t>(detail::FOLD_TABLES.latin[code]);
+        if (code - detail::FOLD_CYRILLIC_BEGIN < detail::FOLD_CYRILLIC_SIZE) {
+            return static_cast<wchar_t>(detail::FOLD_TABLES.cyrillic[code - detail::FOLD_CYRILLIC_BEGIN]);
+        }
+        return static_cast<wchar_t>(towupper(ch));
+    }
+
+    // Ядра одного уровня SIMD; результаты всех уровней совпадают
+    struct CaseFoldKernels {
+        // out[i] = FoldChar(text[i]); out может совпадать с text
+        void (*fold)(wchar_t* out, const wchar_t* text, std::size_t size);
+        // text начинается с foldedPrefix без учета регистра
+        bool (*startsWith)(const wchar_t* text, std::size_t textSize, const wchar_t* foldedPrefix, std::size_t prefixSize);
+        // Позиция первого вхождения foldedNeedle без учета регистра или std::wstring_view::npos
+        std::size_t (*find)(const wchar_t* text, std::size_t textSize, const wchar_t* foldedNeedle, std::size_t needleSize);
+    };
+
+    // Уровень выше поддерживаемого процессором понижается
+    const CaseFoldKernels& GetCaseFoldKernels(SimdLevel level);
+
+    // Ядра лучшего уровня процессора
+    const CaseFoldKernels& CaseFold();
+
+    inline void FoldCaseTo(wchar_t* out, std::wstring_view text) {
+        CaseFold().fold(out, text.data(), text.size());
+    }
+
+    inline void AppendFolded(std::wstring& out, std::wstring_view text) {
+        const std::size_t offset = out.size();
+        out.resize(offset + text.size());
+        FoldCaseTo(&out[offset], text);
+    }
+
+    inline std::wstring FoldCase(std::wstring_view text) {
+        std::wstring result(text.size(), L'\0');
+        FoldCaseTo(&result[0], text);
+        return result;
+    }
+
+    // Сравнение с заранее приведенной строкой (FoldCase): приводится только text
+    inline bool StartsWithFolded(std::wstring_view text, std::wstring_view foldedPrefix) {
+        return CaseFold().startsWith(text.data(), text.size(), foldedPrefix.data(), foldedPrefix.size());
+    }
+
+    inline std::size_t FindFolded(std::wstring_view text, std::wstring_view foldedNeedle, std::size_t from = 0) {
+        if (from > text.size()) return std::wstring_view::npos;
+        const std::size_t pos = CaseFold().find(text.data() + from, text.size() - from, foldedNeedle.data(), foldedNeedle.size());
+        return pos == std::wstring_view::npos ? pos : from + pos;
+    }
+}
@@ -0,0 +1,67 @@
+﻿#pragma once
+
+#include "MigrationRow.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Разбор параметров командной строки, общий для mctool и mcbench
+namespace mc {
+    struct Args {
+        std::vector<std::string_view> items;
+        std::size_t pos = 0;
+
+        bool Next(std::string_view& out) {
+            if (pos >= items.size()) return false;
+            out = items[pos++];
+            return true;
+        }
+
+        std::string_view Value(std::string_view option) {
+            std::string_view value;
+            if (!Next(value)) {
+                throw std::runtime_error("Не указано значение для " + std::string(option));
+            }
+            return value;
+        }
+    };
+
+    inline long long ParseInt(std::string_view text, std::string_view option) {
+        const std::string value(text);
+        char* end = nullptr;
+        const long long result = std::strtoll(value.c_str(), &end, 10);
+        if (value.empty() || *end != '\0') {
+            throw std::runtime_error("Ожидалось число для " + std::string(option) + ": " + value);
+        }
+        return result;
+    }
+
+    // Значения через запятую: "a,b,c"
+    inline std::vector<std::string_view> SplitList(std::string_view text) {
+        std::vector<std::string_view> parts;
+        while (!text.empty()) {
+            const std::size_t comma = text.find(',');
+            parts.push_back(text.substr(0, comma));
+            if (comma == std::string_view::npos) break;
+            text.remove_prefix(comma + 1);
+        }
+        return parts;
+    }
+
+    // Номер колонки словаря по имени файла без .txt; -1, если такой нет
+    inline int ColumnIndex(std::string_view name) {
+        for (std::size_t i = 0; i < COLUMN_COUNT; ++i) {
+            if (name == DictionaryColumnName(i)) return static_cast<int>(i);
+        }
+        return -1;
+    }
+
+    inline double ElapsedMicros(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    }
+}
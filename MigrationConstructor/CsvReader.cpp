@@ -0,0 +1,150 @@
+﻿#include "CsvReader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace mc {
+    CsvReader::CsvReader(std::FILE* in, char delimiter, std::size_t bufferBytes)
+        : in_(in), delimiter_(delimiter), bufferBytes_(std::max<std::size_t>(bufferBytes, 4096)) {
+        buffer_.reserve(bufferBytes_);
+        Fill();
+        const DetectedEncoding detected = DetectEncoding(buffer_, eof_);
+        if (detected.encoding == TextEncoding::Utf8) {
+            pos_ = detected.bomBytes;
+        }
+        else {
+            encoding_ = detected.encoding;
+            raw_.assign(buffer_, detected.bomBytes, std::string::npos);
+            buffer_.clear();
+            Decode();
+        }
+        if (delimiter_ == 0) delimiter_ = DetectDelimiter();
+    }
+
+    // Сдвигает непрочитанное в начало и дочитывает; false, если файл кончился
+    bool CsvReader::Fill() {
+        if (eof_) return false;
+        buffer_.erase(0, pos_);
+        pos_ = 0;
+
+        // Запись длиннее буфера: буфер растет
+        const std::size_t target = std::max(bufferBytes_, buffer_.size() * 2);
+        const std::size_t have = buffer_.size();
+        // Не UTF-8: блок читается в raw_ и перекодируется в конец buffer_
+        std::string& into = encoding_ == TextEncoding::Utf8 ? buffer_ : raw_;
+        const std::size_t offset = into.size();
+        into.resize(offset + target - have);
+        const std::size_t read = std::fread(&into[offset], 1, target - have, in_);
+        into.resize(offset + read);
+        if (read < target - have) {
+            if (std::ferror(in_)) throw std::runtime_error("Ошибка чтения входного файла");
+            eof_ = true;
+        }
+        if (encoding_ != TextEncoding::Utf8) Decode();
+        return read > 0;
+    }
+
+    void CsvReader::Decode() {
+        // Оборванный в конце символ ждет следующего блока
+        const std::size_t complete = eof_ ? raw_.size() : CompleteTextLength(raw_, encoding_);
+        AppendTextAsUtf8(std::string_view(raw_).substr(0, complete), encoding_, buffer_);
+        raw_.erase(0, complete);
+    }
+
+    // Разделитель, который чаще всего встречается в первой строке вне кавычек
+    char CsvReader::DetectDelimiter() {
+        std::size_t counts[3] = {};
+        const char candidates[3] = { ',', ';', '\t' };
+        bool quoted = false;
+        for (std::size_t i = pos_; i < buffer_.size(); ++i) {
+            const char ch = buffer_[i];
+            if (ch == '"') quoted = !quoted;
+            else if (!quoted && (ch == '\n' || ch == '\r')) break;
+            else if (!quoted) {
+                for (int c = 0; c < 3; ++c) counts[c] += ch == candidates[c];
+            }
+        }
+        const std::size_t best = static_cast<std::size_t>(std::max_element(counts, counts + 3) - counts);
+        return counts[best] > 0 ? candidates[best] : ',';
+    }
+
+    bool CsvReader::ParseRecord(std::vector<std::string_view>& fields) {
+        fields.clear();
+        unquoted_.clear();
+        // Поля в кавычках копируются в unquoted_; емкость на всю запись, чтобы string_view не сдвигались
+        unquoted_.reserve(buffer_.size() - pos_);
+
+        const char* const data = buffer_.data();
+        const std::size_t size = buffer_.size();
+        std::size_t i = pos_;
+        std::uint64_t lines = 0;
+
+        for (;;) {
+            if (i < size && data[i] == '"') {
+                const std::size_t start = unquoted_.size();
+                for (++i;; ++i) {
+                    if (i >= size) {
+                        if (!eof_) return false;
+                        break;      // незакрытая кавычка в конце файла
+                    }
+                    if (data[i] == '"') {
+                        if (i + 1 >= size && !eof_) return false;
+                        if (i + 1 < size && data[i + 1] == '"') {
+                            unquoted_ += '"';
+                            ++i;
+                            continue;
+                        }
+                        ++i;
+                        break;
+                    }
+                    lines += data[i] == '\n';
+                    unquoted_ += data[i];
+                }
+                // Текст между закрывающей кавычкой и разделителем добавляется как есть
+                while (i < size && data[i] != delimiter_ && data[i] != '\n' && data[i] != '\r') unquoted_ += data[i++];
+                fields.emplace_back(unquoted_.data() + start, unquoted_.size() - start);
+            }
+            else {
+                const std::size_t start = i;
+                while (i < size && data[i] != delimiter_ && data[i] != '\n' && data[i] != '\r') ++i;
+                fields.emplace_back(data + start, i - start);
+            }
+
+            if (i >= size) {
+                if (!eof_) return false;
+                break;
+            }
+            if (data[i] == delimiter_) {
+                ++i;
+                continue;
+            }
+            // Конец записи: "\n", "\r\n" или одиночный '\r'
+            if (data[i] == '\r') {
+                if (i + 1 >= size && !eof_) return false;
+                if (i + 1 < size && data[i + 1] == '\n') ++i;
+            }
+            ++i;
+            ++lines;
+            break;
+        }
+
+        pos_ = i;
+        recordLine_ = line_;
+        line_ += lines;
+        return true;
+    }
+
+    bool CsvReader::Next(std::vector<std::string_view>& fields) {
+        for (;;) {
+            if (pos_ >= buffer_.size() && !Fill()) return false;
+            if (!ParseRecord(fields)) {
+                Fill();
+                continue;
+            }
+            // Пустая строка - не запись
+            if (fields.size() == 1 && fields[0].empty()) continue;
+            return true;
+        }
+    }
+}
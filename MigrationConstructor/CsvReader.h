@@ -0,0 +1,52 @@
+﻿#pragma once
+
+#include "Encoding.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Потоковое чтение CSV/TSV (выгрузки HR): файл читается блоками фиксированного размера,
+// поля в кавычках могут содержать разделители, переводы строк и удвоенные кавычки.
+// Память не зависит от размера файла - только от длины самой длинной записи.
+// Выгрузки в UTF-16 и CP1251 определяются по первому блоку и перекодируются в UTF-8 по ходу чтения
+namespace mc {
+    class CsvReader {
+    public:
+        // delimiter = 0 - определяется по первой строке (',', ';' или '\t')
+        explicit CsvReader(std::FILE* in, char delimiter = 0, std::size_t bufferBytes = std::size_t(1) << 20);
+
+        // Следующая непустая запись; false в конце файла. Поля действительны до следующего вызова.
+        // Ошибки чтения - std::runtime_error
+        bool Next(std::vector<std::string_view>& fields);
+
+        char Delimiter() const { return delimiter_; }
+        // Кодировка файла; поля всегда в UTF-8
+        TextEncoding Encoding() const { return encoding_; }
+        // Строка файла, с которой началась последняя запись (с 1)
+        std::uint64_t Line() const { return recordLine_; }
+
+    private:
+        bool Fill();
+        // Перекодирует в buffer_ сырые байты raw_, кроме оборванного в конце символа
+        void Decode();
+        // Разбор записи с pos_; false, если запись не закончилась в буфере
+        bool ParseRecord(std::vector<std::string_view>& fields);
+        char DetectDelimiter();
+
+        std::FILE* in_;
+        char delimiter_;
+        std::size_t bufferBytes_;
+        std::string buffer_;
+        TextEncoding encoding_ = TextEncoding::Utf8;
+        std::string raw_;                // прочитанное, но еще не перекодированное (не UTF-8)
+        std::size_t pos_ = 0;
+        bool eof_ = false;
+        std::string unquoted_;           // поля в кавычках без экранирования
+        std::uint64_t line_ = 1;
+        std::uint64_t recordLine_ = 0;
+    };
+}
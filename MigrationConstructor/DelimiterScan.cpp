@@ -0,0 +1,118 @@
+﻿#include "DelimiterScan.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define MC_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__)
+#define MC_TARGET(name) __attribute__((target(name)))
+#else
+#define MC_TARGET(name)
+#endif
+
+namespace mc {
+    namespace {
+        std::uint64_t DelimiterMaskScalar(const char* p) {
+            std::uint64_t mask = 0;
+            for (unsigned i = 0; i < DelimiterScanner::BLOCK; ++i) {
+                if (p[i] == ';' || p[i] == '\n') {
+                    mask |= std::uint64_t(1) << i;
+                }
+            }
+            return mask;
+        }
+
+#ifdef MC_X86
+        MC_TARGET("sse2")
+        std::uint64_t DelimiterMaskSse2(const char* p) {
+            const __m128i semicolon = _mm_set1_epi8(';');
+            const __m128i newline = _mm_set1_epi8('\n');
+            std::uint64_t mask = 0;
+            for (unsigned i = 0; i < 4; ++i) {
+                const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i * 16));
+                const __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(chunk, semicolon), _mm_cmpeq_epi8(chunk, newline));
+                mask |= static_cast<std::uint64_t>(static_cast<std::uint16_t>(_mm_movemask_epi8(hits))) << (i * 16);
+            }
+            return mask;
+        }
+
+        MC_TARGET("avx2")
+        std::uint64_t DelimiterMaskAvx2(const char* p) {
+            const __m256i semicolon = _mm256_set1_epi8(';');
+            const __m256i newline = _mm256_set1_epi8('\n');
+            const __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            const __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32));
+            const __m256i hitsLo = _mm256_or_si256(_mm256_cmpeq_epi8(lo, semicolon), _mm256_cmpeq_epi8(lo, newline));
+            const __m256i hitsHi = _mm256_or_si256(_mm256_cmpeq_epi8(hi, semicolon), _mm256_cmpeq_epi8(hi, newline));
+            return static_cast<std::uint32_t>(_mm256_movemask_epi8(hitsLo)) |
+                (static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(hitsHi))) << 32);
+        }
+
+        bool CpuHasAvx2() {
+#ifdef _MSC_VER
+            int info[4];
+            __cpuid(info, 0);
+            if (info[0] < 7) return false;
+            __cpuid(info, 1);
+            const bool osxsave = (info[2] & (1 << 27)) != 0;
+            const bool avx = (info[2] & (1 << 28)) != 0;
+            if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) return false;
+            __cpuidex(info, 7, 0);
+            return (info[1] & (1 << 5)) != 0;
+#else
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2");
+#endif
+        }
+
+        bool CpuHasSse2() {
+#if defined(_M_X64) || defined(__x86_64__)
+            return true;
+#elif defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 1);
+            return (info[3] & (1 << 26)) != 0;
+#else
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("sse2");
+#endif
+        }
+#endif
+    }
+
+    SimdLevel DetectSimdLevel() {
+#ifdef MC_X86
+        static const SimdLevel level = CpuHasAvx2() ? SimdLevel::Avx2
+            : CpuHasSse2() ? SimdLevel::Sse2 : SimdLevel::Scalar;
+        return level;
+#else
+        return SimdLevel::Scalar;
+#endif
+    }
+
+    const char* SimdLevelName(SimdLevel level) {
+        switch (level) {
+        case SimdLevel::Avx2: return "avx2";
+        case SimdLevel::Sse2: return "sse2";
+        default: return "scalar";
+        }
+    }
+
+    DelimiterMaskFn GetDelimiterMaskFn(SimdLevel level) {
+        // Уровень выше поддерживаемого процессором понижается
+        if (static_cast<int>(level) > static_cast<int>(DetectSimdLevel())) {
+            level = DetectSimdLevel();
+        }
+        switch (level) {
+#ifdef MC_X86
+        case SimdLevel::Avx2: return DelimiterMaskAvx2;
+        case SimdLevel::Sse2: return DelimiterMaskSse2;
+#endif
+        default: return DelimiterMaskScalar;
+        }
+    }
+}
@@ -0,0 +1,82 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Векторный поиск ';' и '\n' блоками по 64 байта (AVX2 / SSE2 / скалярный вариант)
+namespace mc {
+    enum class SimdLevel { Scalar, Sse2, Avx2 };
+
+    // Лучший уровень, поддерживаемый процессором
+    SimdLevel DetectSimdLevel();
+    const char* SimdLevelName(SimdLevel level);
+
+    // Маска байтов ';' и '\n' в 64 байтах начиная с p (бит i - байт p[i])
+    using DelimiterMaskFn = std::uint64_t (*)(const char* p);
+    DelimiterMaskFn GetDelimiterMaskFn(SimdLevel level);
+
+    inline unsigned CountTrailingZeros(std::uint64_t value) {
+#if defined(_MSC_VER)
+        unsigned long index;
+#if defined(_M_X64) || defined(_M_ARM64)
+        _BitScanForward64(&index, value);
+        return index;
+#else
+        if (_BitScanForward(&index, static_cast<unsigned long>(value))) return index;
+        _BitScanForward(&index, static_cast<unsigned long>(value >> 32));
+        return index + 32;
+#endif
+#else
+        return static_cast<unsigned>(__builtin_ctzll(value));
+#endif
+    }
+
+    // Последовательно выдает позиции разделителей в [begin, end)
+    class DelimiterScanner {
+    public:
+        static constexpr std::size_t BLOCK = 64;
+
+        DelimiterScanner(const char* begin, const char* end, DelimiterMaskFn maskFn)
+            : block_(begin), end_(end), maskFn_(maskFn) {
+            Load();
+        }
+
+        // Указатель на следующий ';' или '\n', либо end, если разделителей больше нет
+        const char* Next() {
+            while (mask_ == 0) {
+                block_ += BLOCK;
+                if (block_ >= end_) return end_;
+                Load();
+            }
+            const char* result = block_ + CountTrailingZeros(mask_);
+            mask_ &= mask_ - 1;
+            return result;
+        }
+
+    private:
+        void Load() {
+            if (block_ >= end_) {
+                mask_ = 0;
+                return;
+            }
+            if (static_cast<std::size_t>(end_ - block_) >= BLOCK) {
+                mask_ = maskFn_(block_);
+                return;
+            }
+            // Хвост короче блока: дополняем нулями, они не являются разделителями
+            char tail[BLOCK] = {};
+            std::memcpy(tail, block_, static_cast<std::size_t>(end_ - block_));
+            mask_ = maskFn_(tail);
+        }
+
+        const char* block_;
+        const char* end_;
+        DelimiterMaskFn maskFn_;
+        std::uint64_t mask_ = 0;
+    };
+}
@@ -0,0 +1,250 @@
+﻿#include "DictCache.h"
+#include "Dictionary.h"
+#include "DictionaryLoader.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <random>
+#include <string>
+#include <system_error>
+
+namespace mc {
+    namespace {
+        constexpr char CACHE_MAGIC[8] = { 'M', 'C', 'D', 'I', 'C', 'T', 0, 0 };
+        constexpr std::uint32_t CACHE_VERSION = 4;     // 4 - списки лучших строк для запросов из одного-двух символов
+        constexpr std::uint64_t SECTION_ALIGN = 8;
+
+        enum Section {
+            ARENA, ARENA_OFFSETS,                      // Dictionary
+            KEYS, KEY_OFFSETS, ORDER,                  // PrefixIndex
+            FOLDED, FOLDED_OFFSETS, TRIGRAM_KEYS,      // TrigramIndex
+            POSTING_OFFSETS, POSTINGS,
+            SHORT_KEYS, SHORT_OFFSETS, SHORT_POSTINGS,
+            SECTION_COUNT
+        };
+
+        struct CacheHeader {
+            char magic[8];
+            std::uint32_t version;
+            std::uint32_t wcharSize;
+            std::uint64_t sourceSize;
+            std::int64_t sourceTime;
+            std::uint64_t sourceHash;
+            std::uint64_t sections[SECTION_COUNT][2];  // смещение в байтах, число элементов
+        };
+
+        template <class T>
+        const T* SectionData(const MappedFile& file, const CacheHeader& header, Section section) {
+            return reinterpret_cast<const T*>(file.Data() + header.sections[section][0]);
+        }
+
+        std::uint64_t SectionCount(const CacheHeader& header, Section section) {
+            return header.sections[section][1];
+        }
+
+        // Границы секций и согласованность размеров, чтобы поврежденный кэш не читался за пределами файла
+        bool ValidateHeader(const CacheHeader& header, std::uint64_t fileSize) {
+            static constexpr std::uint64_t elementSize[SECTION_COUNT] = {
+                sizeof(wchar_t), 4, sizeof(wchar_t), 4, 4, sizeof(wchar_t), 4, 8, 4, 4, 8, 4, 4
+            };
+            for (int i = 0; i < SECTION_COUNT; ++i) {
+                const std::uint64_t offset = header.sections[i][0];
+                const std::uint64_t count = header.sections[i][1];
+                if (offset % SECTION_ALIGN != 0 || offset < sizeof(CacheHeader) || offset > fileSize) return false;
+                if (count > (fileSize - offset) / elementSize[i]) return false;
+            }
+
+            const std::uint64_t offsetCount = SectionCount(header, ARENA_OFFSETS);
+            if (offsetCount == 0) return false;
+            const std::uint64_t items = offsetCount - 1;
+            return SectionCount(header, KEY_OFFSETS) == items + 1 &&
+                SectionCount(header, ORDER) == items &&
+                SectionCount(header, FOLDED_OFFSETS) == items + 1 &&
+                SectionCount(header, POSTING_OFFSETS) == SectionCount(header, TRIGRAM_KEYS) + 1 &&
+                SectionCount(header, SHORT_OFFSETS) == SectionCount(header, SHORT_KEYS) + 1;
+        }
+
+        // Смещения не убывают и заканчиваются размером секции, в которую указывают
+        bool ValidOffsets(const MappedFile& file, const CacheHeader& header, Section offsets, Section target) {
+            const std::uint32_t* data = SectionData<std::uint32_t>(file, header, offsets);
+            const std::uint64_t count = SectionCount(header, offsets);
+            bool sorted = true;
+            for (std::uint64_t i = 1; i < count; ++i) sorted &= data[i - 1] <= data[i];
+            return sorted && data[count - 1] == SectionCount(header, target);
+        }
+
+        // Номера строк словаря меньше числа строк
+        bool ValidItems(const MappedFile& file, const CacheHeader& header, Section section, std::uint64_t items) {
+            const std::uint32_t* data = SectionData<std::uint32_t>(file, header, section);
+            const std::uint64_t count = SectionCount(header, section);
+            std::uint32_t largest = 0;
+            for (std::uint64_t i = 0; i < count; ++i) largest = std::max(largest, data[i]);
+            return count == 0 || largest < items;
+        }
+
+        // Значения внутри секций: поиск берет по ним строки и счетчики без проверок.
+        // Один проход по смещениям и спискам - все равно намного быстрее разбора .txt
+        bool ValidateContents(const MappedFile& file, const CacheHeader& header) {
+            const std::uint64_t items = SectionCount(header, ORDER);
+            return ValidOffsets(file, header, ARENA_OFFSETS, ARENA) &&
+                ValidOffsets(file, header, KEY_OFFSETS, KEYS) &&
+                ValidOffsets(file, header, FOLDED_OFFSETS, FOLDED) &&
+                ValidOffsets(file, header, POSTING_OFFSETS, POSTINGS) &&
+                ValidOffsets(file, header, SHORT_OFFSETS, SHORT_POSTINGS) &&
+                ValidItems(file, header, ORDER, items) &&
+                ValidItems(file, header, POSTINGS, items) &&
+                ValidItems(file, header, SHORT_POSTINGS, items);
+        }
+
+        class SectionWriter {
+        public:
+            explicit SectionWriter(std::ofstream& out) : out_(out) {}
+
+            template <class T>
+            void Write(CacheHeader& header, Section section, const MappedArray<T>& data) {
+                const std::uint64_t padding = (SECTION_ALIGN - position_ % SECTION_ALIGN) % SECTION_ALIGN;
+                static const char zeros[SECTION_ALIGN] = {};
+                out_.write(zeros, static_cast<std::streamsize>(padding));
+                position_ += padding;
+
+                header.sections[section][0] = position_;
+                header.sections[section][1] = data.Size();
+                const std::uint64_t bytes = data.Size() * sizeof(T);
+                out_.write(reinterpret_cast<const char*>(data.Data()), static_cast<std::streamsize>(bytes));
+                position_ += bytes;
+            }
+
+            void Skip(std::uint64_t bytes) { position_ += bytes; }
+
+        private:
+            std::ofstream& out_;
+            std::uint64_t position_ = 0;
+        };
+    }
+
+    std::uint64_t HashBytes(std::string_view bytes) {
+        // FNV-1a
+        std::uint64_t hash = 14695981039346656037ull;
+        for (const char ch : bytes) {
+            hash ^= static_cast<unsigned char>(ch);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    bool ReadSourceStamp(const std::filesystem::path& source, SourceStamp& stamp) {
+        std::error_code error;
+        stamp.size = std::filesystem::file_size(source, error);
+        if (error) return false;
+        stamp.time = static_cast<std::int64_t>(std::filesystem::last_write_time(source, error).time_since_epoch().count());
+        return !error;
+    }
+
+    std::filesystem::path CachePathFor(const std::filesystem::path& source) {
+        std::filesystem::path cache = source;
+        cache += ".mcdict";
+        return cache;
+    }
+
+    bool OpenDictionaryCache(const std::filesystem::path& source, const SourceStamp& stamp, LoadedDictionary& dictionary) {
+        MappedFile file;
+        try {
+            file = MappedFile(CachePathFor(source), false);
+        }
+        catch (const std::exception&) {
+            return false;
+        }
+        if (file.Size() < sizeof(CacheHeader)) return false;
+
+        CacheHeader header;
+        std::memcpy(&header, file.Data(), sizeof(header));
+        if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 ||
+            header.version != CACHE_VERSION || header.wcharSize != sizeof(wchar_t) ||
+            header.sourceSize != stamp.size || !ValidateHeader(header, file.Size()) ||
+            !ValidateContents(file, header)) {
+            return false;
+        }
+
+        // Время изменилось при том же размере: файл могли просто сохранить заново
+        if (header.sourceTime != stamp.time) {
+            std::string bytes;
+            if (!ReadWholeFile(source, bytes) || HashBytes(bytes) != header.sourceHash) return false;
+        }
+
+        const std::size_t items = static_cast<std::size_t>(SectionCount(header, ORDER));
+        dictionary.items.Map(SectionData<wchar_t>(file, header, ARENA), SectionCount(header, ARENA),
+            SectionData<std::uint32_t>(file, header, ARENA_OFFSETS), SectionCount(header, ARENA_OFFSETS));
+        dictionary.index.Map(SectionData<wchar_t>(file, header, KEYS), SectionCount(header, KEYS),
+            SectionData<std::uint32_t>(file, header, KEY_OFFSETS), SectionData<std::uint32_t>(file, header, ORDER), items);
+        dictionary.trigrams.Map(SectionData<wchar_t>(file, header, FOLDED), SectionCount(header, FOLDED),
+            SectionData<std::uint32_t>(file, header, FOLDED_OFFSETS), items,
+            SectionData<std::uint64_t>(file, header, TRIGRAM_KEYS), SectionData<std::uint32_t>(file, header, POSTING_OFFSETS),
+            SectionCount(header, TRIGRAM_KEYS),
+            SectionData<std::uint32_t>(file, header, POSTINGS), SectionCount(header, POSTINGS));
+        dictionary.trigrams.MapShort(SectionData<std::uint64_t>(file, header, SHORT_KEYS),
+            SectionData<std::uint32_t>(file, header, SHORT_OFFSETS), SectionCount(header, SHORT_KEYS),
+            SectionData<std::uint32_t>(file, header, SHORT_POSTINGS), SectionCount(header, SHORT_POSTINGS));
+        dictionary.cache = std::move(file);
+        dictionary.opened = true;
+        return true;
+    }
+
+    bool SaveDictionaryCache(const std::filesystem::path& source, const SourceStamp& stamp, const LoadedDictionary& dictionary) {
+        const std::filesystem::path cache = CachePathFor(source);
+        // Свое имя временного файла: кэш одного словаря могут сохранять сразу несколько окон
+        // или загрузка и перезагрузка в одном окне
+        std::random_device random;
+        std::filesystem::path temp = cache;
+        temp += "." + std::to_string(random()) + ".tmp";
+
+        CacheHeader header = {};
+        std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+        header.version = CACHE_VERSION;
+        header.wcharSize = sizeof(wchar_t);
+        header.sourceSize = stamp.size;
+        header.sourceTime = stamp.time;
+        header.sourceHash = stamp.hash;
+
+        {
+            std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+            if (!out.is_open()) return false;
+
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            SectionWriter writer(out);
+            writer.Skip(sizeof(header));
+            writer.Write(header, ARENA, dictionary.items.Arena());
+            writer.Write(header, ARENA_OFFSETS, dictionary.items.Offsets());
+            writer.Write(header, KEYS, dictionary.index.Keys());
+            writer.Write(header, KEY_OFFSETS, dictionary.index.KeyOffsets());
+            writer.Write(header, ORDER, dictionary.index.Order());
+            writer.Write(header, FOLDED, dictionary.trigrams.Folded());
+            writer.Write(header, FOLDED_OFFSETS, dictionary.trigrams.Offsets());
+            writer.Write(header, TRIGRAM_KEYS, dictionary.trigrams.TrigramKeys());
+            writer.Write(header, POSTING_OFFSETS, dictionary.trigrams.PostingOffsets());
+            writer.Write(header, POSTINGS, dictionary.trigrams.Postings());
+            writer.Write(header, SHORT_KEYS, dictionary.trigrams.ShortKeys());
+            writer.Write(header, SHORT_OFFSETS, dictionary.trigrams.ShortOffsets());
+            writer.Write(header, SHORT_POSTINGS, dictionary.trigrams.ShortPostings());
+
+            out.seekp(0);
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            if (!out.flush()) {
+                out.close();
+                std::error_code ignored;
+                std::filesystem::remove(temp, ignored);
+                return false;
+            }
+        }
+
+        std::error_code error;
+        std::filesystem::rename(temp, cache, error);
+        if (error) {
+            std::filesystem::remove(temp, error);
+            return false;
+        }
+        return true;
+    }
+}
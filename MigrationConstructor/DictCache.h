@@ -0,0 +1,33 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+
+// Скомпилированный словарь .mcdict: перекодированные строки, ключи в верхнем регистре,
+// индекс префиксов и индекс триграмм. Файл отображается в память только для чтения,
+// поэтому несколько запущенных экземпляров делят одни и те же страницы
+namespace mc {
+    struct LoadedDictionary;
+
+    // Отпечаток исходного .txt: размер и время изменения, хеш - при расхождении времени
+    struct SourceStamp {
+        std::uint64_t size = 0;
+        std::int64_t time = 0;
+        std::uint64_t hash = 0;
+    };
+
+    std::uint64_t HashBytes(std::string_view bytes);
+
+    // false, если исходного файла нет
+    bool ReadSourceStamp(const std::filesystem::path& source, SourceStamp& stamp);
+
+    // <файл>.mcdict рядом с исходным
+    std::filesystem::path CachePathFor(const std::filesystem::path& source);
+
+    // Отображает кэш в dictionary, если он соответствует исходному файлу
+    bool OpenDictionaryCache(const std::filesystem::path& source, const SourceStamp& stamp, LoadedDictionary& dictionary);
+
+    // Записывает кэш через временный файл и переименование; false при ошибке записи
+    bool SaveDictionaryCache(const std::filesystem::path& source, const SourceStamp& stamp, const LoadedDictionary& dictionary);
+}
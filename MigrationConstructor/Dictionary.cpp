@@ -0,0 +1,75 @@
+﻿#include "Dictionary.h"
+#include "Encoding.h"
+
+#include <algorithm>
+#include <fstream>
+
+namespace mc {
+    bool ReadWholeFile(const std::filesystem::path& path, std::string& bytes) {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file.is_open()) {
+            bytes.clear();
+            return false;
+        }
+
+        const std::streamoff size = file.tellg();
+        bytes.assign(size > 0 ? static_cast<size_t>(size) : 0, '\0');
+        file.seekg(0);
+        file.read(&bytes[0], static_cast<std::streamsize>(bytes.size()));
+        bytes.resize(static_cast<size_t>(file.gcount()));
+        return true;
+    }
+
+    bool Dictionary::Load(const std::filesystem::path& path) {
+        std::string bytes;
+        const bool opened = ReadWholeFile(path, bytes);
+        Assign(bytes);
+        return opened;
+    }
+
+    void Dictionary::Assign(std::string_view bytes) {
+        std::vector<wchar_t>& arena = arena_.Owned();
+        std::vector<std::uint32_t>& offsets = offsets_.Owned();
+        arena.clear();
+        offsets.clear();
+
+        offsets.reserve(static_cast<size_t>(std::count(bytes.begin(), bytes.end(), '\n')) + 2);
+
+        // Перекодирование всего буфера за раз (кодировка и BOM - по содержимому),
+        // затем разметка строк на месте. Переводы строк превращаются в L'\0', поэтому буфер не растет
+        DecodeText(bytes, arena);
+
+        size_t write = 0;
+        size_t lineStart = 0;
+        for (size_t read = 0; read < arena.size(); ++read) {
+            const wchar_t ch = arena[read];
+            if (ch == L'\r') continue;
+            if (ch != L'\n') {
+                arena[write++] = ch;
+                continue;
+            }
+            if (write > lineStart) {
+                offsets.push_back(static_cast<std::uint32_t>(lineStart));
+                arena[write++] = L'\0';
+                lineStart = write;
+            }
+        }
+        if (write > lineStart) {
+            offsets.push_back(static_cast<std::uint32_t>(lineStart));
+            arena.resize(write);
+            arena.push_back(L'\0');
+            write = arena.size();
+        }
+        arena.resize(write);
+        offsets.push_back(static_cast<std::uint32_t>(arena.size()));
+    }
+
+    std::vector<std::wstring_view> Dictionary::Views() const {
+        std::vector<std::wstring_view> views;
+        views.reserve(Size());
+        for (size_t i = 0; i < Size(); ++i) {
+            views.push_back((*this)[i]);
+        }
+        return views;
+    }
+}
@@ -0,0 +1,55 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "MappedArray.h"
+
+// Словарь выпадающего списка: все строки в одном буфере, по строке на запись,
+// плюс таблица смещений. Строки выдаются как wstring_view
+namespace mc {
+    // Весь файл одним чтением; false, если файл не открылся
+    bool ReadWholeFile(const std::filesystem::path& path, std::string& bytes);
+
+    class Dictionary {
+    public:
+        // Файл читается одним блоком; false, если файл не открылся
+        bool Load(const std::filesystem::path& path);
+
+        // Текст UTF-8, UTF-16 или CP1251 (DecodeText); '\r' отбрасывается, пустые строки пропускаются
+        void Assign(std::string_view bytes);
+
+        std::size_t Size() const { return offsets_.Empty() ? 0 : offsets_.Size() - 1; }
+        bool Empty() const { return Size() == 0; }
+
+        std::wstring_view operator[](std::size_t i) const {
+            return std::wstring_view(arena_.Data() + offsets_[i], offsets_[i + 1] - offsets_[i] - 1);
+        }
+
+        // Строка с завершающим нулем (для CB_ADDSTRING)
+        const wchar_t* CStr(std::size_t i) const { return arena_.Data() + offsets_[i]; }
+
+        std::vector<std::wstring_view> Views() const;
+
+        // Занятая память: буфер строк и таблица смещений
+        std::size_t MemoryBytes() const {
+            return arena_.MemoryBytes() + offsets_.MemoryBytes();
+        }
+
+        // Доступ к буферам для кэша .mcdict
+        const MappedArray<wchar_t>& Arena() const { return arena_; }
+        const MappedArray<std::uint32_t>& Offsets() const { return offsets_; }
+        void Map(const wchar_t* arena, std::size_t arenaSize, const std::uint32_t* offsets, std::size_t offsetCount) {
+            arena_.Map(arena, arenaSize);
+            offsets_.Map(offsets, offsetCount);
+        }
+
+    private:
+        MappedArray<wchar_t> arena_;          // строки через L'\0'
+        MappedArray<std::uint32_t> offsets_;  // начало строки, offsets_[n] - конец буфера
+    };
+}
@@ -0,0 +1,100 @@
+﻿#include "DictionaryLoader.h"
+#include "DictCache.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace mc {
+    namespace {
+        const TraceSpan traceLoad("LoadDictionary");
+    }
+
+    void LoadedDictionary::Load(const std::filesystem::path& path, bool useCache) {
+        TraceScope trace(traceLoad);
+        SourceStamp stamp;
+        const bool stamped = ReadSourceStamp(path, stamp);
+        fromCache = useCache && stamped && OpenDictionaryCache(path, stamp, *this);
+        if (fromCache) return;
+
+        std::string bytes;
+        opened = ReadWholeFile(path, bytes);
+        items.Assign(bytes);
+        const std::vector<std::wstring_view> views = items.Views();
+        index.Build(views);
+        trigrams.Build(views);
+
+        if (useCache && opened && stamped) {
+            stamp.hash = HashBytes(bytes);
+            SaveDictionaryCache(path, stamp, *this);
+        }
+    }
+
+    DictionaryLoader::~DictionaryLoader() {
+        {
+            // Незапущенные файлы больше не нужны
+            std::lock_guard<std::mutex> lock(mutex_);
+            next_ = files_.size();
+        }
+        Wait();
+    }
+
+    void DictionaryLoader::Start(std::vector<std::filesystem::path> files, Callback onLoaded, unsigned threads, bool useCache) {
+        Wait();
+
+        files_ = std::move(files);
+        onLoaded_ = std::move(onLoaded);
+        useCache_ = useCache;
+        results_.clear();
+        results_.resize(files_.size());
+        next_ = 0;
+
+        std::vector<std::uintmax_t> sizes(files_.size());
+        for (std::size_t i = 0; i < files_.size(); ++i) {
+            std::error_code error;
+            sizes[i] = std::filesystem::file_size(files_[i], error);
+            if (error) sizes[i] = 0;
+        }
+        order_.resize(files_.size());
+        std::iota(order_.begin(), order_.end(), std::size_t(0));
+        std::stable_sort(order_.begin(), order_.end(), [&](std::size_t a, std::size_t b) { return sizes[a] < sizes[b]; });
+
+        if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+        threads = static_cast<unsigned>(std::min<std::size_t>(threads, files_.size()));
+        for (unsigned i = 0; i < threads; ++i) {
+            threads_.emplace_back(&DictionaryLoader::Worker, this);
+        }
+    }
+
+    void DictionaryLoader::Worker() {
+        for (;;) {
+            std::size_t slot;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (next_ >= files_.size()) return;
+                slot = order_[next_++];
+            }
+
+            auto loaded = std::make_unique<LoadedDictionary>();
+            loaded->Load(files_[slot], useCache_);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                results_[slot] = std::move(loaded);
+            }
+            if (onLoaded_) onLoaded_(slot);
+        }
+    }
+
+    std::unique_ptr<LoadedDictionary> DictionaryLoader::Take(std::size_t slot) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (slot >= results_.size()) return nullptr;
+        return std::move(results_[slot]);
+    }
+
+    void DictionaryLoader::Wait() {
+        for (std::thread& thread : threads_) {
+            thread.join();
+        }
+        threads_.clear();
+    }
+}
@@ -0,0 +1,64 @@
+﻿#pragma once
+
+#include "Dictionary.h"
+#include "MappedFile.h"
+#include "PrefixIndex.h"
+#include "TrigramIndex.h"
+
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Параллельная загрузка словарей: файл читается и индексируется в пуле потоков,
+// о готовности каждого файла сообщает обратный вызов
+namespace mc {
+    struct LoadedDictionary {
+        Dictionary items;
+        PrefixIndex index;
+        TrigramIndex trigrams;
+        MappedFile cache;        // отображенный .mcdict, на который смотрят массивы выше
+        bool opened = false;
+        bool fromCache = false;
+
+        // Чтение файла и построение индексов (вызывается в потоке пула).
+        // С useCache сначала пробуется <файл>.mcdict, а после разбора он пересохраняется
+        void Load(const std::filesystem::path& path, bool useCache = true);
+    };
+
+    class DictionaryLoader {
+    public:
+        // Вызывается в потоке пула; результат забирается через Take(slot)
+        using Callback = std::function<void(std::size_t slot)>;
+
+        DictionaryLoader() = default;
+        ~DictionaryLoader();
+
+        DictionaryLoader(const DictionaryLoader&) = delete;
+        DictionaryLoader& operator=(const DictionaryLoader&) = delete;
+
+        // threads = 0 - по числу ядер, но не больше числа файлов.
+        // Файлы берутся от меньших к большим, чтобы большинство списков стало доступно сразу
+        void Start(std::vector<std::filesystem::path> files, Callback onLoaded, unsigned threads = 0, bool useCache = true);
+
+        // Готовый словарь слота или nullptr, если он еще загружается или уже забран
+        std::unique_ptr<LoadedDictionary> Take(std::size_t slot);
+
+        void Wait();
+
+    private:
+        void Worker();
+
+        std::vector<std::filesystem::path> files_;
+        std::vector<std::size_t> order_;
+        std::vector<std::unique_ptr<LoadedDictionary>> results_;
+        Callback onLoaded_;
+        bool useCache_ = true;
+        std::mutex mutex_;
+        std::size_t next_ = 0;
+        std::vector<std::thread> threads_;
+    };
+}
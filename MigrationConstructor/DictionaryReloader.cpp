@@ -0,0 +1,181 @@
+﻿#include "DictionaryReloader.h"
+#include "DirectoryWatcher.h"
+
+#include <algorithm>
+#include <map>
+#include <numeric>
+
+namespace mc {
+    DictionarySnapshot DictionaryStore::Snapshot(std::size_t slot) const {
+        return std::atomic_load(&slots_[slot]);
+    }
+
+    void DictionaryStore::Publish(std::size_t slot, DictionarySnapshot snapshot) {
+        std::atomic_store(&slots_[slot], std::move(snapshot));
+    }
+
+    bool DictionaryStore::PublishInitial(std::size_t slot, DictionarySnapshot snapshot) {
+        DictionarySnapshot expected;
+        return std::atomic_compare_exchange_strong(&slots_[slot], &expected, std::move(snapshot));
+    }
+
+    namespace {
+        std::vector<std::uint32_t> SortedItems(const Dictionary& dictionary) {
+            std::vector<std::uint32_t> items(dictionary.Size());
+            std::iota(items.begin(), items.end(), 0u);
+            std::sort(items.begin(), items.end(), [&](std::uint32_t a, std::uint32_t b) {
+                return dictionary[a] < dictionary[b];
+            });
+            return items;
+        }
+
+        // Те же строки в том же порядке: номера строк в снимке остаются прежними
+        bool SameLines(const Dictionary& before, const Dictionary& after) {
+            if (before.Size() != after.Size()) return false;
+            for (std::size_t i = 0; i < before.Size(); ++i) {
+                if (before[i] != after[i]) return false;
+            }
+            return true;
+        }
+    }
+
+    DictionaryDiff DiffDictionaries(const Dictionary& before, const Dictionary& after) {
+        const std::vector<std::uint32_t> left = SortedItems(before);
+        const std::vector<std::uint32_t> right = SortedItems(after);
+
+        DictionaryDiff diff;
+        size_t i = 0;
+        size_t j = 0;
+        while (i < left.size() && j < right.size()) {
+            const int order = before[left[i]].compare(after[right[j]]);
+            if (order < 0) diff.removed.push_back(left[i++]);
+            else if (order > 0) diff.added.push_back(right[j++]);
+            else {
+                ++i;
+                ++j;
+            }
+        }
+        diff.removed.insert(diff.removed.end(), left.begin() + i, left.end());
+        diff.added.insert(diff.added.end(), right.begin() + j, right.end());
+        return diff;
+    }
+
+    struct DictionaryReloader::Watch {
+        std::filesystem::path directory;
+        std::vector<std::size_t> slots;
+        std::unique_ptr<DirectoryWatcher> watcher;
+    };
+
+    DictionaryReloader::DictionaryReloader(DictionaryStore& store) : store_(store) {}
+
+    DictionaryReloader::~DictionaryReloader() {
+        Stop();
+    }
+
+    void DictionaryReloader::Start(std::vector<std::filesystem::path> files, Callback onReloaded,
+        std::chrono::milliseconds quiet, bool useCache) {
+        Stop();
+
+        files_ = std::move(files);
+        onReloaded_ = std::move(onReloaded);
+        quiet_ = quiet;
+        useCache_ = useCache;
+
+        for (size_t slot = 0; slot < files_.size(); ++slot) {
+            std::filesystem::path directory = files_[slot].parent_path();
+            if (directory.empty()) directory = ".";
+            auto found = std::find_if(watches_.begin(), watches_.end(),
+                [&](const std::unique_ptr<Watch>& watch) { return watch->directory == directory; });
+            if (found == watches_.end()) {
+                watches_.push_back(std::make_unique<Watch>());
+                watches_.back()->directory = directory;
+                found = watches_.end() - 1;
+            }
+            (*found)->slots.push_back(slot);
+        }
+        // Все наблюдатели создаются до запуска потоков, чтобы ошибка не оставила потоки без Stop
+        for (auto& watch : watches_) {
+            try {
+                watch->watcher = std::make_unique<DirectoryWatcher>(watch->directory);
+            }
+            catch (...) {
+                watches_.clear();
+                throw;
+            }
+        }
+        for (auto& watch : watches_) {
+            threads_.emplace_back(&DictionaryReloader::Worker, this, std::ref(*watch));
+        }
+    }
+
+    void DictionaryReloader::Stop() {
+        for (auto& watch : watches_) {
+            watch->watcher->Stop();
+        }
+        for (std::thread& thread : threads_) {
+            thread.join();
+        }
+        threads_.clear();
+        watches_.clear();
+    }
+
+    void DictionaryReloader::Worker(Watch& watch) {
+        using Clock = std::chrono::steady_clock;
+        std::map<std::size_t, Clock::time_point> pending;   // слот -> когда перечитывать
+        std::vector<std::filesystem::path> changed;
+
+        for (;;) {
+            std::chrono::milliseconds timeout(1000);
+            if (!pending.empty()) {
+                auto due = std::min_element(pending.begin(), pending.end(),
+                    [](const auto& a, const auto& b) { return a.second < b.second; })->second;
+                timeout = std::max(std::chrono::milliseconds(0),
+                    std::chrono::duration_cast<std::chrono::milliseconds>(due - Clock::now()));
+            }
+
+            changed.clear();
+            if (!watch.watcher->Wait(timeout, changed)) return;
+
+            // Каждое новое событие откладывает перечитывание файла
+            const Clock::time_point now = Clock::now();
+            for (const std::filesystem::path& name : changed) {
+                for (std::size_t slot : watch.slots) {
+                    if (files_[slot].filename() == name) pending[slot] = now + quiet_;
+                }
+            }
+
+            for (auto it = pending.begin(); it != pending.end();) {
+                if (it->second <= now) {
+                    Reload(it->first);
+                    it = pending.erase(it);
+                }
+                else {
+                    ++it;
+                }
+            }
+        }
+    }
+
+    void DictionaryReloader::Reload(std::size_t slot) {
+        auto loaded = std::make_shared<LoadedDictionary>();
+        loaded->Load(files_[slot], useCache_);
+        ++reads_;
+        // Файл мог исчезнуть на время сохранения - остается прежний снимок
+        if (!loaded->opened) return;
+
+        const DictionarySnapshot current = store_.Snapshot(slot);
+        DictionaryDiff diff;
+        if (current) {
+            // Публикуется и перестановка строк: разница пуста, но номера строк в снимке другие
+            if (SameLines(current->items, loaded->items)) return;
+            diff = DiffDictionaries(current->items, loaded->items);
+        }
+        else {
+            diff.added.resize(loaded->items.Size());
+            std::iota(diff.added.begin(), diff.added.end(), 0u);
+        }
+
+        store_.Publish(slot, std::move(loaded));
+        if (onReloaded_) onReloaded_(slot, diff);
+    }
+}
@@ -0,0 +1,92 @@
+﻿#pragma once
+
+#include "DictionaryLoader.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Горячая перезагрузка словарей: измененный файл перечитывается, сравнивается с текущим
+// содержимым и публикуется новым неизменяемым снимком. Читатели держат свой снимок
+// и не блокируются на время перезагрузки
+namespace mc {
+    using DictionarySnapshot = std::shared_ptr<const LoadedDictionary>;
+
+    // Текущие снимки словарей по слотам; замена атомарна
+    class DictionaryStore {
+    public:
+        explicit DictionaryStore(std::size_t slots = 0) : slots_(slots) {}
+
+        // Число слотов задается до появления читателей
+        void Resize(std::size_t slots) { slots_.assign(slots, nullptr); }
+        std::size_t Size() const { return slots_.size(); }
+
+        // nullptr, пока словарь не загружен
+        DictionarySnapshot Snapshot(std::size_t slot) const;
+
+        void Publish(std::size_t slot, DictionarySnapshot snapshot);
+
+        // Только в пустой слот: первоначальная загрузка не затирает уже перезагруженный словарь
+        bool PublishInitial(std::size_t slot, DictionarySnapshot snapshot);
+
+    private:
+        std::vector<DictionarySnapshot> slots_;
+    };
+
+    // Строки, которые появились (индексы в новом словаре) и пропали (индексы в старом)
+    struct DictionaryDiff {
+        std::vector<std::uint32_t> added;
+        std::vector<std::uint32_t> removed;
+
+        bool Empty() const { return added.empty() && removed.empty(); }
+    };
+
+    // Сравнение как мультимножеств: порядок строк не учитывается, повторы учитываются.
+    // Для уведомления; решение о публикации принимается по строкам в порядке файла
+    DictionaryDiff DiffDictionaries(const Dictionary& before, const Dictionary& after);
+
+    class DictionaryReloader {
+    public:
+        // Вызывается в потоке наблюдения после публикации нового снимка. Снимок публикуется,
+        // если строки или их порядок изменились; при одной перестановке разница пуста
+        using Callback = std::function<void(std::size_t slot, const DictionaryDiff& diff)>;
+
+        explicit DictionaryReloader(DictionaryStore& store);
+        ~DictionaryReloader();
+
+        DictionaryReloader(const DictionaryReloader&) = delete;
+        DictionaryReloader& operator=(const DictionaryReloader&) = delete;
+
+        // files[i] публикуется в слот i. Каталоги файлов отслеживаются каждый своим потоком.
+        // Файл перечитывается, когда изменения в нем затихли на quiet (редакторы пишут частями).
+        // Бросает std::runtime_error, если каталог нельзя отслеживать
+        void Start(std::vector<std::filesystem::path> files, Callback onReloaded,
+            std::chrono::milliseconds quiet = std::chrono::milliseconds(200), bool useCache = true);
+
+        void Stop();
+
+        // Сколько раз словари перечитывались (в том числе без изменений)
+        std::size_t ReadCount() const { return reads_; }
+
+    private:
+        struct Watch;
+
+        void Worker(Watch& watch);
+        void Reload(std::size_t slot);
+
+        DictionaryStore& store_;
+        std::vector<std::filesystem::path> files_;
+        Callback onReloaded_;
+        std::chrono::milliseconds quiet_{ 0 };
+        bool useCache_ = true;
+        std::atomic<std::size_t> reads_{ 0 };
+        std::vector<std::unique_ptr<Watch>> watches_;
+        std::vector<std::thread> threads_;
+    };
+}
@@ -0,0 +1,135 @@
+﻿#include "DirectoryWatcher.h"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cstdint>
+#endif
+
+namespace mc {
+#ifdef _WIN32
+    namespace {
+        constexpr DWORD WATCH_FILTER = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE;
+        constexpr size_t BUFFER_WORDS = 16384;   // 64 КБ, выравнивание по DWORD
+    }
+
+    DirectoryWatcher::DirectoryWatcher(const std::filesystem::path& directory) : buffer_(BUFFER_WORDS) {
+        directory_ = CreateFileW(directory.c_str(), FILE_LIST_DIRECTORY,
+            FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING,
+            FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL);
+        if (directory_ == INVALID_HANDLE_VALUE) {
+            directory_ = nullptr;
+            throw std::runtime_error("Ошибка открытия каталога: " + directory.u8string());
+        }
+        changeEvent_ = CreateEventW(NULL, TRUE, FALSE, NULL);
+        stopEvent_ = CreateEventW(NULL, TRUE, FALSE, NULL);
+        overlapped_ = new OVERLAPPED();
+        static_cast<OVERLAPPED*>(overlapped_)->hEvent = changeEvent_;
+        if (!changeEvent_ || !stopEvent_ || !Arm()) {
+            Close();
+            throw std::runtime_error("Ошибка отслеживания каталога: " + directory.u8string());
+        }
+    }
+
+    DirectoryWatcher::~DirectoryWatcher() {
+        Close();
+    }
+
+    void DirectoryWatcher::Close() {
+        if (directory_) {
+            // Незавершенное чтение должно закончиться до освобождения буфера
+            if (CancelIoEx(directory_, static_cast<OVERLAPPED*>(overlapped_))) {
+                DWORD bytes;
+                GetOverlappedResult(directory_, static_cast<OVERLAPPED*>(overlapped_), &bytes, TRUE);
+            }
+            CloseHandle(directory_);
+        }
+        if (changeEvent_) CloseHandle(changeEvent_);
+        if (stopEvent_) CloseHandle(stopEvent_);
+        delete static_cast<OVERLAPPED*>(overlapped_);
+        directory_ = changeEvent_ = stopEvent_ = overlapped_ = nullptr;
+    }
+
+    bool DirectoryWatcher::Arm() {
+        ResetEvent(changeEvent_);
+        return ReadDirectoryChangesW(directory_, buffer_.data(), static_cast<DWORD>(buffer_.size() * sizeof(unsigned long)),
+            FALSE, WATCH_FILTER, NULL, static_cast<OVERLAPPED*>(overlapped_), NULL) != 0;
+    }
+
+    bool DirectoryWatcher::Wait(std::chrono::milliseconds timeout, std::vector<std::filesystem::path>& changed) {
+        HANDLE events[] = { stopEvent_, changeEvent_ };
+        const DWORD result = WaitForMultipleObjects(2, events, FALSE, static_cast<DWORD>(timeout.count()));
+        if (result == WAIT_OBJECT_0) return false;
+        if (result != WAIT_OBJECT_0 + 1) return true;
+
+        DWORD bytes = 0;
+        if (GetOverlappedResult(directory_, static_cast<OVERLAPPED*>(overlapped_), &bytes, FALSE) && bytes > 0) {
+            const char* entry = reinterpret_cast<const char*>(buffer_.data());
+            for (;;) {
+                const auto* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(entry);
+                if (info->Action != FILE_ACTION_REMOVED && info->Action != FILE_ACTION_RENAMED_OLD_NAME) {
+                    changed.emplace_back(std::wstring(info->FileName, info->FileNameLength / sizeof(wchar_t)));
+                }
+                if (info->NextEntryOffset == 0) break;
+                entry += info->NextEntryOffset;
+            }
+        }
+        // bytes == 0 - буфер переполнился, имена потеряны; изменения увидит следующее чтение
+        return Arm();
+    }
+
+    void DirectoryWatcher::Stop() {
+        SetEvent(stopEvent_);
+    }
+#else
+    DirectoryWatcher::DirectoryWatcher(const std::filesystem::path& directory) : buffer_(65536) {
+        notify_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        stop_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        // Запись через временный файл и переименование дает IN_MOVED_TO, запись на месте - IN_CLOSE_WRITE
+        if (notify_ < 0 || stop_ < 0 ||
+            inotify_add_watch(notify_, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+            Close();
+            throw std::runtime_error("Ошибка отслеживания каталога: " + directory.u8string());
+        }
+    }
+
+    DirectoryWatcher::~DirectoryWatcher() {
+        Close();
+    }
+
+    void DirectoryWatcher::Close() {
+        if (notify_ >= 0) close(notify_);
+        if (stop_ >= 0) close(stop_);
+        notify_ = stop_ = -1;
+    }
+
+    bool DirectoryWatcher::Wait(std::chrono::milliseconds timeout, std::vector<std::filesystem::path>& changed) {
+        pollfd fds[] = { { stop_, POLLIN, 0 }, { notify_, POLLIN, 0 } };
+        if (poll(fds, 2, static_cast<int>(timeout.count())) <= 0) return true;
+        if (fds[0].revents) return false;
+
+        for (;;) {
+            const ssize_t bytes = read(notify_, buffer_.data(), buffer_.size());
+            if (bytes <= 0) break;
+            for (ssize_t offset = 0; offset < bytes;) {
+                const auto* event = reinterpret_cast<const inotify_event*>(buffer_.data() + offset);
+                if (event->len > 0) changed.emplace_back(event->name);
+                offset += sizeof(inotify_event) + event->len;
+            }
+        }
+        return true;
+    }
+
+    void DirectoryWatcher::Stop() {
+        const std::uint64_t one = 1;
+        (void)!write(stop_, &one, sizeof(one));
+    }
+#endif
+}
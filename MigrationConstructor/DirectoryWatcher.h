@@ -0,0 +1,42 @@
+﻿#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Уведомления об изменении файлов в каталоге (inotify / ReadDirectoryChangesW)
+namespace mc {
+    class DirectoryWatcher {
+    public:
+        // Бросает std::runtime_error, если каталог нельзя отслеживать
+        explicit DirectoryWatcher(const std::filesystem::path& directory);
+        ~DirectoryWatcher();
+
+        DirectoryWatcher(const DirectoryWatcher&) = delete;
+        DirectoryWatcher& operator=(const DirectoryWatcher&) = delete;
+
+        // Ждет изменений не дольше timeout и добавляет в changed имена измененных файлов
+        // (без каталога, возможны повторы). false - после Stop()
+        bool Wait(std::chrono::milliseconds timeout, std::vector<std::filesystem::path>& changed);
+
+        // Прерывает Wait из другого потока
+        void Stop();
+
+    private:
+        void Close();
+#ifdef _WIN32
+        bool Arm();
+
+        void* directory_ = nullptr;
+        void* changeEvent_ = nullptr;
+        void* stopEvent_ = nullptr;
+        void* overlapped_ = nullptr;
+        std::vector<unsigned long> buffer_;
+#else
+        int notify_ = -1;
+        int stop_ = -1;
+        std::vector<char> buffer_;
+#endif
+    };
+}
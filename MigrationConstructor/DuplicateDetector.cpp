@@ -0,0 +1,348 @@
+﻿#include "DuplicateDetector.h"
+#include "MigrationParser.h"
+#include "StringSet.h"
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <system_error>
+
+namespace mc {
+    namespace {
+        constexpr int PARTITION_BITS = 6;
+        constexpr std::size_t PARTITION_COUNT = std::size_t(1) << PARTITION_BITS;
+        constexpr int MAX_PARTITION_LEVEL = 4;
+        constexpr std::size_t MAX_MEMORY = std::size_t(3) << 30;   // смещения ключей 32-битные
+        constexpr std::uint64_t REPORTED = std::uint64_t(1) << 63;
+
+        // Раздел ключа на уровне level: следующие PARTITION_BITS бит хеша, начиная со старших
+        std::size_t PartitionOf(std::uint64_t hash, int level) {
+            return static_cast<std::size_t>(hash >> (64 - PARTITION_BITS * (level + 1))) & (PARTITION_COUNT - 1);
+        }
+
+        constexpr std::size_t SPILL_BUFFER = 64 * 1024;
+        constexpr std::size_t READ_BUFFER = 1 << 20;
+
+        // Запись раздела: line, длина ключа, ключ. Хеш не пишется - он дешевле, чем чтение с диска.
+        // Записи копятся в buffer и уходят в файл блоками
+        template <class Partition>
+        void WriteKey(Partition& partition, std::string_view key, std::uint64_t line) {
+            const std::uint32_t length = static_cast<std::uint32_t>(key.size());
+            std::string& buffer = partition.buffer;
+            buffer.append(reinterpret_cast<const char*>(&line), sizeof(line));
+            buffer.append(reinterpret_cast<const char*>(&length), sizeof(length));
+            buffer.append(key);
+            partition.bytes += sizeof(line) + sizeof(length) + key.size();
+            if (buffer.size() >= SPILL_BUFFER) {
+                partition.out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                buffer.clear();
+            }
+        }
+
+        template <class Partition>
+        void ClosePartition(Partition& partition) {
+            partition.out.write(partition.buffer.data(), static_cast<std::streamsize>(partition.buffer.size()));
+            partition.buffer.clear();
+            partition.buffer.shrink_to_fit();
+            partition.out.close();
+            if (!partition.out) throw std::runtime_error("Ошибка записи в файл: " + partition.path.string());
+        }
+
+        template <class Partition>
+        void RemovePartitions(std::vector<Partition>& partitions) {
+            for (Partition& partition : partitions) {
+                partition.out.close();
+                std::error_code ignored;
+                std::filesystem::remove(partition.path, ignored);
+            }
+        }
+
+        class PartitionReader {
+        public:
+            explicit PartitionReader(const std::filesystem::path& path) : in_(path, std::ios::binary) {
+                if (!in_.is_open()) throw std::runtime_error("Ошибка открытия файла: " + path.string());
+            }
+
+            bool Next(std::string_view& key, std::uint64_t& line) {
+                std::uint32_t length = 0;
+                if (!Ensure(sizeof(line) + sizeof(length))) return false;
+                std::memcpy(&line, buffer_.data() + pos_, sizeof(line));
+                std::memcpy(&length, buffer_.data() + pos_ + sizeof(line), sizeof(length));
+                pos_ += sizeof(line) + sizeof(length);
+                if (!Ensure(length)) return false;
+                key = std::string_view(buffer_.data() + pos_, length);
+                pos_ += length;
+                return true;
+            }
+
+            void Rewind() {
+                in_.clear();
+                in_.seekg(0);
+                buffer_.clear();
+                pos_ = 0;
+            }
+
+        private:
+            // В буфере не меньше bytes непрочитанных байт; false, если файл кончился
+            bool Ensure(std::size_t bytes) {
+                if (buffer_.size() - pos_ >= bytes) return true;
+                buffer_.erase(0, pos_);
+                pos_ = 0;
+                const std::size_t have = buffer_.size();
+                buffer_.resize(std::max(READ_BUFFER, bytes));
+                in_.read(buffer_.data() + have, static_cast<std::streamsize>(buffer_.size() - have));
+                buffer_.resize(have + static_cast<std::size_t>(in_.gcount()));
+                return buffer_.size() >= bytes;
+            }
+
+            std::ifstream in_;
+            std::string buffer_;
+            std::size_t pos_ = 0;
+        };
+    }
+
+    // Ключи подряд в одном буфере (длина, байты), слот - 16 байт: младшие 32 бита хеша, смещение ключа
+    // и первая строка. Позиция слота берется из тех же бит, поэтому при росте таблицы ключи не перечитываются.
+    // Повторные вхождения копятся отдельно и группируются в конце
+    class DuplicateDetector::KeyTable {
+    public:
+        void Add(std::uint64_t hash, std::string_view key, std::uint64_t line) {
+            if (NeedsGrow()) Rehash(std::max<std::size_t>(16, slots_.size() * 2));
+
+            const std::uint32_t tag = static_cast<std::uint32_t>(hash);
+            std::size_t i = tag & mask_;
+            for (; slots_[i].key != 0; i = (i + 1) & mask_) {
+                Slot& slot = slots_[i];
+                if (slot.tag != tag || Key(slot.key - 1) != key) continue;
+                if ((slot.line & REPORTED) == 0) {
+                    occurrences_.push_back(Occurrence{ slot.key - 1, slot.line });
+                    slot.line |= REPORTED;
+                }
+                occurrences_.push_back(Occurrence{ slot.key - 1, line });
+                return;
+            }
+
+            const std::uint32_t offset = static_cast<std::uint32_t>(arena_.size());
+            const std::uint32_t length = static_cast<std::uint32_t>(key.size());
+            arena_.append(reinterpret_cast<const char*>(&length), sizeof(length));
+            arena_.append(key);
+            slots_[i] = Slot{ tag, offset + 1, line };
+            ++size_;
+        }
+
+        // Объем после добавления ключа длины keySize (с учетом возможного роста таблицы)
+        std::size_t MemoryAfterAdd(std::size_t keySize) const {
+            const std::size_t slots = NeedsGrow() ? std::max<std::size_t>(16, slots_.size() * 2) : slots_.size();
+            return slots * sizeof(Slot) + arena_.size() + sizeof(std::uint32_t) + keySize +
+                (occurrences_.size() + 1) * sizeof(Occurrence);
+        }
+
+        // Все известные вхождения: первое для каждого ключа и повторные
+        template <class Visit>
+        void ForEach(Visit&& visit) const {
+            for (const Slot& slot : slots_) {
+                if (slot.key != 0) visit(Key(slot.key - 1), slot.line & ~REPORTED);
+            }
+            for (const Occurrence& occurrence : occurrences_) {
+                visit(Key(occurrence.key), occurrence.line);
+            }
+        }
+
+        void Collect(std::vector<DuplicateGroup>& out) {
+            std::sort(occurrences_.begin(), occurrences_.end(), [](const Occurrence& a, const Occurrence& b) {
+                return a.key != b.key ? a.key < b.key : a.line < b.line;
+            });
+            for (std::size_t i = 0; i < occurrences_.size();) {
+                DuplicateGroup group;
+                group.key = Key(occurrences_[i].key);
+                const std::uint32_t key = occurrences_[i].key;
+                for (; i < occurrences_.size() && occurrences_[i].key == key; ++i) {
+                    // После выгрузки в раздел первое вхождение может прийти дважды
+                    if (group.lines.empty() || group.lines.back() != occurrences_[i].line) {
+                        group.lines.push_back(occurrences_[i].line);
+                    }
+                }
+                if (group.lines.size() > 1) out.push_back(std::move(group));
+            }
+        }
+
+        void Clear() {
+            *this = KeyTable();
+        }
+
+    private:
+        struct Slot {
+            std::uint32_t tag;     // младшие биты хеша
+            std::uint32_t key;     // смещение ключа + 1, 0 - пусто
+            std::uint64_t line;    // первая строка; старший бит - повтор уже учтен
+        };
+        struct Occurrence {
+            std::uint32_t key;
+            std::uint64_t line;
+        };
+
+        // Заполнение до 3/4: с частью хеша в слоте длинные цепочки почти не сравнивают ключи
+        bool NeedsGrow() const { return (size_ + 1) * 4 > slots_.size() * 3; }
+
+        std::string_view Key(std::uint32_t offset) const {
+            std::uint32_t length;
+            std::memcpy(&length, arena_.data() + offset, sizeof(length));
+            return std::string_view(arena_.data() + offset + sizeof(length), length);
+        }
+
+        void Rehash(std::size_t capacity) {
+            std::vector<Slot> old(capacity, Slot{ 0, 0, 0 });
+            old.swap(slots_);
+            mask_ = capacity - 1;
+            for (const Slot& slot : old) {
+                if (slot.key == 0) continue;
+                std::size_t i = slot.tag & mask_;
+                while (slots_[i].key != 0) i = (i + 1) & mask_;
+                slots_[i] = slot;
+            }
+        }
+
+        std::string arena_;
+        std::vector<Slot> slots_;
+        std::vector<Occurrence> occurrences_;
+        std::size_t size_ = 0;
+        std::size_t mask_ = 0;
+    };
+
+    // Буферы всех разделов при выгрузке: меньший лимит все равно превышается ими
+    std::size_t DuplicateDetector::MinMemoryBytes() {
+        return PARTITION_COUNT * SPILL_BUFFER;
+    }
+
+    DuplicateDetector::DuplicateDetector(std::size_t memoryBytes, std::filesystem::path spillDir)
+        : memoryBytes_(std::clamp(memoryBytes, MinMemoryBytes(), MAX_MEMORY)),
+        spillDir_(spillDir.empty() ? std::filesystem::temp_directory_path() : std::move(spillDir)),
+        table_(std::make_unique<KeyTable>()) {
+    }
+
+    DuplicateDetector::~DuplicateDetector() {
+        RemovePartitions(partitions_);
+    }
+
+    void DuplicateDetector::Add(std::string_view key, std::uint64_t line) {
+        const std::uint64_t hash = HashString(key);
+        if (partitions_.empty()) {
+            if (table_->MemoryAfterAdd(key.size()) <= memoryBytes_) {
+                table_->Add(hash, key, line);
+                return;
+            }
+            StartSpill();
+        }
+        WriteKey(partitions_[PartitionOf(hash, 0)], key, line);
+        spillBytes_ += sizeof(std::uint64_t) + sizeof(std::uint32_t) + key.size();
+    }
+
+    void DuplicateDetector::OpenPartitions(std::vector<Partition>& partitions, const std::string& prefix) {
+        partitions.resize(PARTITION_COUNT);
+        for (std::size_t i = 0; i < PARTITION_COUNT; ++i) {
+            partitions[i].path = spillDir_ / (prefix + "-" + std::to_string(i) + ".tmp");
+            partitions[i].out.open(partitions[i].path, std::ios::binary | std::ios::trunc);
+            if (!partitions[i].out.is_open()) {
+                throw std::runtime_error("Ошибка создания файла: " + partitions[i].path.string());
+            }
+        }
+    }
+
+    // Таблица выгружается целиком (первые вхождения и повторы), дальше ключи пишутся сразу в разделы
+    void DuplicateDetector::StartSpill() {
+        std::random_device random;
+        OpenPartitions(partitions_, "mcdup-" + std::to_string(random()));
+        table_->ForEach([&](std::string_view key, std::uint64_t line) {
+            WriteKey(partitions_[PartitionOf(HashString(key), 0)], key, line);
+            spillBytes_ += sizeof(std::uint64_t) + sizeof(std::uint32_t) + key.size();
+        });
+        table_->Clear();
+    }
+
+    void DuplicateDetector::ProcessPartition(const std::filesystem::path& path, int level, std::vector<DuplicateGroup>& out) {
+        PartitionReader in(path);
+        KeyTable table;
+        std::string_view key;
+        std::uint64_t line = 0;
+        bool split = false;
+        while (in.Next(key, line)) {
+            if (level < MAX_PARTITION_LEVEL && table.MemoryAfterAdd(key.size()) > memoryBytes_) {
+                split = true;
+                break;
+            }
+            table.Add(HashString(key), key, line);
+        }
+        if (!split) {
+            table.Collect(out);
+            return;
+        }
+
+        // Раздел не помещается: делится по следующим битам хеша. Файлы частей удаляются
+        // и при исключении
+        table.Clear();
+        std::vector<Partition> parts;
+        try {
+            OpenPartitions(parts, path.stem().string() + "-" + std::to_string(level));
+            in.Rewind();
+            std::uint64_t total = 0;
+            while (in.Next(key, line)) {
+                WriteKey(parts[PartitionOf(HashString(key), level)], key, line);
+                total += sizeof(line) + sizeof(std::uint32_t) + key.size();
+            }
+            for (Partition& part : parts) ClosePartition(part);
+            for (Partition& part : parts) {
+                // Все ключи попали в одну часть (например, один ключ повторяется) - дальше делить
+                // бесполезно, часть проверяется целиком сверх лимита
+                ProcessPartition(part.path, part.bytes == total ? MAX_PARTITION_LEVEL : level + 1, out);
+                std::error_code ignored;
+                std::filesystem::remove(part.path, ignored);
+            }
+        }
+        catch (...) {
+            RemovePartitions(parts);
+            throw;
+        }
+    }
+
+    std::vector<DuplicateGroup> DuplicateDetector::Finish() {
+        std::vector<DuplicateGroup> groups;
+        if (partitions_.empty()) {
+            table_->Collect(groups);
+        }
+        else {
+            for (Partition& partition : partitions_) ClosePartition(partition);
+            for (Partition& partition : partitions_) {
+                ProcessPartition(partition.path, 1, groups);
+                std::error_code ignored;
+                std::filesystem::remove(partition.path, ignored);
+            }
+        }
+        table_->Clear();
+
+        std::sort(groups.begin(), groups.end(), [](const DuplicateGroup& a, const DuplicateGroup& b) {
+            return a.lines.front() < b.lines.front();
+        });
+        return groups;
+    }
+
+    DuplicateReport FindDuplicates(std::string_view data, const DuplicateOptions& options) {
+        DuplicateDetector ids(options.memoryBytes / 2, options.spillDir);
+        DuplicateDetector logins(options.memoryBytes / 2, options.spillDir);
+
+        DuplicateReport report;
+        RecordReader reader(data);
+        Record record;
+        while (reader.Next(record)) {
+            ++report.records;
+            if (!record.Field(0).empty()) ids.Add(record.Field(0), record.line);
+            if (!record.Field(1).empty()) logins.Add(record.Field(1), record.line);
+        }
+
+        report.ids = ids.Finish();
+        report.logins = logins.Finish();
+        report.spilled = ids.Spilled() || logins.Spilled();
+        report.spillBytes = ids.SpillBytes() + logins.SpillBytes();
+        return report;
+    }
+}
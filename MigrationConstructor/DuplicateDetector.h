@@ -0,0 +1,76 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Поиск повторяющихся id и логинов в файле миграции за один проход. Ключи хранятся
+// в компактной хеш-таблице с открытой адресацией; если она перерастает лимит памяти,
+// ключи раскладываются по старшим битам хеша в файлы-разделы, и каждый раздел
+// проверяется отдельно (при необходимости делится дальше)
+namespace mc {
+    struct DuplicateGroup {
+        std::string key;
+        std::vector<std::uint64_t> lines;   // все строки с этим ключом по возрастанию
+    };
+
+    class DuplicateDetector {
+    public:
+        // memoryBytes - примерный предел таблицы, не меньше буферов всех разделов (MinMemoryBytes);
+        // spillDir - каталог для разделов (пусто - временный)
+        DuplicateDetector(std::size_t memoryBytes, std::filesystem::path spillDir = {});
+        ~DuplicateDetector();
+
+        DuplicateDetector(const DuplicateDetector&) = delete;
+        DuplicateDetector& operator=(const DuplicateDetector&) = delete;
+
+        void Add(std::string_view key, std::uint64_t line);
+
+        // Повторы по возрастанию первой строки. Ошибки записи разделов - std::runtime_error
+        std::vector<DuplicateGroup> Finish();
+
+        bool Spilled() const { return !partitions_.empty(); }
+        static std::size_t MinMemoryBytes();
+        std::uint64_t SpillBytes() const { return spillBytes_; }
+
+    private:
+        class KeyTable;
+        struct Partition {
+            std::filesystem::path path;
+            std::ofstream out;
+            std::string buffer;
+            std::uint64_t bytes = 0;
+        };
+
+        void StartSpill();
+        void OpenPartitions(std::vector<Partition>& partitions, const std::string& prefix);
+        void ProcessPartition(const std::filesystem::path& path, int level, std::vector<DuplicateGroup>& out);
+
+        std::size_t memoryBytes_;
+        std::filesystem::path spillDir_;
+        std::unique_ptr<KeyTable> table_;
+        std::vector<Partition> partitions_;
+        std::uint64_t spillBytes_ = 0;
+    };
+
+    struct DuplicateOptions {
+        std::size_t memoryBytes = std::size_t(256) << 20;   // на обе колонки
+        std::filesystem::path spillDir;
+    };
+
+    struct DuplicateReport {
+        std::uint64_t records = 0;
+        std::vector<DuplicateGroup> ids;
+        std::vector<DuplicateGroup> logins;
+        bool spilled = false;
+        std::uint64_t spillBytes = 0;
+    };
+
+    // Повторы id (первая колонка) и логинов (вторая) в тексте файла миграции
+    DuplicateReport FindDuplicates(std::string_view data, const DuplicateOptions& options = {});
+}
@@ -0,0 +1,749 @@
+﻿#include "Encoding.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define MC_X86 1
+#include <immintrin.h>
+#endif
+
+// Обертка уровня встраивает общий цикл вместе с блочными функциями своего набора команд
+#if defined(__GNUC__)
+#define MC_TARGET(name) __attribute__((target(name)))
+#define MC_FLATTEN __attribute__((flatten))
+#else
+#define MC_TARGET(name)
+#define MC_FLATTEN
+#endif
+
+namespace mc {
+    namespace {
+        constexpr char32_t REPLACEMENT = 0xFFFD;
+        constexpr bool WIDE16 = sizeof(wchar_t) == 2;
+
+        // CP1251 0x80-0xBF; 0xC0-0xFF - А-я подряд (U+0410-U+044F). 0x98 не определен
+        constexpr char16_t CP1251_HIGH[64] = {
+            0x0402, 0x0403, 0x201A, 0x0453, 0x201E, 0x2026, 0x2020, 0x2021,
+            0x20AC, 0x2030, 0x0409, 0x2039, 0x040A, 0x040C, 0x040B, 0x040F,
+            0x0452, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+            0xFFFD, 0x2122, 0x0459, 0x203A, 0x045A, 0x045C, 0x045B, 0x045F,
+            0x00A0, 0x040E, 0x045E, 0x0408, 0x00A4, 0x0490, 0x00A6, 0x00A7,
+            0x0401, 0x00A9, 0x0404, 0x00AB, 0x00AC, 0x00AD, 0x00AE, 0x0407,
+            0x00B0, 0x00B1, 0x0406, 0x0456, 0x0491, 0x00B5, 0x00B6, 0x00B7,
+            0x0451, 0x2116, 0x0454, 0x00BB, 0x0458, 0x0405, 0x0455, 0x0457,
+        };
+
+        struct Cp1251Table {
+            char16_t chars[256];
+
+            constexpr Cp1251Table() : chars() {
+                for (unsigned byte = 0; byte < 256; ++byte) {
+                    chars[byte] = static_cast<char16_t>(byte < 0x80 ? byte : byte >= 0xC0 ? byte + 0x350 : CP1251_HIGH[byte - 0x80]);
+                }
+            }
+        };
+
+        constexpr Cp1251Table CP1251{};
+
+        inline wchar_t Cp1251Char(unsigned char byte) {
+            return static_cast<wchar_t>(CP1251.chars[byte]);
+        }
+
+        inline std::size_t WideUnits(char32_t cp) {
+            return WIDE16 && cp >= 0x10000 ? 2 : 1;
+        }
+
+        inline wchar_t* PutCodePoint(char32_t cp, wchar_t* out) {
+            if constexpr (WIDE16) {
+                if (cp >= 0x10000) {
+                    cp -= 0x10000;
+                    *out++ = static_cast<wchar_t>(0xD800 + (cp >> 10));
+                    *out++ = static_cast<wchar_t>(0xDC00 + (cp & 0x3FF));
+                    return out;
+                }
+            }
+            *out++ = static_cast<wchar_t>(cp);
+            return out;
+        }
+
+        inline char* PutUtf8(char32_t cp, char* out) {
+            if (cp < 0x80) {
+                *out++ = static_cast<char>(cp);
+            }
+            else if (cp < 0x800) {
+                *out++ = static_cast<char>(0xC0 | (cp >> 6));
+                *out++ = static_cast<char>(0x80 | (cp & 0x3F));
+            }
+            else if (cp < 0x10000) {
+                *out++ = static_cast<char>(0xE0 | (cp >> 12));
+                *out++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+                *out++ = static_cast<char>(0x80 | (cp & 0x3F));
+            }
+            else {
+                *out++ = static_cast<char>(0xF0 | (cp >> 18));
+                *out++ = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+                *out++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+                *out++ = static_cast<char>(0x80 | (cp & 0x3F));
+            }
+            return out;
+        }
+
+        // Последовательность с ведущим байтом *p >= 0x80: символ или U+FFFD; taken - длина
+        inline char32_t DecodeSequence(const unsigned char* p, const unsigned char* end, std::size_t& taken, bool& valid) {
+            const unsigned char lead = *p;
+            std::size_t length = 0;
+            char32_t cp = 0;
+            char32_t min = 0;
+            if ((lead & 0xE0) == 0xC0) { length = 2; cp = lead & 0x1F; min = 0x80; }
+            else if ((lead & 0xF0) == 0xE0) { length = 3; cp = lead & 0x0F; min = 0x800; }
+            else if ((lead & 0xF8) == 0xF0) { length = 4; cp = lead & 0x07; min = 0x10000; }
+
+            taken = 1;
+            if (length != 0) {
+                while (taken < length && p + taken < end && (p[taken] & 0xC0) == 0x80) {
+                    cp = (cp << 6) | (p[taken] & 0x3F);
+                    ++taken;
+                }
+            }
+            valid = length != 0 && taken == length && cp >= min && cp <= 0x10FFFF && (cp < 0xD800 || cp > 0xDFFF);
+            return valid ? cp : REPLACEMENT;
+        }
+
+        // Общие циклы. Simd::BLOCK - байт (или символов wchar_t) в блоке, 0 - без блоков.
+        // Блок ASCII записывается целиком, засчитывается начало до первого другого символа;
+        // после неполного блока следующий пробуется только за его концом, чтобы кириллица
+        // с пробелами между словами не проверялась заново с каждого пробела
+        struct ScalarBlocks {
+            static constexpr std::size_t BLOCK = 0;
+        };
+
+        template <class Simd>
+        inline Utf8Decoded DecodeUtf8(const char* in, std::size_t size, wchar_t* out, std::size_t outSize) {
+            const auto* const begin = reinterpret_cast<const unsigned char*>(in);
+            const auto* p = begin;
+            const auto* const end = p + size;
+            const auto* vectorFrom = p;
+            wchar_t* w = out;
+            wchar_t* const wEnd = out + outSize;
+            Utf8Decoded result;
+            while (p < end) {
+                const unsigned char lead = *p;
+                if (lead < 0x80) {
+                    if constexpr (Simd::BLOCK != 0) {
+                        if (p >= vectorFrom && static_cast<std::size_t>(end - p) >= Simd::BLOCK &&
+                            static_cast<std::size_t>(wEnd - w) >= Simd::BLOCK) {
+                            const std::size_t ascii = Simd::AsciiToWide(p, w);
+                            if (ascii < Simd::BLOCK) vectorFrom = p + Simd::BLOCK;
+                            p += ascii;
+                            w += ascii;
+                            continue;
+                        }
+                    }
+                    if (w == wEnd) break;
+                    *w++ = static_cast<wchar_t>(lead);
+                    ++p;
+                    continue;
+                }
+                // Двухбайтовые символы (кириллица) - без общего разбора
+                if (lead >= 0xC2 && lead < 0xE0 && end - p >= 2 && (p[1] & 0xC0) == 0x80) {
+                    if (w == wEnd) break;
+                    *w++ = static_cast<wchar_t>(((lead & 0x1F) << 6) | (p[1] & 0x3F));
+                    p += 2;
+                    ++result.multibyte;
+                    continue;
+                }
+                std::size_t taken;
+                bool valid;
+                const char32_t cp = DecodeSequence(p, end, taken, valid);
+                if (static_cast<std::size_t>(wEnd - w) < WideUnits(cp)) break;
+                w = PutCodePoint(cp, w);
+                result.multibyte += valid;
+                result.invalid += !valid;
+                p += taken;
+            }
+            result.read = static_cast<std::size_t>(p - begin);
+            result.written = static_cast<std::size_t>(w - out);
+            return result;
+        }
+
+        template <class Simd>
+        inline Utf8Decoded CheckUtf8(const char* in, std::size_t size) {
+            const auto* p = reinterpret_cast<const unsigned char*>(in);
+            const auto* const end = p + size;
+            const auto* vectorFrom = p;
+            Utf8Decoded result;
+            while (p < end) {
+                if (*p < 0x80) {
+                    if constexpr (Simd::BLOCK != 0) {
+                        if (p >= vectorFrom && static_cast<std::size_t>(end - p) >= Simd::BLOCK) {
+                            if (Simd::IsAscii(p)) {
+                                p += Simd::BLOCK;
+                                continue;
+                            }
+                            vectorFrom = p + Simd::BLOCK;
+                        }
+                    }
+                    ++p;
+                    continue;
+                }
+                if (*p >= 0xC2 && *p < 0xE0 && end - p >= 2 && (p[1] & 0xC0) == 0x80) {
+                    p += 2;
+                    ++result.multibyte;
+                    continue;
+                }
+                std::size_t taken;
+                bool valid;
+                DecodeSequence(p, end, taken, valid);
+                result.multibyte += valid;
+                result.invalid += !valid;
+                p += taken;
+            }
+            return result;
+        }
+
+        template <class Simd>
+        inline std::size_t DecodeCp1251(const char* in, std::size_t size, wchar_t* out) {
+            const auto* p = reinterpret_cast<const unsigned char*>(in);
+            std::size_t i = 0;
+            if constexpr (Simd::BLOCK != 0) {
+                for (; i + Simd::BLOCK <= size; i += Simd::BLOCK) Simd::Cp1251ToWide(p + i, out + i);
+            }
+            for (; i < size; ++i) out[i] = Cp1251Char(p[i]);
+            return size;
+        }
+
+        inline char32_t Utf16Unit(const unsigned char* p, bool bigEndian) {
+            return bigEndian ? (char32_t(p[0]) << 8) | p[1] : p[0] | (char32_t(p[1]) << 8);
+        }
+
+        template <class Simd>
+        inline std::size_t DecodeUtf16(const char* in, std::size_t size, bool bigEndian, wchar_t* out) {
+            const auto* p = reinterpret_cast<const unsigned char*>(in);
+            const std::size_t units = size / 2;
+            wchar_t* w = out;
+            std::size_t i = 0;
+            std::size_t vectorFrom = 0;
+            while (i < units) {
+                if constexpr (Simd::BLOCK != 0) {
+                    constexpr std::size_t BLOCK_UNITS = Simd::BLOCK / 2;
+                    if (i >= vectorFrom && units - i >= BLOCK_UNITS) {
+                        if (Simd::Utf16ToWide(p + 2 * i, bigEndian, w)) {
+                            i += BLOCK_UNITS;
+                            w += BLOCK_UNITS;
+                            continue;
+                        }
+                        vectorFrom = i + BLOCK_UNITS;
+                    }
+                }
+                const char32_t unit = Utf16Unit(p + 2 * i, bigEndian);
+                if constexpr (WIDE16) {
+                    *w++ = static_cast<wchar_t>(unit);
+                    ++i;
+                }
+                else {
+                    if (unit >= 0xD800 && unit <= 0xDBFF && i + 1 < units) {
+                        const char32_t low = Utf16Unit(p + 2 * i + 2, bigEndian);
+                        if (low >= 0xDC00 && low <= 0xDFFF) {
+                            *w++ = static_cast<wchar_t>(0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00));
+                            i += 2;
+                            continue;
+                        }
+                    }
+                    *w++ = static_cast<wchar_t>(unit >= 0xD800 && unit <= 0xDFFF ? REPLACEMENT : unit);
+                    ++i;
+                }
+            }
+            // Оборванный последний символ
+            if (size & 1) *w++ = static_cast<wchar_t>(REPLACEMENT);
+            return static_cast<std::size_t>(w - out);
+        }
+
+        template <class Simd>
+        inline std::size_t EncodeUtf8(const wchar_t* in, std::size_t size, char* out) {
+            char* o = out;
+            std::size_t i = 0;
+            std::size_t vectorFrom = 0;
+            while (i < size) {
+                if constexpr (Simd::BLOCK != 0) {
+                    if (i >= vectorFrom && size - i >= Simd::BLOCK && static_cast<std::uint32_t>(in[i]) < 0x80) {
+                        const std::size_t ascii = Simd::WideAsciiToUtf8(in + i, o);
+                        if (ascii < Simd::BLOCK) vectorFrom = i + Simd::BLOCK;
+                        i += ascii;
+                        o += ascii;
+                        continue;
+                    }
+                }
+                char32_t cp = static_cast<char32_t>(in[i]);
+                if constexpr (WIDE16) {
+                    cp &= 0xFFFF;
+                    if (cp >= 0xD800 && cp <= 0xDBFF && i + 1 < size) {
+                        const char32_t low = static_cast<char32_t>(in[i + 1]) & 0xFFFF;
+                        if (low >= 0xDC00 && low <= 0xDFFF) {
+                            cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                            ++i;
+                        }
+                    }
+                }
+                if ((cp >= 0xD800 && cp <= 0xDFFF) || cp > 0x10FFFF) cp = REPLACEMENT;
+                o = PutUtf8(cp, o);
+                ++i;
+            }
+            return static_cast<std::size_t>(o - out);
+        }
+
+#ifdef MC_X86
+        // Байты 0x80-0xBF блока (биты mask) - по таблице поверх векторного результата
+        inline void PatchCp1251(std::uint32_t mask, const unsigned char* p, wchar_t* out) {
+            while (mask) {
+                const unsigned i = CountTrailingZeros(mask);
+                out[i] = Cp1251Char(p[i]);
+                mask &= mask - 1;
+            }
+        }
+
+        struct Sse2Blocks {
+            static constexpr std::size_t BLOCK = 16;
+
+            // 8 символов по 16 бит
+            MC_TARGET("sse2")
+            static void StoreUnits(__m128i units, wchar_t* out) {
+                if constexpr (WIDE16) {
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), units);
+                }
+                else {
+                    const __m128i zero = _mm_setzero_si128();
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi16(units, zero));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4), _mm_unpackhi_epi16(units, zero));
+                }
+            }
+
+            MC_TARGET("sse2")
+            static bool IsAscii(const unsigned char* p) {
+                return _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))) == 0;
+            }
+
+            // Байт ASCII в начале блока
+            MC_TARGET("sse2")
+            static std::size_t AsciiToWide(const unsigned char* p, wchar_t* out) {
+                const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                const __m128i zero = _mm_setzero_si128();
+                StoreUnits(_mm_unpacklo_epi8(bytes, zero), out);
+                StoreUnits(_mm_unpackhi_epi8(bytes, zero), out + 8);
+                return CountTrailingZeros(static_cast<unsigned>(_mm_movemask_epi8(bytes)) | 0x10000u);
+            }
+
+            // Кириллица 0xC0-0xFF сдвигается на U+0350; редкие 0x80-0xBF (Ё, №, кавычки) - по таблице
+            MC_TARGET("sse2")
+            static void Cp1251ToWide(const unsigned char* p, wchar_t* out) {
+                const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                const __m128i zero = _mm_setzero_si128();
+                const __m128i letter = _mm_set1_epi16(0xBF);
+                const __m128i shift = _mm_set1_epi16(0x350);
+                __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+                __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+                lo = _mm_add_epi16(lo, _mm_and_si128(_mm_cmpgt_epi16(lo, letter), shift));
+                hi = _mm_add_epi16(hi, _mm_and_si128(_mm_cmpgt_epi16(hi, letter), shift));
+                StoreUnits(lo, out);
+                StoreUnits(hi, out + 8);
+                PatchCp1251(static_cast<unsigned>(_mm_movemask_epi8(_mm_cmplt_epi8(bytes, _mm_set1_epi8(-64)))), p, out);
+            }
+
+            // 8 символов UTF-16; false - в блоке суррогат (только для 32-битного wchar_t)
+            MC_TARGET("sse2")
+            static bool Utf16ToWide(const unsigned char* p, bool bigEndian, wchar_t* out) {
+                __m128i units = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                if (bigEndian) units = _mm_or_si128(_mm_slli_epi16(units, 8), _mm_srli_epi16(units, 8));
+                if constexpr (!WIDE16) {
+                    const __m128i surrogate = _mm_cmpeq_epi16(_mm_and_si128(units, _mm_set1_epi16(static_cast<short>(0xF800))),
+                        _mm_set1_epi16(static_cast<short>(0xD800)));
+                    if (_mm_movemask_epi8(surrogate)) return false;
+                }
+                StoreUnits(units, out);
+                return true;
+            }
+
+            // Символов ASCII в начале блока из 16
+            MC_TARGET("sse2")
+            static std::size_t WideAsciiToUtf8(const wchar_t* in, char* out) {
+                const __m128i zero = _mm_setzero_si128();
+                __m128i packed, ascii;
+                if constexpr (WIDE16) {
+                    const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+                    const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 8));
+                    const __m128i high = _mm_set1_epi16(static_cast<short>(0xFF80));
+                    packed = _mm_packus_epi16(a, b);
+                    ascii = _mm_packs_epi16(_mm_cmpeq_epi16(_mm_and_si128(a, high), zero), _mm_cmpeq_epi16(_mm_and_si128(b, high), zero));
+                }
+                else {
+                    const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+                    const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 4));
+                    const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 8));
+                    const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 12));
+                    const __m128i high = _mm_set1_epi32(~0x7F);
+                    packed = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+                    ascii = _mm_packs_epi16(
+                        _mm_packs_epi32(_mm_cmpeq_epi32(_mm_and_si128(a, high), zero), _mm_cmpeq_epi32(_mm_and_si128(b, high), zero)),
+                        _mm_packs_epi32(_mm_cmpeq_epi32(_mm_and_si128(c, high), zero), _mm_cmpeq_epi32(_mm_and_si128(d, high), zero)));
+                }
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out), packed);
+                return CountTrailingZeros(~static_cast<unsigned>(_mm_movemask_epi8(ascii)) | 0x10000u);
+            }
+        };
+
+        struct Avx2Blocks {
+            static constexpr std::size_t BLOCK = 32;
+
+            // 16 символов по 16 бит
+            MC_TARGET("avx2")
+            static void StoreUnits(__m256i units, wchar_t* out) {
+                if constexpr (WIDE16) {
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), units);
+                }
+                else {
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), _mm256_cvtepu16_epi32(_mm256_castsi256_si128(units)));
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 8), _mm256_cvtepu16_epi32(_mm256_extracti128_si256(units, 1)));
+                }
+            }
+
+            MC_TARGET("avx2")
+            static bool IsAscii(const unsigned char* p) {
+                return _mm256_movemask_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))) == 0;
+            }
+
+            MC_TARGET("avx2")
+            static std::size_t AsciiToWide(const unsigned char* p, wchar_t* out) {
+                const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+                StoreUnits(_mm256_cvtepu8_epi16(_mm256_castsi256_si128(bytes)), out);
+                StoreUnits(_mm256_cvtepu8_epi16(_mm256_extracti128_si256(bytes, 1)), out + 16);
+                return CountTrailingZeros(static_cast<std::uint32_t>(_mm256_movemask_epi8(bytes)) | (std::uint64_t(1) << 32));
+            }
+
+            MC_TARGET("avx2")
+            static void Cp1251ToWide(const unsigned char* p, wchar_t* out) {
+                const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+                const __m256i letter = _mm256_set1_epi16(0xBF);
+                const __m256i shift = _mm256_set1_epi16(0x350);
+                __m256i lo = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(bytes));
+                __m256i hi = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(bytes, 1));
+                lo = _mm256_add_epi16(lo, _mm256_and_si256(_mm256_cmpgt_epi16(lo, letter), shift));
+                hi = _mm256_add_epi16(hi, _mm256_and_si256(_mm256_cmpgt_epi16(hi, letter), shift));
+                StoreUnits(lo, out);
+                StoreUnits(hi, out + 16);
+                PatchCp1251(static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpgt_epi8(_mm256_set1_epi8(-64), bytes))), p, out);
+            }
+
+            MC_TARGET("avx2")
+            static bool Utf16ToWide(const unsigned char* p, bool bigEndian, wchar_t* out) {
+                __m256i units = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+                if (bigEndian) units = _mm256_or_si256(_mm256_slli_epi16(units, 8), _mm256_srli_epi16(units, 8));
+                if constexpr (!WIDE16) {
+                    const __m256i surrogate = _mm256_cmpeq_epi16(
+                        _mm256_and_si256(units, _mm256_set1_epi16(static_cast<short>(0xF800))),
+                        _mm256_set1_epi16(static_cast<short>(0xD800)));
+                    if (_mm256_movemask_epi8(surrogate)) return false;
+                }
+                StoreUnits(units, out);
+                return true;
+            }
+
+            // Символов ASCII в начале блока из 32. Упаковка идет внутри 128-битных половин,
+            // поэтому порядок восстанавливается перестановкой
+            MC_TARGET("avx2")
+            static std::size_t WideAsciiToUtf8(const wchar_t* in, char* out) {
+                const __m256i zero = _mm256_setzero_si256();
+                __m256i packed, ascii;
+                if constexpr (WIDE16) {
+                    const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in));
+                    const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + 16));
+                    const __m256i high = _mm256_set1_epi16(static_cast<short>(0xFF80));
+                    packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+                    ascii = _mm256_permute4x64_epi64(_mm256_packs_epi16(_mm256_cmpeq_epi16(_mm256_and_si256(a, high), zero),
+                        _mm256_cmpeq_epi16(_mm256_and_si256(b, high), zero)), 0xD8);
+                }
+                else {
+                    const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in));
+                    const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + 8));
+                    const __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + 16));
+                    const __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + 24));
+                    const __m256i high = _mm256_set1_epi32(~0x7F);
+                    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+                    packed = _mm256_permutevar8x32_epi32(
+                        _mm256_packus_epi16(_mm256_packs_epi32(a, b), _mm256_packs_epi32(c, d)), order);
+                    ascii = _mm256_permutevar8x32_epi32(_mm256_packs_epi16(
+                        _mm256_packs_epi32(_mm256_cmpeq_epi32(_mm256_and_si256(a, high), zero), _mm256_cmpeq_epi32(_mm256_and_si256(b, high), zero)),
+                        _mm256_packs_epi32(_mm256_cmpeq_epi32(_mm256_and_si256(c, high), zero), _mm256_cmpeq_epi32(_mm256_and_si256(d, high), zero))),
+                        order);
+                }
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), packed);
+                return CountTrailingZeros(~static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(ascii))));
+            }
+        };
+#endif
+
+        // Ядра уровня: общий цикл с блоками Simd
+#define MC_ENCODING_KERNELS(Name, Simd, ...)                                                                    \
+        __VA_ARGS__ Utf8Decoded Utf8ToWide##Name(const char* in, std::size_t size, wchar_t* out, std::size_t outSize) { \
+            return DecodeUtf8<Simd>(in, size, out, outSize);                                                    \
+        }                                                                                                       \
+        __VA_ARGS__ std::size_t Cp1251ToWide##Name(const char* in, std::size_t size, wchar_t* out) {            \
+            return DecodeCp1251<Simd>(in, size, out);                                                           \
+        }                                                                                                       \
+        __VA_ARGS__ std::size_t Utf16ToWide##Name(const char* in, std::size_t size, bool bigEndian, wchar_t* out) { \
+            return DecodeUtf16<Simd>(in, size, bigEndian, out);                                                 \
+        }                                                                                                       \
+        __VA_ARGS__ std::size_t WideToUtf8##Name(const wchar_t* in, std::size_t size, char* out) {              \
+            return EncodeUtf8<Simd>(in, size, out);                                                             \
+        }                                                                                                       \
+        __VA_ARGS__ Utf8Decoded CheckUtf8##Name(const char* in, std::size_t size) {                             \
+            return CheckUtf8<Simd>(in, size);                                                                   \
+        }                                                                                                       \
+        const EncodingKernels Name##_KERNELS = {                                                                \
+            Utf8ToWide##Name, Cp1251ToWide##Name, Utf16ToWide##Name, WideToUtf8##Name, CheckUtf8##Name };
+
+        MC_ENCODING_KERNELS(SCALAR, ScalarBlocks)
+#ifdef MC_X86
+        MC_ENCODING_KERNELS(SSE2, Sse2Blocks, MC_TARGET("sse2") MC_FLATTEN)
+        MC_ENCODING_KERNELS(AVX2, Avx2Blocks, MC_TARGET("avx2") MC_FLATTEN)
+#endif
+#undef MC_ENCODING_KERNELS
+
+        const EncodingKernels& Kernels() {
+            static const EncodingKernels& kernels = GetEncodingKernels(DetectSimdLevel());
+            return kernels;
+        }
+
+        // Символов wchar_t в корректном UTF-8: по одному на каждый ведущий байт
+        std::size_t CountWideUnits(std::string_view utf8) {
+            std::size_t units = 0;
+            for (const char ch : utf8) {
+                const auto byte = static_cast<unsigned char>(ch);
+                units += (byte & 0xC0) != 0x80;
+                if constexpr (WIDE16) units += byte >= 0xF0;
+            }
+            return units;
+        }
+
+        // Не меньше длины в UTF-8: одиночный суррогат и символ вне Unicode станут U+FFFD (3 байта)
+        std::size_t Utf8Bound(std::wstring_view wide) {
+            std::size_t bytes = 0;
+            for (const wchar_t ch : wide) {
+                const auto cp = static_cast<std::uint32_t>(ch) & (WIDE16 ? 0xFFFFu : 0xFFFFFFFFu);
+                bytes += cp < 0x80 ? 1 : cp < 0x800 ? 2 : cp >= 0x10000 && cp <= 0x10FFFF ? 4 : 3;
+            }
+            return bytes;
+        }
+
+        template <class Out>
+        Utf8Decoded AppendUtf8AsWideImpl(std::string_view utf8, Out& out) {
+            const EncodingKernels& kernels = Kernels();
+            const std::size_t offset = out.size();
+            out.resize(offset + CountWideUnits(utf8));
+            Utf8Decoded total;
+            for (;;) {
+                const Utf8Decoded part = kernels.utf8ToWide(utf8.data() + total.read, utf8.size() - total.read,
+                    out.data() + offset + total.written, out.size() - offset - total.written);
+                total.read += part.read;
+                total.written += part.written;
+                total.invalid += part.invalid;
+                total.multibyte += part.multibyte;
+                if (total.read == utf8.size()) break;
+                // Байты продолжения без ведущего не учтены при подсчете: на каждый - свой U+FFFD
+                out.resize(offset + total.written + (utf8.size() - total.read) + 2);
+            }
+            out.resize(offset + total.written);
+            return total;
+        }
+
+        template <class Out>
+        void AppendTextAsWideImpl(std::string_view bytes, TextEncoding encoding, Out& out) {
+            const std::size_t offset = out.size();
+            switch (encoding) {
+            case TextEncoding::Utf8:
+                AppendUtf8AsWideImpl(bytes, out);
+                return;
+            case TextEncoding::Cp1251:
+                out.resize(offset + bytes.size());
+                Kernels().cp1251ToWide(bytes.data(), bytes.size(), out.data() + offset);
+                return;
+            case TextEncoding::Utf16Le:
+            case TextEncoding::Utf16Be:
+                out.resize(offset + (bytes.size() + 1) / 2);
+                out.resize(offset + Kernels().utf16ToWide(bytes.data(), bytes.size(),
+                    encoding == TextEncoding::Utf16Be, out.data() + offset));
+                return;
+            }
+        }
+
+        // BOM или признаки UTF-16; false - нужна проверка UTF-8
+        bool DetectWithoutUtf8Check(std::string_view bytes, DetectedEncoding& detected) {
+            if (bytes.size() >= 3 && bytes.compare(0, 3, "\xEF\xBB\xBF") == 0) {
+                detected = { TextEncoding::Utf8, 3 };
+                return true;
+            }
+            if (bytes.size() >= 2 && bytes.compare(0, 2, "\xFF\xFE") == 0) {
+                detected = { TextEncoding::Utf16Le, 2 };
+                return true;
+            }
+            if (bytes.size() >= 2 && bytes.compare(0, 2, "\xFE\xFF") == 0) {
+                detected = { TextEncoding::Utf16Be, 2 };
+                return true;
+            }
+
+            // Старший байт латиницы и цифр в UTF-16 - 0x00, кириллицы - 0x04;
+            // в UTF-8 и CP1251 таких байтов в тексте нет
+            const std::size_t pairs = std::min<std::size_t>(bytes.size(), 4096) / 2;
+            if (pairs == 0) return false;
+            std::size_t evenHigh = 0, oddHigh = 0;
+            for (std::size_t i = 0; i < pairs; ++i) {
+                const auto even = static_cast<unsigned char>(bytes[2 * i]);
+                const auto odd = static_cast<unsigned char>(bytes[2 * i + 1]);
+                evenHigh += even == 0x00 || even == 0x04;
+                oddHigh += odd == 0x00 || odd == 0x04;
+            }
+            if (oddHigh * 10 >= pairs * 9 && evenHigh * 2 < pairs) {
+                detected = { TextEncoding::Utf16Le, 0 };
+                return true;
+            }
+            if (evenHigh * 10 >= pairs * 9 && oddHigh * 2 < pairs) {
+                detected = { TextEncoding::Utf16Be, 0 };
+                return true;
+            }
+            return false;
+        }
+
+        bool LooksLikeCp1251(const Utf8Decoded& check) {
+            return check.invalid > check.multibyte;
+        }
+    }
+
+    const char* EncodingName(TextEncoding encoding) {
+        switch (encoding) {
+        case TextEncoding::Utf16Le: return "UTF-16LE";
+        case TextEncoding::Utf16Be: return "UTF-16BE";
+        case TextEncoding::Cp1251: return "CP1251";
+        default: return "UTF-8";
+        }
+    }
+
+    DetectedEncoding DetectEncoding(std::string_view bytes, bool complete) {
+        DetectedEncoding detected;
+        if (DetectWithoutUtf8Check(bytes, detected)) return detected;
+
+        if (!complete) {
+            // Начало символа, оборванное концом блока, отбрасывается
+            for (std::size_t k = 1; k <= std::min<std::size_t>(4, bytes.size()); ++k) {
+                const auto byte = static_cast<unsigned char>(bytes[bytes.size() - k]);
+                if ((byte & 0xC0) == 0x80) continue;
+                const std::size_t length = byte >= 0xF0 ? 4 : byte >= 0xE0 ? 3 : byte >= 0xC0 ? 2 : 1;
+                if (length > k) bytes.remove_suffix(k);
+                break;
+            }
+        }
+        if (LooksLikeCp1251(Kernels().checkUtf8(bytes.data(), bytes.size()))) detected.encoding = TextEncoding::Cp1251;
+        return detected;
+    }
+
+    void AppendUtf8AsWide(std::string_view utf8, std::wstring& out) {
+        AppendUtf8AsWideImpl(utf8, out);
+    }
+
+    void AppendUtf8AsWide(std::string_view utf8, std::vector<wchar_t>& out) {
+        AppendUtf8AsWideImpl(utf8, out);
+    }
+
+    void AppendWideAsUtf8(std::wstring_view wide, std::string& out) {
+        const std::size_t offset = out.size();
+        out.resize(offset + Utf8Bound(wide));
+        out.resize(offset + Kernels().wideToUtf8(wide.data(), wide.size(), &out[offset]));
+    }
+
+    void AppendTextAsWide(std::string_view bytes, TextEncoding encoding, std::vector<wchar_t>& out) {
+        AppendTextAsWideImpl(bytes, encoding, out);
+    }
+
+    std::size_t CompleteTextLength(std::string_view bytes, TextEncoding encoding) {
+        const auto* data = reinterpret_cast<const unsigned char*>(bytes.data());
+        std::size_t size = bytes.size();
+        switch (encoding) {
+        case TextEncoding::Cp1251:
+            return size;
+        case TextEncoding::Utf16Le:
+        case TextEncoding::Utf16Be: {
+            // Нечетный байт и старшая половина суррогатной пары ждут следующего блока
+            size &= ~std::size_t(1);
+            if (size < 2) return size;
+            const char32_t unit = Utf16Unit(data + size - 2, encoding == TextEncoding::Utf16Be);
+            return unit >= 0xD800 && unit <= 0xDBFF ? size - 2 : size;
+        }
+        default: {
+            // Ведущий байт, после которого продолжений меньше, чем он требует
+            std::size_t tail = 0;
+            while (tail < 3 && tail < size && (data[size - 1 - tail] & 0xC0) == 0x80) ++tail;
+            if (tail == size) return size;
+            const unsigned char lead = data[size - 1 - tail];
+            const std::size_t length = lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC0 ? 2 : 1;
+            return length > tail + 1 ? size - 1 - tail : size;
+        }
+        }
+    }
+
+    void AppendTextAsUtf8(std::string_view bytes, TextEncoding encoding, std::string& out) {
+        if (encoding == TextEncoding::Utf8) {
+            out.append(bytes);
+            return;
+        }
+        // Через wchar_t частями, чтобы промежуточный буфер не зависел от размера файла.
+        // Часть UTF-16 не разрывает суррогатную пару
+        constexpr std::size_t CHUNK = std::size_t(1) << 20;
+        std::vector<wchar_t> wide;
+        while (!bytes.empty()) {
+            std::size_t take = std::min(bytes.size(), CHUNK);
+            if (take < bytes.size()) take = CompleteTextLength(bytes.substr(0, take), encoding);
+            wide.clear();
+            AppendTextAsWideImpl(bytes.substr(0, take), encoding, wide);
+            AppendWideAsUtf8(std::wstring_view(wide.data(), wide.size()), out);
+            bytes.remove_prefix(take);
+        }
+    }
+
+    TextEncoding DecodeText(std::string_view bytes, std::vector<wchar_t>& out) {
+        DetectedEncoding detected;
+        if (DetectWithoutUtf8Check(bytes, detected)) {
+            AppendTextAsWideImpl(bytes.substr(detected.bomBytes), detected.encoding, out);
+            return detected.encoding;
+        }
+        // Обычно файл в UTF-8: проверка по ходу перекодирования, CP1251 - повторным проходом.
+        // Если CP1251 видна уже по началу файла, UTF-8 не пробуется
+        constexpr std::size_t HEAD_BYTES = 4096;
+        const std::size_t offset = out.size();
+        const bool cp1251 = bytes.size() > HEAD_BYTES && DetectEncoding(bytes.substr(0, HEAD_BYTES), false).encoding == TextEncoding::Cp1251;
+        if (!cp1251 && !LooksLikeCp1251(AppendUtf8AsWideImpl(bytes, out))) return TextEncoding::Utf8;
+        out.resize(offset);
+        AppendTextAsWideImpl(bytes, TextEncoding::Cp1251, out);
+        return TextEncoding::Cp1251;
+    }
+
+    TextEncoding ConvertToUtf8(std::string& bytes) {
+        const DetectedEncoding detected = DetectEncoding(bytes);
+        if (detected.encoding == TextEncoding::Utf8) return detected.encoding;
+        std::string utf8;
+        utf8.reserve(bytes.size());
+        AppendTextAsUtf8(std::string_view(bytes).substr(detected.bomBytes), detected.encoding, utf8);
+        bytes.swap(utf8);
+        return detected.encoding;
+    }
+
+    const EncodingKernels& GetEncodingKernels(SimdLevel level) {
+        if (static_cast<int>(level) > static_cast<int>(DetectSimdLevel())) {
+            level = DetectSimdLevel();
+        }
+        switch (level) {
+#ifdef MC_X86
+        case SimdLevel::Avx2: return AVX2_KERNELS;
+        case SimdLevel::Sse2: return SSE2_KERNELS;
+#endif
+        default: return SCALAR_KERNELS;
+        }
+    }
+}
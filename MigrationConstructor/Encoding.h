@@ -0,0 +1,84 @@
+﻿#pragma once
+
+#include "DelimiterScan.h"
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Перекодирование текста без WinAPI: UTF-8, UTF-16 и CP1251 в wchar_t (UTF-16 на Windows,
+// UTF-32 на Linux) и обратно в UTF-8. Буфер перекодируется целиком, блоки ASCII
+// (и кириллица CP1251) - векторно (SSE2/AVX2), остальное посимвольно
+namespace mc {
+    enum class TextEncoding { Utf8, Utf16Le, Utf16Be, Cp1251 };
+
+    const char* EncodingName(TextEncoding encoding);
+
+    struct DetectedEncoding {
+        TextEncoding encoding = TextEncoding::Utf8;
+        std::size_t bomBytes = 0;       // BOM в начале текста, при перекодировании пропускается
+    };
+
+    // BOM; без него - UTF-16, если через байт стоят 0x00 или 0x04 (старшие байты латиницы
+    // и кириллицы); иначе UTF-8, если неверных последовательностей не больше, чем верных
+    // многобайтовых, и CP1251, если больше. complete = false - bytes только начало файла,
+    // оборванный в конце символ ошибкой не считается
+    DetectedEncoding DetectEncoding(std::string_view bytes, bool complete = true);
+
+    // Добавляет текст к out; неверные последовательности заменяются на U+FFFD, как в MultiByteToWideChar
+    void AppendUtf8AsWide(std::string_view utf8, std::wstring& out);
+    void AppendUtf8AsWide(std::string_view utf8, std::vector<wchar_t>& out);
+    void AppendWideAsUtf8(std::wstring_view wide, std::string& out);
+
+    // Длина начала bytes без оборванного в конце символа: для перекодирования блоками
+    std::size_t CompleteTextLength(std::string_view bytes, TextEncoding encoding);
+
+    // Текст в указанной кодировке без BOM
+    void AppendTextAsWide(std::string_view bytes, TextEncoding encoding, std::vector<wchar_t>& out);
+    void AppendTextAsUtf8(std::string_view bytes, TextEncoding encoding, std::string& out);
+
+    // Кодировка определяется по содержимому, BOM отбрасывается. UTF-8 перекодируется за один
+    // проход: проверка идет по ходу перекодирования
+    TextEncoding DecodeText(std::string_view bytes, std::vector<wchar_t>& out);
+
+    // Текст не в UTF-8 перекодируется в UTF-8 на месте (без BOM); UTF-8 остается как есть.
+    // Возвращает исходную кодировку
+    TextEncoding ConvertToUtf8(std::string& bytes);
+
+    inline std::wstring Utf8ToWide(std::string_view utf8) {
+        std::wstring result;
+        AppendUtf8AsWide(utf8, result);
+        return result;
+    }
+
+    inline std::string WideToUtf8(std::wstring_view wide) {
+        std::string result;
+        AppendWideAsUtf8(wide, result);
+        return result;
+    }
+
+    struct Utf8Decoded {
+        std::size_t read = 0;           // байт прочитано
+        std::size_t written = 0;        // символов wchar_t записано
+        std::size_t invalid = 0;        // неверных последовательностей (заменены на U+FFFD)
+        std::size_t multibyte = 0;      // верных многобайтовых символов
+    };
+
+    // Ядра одного уровня SIMD; результаты всех уровней совпадают
+    struct EncodingKernels {
+        // Перекодирует, пока в out есть место (outSize); остаток - при следующем вызове
+        Utf8Decoded (*utf8ToWide)(const char* in, std::size_t size, wchar_t* out, std::size_t outSize);
+        // out - не меньше size символов
+        std::size_t (*cp1251ToWide)(const char* in, std::size_t size, wchar_t* out);
+        // out - не меньше (size + 1) / 2 символов
+        std::size_t (*utf16ToWide)(const char* in, std::size_t size, bool bigEndian, wchar_t* out);
+        // out - не меньше 3 байт на символ (4 для 32-битного wchar_t)
+        std::size_t (*wideToUtf8)(const wchar_t* in, std::size_t size, char* out);
+        // Проверка UTF-8 без перекодирования (read и written не заполняются)
+        Utf8Decoded (*checkUtf8)(const char* in, std::size_t size);
+    };
+
+    // Уровень выше поддерживаемого процессором понижается
+    const EncodingKernels& GetEncodingKernels(SimdLevel level);
+}
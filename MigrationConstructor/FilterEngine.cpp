@@ -0,0 +1,160 @@
+﻿#include "FilterEngine.h"
+#include "Trace.h"
+
+#include <stdexcept>
+
+namespace mc {
+    namespace {
+        const TraceSpan traceQuery("FilterQuery");
+    }
+
+    FilterEngine::~FilterEngine() {
+        Stop();
+    }
+
+    void FilterEngine::Start(std::size_t slots, Callback onReady) {
+        Stop();
+        slots_.reset(new Slot[slots]);
+        slotCount_ = slots;
+        onReady_ = std::move(onReady);
+        stats_ = FilterStats();
+        stop_ = false;
+        thread_ = std::thread(&FilterEngine::Worker, this);
+    }
+
+    void FilterEngine::Stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+            // Поиск, который идет сейчас, прерывается на ближайшей проверке
+            for (std::size_t i = 0; i < slotCount_; ++i) slots_[i].latest.fetch_add(1);
+        }
+        wake_.notify_all();
+        if (thread_.joinable()) thread_.join();
+    }
+
+    std::uint64_t FilterEngine::Submit(FilterQuery query) {
+        if (query.slot >= slotCount_) throw std::runtime_error("Неверный номер списка фильтра");
+        Slot& slot = slots_[query.slot];
+        const std::uint64_t generation = ++nextGeneration_;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            // Поколение меняется раньше всего: идущий поиск увидит его и остановится
+            slot.latest.store(generation);
+            if (slot.pending) ++stats_.skipped;
+            slot.pending = true;
+            slot.query = std::move(query);
+            slot.queryGeneration = generation;
+            slot.ready = false;
+            ++stats_.submitted;
+        }
+        wake_.notify_one();
+        return generation;
+    }
+
+    void FilterEngine::Cancel(std::size_t slot) {
+        if (slot >= slotCount_) return;
+        std::lock_guard<std::mutex> lock(mutex_);
+        slots_[slot].latest.store(++nextGeneration_);
+        if (slots_[slot].pending) ++stats_.skipped;
+        slots_[slot].pending = false;
+        slots_[slot].ready = false;
+    }
+
+    bool FilterEngine::Take(std::size_t slot, FilterResult& out) {
+        if (slot >= slotCount_) return false;
+        std::lock_guard<std::mutex> lock(mutex_);
+        Slot& s = slots_[slot];
+        // Пока сообщение о готовности шло к окну, мог прийти новый запрос
+        if (!s.ready || s.result.generation != s.latest.load()) return false;
+        s.ready = false;
+        out = std::move(s.result);
+        return true;
+    }
+
+    FilterStats FilterEngine::Stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+    void FilterEngine::Worker() {
+        std::vector<std::uint32_t> items;
+        std::size_t next = 0;
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            // Списки обходятся по кругу, чтобы частый набор в одном не задерживал другой
+            Slot* slot = nullptr;
+            for (std::size_t i = 0; i < slotCount_ && !stop_; ++i) {
+                Slot& candidate = slots_[(next + i) % slotCount_];
+                if (candidate.pending) {
+                    slot = &candidate;
+                    next = (next + i + 1) % slotCount_;
+                    break;
+                }
+            }
+            if (stop_) return;
+            if (!slot) {
+                wake_.wait(lock);
+                continue;
+            }
+
+            const FilterQuery query = std::move(slot->query);
+            const std::uint64_t generation = slot->queryGeneration;
+            slot->pending = false;
+            lock.unlock();
+
+            const bool done = Run(*slot, query, generation, items);
+
+            lock.lock();
+            if (!done) {
+                ++stats_.cancelled;
+                continue;
+            }
+            if (slot->latest.load() != generation) {
+                ++stats_.stale;
+                continue;
+            }
+            slot->result.generation = generation;
+            slot->result.dictionary = query.dictionary;
+            slot->result.text = query.text;
+            slot->result.items.swap(items);
+            slot->ready = true;
+            ++stats_.completed;
+
+            lock.unlock();
+            if (onReady_) onReady_(query.slot, generation);
+            lock.lock();
+        }
+    }
+
+    // false - запрос отменен новым
+    bool FilterEngine::Run(Slot& slot, const FilterQuery& query, std::uint64_t generation, std::vector<std::uint32_t>& items) {
+        items.clear();
+        const CancelToken cancel(slot.latest, generation);
+        if (cancel.Cancelled()) return false;
+        if (!query.dictionary) return true;
+        TraceScope trace(traceQuery);
+
+        const LoadedDictionary& dictionary = *query.dictionary;
+        // Другой снимок словаря - сужать прежний диапазон нельзя
+        if (slot.cursorDictionary.lock() != query.dictionary) {
+            slot.cursor.Reset();
+            slot.cursorDictionary = query.dictionary;
+        }
+
+        if (query.substring && !query.text.empty()) {
+            slot.cursor.Reset();
+            if (!dictionary.trigrams.Search(query.text, MatchMode::Substring, query.maxRanked, slot.ranked, cancel)) return false;
+            if (slot.ranked.empty() &&
+                !dictionary.trigrams.Search(query.text, MatchMode::Fuzzy, query.maxRanked, slot.ranked, cancel)) {
+                return false;
+            }
+            for (const Match& match : slot.ranked) items.push_back(match.item);
+            return true;
+        }
+
+        // Диапазон совпадений по индексу; при дописывании символа сужается предыдущий
+        const PrefixRange range = slot.cursor.Update(dictionary.index, query.text);
+        return dictionary.index.CollectItems(range, items, cancel);
+    }
+}
@@ -0,0 +1,98 @@
+﻿#pragma once
+
+#include "DictionaryReloader.h"
+#include "PrefixIndex.h"
+#include "TrigramIndex.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Фильтр выпадающих списков в фоновом потоке. Каждый запрос получает поколение; новый запрос
+// того же списка отменяет предыдущий (поиск сверяется с поколением по ходу работы),
+// а отдается только результат последнего запроса
+namespace mc {
+    struct FilterQuery {
+        std::size_t slot = 0;           // номер списка
+        DictionarySnapshot dictionary;
+        std::wstring text;
+        bool substring = false;         // поиск по части строки, без совпадений - нечеткий
+        std::size_t maxRanked = 200;    // сколько лучших совпадений при поиске по части строки
+    };
+
+    struct FilterResult {
+        std::uint64_t generation = 0;
+        DictionarySnapshot dictionary;      // снимок, к которому относятся items
+        std::wstring text;
+        std::vector<std::uint32_t> items;   // строки словаря в порядке показа
+    };
+
+    struct FilterStats {
+        std::uint64_t submitted = 0;
+        std::uint64_t completed = 0;    // доведены до конца и отданы
+        std::uint64_t skipped = 0;      // устарели до начала поиска
+        std::uint64_t cancelled = 0;    // прерваны новым запросом по ходу поиска
+        std::uint64_t stale = 0;        // устарели, пока результат передавался
+    };
+
+    class FilterEngine {
+    public:
+        // Вызывается в фоновом потоке, когда результат slot готов; забирается через Take
+        using Callback = std::function<void(std::size_t slot, std::uint64_t generation)>;
+
+        FilterEngine() = default;
+        ~FilterEngine();
+
+        FilterEngine(const FilterEngine&) = delete;
+        FilterEngine& operator=(const FilterEngine&) = delete;
+
+        void Start(std::size_t slots, Callback onReady);
+        void Stop();
+
+        // Ставит запрос в очередь и возвращает его поколение; прежний запрос списка отменяется
+        std::uint64_t Submit(FilterQuery query);
+
+        // Отменяет запрос списка без нового (например, список закрыт)
+        void Cancel(std::size_t slot);
+
+        // Результат списка, только если он от последнего запроса; иначе false
+        bool Take(std::size_t slot, FilterResult& out);
+
+        FilterStats Stats() const;
+
+    private:
+        struct Slot {
+            std::atomic<std::uint64_t> latest{ 0 };
+            bool pending = false;
+            FilterQuery query;
+            std::uint64_t queryGeneration = 0;
+            bool ready = false;
+            FilterResult result;
+            // Состояние поиска принадлежит фоновому потоку
+            PrefixCursor cursor;
+            std::weak_ptr<const LoadedDictionary> cursorDictionary;
+            std::vector<Match> ranked;
+        };
+
+        void Worker();
+        bool Run(Slot& slot, const FilterQuery& query, std::uint64_t generation, std::vector<std::uint32_t>& items);
+
+        std::unique_ptr<Slot[]> slots_;
+        std::size_t slotCount_ = 0;
+        Callback onReady_;
+        std::atomic<std::uint64_t> nextGeneration_{ 0 };
+
+        mutable std::mutex mutex_;
+        std::condition_variable wake_;
+        bool stop_ = false;
+        FilterStats stats_;
+        std::thread thread_;
+    };
+}
@@ -0,0 +1,84 @@
+﻿#include "LastRecord.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+namespace mc {
+    namespace {
+        constexpr std::size_t HEAD_BYTES = 64 * 1024;   // начало файла для определения кодировки
+    }
+
+    bool ReadLastRecord(const std::filesystem::path& path, std::wstring& record, TextEncoding& encoding, std::size_t blockSize) {
+        record.clear();
+        encoding = TextEncoding::Utf8;
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file.is_open()) return false;
+
+        const std::streamoff fileSize = file.tellg();
+        if (fileSize < 0) return false;
+        blockSize = std::max<std::size_t>(blockSize, 2);
+
+        // Кодировка по началу файла
+        std::string head(static_cast<std::size_t>(std::min<std::uint64_t>(HEAD_BYTES, static_cast<std::uint64_t>(fileSize))), '\0');
+        file.seekg(0);
+        if (!file.read(head.data(), static_cast<std::streamsize>(head.size()))) return false;
+        const DetectedEncoding detected = DetectEncoding(head, head.size() == static_cast<std::uint64_t>(fileSize));
+        encoding = detected.encoding;
+        const bool utf16 = encoding == TextEncoding::Utf16Le || encoding == TextEncoding::Utf16Be;
+        const bool bigEndian = encoding == TextEncoding::Utf16Be;
+
+        // Хвост файла растет блоками к началу, пока в нем не окажется начало последней строки.
+        // В UTF-8 и CP1251 перевод строки - байт '\n'; в UTF-16 хвост начинается с четного
+        // смещения и ищется по 16-битным символам
+        std::string tail;
+        std::u16string units;
+        std::uint64_t tailStart = static_cast<std::uint64_t>(fileSize);
+        std::size_t recordOffset = 0;
+        std::size_t recordBytes = 0;
+        for (;;) {
+            std::size_t block = static_cast<std::size_t>(std::min<std::uint64_t>(blockSize, tailStart));
+            if (utf16 && (tailStart - block) % 2 != 0) ++block;
+            tailStart -= block;
+            tail.insert(0, block, '\0');
+            file.seekg(static_cast<std::streamoff>(tailStart));
+            if (!file.read(tail.data(), static_cast<std::streamsize>(block))) return false;
+
+            if (!utf16) {
+                std::string_view found;
+                if (FindLastRecord(std::string_view(tail), tailStart == 0, found)) {
+                    recordOffset = static_cast<std::size_t>(found.data() - tail.data());
+                    recordBytes = found.size();
+                    break;
+                }
+                continue;
+            }
+
+            std::u16string part(block / 2, u'\0');
+            for (std::size_t i = 0; i < part.size(); ++i) {
+                const unsigned char first = static_cast<unsigned char>(tail[2 * i]);
+                const unsigned char second = static_cast<unsigned char>(tail[2 * i + 1]);
+                part[i] = static_cast<char16_t>(bigEndian ? (first << 8) | second : (second << 8) | first);
+            }
+            units.insert(0, part);
+            std::u16string_view found;
+            if (FindLastRecord(std::u16string_view(units), tailStart == 0, found)) {
+                recordOffset = static_cast<std::size_t>(found.data() - units.data()) * 2;
+                recordBytes = found.size() * 2;
+                break;
+            }
+        }
+
+        std::string_view bytes = std::string_view(tail).substr(recordOffset, recordBytes);
+        if (tailStart == 0 && recordOffset == 0) bytes.remove_prefix(std::min(detected.bomBytes, bytes.size()));
+        // Начало без BOM могло быть только латиницей: CP1251 видна и по самой записи
+        if (encoding == TextEncoding::Utf8 && detected.bomBytes == 0 && DetectEncoding(bytes).encoding == TextEncoding::Cp1251) {
+            encoding = TextEncoding::Cp1251;
+        }
+        std::vector<wchar_t> wide;
+        AppendTextAsWide(bytes, encoding, wide);
+        record.assign(wide.begin(), wide.end());
+        return true;
+    }
+}
@@ -0,0 +1,43 @@
+﻿#pragma once
+
+#include "Encoding.h"
+
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+// Последняя запись файла миграции для продолжения нумерации. Файл читается блоками
+// с конца до начала последней непустой строки, поэтому время не зависит от размера файла
+namespace mc {
+    // Поиск в хвосте текста. atStart - хвост начинается с начала текста.
+    // false - последняя строка начинается раньше хвоста и нужен следующий блок
+    template <class CharT>
+    bool FindLastRecord(std::basic_string_view<CharT> tail, bool atStart, std::basic_string_view<CharT>& record) {
+        std::size_t end = tail.size();
+        while (end > 0 && (tail[end - 1] == CharT('\n') || tail[end - 1] == CharT('\r'))) --end;
+
+        const std::size_t lineBreak = tail.find_last_of(CharT('\n'), end == 0 ? 0 : end - 1);
+        if (end != 0 && lineBreak != std::basic_string_view<CharT>::npos) {
+            record = tail.substr(lineBreak + 1, end - lineBreak - 1);
+            return true;
+        }
+        if (!atStart) return false;
+        record = tail.substr(0, end);
+        return true;
+    }
+
+    // Последняя непустая строка текста в памяти (без "\r\n"); пустая, если записей нет
+    template <class CharT>
+    std::basic_string_view<CharT> LastRecord(std::basic_string_view<CharT> text) {
+        std::basic_string_view<CharT> record;
+        FindLastRecord(text, true, record);
+        return record;
+    }
+
+    // Последняя непустая строка файла. Кодировка определяется по BOM или по первому блоку
+    // (DetectEncoding) и возвращается в encoding; BOM отбрасывается.
+    // false, если файл не открывается; record пуст, если в файле нет записей
+    bool ReadLastRecord(const std::filesystem::path& path, std::wstring& record, TextEncoding& encoding,
+        std::size_t blockSize = 64 * 1024);
+}
@@ -0,0 +1,91 @@
+﻿#include "LoginAllocator.h"
+#include "MigrationRow.h"
+
+#include <algorithm>
+
+namespace mc {
+    namespace {
+        constexpr std::size_t BLOCK_WORDS = 8;          // 512 бит
+        constexpr std::size_t BITS_PER_KEY = 10;
+        constexpr int BITS_PER_HASH = 7;                // по 9 бит хеша на номер бита в блоке
+
+        // Номер блока - старшие 32 бита хеша, умноженные на число блоков (без деления)
+        std::size_t BlockOf(std::uint64_t hash, std::size_t blocks) {
+            return static_cast<std::size_t>(((hash >> 32) * blocks) >> 32);
+        }
+
+        // Биты в блоке - из перемешанного хеша, чтобы не зависеть от бит номера блока
+        std::uint64_t BitSource(std::uint64_t hash) {
+            return hash * 0x9E3779B97F4A7C15ull;
+        }
+    }
+
+    void BloomFilter::Reset(std::size_t expected) {
+        capacity_ = std::max<std::size_t>(expected, 1024);
+        blocks_ = capacity_ * BITS_PER_KEY / (BLOCK_WORDS * 64) + 1;
+        words_.assign(blocks_ * BLOCK_WORDS, 0);
+    }
+
+    void BloomFilter::Add(std::uint64_t hash) {
+        std::uint64_t* block = &words_[BlockOf(hash, blocks_) * BLOCK_WORDS];
+        std::uint64_t bits = BitSource(hash);
+        for (int i = 0; i < BITS_PER_HASH; ++i, bits >>= 9) {
+            block[(bits & 511) >> 6] |= std::uint64_t(1) << (bits & 63);
+        }
+    }
+
+    bool BloomFilter::MayContain(std::uint64_t hash) const {
+        if (words_.empty()) return false;
+        const std::uint64_t* block = &words_[BlockOf(hash, blocks_) * BLOCK_WORDS];
+        std::uint64_t bits = BitSource(hash);
+        for (int i = 0; i < BITS_PER_HASH; ++i, bits >>= 9) {
+            if (!(block[(bits & 511) >> 6] >> (bits & 63) & 1)) return false;
+        }
+        return true;
+    }
+
+    // Таблица растет по мере добавления, а не по числу строк: в выгрузках логины повторяются.
+    // Фильтр - с запасом вдвое: выданные логины добавляются без перестройки, пока их не больше загруженных
+    void LoginSet::Assign(std::string_view utf8) {
+        set_.Clear();
+        if (utf8.size() >= 3 && utf8.compare(0, 3, "\xEF\xBB\xBF") == 0) utf8.remove_prefix(3);
+        while (!utf8.empty()) {
+            const std::size_t end = std::min(utf8.find('\n'), utf8.size());
+            std::string_view line = utf8.substr(0, end);
+            if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+            if (!line.empty()) set_.Insert(line);
+            utf8.remove_prefix(std::min(end + 1, utf8.size()));
+        }
+        set_.ShrinkToFit();
+        RebuildFilter(set_.Size() * 2);
+    }
+
+    void LoginSet::Insert(std::string_view login) {
+        if (set_.Size() >= filter_.Capacity()) RebuildFilter(set_.Size() * 2);
+        const std::uint64_t hash = HashString(login);
+        set_.Insert(login, hash);
+        filter_.Add(hash);
+    }
+
+    void LoginSet::RebuildFilter(std::size_t expected) {
+        filter_.Reset(expected);
+        set_.ForEach([this](std::string_view login) { filter_.Add(HashString(login)); });
+    }
+
+    std::string_view LoginAllocator::Next(std::string_view base, long long& counter) {
+        if (login_.size() <= baseSize_ || std::string_view(login_).substr(0, baseSize_) != base) {
+            login_.assign(base);
+            login_ += '_';
+            baseSize_ = base.size();
+        }
+        counter = std::max(counter, 0ll);
+        for (;; ++counter, ++skipped_) {
+            login_.resize(baseSize_ + 1 + IntLength(counter, LOGIN_SUFFIX_WIDTH));
+            WriteInt(&login_[baseSize_ + 1], counter, LOGIN_SUFFIX_WIDTH);
+            if (!taken_.Contains(login_)) break;
+        }
+        if (record_) taken_.Insert(login_);
+        ++counter;
+        return login_;
+    }
+}
@@ -0,0 +1,79 @@
+﻿#pragma once
+
+#include "StringSet.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Выдача свободных логинов base_NN с учетом пользователей, которые уже есть в системе.
+// Занятые логины (миллионы) хранятся в StringSet, перед ним - фильтр Блума: свободный
+// логин почти всегда отсеивается фильтром за одно обращение к памяти, не доходя до таблицы
+namespace mc {
+    // Блочный фильтр Блума: все биты ключа - в одном блоке из 512 бит (кеш-строке), номер
+    // блока и биты берутся из одного 64-битного хеша. Около 10 бит на ключ, ложных
+    // срабатываний - примерно 1%
+    class BloomFilter {
+    public:
+        void Reset(std::size_t expected);
+        void Add(std::uint64_t hash);
+        bool MayContain(std::uint64_t hash) const;
+
+        // Сколько ключей помещается без роста ложных срабатываний
+        std::size_t Capacity() const { return capacity_; }
+        std::size_t MemoryBytes() const { return words_.capacity() * sizeof(std::uint64_t); }
+
+    private:
+        std::vector<std::uint64_t> words_;
+        std::size_t blocks_ = 0;
+        std::size_t capacity_ = 0;
+    };
+
+    // Логины сравниваются побайтно, регистр учитывается
+    class LoginSet {
+    public:
+        // Логины по одному в строке, как в StringSet::Assign
+        void Assign(std::string_view utf8);
+        void Insert(std::string_view login);
+
+        bool Contains(std::string_view login) const {
+            const std::uint64_t hash = HashString(login);
+            return filter_.MayContain(hash) && set_.Contains(login, hash);
+        }
+
+        std::size_t Size() const { return set_.Size(); }
+        std::size_t MemoryBytes() const { return set_.MemoryBytes() + filter_.MemoryBytes(); }
+        const BloomFilter& Filter() const { return filter_; }
+
+    private:
+        void RebuildFilter(std::size_t expected);
+
+        StringSet set_;
+        BloomFilter filter_;
+    };
+
+    // Логины base_NN по возрастанию счетчика, как в UpdateTextBox, но занятые пропускаются.
+    // Выданные логины добавляются в taken и больше не выдаются
+    class LoginAllocator {
+    public:
+        // record = false - выданные логины в taken не добавляются: достаточно, если счетчик
+        // одного base только растет (генерация), и память не зависит от числа выданных
+        explicit LoginAllocator(LoginSet& taken, bool record = true) : taken_(taken), record_(record) {}
+
+        // Свободный логин base с наименьшим счетчиком не меньше counter (отрицательный - с 0);
+        // counter становится следующим после выданного. Строка действительна до следующего вызова
+        std::string_view Next(std::string_view base, long long& counter);
+
+        // Сколько занятых логинов пропущено
+        std::uint64_t Skipped() const { return skipped_; }
+
+    private:
+        LoginSet& taken_;
+        bool record_;
+        std::string login_;         // base_ и суффикс последнего кандидата
+        std::size_t baseSize_ = 0;
+        std::uint64_t skipped_ = 0;
+    };
+}
@@ -0,0 +1,38 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Массив, который либо владеет данными (vector), либо смотрит в отображенный файл (.mcdict)
+namespace mc {
+    template <class T>
+    class MappedArray {
+    public:
+        std::vector<T>& Owned() {
+            mapped_ = nullptr;
+            mappedSize_ = 0;
+            return owned_;
+        }
+
+        void Map(const T* data, std::size_t size) {
+            owned_.clear();
+            owned_.shrink_to_fit();
+            mapped_ = data;
+            mappedSize_ = size;
+        }
+
+        const T* Data() const { return mapped_ ? mapped_ : owned_.data(); }
+        std::size_t Size() const { return mapped_ ? mappedSize_ : owned_.size(); }
+        bool Empty() const { return Size() == 0; }
+        const T& operator[](std::size_t i) const { return Data()[i]; }
+        const T* begin() const { return Data(); }
+        const T* end() const { return Data() + Size(); }
+
+        std::size_t MemoryBytes() const { return owned_.capacity() * sizeof(T); }
+
+    private:
+        std::vector<T> owned_;
+        const T* mapped_ = nullptr;
+        std::size_t mappedSize_ = 0;
+    };
+}
@@ -0,0 +1,109 @@
+﻿#include "MappedFile.h"
+
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace mc {
+#ifdef _WIN32
+    MappedFile::MappedFile(const std::filesystem::path& path, bool sequential) {
+        // FILE_SHARE_DELETE: кэш .mcdict можно заменить, пока он открыт в другом экземпляре
+        HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+            NULL, OPEN_EXISTING, sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE) {
+            throw std::runtime_error("Ошибка открытия файла: " + path.u8string());
+        }
+        file_ = file;
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size)) {
+            Close();
+            throw std::runtime_error("Ошибка чтения размера файла: " + path.u8string());
+        }
+        size_ = static_cast<std::size_t>(size.QuadPart);
+        if (size_ == 0) return;
+
+        mapping_ = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping_) {
+            data_ = static_cast<const char*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+        }
+        if (!data_) {
+            Close();
+            throw std::runtime_error("Ошибка отображения файла в память: " + path.u8string());
+        }
+    }
+
+    void MappedFile::Close() {
+        if (data_) UnmapViewOfFile(data_);
+        if (mapping_) CloseHandle(mapping_);
+        if (file_) CloseHandle(file_);
+        data_ = nullptr;
+        mapping_ = nullptr;
+        file_ = nullptr;
+        size_ = 0;
+    }
+#else
+    MappedFile::MappedFile(const std::filesystem::path& path, bool sequential) {
+        const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw std::runtime_error("Ошибка открытия файла: " + path.u8string());
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            throw std::runtime_error("Ошибка чтения размера файла: " + path.u8string());
+        }
+        size_ = static_cast<std::size_t>(st.st_size);
+        if (size_ == 0) {
+            close(fd);
+            return;
+        }
+
+        void* data = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED) {
+            size_ = 0;
+            throw std::runtime_error("Ошибка отображения файла в память: " + path.u8string());
+        }
+        madvise(data, size_, sequential ? MADV_SEQUENTIAL : MADV_NORMAL);
+        data_ = static_cast<const char*>(data);
+    }
+
+    void MappedFile::Close() {
+        if (data_) munmap(const_cast<char*>(data_), size_);
+        data_ = nullptr;
+        size_ = 0;
+    }
+#endif
+
+    MappedFile::~MappedFile() {
+        Close();
+    }
+
+    MappedFile::MappedFile(MappedFile&& other) noexcept {
+        *this = std::move(other);
+    }
+
+    MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+        if (this != &other) {
+            Close();
+            std::swap(data_, other.data_);
+            std::swap(size_, other.size_);
+#ifdef _WIN32
+            std::swap(file_, other.file_);
+            std::swap(mapping_, other.mapping_);
+#endif
+        }
+        return *this;
+    }
+}
@@ -0,0 +1,36 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <string_view>
+
+// Файл, отображенный в память только для чтения (mmap / CreateFileMapping)
+namespace mc {
+    class MappedFile {
+    public:
+        MappedFile() = default;
+        // Бросает std::runtime_error, если файл не открывается.
+        // sequential - подсказка ОС о чтении подряд (для разбора файлов миграции)
+        explicit MappedFile(const std::filesystem::path& path, bool sequential = true);
+        ~MappedFile();
+
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator=(MappedFile&& other) noexcept;
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        std::string_view View() const { return { data_, size_ }; }
+        const char* Data() const { return data_; }
+        std::size_t Size() const { return size_; }
+
+    private:
+        void Close();
+
+        const char* data_ = nullptr;
+        std::size_t size_ = 0;
+#ifdef _WIN32
+        void* file_ = nullptr;
+        void* mapping_ = nullptr;
+#endif
+    };
+}
@@ -0,0 +1,393 @@
+﻿// mcbench: замеры горячих путей MigrationConstructor на словарях и файлах от 1e3 до 1e7 строк.
+// Результат - JSON (по случаю в строке), сравнение с сохраненным базовым прогоном
+#include "BenchModes.h"
+#include "CaseFold.h"
+#include "DictCache.h"
+#include "DictionaryLoader.h"
+#include "MigrationParser.h"
+#include "MigrationRow.h"
+#include "PrefixIndex.h"
+#include "RowGenerator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cwctype>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+    void PrintUsage() {
+        std::fprintf(stderr,
+            "Использование: mcbench [параметры] - замеры случаев по размерам\n"
+            "       mcbench <режим> [параметры] - сравнение прежнего и нового кода (ниже)\n"
+            "\n"
+            "Случаи:\n"
+            "  load        чтение словаря из .txt и построение индексов (ReadFileToVector), нс на строку\n"
+            "  load-cache  открытие того же словаря из .mcdict, нс на файл\n"
+            "  prefix      фильтр списка при наборе по буквам (FilterComboBox), нс на нажатие\n"
+            "  fold        приведение регистра строк словаря для индексов (FoldCase), нс на символ\n"
+            "  parse       разбор файла миграции на поля (SplitString), нс на запись\n"
+            "  format      сборка записей (UpdateTextBox), нс на запись\n"
+            "\n"
+            "  --cases A,B           случаи (по умолчанию все)\n"
+            "  --sizes N,M           размеры (по умолчанию от 1000 до 10000000)\n"
+            "  --max-size N          размеры 1e3, 1e4... до N (например 10000000)\n"
+            "  --min-time MS         минимальное время замера одного случая (по умолчанию 300)\n"
+            "  --out FILE            записать результат в FILE (по умолчанию stdout)\n"
+            "  --baseline FILE       сравнить с прежним результатом; код возврата 1 при регрессии\n"
+            "  --threshold PCT       допустимое замедление в процентах (по умолчанию 25)\n"
+            "  --dir DIR             каталог для временных словарей (по умолчанию временный)\n"
+            "\n");
+        mc::PrintBenchModes();
+    }
+
+    struct CaseResult {
+        std::string name;
+        std::string unit;               // единица, на которую приходится время
+        std::uint64_t size = 0;
+        double nsPerItem = 0;
+        std::uint64_t repeats = 0;
+    };
+
+    struct BenchOptions {
+        double minMicros = 300000;
+        std::filesystem::path dir = std::filesystem::temp_directory_path();
+    };
+
+    // Повторяет run, пока не наберется minMicros (но не меньше 3 раз); берется лучший повтор,
+    // он меньше всего зависит от соседних процессов. run возвращает число обработанных единиц
+    CaseResult Measure(const std::string& name, const std::string& unit, std::uint64_t size, const BenchOptions& options,
+        const std::function<std::uint64_t()>& run) {
+        CaseResult result{ name, unit, size, 0, 0 };
+        double total = 0;
+        double best = 0;
+        while (result.repeats < 3 || (total < options.minMicros && result.repeats < 1000)) {
+            const auto start = std::chrono::steady_clock::now();
+            const std::uint64_t items = run();
+            const double micros = mc::ElapsedMicros(start);
+            const double perItem = micros * 1000 / static_cast<double>(std::max<std::uint64_t>(items, 1));
+            if (result.repeats == 0 || perItem < best) best = perItem;
+            total += micros;
+            ++result.repeats;
+        }
+        result.nsPerItem = best;
+        return result;
+    }
+
+    // Шаблон, как после заполнения всех комбобоксов окна
+    mc::RowTemplate MakeTemplate() {
+        mc::RowTemplate tmpl;
+        tmpl.loginBase = "ivanov";
+        for (size_t i = 0; i < mc::COLUMN_COUNT; ++i) {
+            tmpl.fields.push_back({ std::string(mc::DictionaryColumnName(i)) + "_VALUE" });
+        }
+        return tmpl;
+    }
+
+    std::vector<CaseResult> RunLoad(std::uint64_t size, const BenchOptions& options, bool cached) {
+        std::mt19937 rng(42);
+        const std::filesystem::path path = options.dir / ("mcbench_" + std::to_string(size) + ".txt");
+        {
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            if (!out.is_open()) throw std::runtime_error("Ошибка открытия файла: " + path.string());
+            for (const std::wstring& item : mc::MakeDictionary(size, rng)) {
+                out << std::string(item.begin(), item.end()) << "\r\n";
+            }
+            if (!out.flush()) throw std::runtime_error("Ошибка записи в файл: " + path.string());
+        }
+        std::filesystem::path cachePath = path;
+        cachePath += ".mcdict";
+        std::error_code error;
+        std::filesystem::remove(cachePath, error);
+
+        CaseResult result;
+        if (cached) {
+            // Первая загрузка сохраняет .mcdict, замеряются следующие. Строки при открытии
+            // не разбираются (проверяются только смещения), поэтому время - на файл
+            mc::LoadedDictionary().Load(path, true);
+            result = Measure("load-cache", "file", size, options, [&] {
+                mc::LoadedDictionary dictionary;
+                dictionary.Load(path, true);
+                if (!dictionary.fromCache || dictionary.items.Size() != size) {
+                    throw std::runtime_error("Словарь не открылся из .mcdict");
+                }
+                return std::uint64_t{ 1 };
+            });
+        }
+        else {
+            result = Measure("load", "line", size, options, [&] {
+                mc::LoadedDictionary dictionary;
+                dictionary.Load(path, false);
+                return static_cast<std::uint64_t>(dictionary.items.Size());
+            });
+        }
+        std::filesystem::remove(path, error);
+        std::filesystem::remove(cachePath, error);
+        return { result };
+    }
+
+    std::vector<CaseResult> RunPrefix(std::uint64_t size, const BenchOptions& options) {
+        std::mt19937 rng(42);
+        const std::vector<std::wstring> items = mc::MakeDictionary(size, rng);
+        mc::PrefixIndex index;
+        index.Build(std::vector<std::wstring_view>(items.begin(), items.end()));
+
+        // Набор слова по буквам (в нижнем регистре), как в CBN_EDITUPDATE
+        std::uniform_int_distribution<size_t> pick(0, items.size() - 1);
+        std::vector<std::wstring> words;
+        for (int q = 0; q < 100; ++q) {
+            std::wstring word = items[pick(rng)].substr(0, 6);
+            for (wchar_t& ch : word) ch = static_cast<wchar_t>(towlower(ch));
+            words.push_back(std::move(word));
+        }
+
+        std::vector<std::uint32_t> matches;
+        return { Measure("prefix", "keystroke", size, options, [&] {
+            std::uint64_t keystrokes = 0;
+            for (const std::wstring& word : words) {
+                mc::PrefixCursor cursor;
+                for (size_t len = 1; len <= word.size(); ++len, ++keystrokes) {
+                    index.CollectItems(cursor.Update(index, std::wstring_view(word).substr(0, len)), matches);
+                }
+            }
+            return keystrokes;
+        }) };
+    }
+
+    std::vector<CaseResult> RunFold(std::uint64_t size, const BenchOptions& options) {
+        std::mt19937 rng(42);
+        const std::vector<std::wstring> items = mc::MakeDictionary(size, rng);
+        size_t chars = 0;
+        for (const std::wstring& item : items) chars += item.size();
+
+        std::vector<wchar_t> folded(chars);
+        return { Measure("fold", "char", size, options, [&] {
+            size_t offset = 0;
+            for (const std::wstring& item : items) {
+                mc::FoldCaseTo(folded.data() + offset, item);
+                offset += item.size();
+            }
+            return static_cast<std::uint64_t>(offset);
+        }) };
+    }
+
+    std::vector<CaseResult> RunRows(std::uint64_t size, const BenchOptions& options, bool parse) {
+        const mc::RowTemplate tmpl = MakeTemplate();
+        std::string text;
+        if (!parse) {
+            return { Measure("format", "row", size, options, [&] {
+                text.clear();
+                mc::FormatRows(text, tmpl, 0, size, "\r\n");
+                return size;
+            }) };
+        }
+
+        mc::FormatRows(text, tmpl, 0, size, "\r\n");
+        std::uint64_t checksum = 0;
+        CaseResult result = Measure("parse", "row", size, options, [&] {
+            mc::RecordReader reader(text);
+            mc::Record record;
+            std::uint64_t rows = 0;
+            for (; reader.Next(record); ++rows) checksum += record.fieldCount + record.Field(1).size();
+            if (rows != size) throw std::runtime_error("Разобрано записей: " + std::to_string(rows));
+            return rows;
+        });
+        if (checksum == 0) throw std::runtime_error("Пустой разбор");
+        return { result };
+    }
+
+    void WriteJson(std::FILE* out, const std::vector<CaseResult>& results) {
+        std::fprintf(out, "{\n  \"version\": 1,\n  \"cases\": [\n");
+        for (size_t i = 0; i < results.size(); ++i) {
+            const CaseResult& r = results[i];
+            std::fprintf(out, "    {\"name\": \"%s\", \"size\": %llu, \"ns_per_item\": %.3f, \"item\": \"%s\", \"repeats\": %llu}%s\n",
+                r.name.c_str(), static_cast<unsigned long long>(r.size), r.nsPerItem, r.unit.c_str(),
+                static_cast<unsigned long long>(r.repeats), i + 1 < results.size() ? "," : "");
+        }
+        std::fprintf(out, "  ]\n}\n");
+    }
+
+    // Значение поля key из строки случая, записанной WriteJson
+    bool JsonField(std::string_view line, std::string_view key, std::string_view& value) {
+        const std::string quoted = "\"" + std::string(key) + "\":";
+        size_t pos = line.find(quoted);
+        if (pos == std::string_view::npos) return false;
+        pos = line.find_first_not_of(' ', pos + quoted.size());
+        if (pos == std::string_view::npos) return false;
+        if (line[pos] == '"') {
+            const size_t end = line.find('"', pos + 1);
+            if (end == std::string_view::npos) return false;
+            value = line.substr(pos + 1, end - pos - 1);
+        }
+        else {
+            const size_t end = line.find_first_of(",}", pos);
+            value = line.substr(pos, end == std::string_view::npos ? std::string_view::npos : end - pos);
+        }
+        return true;
+    }
+
+    std::vector<CaseResult> ReadBaseline(const std::filesystem::path& path) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in.is_open()) throw std::runtime_error("Ошибка открытия файла: " + path.string());
+        std::vector<CaseResult> results;
+        std::string line;
+        while (std::getline(in, line)) {
+            std::string_view name, size, ns;
+            if (!JsonField(line, "name", name) || !JsonField(line, "size", size) || !JsonField(line, "ns_per_item", ns)) continue;
+            CaseResult result;
+            result.name = std::string(name);
+            result.size = static_cast<std::uint64_t>(mc::ParseInt(size, "size"));
+            result.nsPerItem = std::strtod(std::string(ns).c_str(), nullptr);
+            results.push_back(std::move(result));
+        }
+        if (results.empty()) throw std::runtime_error("В базовом прогоне нет случаев: " + path.string());
+        return results;
+    }
+
+    // Печатает сравнение; возвращает число регрессий
+    size_t CompareWithBaseline(const std::vector<CaseResult>& results, const std::vector<CaseResult>& baseline, double threshold) {
+        size_t regressions = 0;
+        for (const CaseResult& r : results) {
+            const auto it = std::find_if(baseline.begin(), baseline.end(), [&](const CaseResult& b) {
+                return b.name == r.name && b.size == r.size;
+            });
+            if (it == baseline.end() || it->nsPerItem <= 0) {
+                std::fprintf(stderr, "%-10s %9llu %12.1f нс/%-9s  нет в базовом прогоне\n", r.name.c_str(),
+                    static_cast<unsigned long long>(r.size), r.nsPerItem, r.unit.c_str());
+                continue;
+            }
+            const double change = (r.nsPerItem / it->nsPerItem - 1) * 100;
+            const bool regressed = change > threshold;
+            regressions += regressed;
+            std::fprintf(stderr, "%-10s %9llu %12.1f нс/%-9s  было %12.1f  %+7.1f%%%s\n", r.name.c_str(),
+                static_cast<unsigned long long>(r.size), r.nsPerItem, r.unit.c_str(), it->nsPerItem, change,
+                regressed ? "  РЕГРЕССИЯ" : "");
+        }
+        return regressions;
+    }
+
+    int Run(mc::Args& args) {
+        std::vector<std::string> cases = { "load", "load-cache", "prefix", "fold", "parse", "format" };
+        std::vector<std::uint64_t> sizes = { 1000, 10000, 100000, 1000000, 10000000 };
+        std::string outPath;
+        std::string baselinePath;
+        double threshold = 25;
+        BenchOptions options;
+
+        std::string_view option;
+        while (args.Next(option)) {
+            if (option == "--cases") {
+                cases.clear();
+                for (std::string_view name : mc::SplitList(args.Value(option))) cases.emplace_back(name);
+            }
+            else if (option == "--sizes") {
+                sizes.clear();
+                for (std::string_view size : mc::SplitList(args.Value(option))) {
+                    sizes.push_back(static_cast<std::uint64_t>(mc::ParseInt(size, option)));
+                }
+            }
+            else if (option == "--max-size") {
+                const long long max = mc::ParseInt(args.Value(option), option);
+                sizes.clear();
+                for (long long size = 1000; size <= max; size *= 10) sizes.push_back(static_cast<std::uint64_t>(size));
+            }
+            else if (option == "--min-time") options.minMicros = mc::ParseInt(args.Value(option), option) * 1000.0;
+            else if (option == "--out") outPath = args.Value(option);
+            else if (option == "--baseline") baselinePath = args.Value(option);
+            else if (option == "--threshold") threshold = static_cast<double>(mc::ParseInt(args.Value(option), option));
+            else if (option == "--dir") options.dir = std::string(args.Value(option));
+            else if (option == "--help" || option == "-h") {
+                PrintUsage();
+                return 0;
+            }
+            else throw std::runtime_error("Неизвестный параметр: " + std::string(option));
+        }
+        for (const std::uint64_t size : sizes) {
+            if (size == 0) throw std::runtime_error("Размер должен быть больше нуля");
+        }
+
+        // Базовый прогон читается до замеров, чтобы ошибка в пути не стоила полного прогона
+        std::vector<CaseResult> baseline;
+        if (!baselinePath.empty()) baseline = ReadBaseline(baselinePath);
+
+        std::vector<CaseResult> results;
+        for (const std::string& name : cases) {
+            for (const std::uint64_t size : sizes) {
+                std::vector<CaseResult> measured;
+                if (name == "load") measured = RunLoad(size, options, false);
+                else if (name == "load-cache") measured = RunLoad(size, options, true);
+                else if (name == "prefix") measured = RunPrefix(size, options);
+                else if (name == "fold") measured = RunFold(size, options);
+                else if (name == "parse") measured = RunRows(size, options, true);
+                else if (name == "format") measured = RunRows(size, options, false);
+                else throw std::runtime_error("Неизвестный случай: " + name);
+                for (const CaseResult& r : measured) {
+                    if (baseline.empty()) {
+                        std::fprintf(stderr, "%-10s %9llu %12.1f нс/%s\n", r.name.c_str(),
+                            static_cast<unsigned long long>(r.size), r.nsPerItem, r.unit.c_str());
+                    }
+                    results.push_back(r);
+                }
+            }
+        }
+
+        if (outPath.empty()) {
+            WriteJson(stdout, results);
+        }
+        else {
+            std::FILE* out = std::fopen(outPath.c_str(), "wb");
+            if (!out) throw std::runtime_error("Ошибка открытия файла: " + outPath);
+            WriteJson(out, results);
+            if (std::fclose(out) != 0) throw std::runtime_error("Ошибка записи в файл: " + outPath);
+        }
+
+        if (baseline.empty()) return 0;
+        const size_t regressions = CompareWithBaseline(results, baseline, threshold);
+        if (regressions > 0) {
+            std::fprintf(stderr, "Регрессий: %zu (порог %.0f%%)\n", regressions, threshold);
+            return 1;
+        }
+        return 0;
+    }
+}
+
+int main(int argc, char** argv) {
+    mc::Args args;
+    for (int i = 1; i < argc; ++i) {
+        args.items.emplace_back(argv[i]);
+    }
+
+    // Первый аргумент без "-" - режим, иначе замеры случаев
+    if (argc > 1 && argv[1][0] != '-') {
+        const mc::BenchMode* mode = mc::FindBenchMode(argv[1]);
+        if (!mode) {
+            PrintUsage();
+            return 2;
+        }
+        args.pos = 1;
+        try {
+            return mode->run(args);
+        }
+        catch (const std::exception& e) {
+            std::fprintf(stderr, "Ошибка: %s\n", e.what());
+            return 1;
+        }
+    }
+
+    try {
+        return Run(args);
+    }
+    catch (const std::exception& e) {
+        std::fprintf(stderr, "Ошибка: %s\n", e.what());
+        return 2;
+    }
+}
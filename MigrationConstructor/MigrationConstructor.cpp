@@ -2,15 +2,25 @@
 #include <commctrl.h>
 #include <string>
 #include <vector>
-#include <fstream>
-#include <sstream>
-#include <iomanip>
 #include <algorithm>
 #include <cwctype>
 #include <memory>
 #include <regex>
+#include <exception>
+#include <limits>
+
+#include "DictionaryLoader.h"
+#include "DictionaryReloader.h"
+#include "Encoding.h"
+#include "FilterEngine.h"
+#include "LastRecord.h"
+#include "MigrationRow.h"
+#include "MigrationWriter.h"
+#include "TextRope.h"
+#include "Trace.h"
 
 #pragma comment(lib, "comctl32.lib")
+#pragma comment(lib, "comdlg32.lib")
 #pragma comment(linker, "\"/manifestdependency:type='win32' name='Microsoft.Windows.Common-Controls' version='6.0.0.0' processorArchitecture='*' publicKeyToken='6595b64144ccf1df' language='*'\"")
 
 // Константы и определения
@@ -24,7 +34,10 @@ namespace {
     constexpr int ID_ADD_FIELD_BUTTON = 122;
     constexpr int ID_EXTRA_FIELD_BASE = 123;
     constexpr int ID_PARSE_BUTTON = 124;
-    constexpr int MAX_EXTRA_FIELDS = 3;
+    constexpr int ID_SUBSTRING_CHECK = 125;
+    constexpr int ID_COPY_BUTTON = 126;
+    constexpr int ID_WRITE_BUTTON = 127;
+    constexpr int ID_RESUME_BUTTON = 128;
     constexpr int COMBO_COLUMNS = 4;
     constexpr int DEFAULT_MARGIN = 5;
     constexpr int COMBO_HEIGHT = 50;
@@ -33,16 +46,46 @@ namespace {
     constexpr int BUTTON_HEIGHT = 30;
     constexpr int BUTTON_WIDTH = 150;
     constexpr int TEXTBOX_HEIGHT = 200;
+    constexpr size_t MAX_FILTER_RESULTS = 200;
+    constexpr size_t OUTPUT_WINDOW_LINES = 1000;   // сколько последних записей видно в текстовом поле
+    constexpr UINT WM_APP_DICTIONARY_LOADED = WM_APP + 1;   // wParam - номер комбобокса
+    constexpr UINT WM_APP_DICTIONARY_RELOADED = WM_APP + 2; // wParam - номер комбобокса
+    constexpr UINT WM_APP_FILTER_READY = WM_APP + 3;        // wParam - номер комбобокса
+
+    // Файлы словарей в порядке колонок записи (mc::ROW_COLUMNS)
+    std::vector<std::wstring> MakeComboBoxFiles() {
+        std::vector<std::wstring> files;
+        for (size_t i = 0; i < mc::COLUMN_COUNT; ++i) {
+            const std::string_view name = mc::DictionaryColumnName(i);
+            files.emplace_back(name.begin(), name.end());   // имена колонок - ASCII
+            files.back() += L".txt";
+        }
+        return files;
+    }
 
-    const std::vector<std::wstring> comboBoxFiles = {
-        L"role.txt", L"headLead.txt", L"fullname.txt", L"position.txt",
-        L"department.txt", L"protectedInfoAccess.txt", L"desks.txt", L"region.txt",
-        L"personalNumber.txt", L"pointOfSale.txt", L"coordinator.txt",
-        L"BaseMarketFinanceSectors.txt", L"CredDocInvestOperatons.txt",
-        L"percIndCoordinator.txt"
-    };
+    const std::vector<std::wstring> comboBoxFiles = MakeComboBoxFiles();
+
+    // Участки трассировки (запуск с /trace, выгрузка - F12)
+    const mc::TraceSpan traceEditUpdate("CBN_EDITUPDATE");
+    const mc::TraceSpan traceFilter("ShowFilterResult");
+    const mc::TraceSpan traceResetContent("CB_RESETCONTENT");
+    const mc::TraceSpan traceAddString("CB_ADDSTRING");
+    const mc::TraceSpan traceShowDropdown("CB_SHOWDROPDOWN");
+    const mc::TraceSpan tracePopulate("PopulateComboBox");
+    const mc::TraceSpan traceLoadComboBox("LoadComboBox");
+    const mc::TraceSpan traceUpdateTextBox("UpdateTextBox");
+    const mc::TraceSpan traceParseText("ParseTextAndFillControls");
+    const wchar_t TRACE_FILE[] = L"MigrationConstructor-trace.json";
 }
 
+// Данные комбобокса (GWLP_USERDATA): словарь с индексами и состояние фильтра
+struct ComboData {
+    std::wstring filename;
+    size_t slot = 0;                                    // номер в AppState::comboBoxes и в фильтре
+    mc::DictionarySnapshot dictionary;                  // снимок, по которому заполнен список; nullptr, пока файл загружается
+    bool populated = false;                             // список заполнен (при первом открытии)
+};
+
 // Структура для хранения состояния приложения
 struct AppState {
     int idCounter = 1;
@@ -55,28 +98,31 @@ struct AppState {
     HWND hIdEdit = nullptr;
     HWND hLoginEdit = nullptr;
     int extraFieldsCount = 0;
+    bool substringSearch = false;
     HFONT hFont = nullptr;
+    mc::TextRope output;        // все добавленные записи через "\r\n"
+    size_t shownLines = 0;      // записей сейчас в текстовом поле
+    bool textEdited = false;    // поле правили вручную, буфер еще не обновлен
+    bool updatingText = false;  // поле меняет сама программа - EN_CHANGE не правка
+    std::wstring outputPath;    // файл миграции, выбранный при первой записи
+    size_t writtenChars = 0;    // часть output, уже записанная в файл
+    size_t writtenLines = 0;
+    mc::DictionaryStore dictionaries;
+    mc::DictionaryLoader loader;
+    mc::DictionaryReloader reloader{ dictionaries };
+    mc::FilterEngine filters;   // останавливается первым: держит снимки словарей
 
     ~AppState() {
         if (hFont) DeleteObject(hFont);
         for (HWND hCombo : comboBoxes) {
-            auto* pItems = reinterpret_cast<std::vector<std::wstring>*>(GetWindowLongPtr(hCombo, GWLP_USERDATA));
-            delete pItems;
+            auto* pData = reinterpret_cast<ComboData*>(GetWindowLongPtr(hCombo, GWLP_USERDATA));
+            delete pData;
         }
     }
 };
 
 // Вспомогательные функции
 namespace {
-    bool StartsWithCaseInsensitive(const std::wstring& str, const std::wstring& prefix) {
-        if (prefix.empty()) return true;
-        if (str.length() < prefix.length()) return false;
-
-        return std::equal(prefix.begin(), prefix.end(), str.begin(), [](wchar_t ch1, wchar_t ch2) {
-            return towupper(ch1) == towupper(ch2);
-            });
-    }
-
     std::wstring GetWindowTextStr(HWND hWnd) {
         const int length = GetWindowTextLength(hWnd) + 1;
         std::unique_ptr<wchar_t[]> buffer(new wchar_t[length]);
@@ -93,76 +139,118 @@ namespace {
         return (lastdot == std::wstring::npos) ? filename : filename.substr(0, lastdot);
     }
 
-    std::vector<std::wstring> ReadFileToVector(const std::wstring& filename) {
-        std::vector<std::wstring> items;
-        std::ifstream file(filename, std::ios::binary);
-
-        if (!file.is_open()) {
-            MessageBoxW(NULL, (L"Ошибка открытия файла: " + filename).c_str(), L"Ошибка", MB_ICONERROR);
-            return items;
-        }
+    ComboData* GetComboData(HWND hCombo) {
+        return reinterpret_cast<ComboData*>(GetWindowLongPtr(hCombo, GWLP_USERDATA));
+    }
 
-        // Проверка BOM для UTF-8
-        char bom[3] = { 0 };
-        file.read(bom, 3);
-        if (bom[0] != '\xEF' || bom[1] != '\xBB' || bom[2] != '\xBF') {
-            file.seekg(0);
-        }
+    // Словарь загружен в пуле потоков: комбобокс становится доступен
+    void LoadComboBox(AppState* state, size_t slot) {
+        if (!state || slot >= state->comboBoxes.size()) return;
+        mc::TraceScope trace(traceLoadComboBox);
 
-        std::string line;
-        while (std::getline(file, line)) {
-            if (!line.empty()) {
-                line.erase(std::remove(line.begin(), line.end(), '\r'), line.end());
+        HWND hCombo = state->comboBoxes[slot];
+        ComboData* pData = GetComboData(hCombo);
+        if (!pData) return;
 
-                int wcharsCount = MultiByteToWideChar(CP_UTF8, 0, line.c_str(), -1, NULL, 0);
-                if (wcharsCount > 0) {
-                    std::wstring wline(wcharsCount, 0);
-                    MultiByteToWideChar(CP_UTF8, 0, line.c_str(), -1, &wline[0], wcharsCount);
-                    wline.pop_back();
-                    items.push_back(wline);
-                }
-            }
+        std::unique_ptr<mc::LoadedDictionary> loaded = state->loader.Take(slot);
+        if (!loaded) return;
+        if (!loaded->opened) {
+            MessageBoxW(NULL, (L"Ошибка открытия файла: " + pData->filename).c_str(), L"Ошибка", MB_ICONERROR);
         }
-
-        return items;
+        // Если файл уже успели перечитать после изменения, остается более новый снимок
+        state->dictionaries.PublishInitial(slot, std::move(loaded));
+        pData->dictionary = state->dictionaries.Snapshot(slot);
+        EnableWindow(hCombo, TRUE);
     }
 
-    void LoadComboBox(HWND hCombo, const std::wstring& filename) {
-        auto items = ReadFileToVector(filename);
-        auto* pOriginalItems = new std::vector<std::wstring>(std::move(items));
-        SetWindowLongPtr(hCombo, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(pOriginalItems));
+    // Содержимое списка добавляется при первом открытии
+    void PopulateComboBox(HWND hCombo) {
+        ComboData* pData = GetComboData(hCombo);
+        if (!pData || !pData->dictionary || pData->populated) return;
+        mc::TraceScope trace(tracePopulate);
 
+        const mc::Dictionary& items = pData->dictionary->items;
         SendMessage(hCombo, CB_RESETCONTENT, 0, 0);
-        for (const auto& item : *pOriginalItems) {
-            SendMessage(hCombo, CB_ADDSTRING, 0, reinterpret_cast<LPARAM>(item.c_str()));
+        for (size_t i = 0; i < items.Size(); ++i) {
+            SendMessage(hCombo, CB_ADDSTRING, 0, reinterpret_cast<LPARAM>(items.CStr(i)));
         }
+        pData->populated = true;
     }
 
-    void FilterComboBox(HWND hCombo, const std::wstring& filter) {
-        auto* pOriginalItems = reinterpret_cast<std::vector<std::wstring>*>(GetWindowLongPtr(hCombo, GWLP_USERDATA));
-        if (!pOriginalItems) return;
+    // Фильтр при наборе: поиск уходит в фоновый поток, новый символ отменяет прежний запрос
+    void FilterComboBox(AppState* state, HWND hCombo, const std::wstring& filter) {
+        ComboData* pData = GetComboData(hCombo);
+        if (!state || !pData || !pData->dictionary) return;
+
+        mc::FilterQuery query;
+        query.slot = pData->slot;
+        query.dictionary = pData->dictionary;
+        query.text = filter;
+        query.substring = state->substringSearch;
+        query.maxRanked = MAX_FILTER_RESULTS;
+        state->filters.Submit(std::move(query));
+    }
+
+    // Результат последнего запроса готов; устаревшие Take не отдает
+    void ShowFilterResult(AppState* state, size_t slot) {
+        if (!state || slot >= state->comboBoxes.size()) return;
+
+        HWND hCombo = state->comboBoxes[slot];
+        ComboData* pData = GetComboData(hCombo);
+        mc::FilterResult result;
+        if (!pData || !state->filters.Take(slot, result)) return;
+        // Словарь успели перезагрузить: ReloadComboBox уже запросил фильтр по новому снимку
+        if (result.dictionary != pData->dictionary) return;
+        mc::TraceScope trace(traceFilter);
+        const mc::Dictionary& items = result.dictionary->items;
 
         DWORD startPos, endPos;
         SendMessage(hCombo, CB_GETEDITSEL, reinterpret_cast<WPARAM>(&startPos), reinterpret_cast<LPARAM>(&endPos));
 
-        SendMessage(hCombo, CB_RESETCONTENT, 0, 0);
-
-        bool hasMatches = false;
-        for (const auto& item : *pOriginalItems) {
-            if (StartsWithCaseInsensitive(item, filter)) {
-                SendMessage(hCombo, CB_ADDSTRING, 0, reinterpret_cast<LPARAM>(item.c_str()));
-                hasMatches = true;
+        {
+            mc::TraceScope traceReset(traceResetContent);
+            SendMessage(hCombo, CB_RESETCONTENT, 0, 0);
+        }
+        {
+            mc::TraceScope traceAdd(traceAddString);
+            for (std::uint32_t item : result.items) {
+                SendMessage(hCombo, CB_ADDSTRING, 0, reinterpret_cast<LPARAM>(items.CStr(item)));
             }
         }
+        pData->populated = true;
 
-        SetWindowText(hCombo, filter.c_str());
+        SetWindowText(hCombo, result.text.c_str());
         SendMessage(hCombo, CB_SETEDITSEL, 0, MAKELPARAM(startPos, endPos));
 
-        if (hasMatches) {
+        if (!result.items.empty()) {
+            mc::TraceScope traceShow(traceShowDropdown);
             SendMessage(hCombo, CB_SHOWDROPDOWN, TRUE, 0);
         }
     }
 
+    // Файл словаря изменился: список заполняется заново из нового снимка, введенный текст сохраняется
+    void ReloadComboBox(AppState* state, size_t slot) {
+        if (!state || slot >= state->comboBoxes.size()) return;
+
+        HWND hCombo = state->comboBoxes[slot];
+        ComboData* pData = GetComboData(hCombo);
+        if (!pData) return;
+
+        pData->dictionary = state->dictionaries.Snapshot(slot);
+        pData->populated = false;
+        EnableWindow(hCombo, TRUE);
+
+        const std::wstring text = GetWindowTextStr(hCombo);
+        if (SendMessage(hCombo, CB_GETDROPPEDSTATE, 0, 0)) {
+            FilterComboBox(state, hCombo, text);
+        }
+        else {
+            state->filters.Cancel(slot);
+            SendMessage(hCombo, CB_RESETCONTENT, 0, 0);
+            SetWindowTextStr(hCombo, text);
+        }
+    }
+
     void AppendTextToEdit(HWND hEdit, const std::wstring& text) {
         const int len = GetWindowTextLength(hEdit);
         SendMessage(hEdit, EM_SETSEL, len, len);
@@ -171,6 +259,157 @@ namespace {
         SendMessage(hEdit, EM_SCROLLCARET, 0, 0);
     }
 
+    // Последние OUTPUT_WINDOW_LINES записей буфера в текстовое поле
+    void ShowOutputTail(AppState* state) {
+        const mc::TextRope& output = state->output;
+        const size_t lines = output.LineCount();
+        const size_t first = lines > OUTPUT_WINDOW_LINES ? lines - OUTPUT_WINDOW_LINES : 0;
+        const size_t offset = output.LineStart(first);
+        state->updatingText = true;
+        SetWindowTextStr(state->hText, output.Substr(offset, output.Size() - offset));
+
+        const int len = GetWindowTextLength(state->hText);
+        SendMessage(state->hText, EM_SETSEL, len, len);
+        SendMessage(state->hText, EM_SCROLLCARET, 0, 0);
+        state->updatingText = false;
+        state->shownLines = lines - first;
+    }
+
+    // Ручные правки поля переносятся в буфер: поле показывает хвост буфера, и этот хвост
+    // заменяется текстом поля. Вызывается перед пересборкой поля, копированием и записью в файл.
+    // Уже записанные в файл записи там не меняются: если правка задела их, измененные
+    // записи снова считаются незаписанными
+    void SyncEditedOutput(AppState* state) {
+        if (!state->textEdited) return;
+        state->textEdited = false;
+
+        mc::TextRope& output = state->output;
+        const size_t lines = output.LineCount();
+        const size_t first = lines - std::min(state->shownLines, lines);
+        const size_t offset = output.LineStart(first);
+        const std::wstring shown = output.Substr(offset, output.Size() - offset);
+        const std::wstring text = GetWindowTextStr(state->hText);
+        if (text == shown) return;
+
+        // До same буфер и поле совпадают
+        const size_t same = offset + static_cast<size_t>(
+            std::mismatch(shown.begin(), shown.end(), text.begin(), text.end()).first - shown.begin());
+        const auto intact = [&](size_t written) {
+            if (written == 0) return true;
+            if (written < lines) return output.LineStart(written) <= same;
+            // Записан весь буфер: цел, если после него в поле только начался новый абзац
+            return same == output.Size() && (text.size() == shown.size() || text[shown.size()] == L'\r' || text[shown.size()] == L'\n');
+        };
+        size_t written = state->writtenLines;
+        while (!intact(written)) --written;
+        if (written < state->writtenLines) {
+            state->writtenLines = written;
+            state->writtenChars = written == 0 ? 0 : output.LineStart(written) - 2;
+        }
+
+        // Хвост вместе с разделителем перед ним заменяется текстом поля
+        output.Truncate(offset >= 2 ? offset - 2 : 0);
+        if (!text.empty()) {
+            if (!output.Empty()) output.Append(L"\r\n");
+            output.Append(text);
+        }
+        state->shownLines = output.LineCount() - first;
+    }
+
+    // Запись сохраняется в буфере приложения; поле показывает только окно из последних записей
+    // и пересобирается, когда в нем накопилось вдвое больше
+    void AppendOutputRow(AppState* state, const std::wstring& row) {
+        SyncEditedOutput(state);
+        if (!state->output.Empty()) state->output.Append(L"\r\n");
+        state->output.Append(row);
+
+        if (state->shownLines < 2 * OUTPUT_WINDOW_LINES) {
+            state->updatingText = true;
+            AppendTextToEdit(state->hText, row);
+            state->updatingText = false;
+            ++state->shownLines;
+        }
+        else {
+            ShowOutputTail(state);
+        }
+    }
+
+    // Все записи в буфер обмена: копируются из блоков прямо в память буфера обмена
+    void CopyOutputToClipboard(AppState* state, HWND hWnd) {
+        if (!state) return;
+        SyncEditedOutput(state);
+        if (state->output.Empty()) return;
+
+        const size_t size = state->output.Size();
+        HGLOBAL hMem = GlobalAlloc(GMEM_MOVEABLE, (size + 1) * sizeof(wchar_t));
+        wchar_t* text = hMem ? static_cast<wchar_t*>(GlobalLock(hMem)) : nullptr;
+        if (!text) {
+            if (hMem) GlobalFree(hMem);
+            MessageBoxW(hWnd, L"Недостаточно памяти для копирования", L"Ошибка", MB_ICONERROR);
+            return;
+        }
+        state->output.Copy(0, size, text);
+        text[size] = L'\0';
+        GlobalUnlock(hMem);
+
+        if (!OpenClipboard(hWnd)) {
+            GlobalFree(hMem);
+            return;
+        }
+        EmptyClipboard();
+        if (!SetClipboardData(CF_UNICODETEXT, hMem)) GlobalFree(hMem);
+        CloseClipboard();
+    }
+
+    // Новые записи (после прошлой записи) дописываются в файл миграции.
+    // Файл выбирается один раз; новый файл создается в UTF-8 с BOM
+    void WriteOutputToFile(AppState* state, HWND hWnd) {
+        if (!state) return;
+        SyncEditedOutput(state);
+
+        const mc::TextRope& output = state->output;
+        const size_t lines = output.LineCount();
+        if (lines == state->writtenLines) {
+            MessageBoxW(hWnd, L"Нет новых записей", L"Запись в файл", MB_ICONINFORMATION);
+            return;
+        }
+
+        if (state->outputPath.empty()) {
+            wchar_t path[MAX_PATH] = L"migration.txt";
+            OPENFILENAMEW ofn = { sizeof(OPENFILENAMEW) };
+            ofn.hwndOwner = hWnd;
+            ofn.lpstrFilter = L"Текстовые файлы (*.txt)\0*.txt\0Все файлы\0*.*\0";
+            ofn.lpstrFile = path;
+            ofn.nMaxFile = MAX_PATH;
+            ofn.lpstrDefExt = L"txt";
+            // Без OFN_NOCHANGEDIR диалог сменил бы текущий каталог, а словари открываются относительно него
+            ofn.Flags = OFN_PATHMUSTEXIST | OFN_NOCHANGEDIR;
+            if (!GetSaveFileNameW(&ofn)) return;
+            state->outputPath = path;
+        }
+
+        // Записи в буфере разделены "\r\n"; уже записанная часть заканчивается перед разделителем
+        const size_t offset = state->writtenChars == 0 ? 0 : state->writtenChars + 2;
+        try {
+            mc::WriterOptions options;
+            options.bom = true;
+            mc::MigrationWriter writer(std::filesystem::path(state->outputPath), options);
+            output.ForEachPiece(offset, output.Size() - offset, [&](std::wstring_view piece) { writer.WriteWide(piece); });
+            writer.Write("\r\n");
+            writer.Close();
+        }
+        catch (const std::exception& e) {
+            MessageBoxW(hWnd, mc::Utf8ToWide(e.what()).c_str(), L"Ошибка", MB_ICONERROR);
+            return;
+        }
+
+        const size_t written = lines - state->writtenLines;
+        state->writtenChars = output.Size();
+        state->writtenLines = lines;
+        MessageBoxW(hWnd, (L"Записано записей: " + std::to_wstring(written) + L"\n" + state->outputPath).c_str(),
+            L"Запись в файл", MB_ICONINFORMATION);
+    }
+
     HWND CreateLabel(HWND hParent, const std::wstring& text, int x, int y, int width, HFONT hFont) {
         HWND hLabel = CreateWindow(WC_STATIC, text.c_str(),
             WS_VISIBLE | WS_CHILD,
@@ -203,69 +442,112 @@ namespace {
         return hButton;
     }
 
-    std::vector<std::wstring> SplitString(const std::wstring& input, wchar_t delimiter) {
-        std::vector<std::wstring> result;
-        std::wstringstream ss(input);
-        std::wstring item;
+    HWND CreateCheckBox(HWND hParent, const std::wstring& text, int x, int y, int width, int id, HFONT hFont) {
+        HWND hCheck = CreateWindow(WC_BUTTON, text.c_str(),
+            WS_VISIBLE | WS_CHILD | WS_TABSTOP | BS_AUTOCHECKBOX,
+            x, y, width, EDIT_HEIGHT, hParent, reinterpret_cast<HMENU>(id), NULL, NULL);
+        SendMessage(hCheck, WM_SETFONT, reinterpret_cast<WPARAM>(hFont), TRUE);
+        return hCheck;
+    }
+
+    // Заполняет поля по самой свежей записи; false, если запись не разбирается
+    bool FillControlsFromRecord(AppState* state, std::wstring_view record) {
+        mc::Row<wchar_t> row;
+        if (!mc::ParseRow(record, row)) return false; // Минимум ID и логин
+
+        // Заполняем ID (ID записи не меньше 1)
+        if (state->hIdEdit && row.id > 0) {
+            SetWindowTextStr(state->hIdEdit, std::to_wstring(row.id));
+            // Как прежде с std::stoi: ID вне диапазона int сбрасывает счетчик
+            state->idCounter = row.id < (std::numeric_limits<int>::max)() ? static_cast<int>(row.id) + 1 : 1;
+        }
+
+        // Заполняем логин (без суффикса _NN)
+        if (state->hLoginEdit && !row.loginBase.empty()) {
+            SetWindowTextStr(state->hLoginEdit, std::wstring(row.loginBase));
+        }
 
-        while (std::getline(ss, item, delimiter)) {
-            result.push_back(item);
+        // Заполняем комбобоксы
+        for (size_t i = 0; i < state->comboBoxes.size() && i < mc::COLUMN_COUNT; ++i) {
+            if (!row.columns[i].empty()) {
+                SetWindowTextStr(state->comboBoxes[i], std::wstring(row.columns[i]));
+            }
         }
 
-        return result;
+        // Заполняем дополнительные поля
+        for (size_t i = 0; i < state->extraFields.size() && i < row.extraCount; ++i) {
+            if (!row.extras[i].empty()) {
+                SetWindowTextStr(state->extraFields[i], std::wstring(row.extras[i]));
+            }
+        }
+        return true;
     }
 
     void ParseTextAndFillControls(AppState* state, const std::wstring& text) {
         if (!state) return;
+        mc::TraceScope trace(traceParseText);
+        FillControlsFromRecord(state, mc::LastRecord(std::wstring_view(text)));
+    }
 
-        std::vector<std::wstring> lines = SplitString(text, L'\n');
-        if (lines.empty()) return;
-
-        // Берем последнюю строку (самую свежую запись)
-        std::wstring lastLine = lines.back();
-        std::vector<std::wstring> parts = SplitString(lastLine, L';');
-
-        if (parts.size() < 2) return; // Минимум ID и логин
+    // Продолжение файла миграции: поля заполняются по его последней записи (читается только хвост),
+    // а следующие записи дописываются в этот же файл
+    void ResumeFromFile(AppState* state, HWND hWnd) {
+        if (!state) return;
 
-        // Заполняем ID
-        if (state->hIdEdit && !parts[0].empty()) {
-            SetWindowTextStr(state->hIdEdit, parts[0]);
-            try {
-                state->idCounter = std::stoi(parts[0]) + 1;
-            }
-            catch (...) {
-                state->idCounter = 1;
-            }
+        wchar_t path[MAX_PATH] = L"";
+        OPENFILENAMEW ofn = { sizeof(OPENFILENAMEW) };
+        ofn.hwndOwner = hWnd;
+        ofn.lpstrFilter = L"Текстовые файлы (*.txt)\0*.txt\0Все файлы\0*.*\0";
+        ofn.lpstrFile = path;
+        ofn.nMaxFile = MAX_PATH;
+        ofn.Flags = OFN_FILEMUSTEXIST | OFN_NOCHANGEDIR;
+        if (!GetOpenFileNameW(&ofn)) return;
+
+        std::wstring record;
+        mc::TextEncoding encoding;
+        if (!mc::ReadLastRecord(std::filesystem::path(path), record, encoding)) {
+            MessageBoxW(hWnd, L"Не удалось прочитать файл", L"Ошибка", MB_ICONERROR);
+            return;
+        }
+        if (!FillControlsFromRecord(state, record)) {
+            MessageBoxW(hWnd, L"В файле нет записей", L"Продолжить файл", MB_ICONWARNING);
+            return;
         }
 
-        // Заполняем логин
-        if (state->hLoginEdit && parts.size() > 1 && !parts[1].empty()) {
-            std::wstring login = parts[1];
-            // Удаляем суффикс _XX если есть
-            size_t underscorePos = login.find_last_of(L'_');
-            if (underscorePos != std::wstring::npos &&
-                login.length() - underscorePos == 3 &&
-                iswdigit(login[underscorePos + 1]) &&
-                iswdigit(login[underscorePos + 2])) {
-                login = login.substr(0, underscorePos);
-            }
-            SetWindowTextStr(state->hLoginEdit, login);
+        // Записи пишутся в UTF-8: файл в другой кодировке стал бы смесью кодировок
+        if (encoding != mc::TextEncoding::Utf8) {
+            MessageBoxW(hWnd, (L"Файл в кодировке " + mc::Utf8ToWide(mc::EncodingName(encoding)) +
+                L". Поля заполнены по последней записи, но дописывать в этот файл нельзя: новые записи пишутся в UTF-8").c_str(),
+                L"Продолжить файл", MB_ICONWARNING);
+            return;
         }
 
-        // Заполняем комбобоксы
-        for (size_t i = 0; i < state->comboBoxes.size() && (i + 2) < parts.size(); ++i) {
-            if (!parts[i + 2].empty()) {
-                SetWindowTextStr(state->comboBoxes[i], parts[i + 2]);
-            }
+        // Уже накопленные записи к этому файлу не относятся
+        SyncEditedOutput(state);
+        state->outputPath = path;
+        state->writtenChars = state->output.Size();
+        state->writtenLines = state->output.LineCount();
+    }
+
+    // F12 при запуске с /trace: трасса Chrome в рабочий каталог и сводка задержек по участкам
+    void ExportTrace(HWND hWnd) {
+        try {
+            mc::WriteChromeTrace(std::filesystem::path(TRACE_FILE));
+        }
+        catch (const std::exception& e) {
+            MessageBoxW(hWnd, mc::Utf8ToWide(e.what()).c_str(), L"Ошибка", MB_ICONERROR);
+            return;
         }
 
-        // Заполняем дополнительные поля
-        size_t offset = 2 + state->comboBoxes.size();
-        for (size_t i = 0; i < state->extraFields.size() && (offset + i) < parts.size(); ++i) {
-            if (!parts[offset + i].empty()) {
-                SetWindowTextStr(state->extraFields[i], parts[offset + i]);
-            }
+        std::wstring summary = std::wstring(L"Трасса записана в ") + TRACE_FILE + L"\r\n\r\n";
+        for (const mc::TraceSpanStats& stats : mc::TraceSummary()) {
+            wchar_t line[256];
+            swprintf(line, 256, L"%ls: %llu, p50 %.2f мс, p99 %.2f мс, макс. %.2f мс\r\n",
+                std::wstring(stats.name.begin(), stats.name.end()).c_str(), static_cast<unsigned long long>(stats.count),
+                stats.p50Micros / 1000, stats.p99Micros / 1000, stats.maxMicros / 1000);
+            summary += line;
         }
+        MessageBoxW(hWnd, summary.c_str(), L"Трассировка", MB_ICONINFORMATION);
     }
 }
 
@@ -273,48 +555,34 @@ namespace {
 namespace {
     void UpdateTextBox(AppState* state) {
         if (!state || !state->hLoginEdit || !state->hText || !state->hIdEdit) return;
+        mc::TraceScope trace(traceUpdateTextBox);
 
         const int currentId = std::max<int>(1, _wtoi(GetWindowTextStr(state->hIdEdit).c_str()));
-        std::wstring loginBase = GetWindowTextStr(state->hLoginEdit);
+        const std::wstring loginText = GetWindowTextStr(state->hLoginEdit);
 
         // Обработка суффикса логина
-        const size_t underscorePos = loginBase.find_last_of(L'_');
-        if (underscorePos != std::wstring::npos &&
-            loginBase.length() - underscorePos == 3 &&
-            iswdigit(loginBase[underscorePos + 1]) &&
-            iswdigit(loginBase[underscorePos + 2])) {
-            loginBase = loginBase.substr(0, underscorePos);
-        }
-
-        // Формирование логина
-        std::wstringstream loginSuffix;
-        loginSuffix << L"_" << std::setw(2) << std::setfill(L'0') << state->loginCounter;
-        const std::wstring fullLogin = loginBase + loginSuffix.str();
-
-        // Формирование строки результата
-        std::wstring result = std::to_wstring(currentId) + L";" + fullLogin + L";";
-
-        // Добавление значений из комбобоксов
-        for (size_t i = 0; i < state->comboBoxes.size(); ++i) {
-            if (state->comboBoxes[i]) {
-                result += GetWindowTextStr(state->comboBoxes[i]);
-                if (i < state->comboBoxes.size() - 1 || !state->extraFields.empty()) {
-                    result += L";";
-                }
-            }
+        const std::wstring loginBase(mc::StripLoginSuffix<wchar_t>(loginText));
+
+        // Значения колонок; запись собирается по схеме mc::ROW_COLUMNS одним буфером
+        std::vector<std::wstring> values;
+        values.reserve(state->comboBoxes.size() + state->extraFields.size());
+        mc::Row<wchar_t> row;
+        row.id = currentId;
+        row.loginBase = loginBase;
+        row.loginCounter = state->loginCounter;
+        for (size_t i = 0; i < state->comboBoxes.size() && i < mc::COLUMN_COUNT; ++i) {
+            values.push_back(GetWindowTextStr(state->comboBoxes[i]));
+            row.columns[i] = values.back();
         }
-
-        // Добавление значений из дополнительных полей
-        for (size_t i = 0; i < state->extraFields.size(); ++i) {
-            if (state->extraFields[i]) {
-                result += GetWindowTextStr(state->extraFields[i]);
-                if (i < state->extraFields.size() - 1) {
-                    result += L";";
-                }
-            }
+        for (HWND hField : state->extraFields) {
+            values.push_back(GetWindowTextStr(hField));
+            row.extras[row.extraCount++] = values.back();
         }
 
-        AppendTextToEdit(state->hText, result);
+        std::wstring result(mc::RowLength(row), L'\0');
+        mc::WriteRow(row, &result[0]);
+
+        AppendOutputRow(state, result);
 
         // Обновление счетчиков
         state->idCounter = currentId + 1;
@@ -329,7 +597,14 @@ namespace {
 
         state->idCounter = 1;
         state->loginCounter = 1;
+        state->output.Clear();
+        state->shownLines = 0;
+        state->writtenChars = 0;
+        state->writtenLines = 0;
+        state->updatingText = true;
         SetWindowTextStr(state->hText, L"");
+        state->updatingText = false;
+        state->textEdited = false;
         SetWindowTextStr(state->hIdEdit, L"1");
         SetWindowTextStr(state->hLoginEdit, L"user");
 
@@ -345,7 +620,7 @@ namespace {
     }
 
     void AddExtraField(AppState* state, HWND hWnd) {
-        if (!state || state->extraFieldsCount >= MAX_EXTRA_FIELDS) return;
+        if (!state || state->extraFieldsCount >= mc::MAX_EXTRA_FIELDS) return;
 
         const int totalControls = state->comboBoxes.size() + state->extraFieldsCount;
         const int col = totalControls % COMBO_COLUMNS;
@@ -412,8 +687,16 @@ namespace {
                 width - 2 * DEFAULT_MARGIN, TEXTBOX_HEIGHT, SWP_NOZORDER);
         }
 
+        // Кнопки файла миграции - под текстовым полем у правого края, вместе с ним сдвигаются
+        // вниз при добавлении полей
+        const int fileButtonsY = textBoxTop + TEXTBOX_HEIGHT + DEFAULT_MARGIN;
+        SetWindowPos(GetDlgItem(hWnd, ID_WRITE_BUTTON), NULL,
+            width - 2 * (DEFAULT_MARGIN + BUTTON_WIDTH), fileButtonsY, BUTTON_WIDTH, BUTTON_HEIGHT, SWP_NOZORDER);
+        SetWindowPos(GetDlgItem(hWnd, ID_RESUME_BUTTON), NULL,
+            width - DEFAULT_MARGIN - BUTTON_WIDTH, fileButtonsY, BUTTON_WIDTH, BUTTON_HEIGHT, SWP_NOZORDER);
+
         // Позиционирование кнопок
-        const int buttonsY = 750 - 50;
+        const int buttonsY = std::max(750 - 50, fileButtonsY + BUTTON_HEIGHT + DEFAULT_MARGIN);
         SetWindowPos(GetDlgItem(hWnd, ID_BUTTON), NULL,
             DEFAULT_MARGIN, buttonsY, BUTTON_WIDTH, BUTTON_HEIGHT, SWP_NOZORDER);
         SetWindowPos(GetDlgItem(hWnd, ID_CLEAR_BUTTON), NULL,
@@ -422,6 +705,8 @@ namespace {
             DEFAULT_MARGIN + 320, buttonsY, BUTTON_WIDTH, BUTTON_HEIGHT, SWP_NOZORDER);
         SetWindowPos(GetDlgItem(hWnd, ID_PARSE_BUTTON), NULL,
             DEFAULT_MARGIN + 480, buttonsY, BUTTON_WIDTH, BUTTON_HEIGHT, SWP_NOZORDER);
+        SetWindowPos(GetDlgItem(hWnd, ID_COPY_BUTTON), NULL,
+            DEFAULT_MARGIN + 640, buttonsY, BUTTON_WIDTH, BUTTON_HEIGHT, SWP_NOZORDER);
     }
 }
 
@@ -451,6 +736,11 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
         pState->hLoginEdit = CreateEdit(hWnd, DEFAULT_MARGIN + 255, 10, 120, ID_LOGIN_EDIT, pState->hFont);
         SetWindowTextStr(pState->hLoginEdit, L"user");
 
+        CreateCheckBox(hWnd, L"Поиск по подстроке", DEFAULT_MARGIN + 400, 10, 180, ID_SUBSTRING_CHECK, pState->hFont);
+        // Место кнопок файла - в PositionControls
+        CreateButton(hWnd, L"Записать в файл", 0, 0, ID_WRITE_BUTTON, pState->hFont);
+        CreateButton(hWnd, L"Продолжить файл", 0, 0, ID_RESUME_BUTTON, pState->hFont);
+
         // Создание комбобоксов
         for (size_t i = 0; i < comboBoxFiles.size(); ++i) {
             const int col = i % COMBO_COLUMNS;
@@ -467,7 +757,30 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
             HWND hCombo = CreateComboBox(hWnd, x, y + LABEL_HEIGHT + 2, BUTTON_WIDTH,
                 ID_COMBO_BASE + i, pState->hFont);
             pState->comboBoxes.push_back(hCombo);
-            LoadComboBox(hCombo, comboBoxFiles[i]);
+
+            // Недоступен, пока словарь не загрузится
+            auto* pData = new ComboData();
+            pData->filename = comboBoxFiles[i];
+            pData->slot = i;
+            SetWindowLongPtr(hCombo, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(pData));
+            EnableWindow(hCombo, FALSE);
+        }
+
+        pState->filters.Start(comboBoxFiles.size(),
+            [hWnd](size_t slot, std::uint64_t) { PostMessage(hWnd, WM_APP_FILTER_READY, slot, 0); });
+
+        // Словари загружаются параллельно, окно показывается сразу
+        pState->dictionaries.Resize(comboBoxFiles.size());
+        pState->loader.Start(std::vector<std::filesystem::path>(comboBoxFiles.begin(), comboBoxFiles.end()),
+            [hWnd](size_t slot) { PostMessage(hWnd, WM_APP_DICTIONARY_LOADED, slot, 0); });
+
+        // Справочники обновляются в течение дня: измененный файл перечитывается без перезапуска
+        try {
+            pState->reloader.Start(std::vector<std::filesystem::path>(comboBoxFiles.begin(), comboBoxFiles.end()),
+                [hWnd](size_t slot, const mc::DictionaryDiff&) { PostMessage(hWnd, WM_APP_DICTIONARY_RELOADED, slot, 0); });
+        }
+        catch (const std::exception&) {
+            // Каталог нельзя отслеживать - изменения подхватятся при следующем запуске
         }
 
         // Текстовое поле
@@ -480,12 +793,14 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
             DEFAULT_MARGIN, textBoxTop, BUTTON_WIDTH * COMBO_COLUMNS + DEFAULT_MARGIN * (COMBO_COLUMNS - 1),
             TEXTBOX_HEIGHT, hWnd, reinterpret_cast<HMENU>(ID_TEXTBOX), NULL, NULL);
         SendMessage(pState->hText, WM_SETFONT, reinterpret_cast<WPARAM>(pState->hFont), TRUE);
+        SendMessage(pState->hText, EM_SETLIMITTEXT, 0, 0);   // окно записей больше 32K символов по умолчанию
 
         // Кнопки
         CreateButton(hWnd, L"Добавить запись", DEFAULT_MARGIN, 700, ID_BUTTON, pState->hFont);
         CreateButton(hWnd, L"Очистка", DEFAULT_MARGIN + 160, 700, ID_CLEAR_BUTTON, pState->hFont);
         CreateButton(hWnd, L"Добавить поле", DEFAULT_MARGIN + 320, 700, ID_ADD_FIELD_BUTTON, pState->hFont);
         CreateButton(hWnd, L"Разобрать текст", DEFAULT_MARGIN + 480, 700, ID_PARSE_BUTTON, pState->hFont);
+        CreateButton(hWnd, L"Копировать все", DEFAULT_MARGIN + 640, 700, ID_COPY_BUTTON, pState->hFont);
 
         SetWindowPos(hWnd, NULL, 0, 0, 800, 800, SWP_NOMOVE | SWP_NOZORDER);
         break;
@@ -499,18 +814,45 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
         }
         break;
 
+    case WM_APP_DICTIONARY_LOADED:
+        LoadComboBox(pState, static_cast<size_t>(wParam));
+        break;
+
+    case WM_APP_DICTIONARY_RELOADED:
+        ReloadComboBox(pState, static_cast<size_t>(wParam));
+        break;
+
+    case WM_APP_FILTER_READY:
+        ShowFilterResult(pState, static_cast<size_t>(wParam));
+        break;
+
     case WM_COMMAND:
         if (HIWORD(wParam) == CBN_EDITUPDATE) {
             HWND hCombo = reinterpret_cast<HWND>(lParam);
             if (hCombo && (GetWindowLongPtr(hCombo, GWL_STYLE) & CBS_DROPDOWN)) {
-                FilterComboBox(hCombo, GetWindowTextStr(hCombo));
+                mc::TraceScope trace(traceEditUpdate);
+                FilterComboBox(pState, hCombo, GetWindowTextStr(hCombo));
             }
         }
+        else if (HIWORD(wParam) == CBN_DROPDOWN) {
+            PopulateComboBox(reinterpret_cast<HWND>(lParam));
+        }
+        else if (HIWORD(wParam) == EN_CHANGE && LOWORD(wParam) == ID_TEXTBOX) {
+            if (pState && !pState->updatingText) pState->textEdited = true;
+        }
         else {
             switch (LOWORD(wParam)) {
             case ID_BUTTON: UpdateTextBox(pState); break;
             case ID_CLEAR_BUTTON: ResetCounters(pState); break;
             case ID_ADD_FIELD_BUTTON: AddExtraField(pState, hWnd); break;
+            case ID_COPY_BUTTON: CopyOutputToClipboard(pState, hWnd); break;
+            case ID_WRITE_BUTTON: WriteOutputToFile(pState, hWnd); break;
+            case ID_RESUME_BUTTON: ResumeFromFile(pState, hWnd); break;
+            case ID_SUBSTRING_CHECK:
+                if (pState) {
+                    pState->substringSearch = SendMessage(reinterpret_cast<HWND>(lParam), BM_GETCHECK, 0, 0) == BST_CHECKED;
+                }
+                break;
             case ID_PARSE_BUTTON: {
                 if (pState && pState->hText) {
                     std::wstring text = GetWindowTextStr(pState->hText);
@@ -535,6 +877,11 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 }
 
 int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PWSTR pCmdLine, int nCmdShow) {
+    // Замеры задержек включаются только явно: MigrationConstructor.exe /trace
+    if (pCmdLine && wcsstr(pCmdLine, L"/trace")) {
+        mc::EnableTracing(true);
+    }
+
     WNDCLASS wc = { 0 };
     wc.lpfnWndProc = WndProc;
     wc.hInstance = hInstance;
@@ -562,6 +909,11 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PWSTR pCmdLine
 
     MSG msg;
     while (GetMessage(&msg, NULL, 0, 0)) {
+        // Фокус обычно в дочернем элементе, поэтому F12 перехватывается здесь, а не в WndProc
+        if (msg.message == WM_KEYDOWN && msg.wParam == VK_F12 && mc::TracingEnabled()) {
+            ExportTrace(hWnd);
+            continue;
+        }
         TranslateMessage(&msg);
         DispatchMessage(&msg);
     }
@@ -0,0 +1,329 @@
+﻿#include "MigrationDiff.h"
+#include "MigrationParser.h"
+#include "StringSet.h"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <string>
+
+namespace mc {
+    namespace {
+        constexpr std::uint64_t MATCHED = std::uint64_t(1) << 63;
+        constexpr std::uint64_t PROBE_ONLY = std::uint64_t(1) << 62;    // id только из большего файла
+        constexpr std::uint64_t LINE_MASK = ~(MATCHED | PROBE_ONLY);
+
+        using Fields = std::array<std::string_view, MAX_RECORD_FIELDS>;
+
+        std::size_t SplitFields(std::string_view text, Fields& fields) {
+            std::size_t count = 0;
+            for (std::size_t end; count < MAX_RECORD_FIELDS - 1 && (end = text.find(';')) != std::string_view::npos;) {
+                fields[count++] = text.substr(0, end);
+                text.remove_prefix(end + 1);
+            }
+            fields[count++] = text;
+            return count;
+        }
+
+        bool IsNumber(std::string_view id) {
+            return !id.empty() && std::all_of(id.begin(), id.end(), [](char ch) { return ch >= '0' && ch <= '9'; });
+        }
+
+        std::string_view IdOf(std::string_view text) {
+            return text.substr(0, text.find(';'));
+        }
+
+        // Подсчет и передача записей в sink
+        class DiffOutput {
+        public:
+            DiffOutput(const DiffSink& sink, DiffStats& stats) : sink_(sink), stats_(stats) {}
+
+            void Added(std::string_view id, std::uint64_t line, std::string_view text) {
+                ++stats_.added;
+                const DiffEntry entry{ DiffKind::Added, id, 0, line, {}, text, 0 };
+                if (sink_) sink_(entry);
+            }
+
+            void Removed(std::string_view id, std::uint64_t line, std::string_view text) {
+                ++stats_.removed;
+                const DiffEntry entry{ DiffKind::Removed, id, line, 0, text, {}, 0 };
+                if (sink_) sink_(entry);
+            }
+
+            // Поля сравниваются, только если строки различаются. Поле, которого нет
+            // в одной из строк, считается измененным
+            void Matched(std::string_view id, std::uint64_t oldLine, std::string_view oldText,
+                std::uint64_t newLine, std::string_view newText) {
+                if (oldText == newText) {
+                    ++stats_.unchanged;
+                    return;
+                }
+                const std::size_t oldCount = SplitFields(oldText, oldFields_);
+                const std::size_t newCount = SplitFields(newText, newFields_);
+                const std::size_t count = std::max(oldCount, newCount);
+                if (stats_.fieldChanges.size() < count) stats_.fieldChanges.resize(count);
+                std::uint64_t changed = 0;
+                for (std::size_t i = 0; i < count; ++i) {
+                    if (i < oldCount && i < newCount && oldFields_[i] == newFields_[i]) continue;
+                    changed |= std::uint64_t(1) << i;
+                    ++stats_.fieldChanges[i];
+                }
+                ++stats_.changed;
+                const DiffEntry entry{ DiffKind::Changed, id, oldLine, newLine, oldText, newText, changed };
+                if (sink_) sink_(entry);
+            }
+
+        private:
+            const DiffSink& sink_;
+            DiffStats& stats_;
+            Fields oldFields_;
+            Fields newFields_;
+        };
+
+        [[noreturn]] void ThrowDuplicate(std::string_view id, std::uint64_t line, bool old) {
+            throw std::runtime_error("Повтор id " + std::string(id) + " в строке " + std::to_string(line) +
+                (old ? " прежнего файла" : " нового файла"));
+        }
+
+        // id меньшего файла. Запись - ссылка на строку в отображенном файле и младшие 32 бита хеша id
+        // (по ним же выбирается слот), слот - номер записи + 1.
+        // Записи хранятся в порядке файла, чтобы несопоставленные выдавались по порядку
+        class IdTable {
+        public:
+            struct Entry {
+                const char* text;
+                std::uint32_t size;
+                std::uint32_t hash;
+                std::uint64_t line;     // старшие биты - MATCHED и PROBE_ONLY
+            };
+
+            explicit IdTable(std::size_t memoryBytes) : memoryBytes_(memoryBytes) {}
+
+            // false - таблица выросла бы за предел памяти. flags - к номеру строки (PROBE_ONLY)
+            bool Add(const Record& record, bool old, std::uint64_t flags = 0) {
+                if (record.text.size() > UINT32_MAX) return false;
+                if ((entries_.size() + 1) * 2 > slots_.size()) {
+                    const std::size_t slots = std::max<std::size_t>(16, slots_.size() * 2);
+                    if (Memory(std::max(entries_.capacity(), entries_.size() + 1), slots) > memoryBytes_) return false;
+                    Rehash(slots);
+                }
+                // При росте массива записей старый и новый буферы живут одновременно
+                if (entries_.size() == entries_.capacity() &&
+                    Memory(entries_.capacity() + std::max<std::size_t>(16, entries_.capacity() * 2), slots_.size()) > memoryBytes_) {
+                    return false;
+                }
+
+                const std::string_view id = record.Field(0);
+                const auto hash = static_cast<std::uint32_t>(HashString(id));
+                std::size_t i = hash & mask_;
+                for (; slots_[i] != 0; i = (i + 1) & mask_) {
+                    const Entry& entry = entries_[slots_[i] - 1];
+                    if (entry.hash == hash && IdOf(Text(entry)) == id) ThrowDuplicate(id, record.line, old);
+                }
+                entries_.push_back(Entry{ record.text.data(), static_cast<std::uint32_t>(record.text.size()), hash, record.line | flags });
+                slots_[i] = static_cast<std::uint32_t>(entries_.size());
+                return true;
+            }
+
+            Entry* Find(std::string_view id) {
+                if (slots_.empty()) return nullptr;
+                const auto hash = static_cast<std::uint32_t>(HashString(id));
+                for (std::size_t i = hash & mask_; slots_[i] != 0; i = (i + 1) & mask_) {
+                    Entry& entry = entries_[slots_[i] - 1];
+                    if (entry.hash == hash && IdOf(Text(entry)) == id) return &entry;
+                }
+                return nullptr;
+            }
+
+            const std::vector<Entry>& Entries() const { return entries_; }
+
+            static std::string_view Text(const Entry& entry) { return std::string_view(entry.text, entry.size); }
+
+        private:
+            static std::size_t Memory(std::size_t entries, std::size_t slots) {
+                return entries * sizeof(Entry) + slots * sizeof(std::uint32_t);
+            }
+
+            void Rehash(std::size_t capacity) {
+                slots_.assign(capacity, 0);
+                mask_ = capacity - 1;
+                for (std::size_t e = 0; e < entries_.size(); ++e) {
+                    std::size_t i = entries_[e].hash & mask_;
+                    while (slots_[i] != 0) i = (i + 1) & mask_;
+                    slots_[i] = static_cast<std::uint32_t>(e + 1);
+                }
+            }
+
+            std::size_t memoryBytes_;
+            std::vector<Entry> entries_;
+            std::vector<std::uint32_t> slots_;
+            std::size_t mask_ = 0;
+        };
+
+        // build - меньший файл; false - его id не поместились в память
+        bool HashJoin(std::string_view build, std::string_view probe, bool buildIsOld, std::size_t memoryBytes,
+            DiffOutput& out, DiffStats& stats) {
+            IdTable table(memoryBytes);
+            std::uint64_t buildRecords = 0;
+            std::uint64_t probeRecords = 0;
+            Record record;
+            {
+                RecordReader reader(build);
+                while (reader.Next(record)) {
+                    if (!table.Add(record, buildIsOld)) return false;
+                    ++buildRecords;
+                }
+            }
+
+            // Проверка большего файла до выдачи: id, которых нет в меньшем, тоже попадают в таблицу,
+            // чтобы их повтор был ошибкой, как при слиянии. Таблица еще может не поместиться
+            // в память - тогда в sink ничего не ушло и можно перейти к слиянию
+            {
+                RecordReader reader(probe);
+                while (reader.Next(record)) {
+                    ++probeRecords;
+                    const std::string_view id = record.Field(0);
+                    IdTable::Entry* entry = table.Find(id);
+                    if (!entry) {
+                        if (!table.Add(record, !buildIsOld, PROBE_ONLY)) return false;
+                        continue;
+                    }
+                    if (entry->line & (MATCHED | PROBE_ONLY)) ThrowDuplicate(id, record.line, !buildIsOld);
+                    entry->line |= MATCHED;
+                }
+            }
+
+            RecordReader reader(probe);
+            while (reader.Next(record)) {
+                const std::string_view id = record.Field(0);
+                const IdTable::Entry& entry = *table.Find(id);
+                if (entry.line & PROBE_ONLY) {
+                    if (buildIsOld) out.Added(id, record.line, record.text);
+                    else out.Removed(id, record.line, record.text);
+                    continue;
+                }
+                const std::string_view text = IdTable::Text(entry);
+                if (buildIsOld) out.Matched(id, entry.line & LINE_MASK, text, record.line, record.text);
+                else out.Matched(id, record.line, record.text, entry.line & LINE_MASK, text);
+            }
+
+            for (const IdTable::Entry& entry : table.Entries()) {
+                if (entry.line & (MATCHED | PROBE_ONLY)) continue;
+                const std::string_view text = IdTable::Text(entry);
+                if (buildIsOld) out.Removed(IdOf(text), entry.line, text);
+                else out.Added(IdOf(text), entry.line, text);
+            }
+            stats.oldRecords = buildIsOld ? buildRecords : probeRecords;
+            stats.newRecords = buildIsOld ? probeRecords : buildRecords;
+            return true;
+        }
+
+        // Записи одного файла по возрастанию id; иначе - std::runtime_error
+        class OrderedReader {
+        public:
+            OrderedReader(std::string_view data, bool old) : reader_(data), old_(old) { Advance(); }
+
+            bool Valid() const { return valid_; }
+            const Record& Current() const { return record_; }
+            std::string_view Id() const { return id_; }
+            std::uint64_t Records() const { return records_; }
+
+            void Advance() {
+                const std::string_view previous = id_;
+                valid_ = reader_.Next(record_);
+                if (!valid_) return;
+                id_ = record_.Field(0);
+                if (records_++ == 0) return;
+                const int order = CompareIds(previous, id_);
+                if (order == 0) ThrowDuplicate(id_, record_.line, old_);
+                if (order > 0) {
+                    throw std::runtime_error(std::string(old_ ? "Прежний" : "Новый") + " файл не упорядочен по id: строка " +
+                        std::to_string(record_.line) + " (id " + std::string(id_) + " после " + std::string(previous) + ")");
+                }
+            }
+
+        private:
+            RecordReader reader_;
+            Record record_;
+            std::string_view id_;      // строки файла не копируются: данные живут дольше читателя
+            std::uint64_t records_ = 0;
+            bool old_;
+            bool valid_ = false;
+        };
+
+        void MergeJoin(std::string_view oldData, std::string_view newData, DiffOutput& out, DiffStats& stats) {
+            OrderedReader oldReader(oldData, true);
+            OrderedReader newReader(newData, false);
+            while (oldReader.Valid() || newReader.Valid()) {
+                const int order = !newReader.Valid() ? -1 : !oldReader.Valid() ? 1 : CompareIds(oldReader.Id(), newReader.Id());
+                if (order < 0) {
+                    out.Removed(oldReader.Id(), oldReader.Current().line, oldReader.Current().text);
+                    oldReader.Advance();
+                }
+                else if (order > 0) {
+                    out.Added(newReader.Id(), newReader.Current().line, newReader.Current().text);
+                    newReader.Advance();
+                }
+                else {
+                    out.Matched(oldReader.Id(), oldReader.Current().line, oldReader.Current().text,
+                        newReader.Current().line, newReader.Current().text);
+                    oldReader.Advance();
+                    newReader.Advance();
+                }
+            }
+            stats.oldRecords = oldReader.Records();
+            stats.newRecords = newReader.Records();
+        }
+    }
+
+    const char* DiffMethodName(DiffMethod method) {
+        switch (method) {
+        case DiffMethod::Hash: return "hash";
+        case DiffMethod::Merge: return "merge";
+        default: return "auto";
+        }
+    }
+
+    int CompareIds(std::string_view a, std::string_view b) {
+        const bool numberA = IsNumber(a);
+        const bool numberB = IsNumber(b);
+        if (numberA != numberB) return numberA ? -1 : 1;
+        if (numberA) {
+            const std::string_view valueA = a.substr(std::min(a.find_first_not_of('0'), a.size()));
+            const std::string_view valueB = b.substr(std::min(b.find_first_not_of('0'), b.size()));
+            if (valueA.size() != valueB.size()) return valueA.size() < valueB.size() ? -1 : 1;
+            if (const int order = valueA.compare(valueB)) return order < 0 ? -1 : 1;
+            // Одно число с разным числом нулей впереди: больше нулей - раньше
+            if (a.size() != b.size()) return a.size() > b.size() ? -1 : 1;
+            return 0;
+        }
+        const int order = a.compare(b);
+        return order < 0 ? -1 : order > 0 ? 1 : 0;
+    }
+
+    std::string_view RecordField(std::string_view text, std::size_t index) {
+        Fields fields;
+        const std::size_t count = SplitFields(text, fields);
+        return index < count ? fields[index] : std::string_view();
+    }
+
+    DiffStats DiffMigrations(std::string_view oldData, std::string_view newData, const DiffSink& sink, const DiffOptions& options) {
+        DiffStats stats;
+        DiffOutput out(sink, stats);
+        if (options.method != DiffMethod::Merge) {
+            // Таблица строится по меньшему файлу и дополняется id большего; пока она растет,
+            // в sink ничего не уходит, поэтому при нехватке памяти можно перейти к слиянию
+            const bool oldSmaller = oldData.size() <= newData.size();
+            if (HashJoin(oldSmaller ? oldData : newData, oldSmaller ? newData : oldData, oldSmaller, options.memoryBytes, out, stats)) {
+                stats.method = DiffMethod::Hash;
+                return stats;
+            }
+            if (options.method == DiffMethod::Hash) {
+                throw std::runtime_error("Таблица id не помещается в память: увеличьте лимит или упорядочьте файлы по id");
+            }
+        }
+        MergeJoin(oldData, newData, out, stats);
+        stats.method = DiffMethod::Merge;
+        return stats;
+    }
+}
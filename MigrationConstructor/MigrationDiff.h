@@ -0,0 +1,62 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+// Сравнение двух файлов миграции по id (первая колонка): добавленные, удаленные и измененные
+// записи и номера измененных полей. Если id меньшего файла и id большего, которых нет
+// в меньшем, помещаются в лимит памяти - хеш-соединение, иначе слияние файлов, упорядоченных
+// по id, за один проход без памяти под записи. Файлы читаются как есть (MappedFile): в памяти
+// только таблица id
+namespace mc {
+    enum class DiffMethod { Auto, Hash, Merge };
+
+    const char* DiffMethodName(DiffMethod method);
+
+    enum class DiffKind { Added, Removed, Changed };
+
+    // Строки действительны только внутри обратного вызова
+    struct DiffEntry {
+        DiffKind kind;
+        std::string_view id;
+        std::uint64_t oldLine = 0;           // 0 - записи нет (Added)
+        std::uint64_t newLine = 0;           // 0 - записи нет (Removed)
+        std::string_view oldText;
+        std::string_view newText;
+        std::uint64_t changedFields = 0;     // Changed: бит i - поле i изменилось
+    };
+
+    using DiffSink = std::function<void(const DiffEntry& entry)>;
+
+    struct DiffOptions {
+        DiffMethod method = DiffMethod::Auto;
+        std::size_t memoryBytes = std::size_t(256) << 20;   // предел таблицы хеш-соединения
+    };
+
+    struct DiffStats {
+        std::uint64_t oldRecords = 0;
+        std::uint64_t newRecords = 0;
+        std::uint64_t added = 0;
+        std::uint64_t removed = 0;
+        std::uint64_t changed = 0;
+        std::uint64_t unchanged = 0;
+        std::vector<std::uint64_t> fieldChanges;    // по номеру поля: сколько записей его изменили
+        DiffMethod method = DiffMethod::Auto;       // каким способом сравнено
+    };
+
+    // Порядок id: числа - по значению, остальное - побайтно после чисел.
+    // Равны только одинаковые строки ("007" идет сразу перед "7")
+    int CompareIds(std::string_view a, std::string_view b);
+
+    // Поле строки записи по номеру, как в RecordReader (последнее из MAX_RECORD_FIELDS - остаток строки)
+    std::string_view RecordField(std::string_view text, std::size_t index);
+
+    // Записи сообщаются в sink: при хеш-соединении - в порядке большего файла, затем
+    // оставшиеся из меньшего, при слиянии - по возрастанию id. Повтор id в одном файле,
+    // Hash без места в памяти и Merge по неупорядоченному файлу - std::runtime_error
+    DiffStats DiffMigrations(std::string_view oldData, std::string_view newData, const DiffSink& sink,
+        const DiffOptions& options = {});
+}
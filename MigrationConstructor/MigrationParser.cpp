@@ -0,0 +1,49 @@
+﻿#include "MigrationParser.h"
+
+namespace mc {
+    RecordReader::RecordReader(std::string_view data, SimdLevel level)
+        : pos_(data.data()), end_(data.data() + data.size()),
+        scanner_(data.data(), data.data() + data.size(), GetDelimiterMaskFn(level)) {
+        // BOM UTF-8 в начале файла не относится к первому полю
+        if (data.size() >= 3 && data.compare(0, 3, "\xEF\xBB\xBF") == 0) {
+            pos_ += 3;
+        }
+    }
+
+    bool RecordReader::Next(Record& record) {
+        while (pos_ < end_) {
+            const char* lineStart = pos_;
+            const char* fieldStart = pos_;
+            std::size_t count = 0;
+            ++line_;
+
+            for (;;) {
+                const char* delimiter = scanner_.Next();
+                const bool lineEnd = delimiter == end_ || *delimiter == '\n';
+                if (!lineEnd) {
+                    if (count < MAX_RECORD_FIELDS - 1) {
+                        fields_[count++] = std::string_view(fieldStart, delimiter - fieldStart);
+                        fieldStart = delimiter + 1;
+                    }
+                    continue;
+                }
+
+                const char* lineStop = delimiter;
+                if (lineStop > lineStart && lineStop[-1] == '\r') --lineStop;
+                if (lineStop < fieldStart) fieldStart = lineStop;
+                fields_[count++] = std::string_view(fieldStart, lineStop - fieldStart);
+                pos_ = delimiter == end_ ? end_ : delimiter + 1;
+
+                record.line = line_;
+                record.text = std::string_view(lineStart, lineStop - lineStart);
+                break;
+            }
+
+            if (record.text.empty()) continue;
+            record.fieldCount = count;
+            record.fields = fields_.data();
+            return true;
+        }
+        return false;
+    }
+}
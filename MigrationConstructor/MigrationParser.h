@@ -0,0 +1,52 @@
+﻿#pragma once
+
+#include "DelimiterScan.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Разбор файла миграции без копирования: поля - string_view в исходный буфер
+namespace mc {
+    // Поля сверх лимита остаются в последнем поле вместе с разделителями
+    constexpr std::size_t MAX_RECORD_FIELDS = 64;
+
+    struct Record {
+        std::uint64_t line = 0;            // номер строки с 1
+        std::string_view text;             // строка без '\r\n'
+        std::size_t fieldCount = 0;
+        const std::string_view* fields = nullptr;
+
+        std::string_view Field(std::size_t index) const {
+            return index < fieldCount ? fields[index] : std::string_view();
+        }
+    };
+
+    // Начало строки, в которой лежит байт pos - 1: куски от LineStart(a) до LineStart(b)
+    // содержат только целые строки, и каждая строка попадает ровно в один кусок
+    inline std::size_t LineStart(std::string_view data, std::size_t pos) {
+        if (pos == 0 || pos >= data.size()) return pos < data.size() ? pos : data.size();
+        const std::size_t newline = data.find('\n', pos - 1);
+        return newline == std::string_view::npos ? data.size() : newline + 1;
+    }
+
+    class RecordReader {
+    public:
+        explicit RecordReader(std::string_view data, SimdLevel level = DetectSimdLevel());
+
+        // Следующая непустая запись; false, когда данные закончились.
+        // Поля действительны до следующего вызова
+        bool Next(Record& record);
+
+        // Сколько строк пройдено, включая пустые
+        std::uint64_t Line() const { return line_; }
+
+    private:
+        const char* pos_;
+        const char* end_;
+        DelimiterScanner scanner_;
+        std::uint64_t line_ = 0;
+        std::array<std::string_view, MAX_RECORD_FIELDS> fields_;
+    };
+}
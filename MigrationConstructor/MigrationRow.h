@@ -0,0 +1,307 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <utility>
+
+// Формат записи файла миграции: id;login_NN;<комбобоксы>;<доп. поля>
+// Колонки описаны один раз в ROW_COLUMNS; по схеме на этапе компиляции собираются
+// форматирование и разбор записи для окна (wchar_t) и консольной утилиты (char)
+namespace mc {
+    enum class ColumnKind { Id, Login, Dictionary };
+
+    struct ColumnSpec {
+        ColumnKind kind;
+        const char* name;   // для Dictionary - имя файла словаря без .txt
+    };
+
+    constexpr ColumnSpec ROW_COLUMNS[] = {
+        { ColumnKind::Id, "id" },
+        { ColumnKind::Login, "login" },
+        { ColumnKind::Dictionary, "role" },
+        { ColumnKind::Dictionary, "headLead" },
+        { ColumnKind::Dictionary, "fullname" },
+        { ColumnKind::Dictionary, "position" },
+        { ColumnKind::Dictionary, "department" },
+        { ColumnKind::Dictionary, "protectedInfoAccess" },
+        { ColumnKind::Dictionary, "desks" },
+        { ColumnKind::Dictionary, "region" },
+        { ColumnKind::Dictionary, "personalNumber" },
+        { ColumnKind::Dictionary, "pointOfSale" },
+        { ColumnKind::Dictionary, "coordinator" },
+        { ColumnKind::Dictionary, "BaseMarketFinanceSectors" },
+        { ColumnKind::Dictionary, "CredDocInvestOperatons" },
+        { ColumnKind::Dictionary, "percIndCoordinator" },
+    };
+    constexpr std::size_t ROW_COLUMN_COUNT = std::size(ROW_COLUMNS);
+
+    // Доп. поля идут после колонок схемы
+    constexpr int MAX_EXTRA_FIELDS = 3;
+    constexpr std::size_t MAX_ROW_FIELDS = ROW_COLUMN_COUNT + MAX_EXTRA_FIELDS;
+    constexpr std::size_t LOGIN_SUFFIX_WIDTH = 2;
+
+    constexpr std::size_t CountColumns(ColumnKind kind) {
+        std::size_t count = 0;
+        for (const ColumnSpec& column : ROW_COLUMNS) {
+            if (column.kind == kind) ++count;
+        }
+        return count;
+    }
+
+    constexpr std::size_t FirstColumn(ColumnKind kind) {
+        for (std::size_t i = 0; i < ROW_COLUMN_COUNT; ++i) {
+            if (ROW_COLUMNS[i].kind == kind) return i;
+        }
+        return ROW_COLUMN_COUNT;
+    }
+
+    // Колонки словарей (комбобоксы) в порядке comboBoxFiles
+    constexpr std::size_t COLUMN_COUNT = CountColumns(ColumnKind::Dictionary);
+    constexpr std::size_t FIRST_DICTIONARY_COLUMN = FirstColumn(ColumnKind::Dictionary);
+
+    static_assert(CountColumns(ColumnKind::Id) == 1 && CountColumns(ColumnKind::Login) == 1,
+        "В записи ровно один id и один логин");
+    static_assert(FIRST_DICTIONARY_COLUMN + COLUMN_COUNT == ROW_COLUMN_COUNT,
+        "Колонки словарей идут подряд в конце схемы");
+
+    constexpr const char* DictionaryColumnName(std::size_t i) {
+        return ROW_COLUMNS[FIRST_DICTIONARY_COLUMN + i].name;
+    }
+
+    // Значения одной записи; строки не копируются
+    template <class CharT>
+    struct Row {
+        using View = std::basic_string_view<CharT>;
+
+        long long id = 0;
+        View loginBase;                 // без суффикса _NN
+        long long loginCounter = 0;     // после разбора -1, если у логина нет суффикса
+        View columns[COLUMN_COUNT];
+        View extras[MAX_EXTRA_FIELDS];
+        std::size_t extraCount = 0;
+    };
+
+    template <class CharT>
+    constexpr bool IsAsciiDigit(CharT ch) {
+        return ch >= CharT('0') && ch <= CharT('9');
+    }
+
+    // Суффикс логина - '_' и не меньше LOGIN_SUFFIX_WIDTH цифр: счетчик дополняется нулями до
+    // LOGIN_SUFFIX_WIDTH, а больший пишется целиком ("user_07", "user_100"). Цифр не больше,
+    // чем помещается в long long
+    constexpr std::size_t MAX_LOGIN_SUFFIX_DIGITS = 18;
+
+    // Отрезает суффикс, если есть
+    template <class CharT>
+    std::basic_string_view<CharT> StripLoginSuffix(std::basic_string_view<CharT> login) {
+        const size_t underscorePos = login.find_last_of(CharT('_'));
+        if (underscorePos == std::basic_string_view<CharT>::npos) return login;
+        const size_t digits = login.length() - underscorePos - 1;
+        if (digits < LOGIN_SUFFIX_WIDTH || digits > MAX_LOGIN_SUFFIX_DIGITS) return login;
+        for (size_t i = underscorePos + 1; i < login.length(); ++i) {
+            if (!IsAsciiDigit(login[i])) return login;
+        }
+        return login.substr(0, underscorePos);
+    }
+
+    // Счетчик из суффикса логина; -1, если суффикса нет
+    template <class CharT>
+    long long LoginSuffixCounter(std::basic_string_view<CharT> login) {
+        const size_t baseLength = StripLoginSuffix(login).size();
+        if (baseLength == login.size()) return -1;
+        long long counter = 0;
+        for (size_t i = baseLength + 1; i < login.size(); ++i) counter = counter * 10 + (login[i] - CharT('0'));
+        return counter;
+    }
+
+    // Целые числа: длина считается заранее, цифры пишутся парами с конца
+    namespace detail {
+        constexpr char DIGIT_PAIRS[] =
+            "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+            "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+            "8081828384858687888990919293949596979899";
+
+        constexpr unsigned long long Magnitude(long long value) {
+            return value < 0 ? 0ull - static_cast<unsigned long long>(value) : static_cast<unsigned long long>(value);
+        }
+
+        constexpr std::size_t CountDigits(unsigned long long value) {
+            std::size_t digits = 1;
+            for (; value >= 100; value /= 100) digits += 2;
+            return digits + (value >= 10);
+        }
+    }
+
+    // Длина числа с дополнением нулями до minDigits цифр
+    constexpr std::size_t IntLength(long long value, std::size_t minDigits = 1) {
+        return (value < 0) + std::max(detail::CountDigits(detail::Magnitude(value)), minDigits);
+    }
+
+    template <class CharT>
+    CharT* WriteInt(CharT* out, long long value, std::size_t minDigits = 1) {
+        if (value < 0) *out++ = CharT('-');
+        unsigned long long magnitude = detail::Magnitude(value);
+        CharT* const end = out + std::max(detail::CountDigits(magnitude), minDigits);
+        CharT* p = end;
+        for (; magnitude >= 100; magnitude /= 100) {
+            const std::size_t pair = static_cast<std::size_t>(magnitude % 100) * 2;
+            *--p = CharT(detail::DIGIT_PAIRS[pair + 1]);
+            *--p = CharT(detail::DIGIT_PAIRS[pair]);
+        }
+        if (magnitude >= 10) {
+            const std::size_t pair = static_cast<std::size_t>(magnitude) * 2;
+            *--p = CharT(detail::DIGIT_PAIRS[pair + 1]);
+            *--p = CharT(detail::DIGIT_PAIRS[pair]);
+        }
+        else {
+            *--p = CharT('0' + magnitude);
+        }
+        while (p > out) *--p = CharT('0');
+        return end;
+    }
+
+    // Начало записи "id;login_NN;" - общее для окна и пакетной генерации
+    template <class CharT>
+    constexpr std::size_t RowHeadLength(long long id, std::basic_string_view<CharT> loginBase, long long loginCounter) {
+        return IntLength(id) + 1 + loginBase.size() + 1 + IntLength(loginCounter, LOGIN_SUFFIX_WIDTH) + 1;
+    }
+
+    template <class CharT>
+    CharT* WriteRowHead(CharT* out, long long id, std::basic_string_view<CharT> loginBase, long long loginCounter) {
+        out = WriteInt(out, id);
+        *out++ = CharT(';');
+        out = std::copy(loginBase.begin(), loginBase.end(), out);
+        *out++ = CharT('_');
+        out = WriteInt(out, loginCounter, LOGIN_SUFFIX_WIDTH);
+        *out++ = CharT(';');
+        return out;
+    }
+
+    namespace detail {
+        template <ColumnKind Kind, std::size_t Index, class CharT>
+        std::size_t ColumnLength(const Row<CharT>& row) {
+            if constexpr (Kind == ColumnKind::Id) return IntLength(row.id);
+            else if constexpr (Kind == ColumnKind::Login) return row.loginBase.size() + 1 + IntLength(row.loginCounter, LOGIN_SUFFIX_WIDTH);
+            else return row.columns[Index - FIRST_DICTIONARY_COLUMN].size();
+        }
+
+        template <ColumnKind Kind, std::size_t Index, class CharT>
+        CharT* WriteColumn(const Row<CharT>& row, CharT* out) {
+            if constexpr (Kind == ColumnKind::Id) {
+                out = WriteInt(out, row.id);
+            }
+            else if constexpr (Kind == ColumnKind::Login) {
+                out = std::copy(row.loginBase.begin(), row.loginBase.end(), out);
+                *out++ = CharT('_');
+                out = WriteInt(out, row.loginCounter, LOGIN_SUFFIX_WIDTH);
+            }
+            else {
+                const auto value = row.columns[Index - FIRST_DICTIONARY_COLUMN];
+                out = std::copy(value.begin(), value.end(), out);
+            }
+            if constexpr (Index + 1 < ROW_COLUMN_COUNT) *out++ = CharT(';');
+            return out;
+        }
+
+        // Поле записи в значение колонки по ее виду
+        template <ColumnKind Kind, std::size_t Index, class CharT>
+        void ParseColumn(Row<CharT>& row, std::basic_string_view<CharT> field) {
+            if constexpr (Kind == ColumnKind::Id) {
+                // Как std::stoi: знак и ведущие цифры, остальное отбрасывается.
+                // Слишком длинное число не переполняется, а упирается в LLONG_MAX
+                std::size_t pos = 0;
+                const bool negative = !field.empty() && field[0] == CharT('-');
+                if (negative || (!field.empty() && field[0] == CharT('+'))) ++pos;
+                constexpr long long limit = (std::numeric_limits<long long>::max)();
+                long long value = 0;
+                for (; pos < field.size() && IsAsciiDigit(field[pos]); ++pos) {
+                    const int digit = static_cast<int>(field[pos] - CharT('0'));
+                    value = value > (limit - digit) / 10 ? limit : value * 10 + digit;
+                }
+                row.id = negative ? -value : value;
+            }
+            else if constexpr (Kind == ColumnKind::Login) {
+                row.loginBase = StripLoginSuffix(field);
+                row.loginCounter = LoginSuffixCounter(field);
+            }
+            else {
+                row.columns[Index - FIRST_DICTIONARY_COLUMN] = field;
+            }
+        }
+
+        template <class CharT, std::size_t... I>
+        std::size_t RowLength(const Row<CharT>& row, std::index_sequence<I...>) {
+            return (ColumnLength<ROW_COLUMNS[I].kind, I>(row) + ...) + (ROW_COLUMN_COUNT - 1);
+        }
+
+        template <class CharT, std::size_t... I>
+        CharT* WriteColumns(const Row<CharT>& row, CharT* out, std::index_sequence<I...>) {
+            ((out = WriteColumn<ROW_COLUMNS[I].kind, I>(row, out)), ...);
+            return out;
+        }
+
+        template <class CharT, std::size_t... I>
+        void ParseColumns(Row<CharT>& row, const std::basic_string_view<CharT>* fields, std::index_sequence<I...>) {
+            (ParseColumn<ROW_COLUMNS[I].kind, I>(row, fields[I]), ...);
+        }
+    }
+
+    // Точная длина записи без перевода строки
+    template <class CharT>
+    std::size_t RowLength(const Row<CharT>& row) {
+        std::size_t length = detail::RowLength(row, std::make_index_sequence<ROW_COLUMN_COUNT>());
+        for (std::size_t i = 0; i < row.extraCount; ++i) {
+            length += 1 + row.extras[i].size();
+        }
+        return length;
+    }
+
+    // Без проверки размера: в out должно помещаться RowLength(row) символов
+    template <class CharT>
+    CharT* WriteRow(const Row<CharT>& row, CharT* out) {
+        out = detail::WriteColumns(row, out, std::make_index_sequence<ROW_COLUMN_COUNT>());
+        for (std::size_t i = 0; i < row.extraCount; ++i) {
+            *out++ = CharT(';');
+            out = std::copy(row.extras[i].begin(), row.extras[i].end(), out);
+        }
+        return out;
+    }
+
+    // Запись в буфер вызывающего без завершающего нуля; 0, если не помещается
+    template <class CharT>
+    std::size_t FormatRow(const Row<CharT>& row, CharT* buffer, std::size_t capacity) {
+        const std::size_t length = RowLength(row);
+        if (length > capacity) return 0;
+        WriteRow(row, buffer);
+        return length;
+    }
+
+    // Разбор записи по той же схеме; false, если нет хотя бы id и логина.
+    // Недостающие колонки остаются пустыми, поля сверх MAX_EXTRA_FIELDS отбрасываются
+    template <class CharT>
+    bool ParseRow(std::basic_string_view<CharT> line, Row<CharT>& row) {
+        using View = std::basic_string_view<CharT>;
+        if (!line.empty() && line.back() == CharT('\r')) line.remove_suffix(1);
+
+        View fields[MAX_ROW_FIELDS];
+        std::size_t count = 0;
+        for (std::size_t start = 0; count < MAX_ROW_FIELDS;) {
+            const std::size_t end = line.find(CharT(';'), start);
+            fields[count++] = line.substr(start, end == View::npos ? View::npos : end - start);
+            if (end == View::npos) break;
+            start = end + 1;
+        }
+        if (count < 2) return false;
+
+        detail::ParseColumns(row, fields, std::make_index_sequence<ROW_COLUMN_COUNT>());
+        row.extraCount = count > ROW_COLUMN_COUNT ? count - ROW_COLUMN_COUNT : 0;
+        for (std::size_t i = 0; i < row.extraCount; ++i) {
+            row.extras[i] = fields[ROW_COLUMN_COUNT + i];
+        }
+        return true;
+    }
+}
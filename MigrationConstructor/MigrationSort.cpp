@@ -0,0 +1,345 @@
+﻿#include "MigrationSort.h"
+#include "MigrationDiff.h"
+#include "MigrationParser.h"
+#include "MigrationWriter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace mc {
+    namespace {
+        constexpr std::size_t MIN_CHUNK = 64 * 1024;
+        constexpr std::size_t RUN_BUFFER = 64 * 1024;
+        constexpr std::size_t MIN_MERGE_BUFFER = 64 * 1024;
+        constexpr std::size_t MAX_MERGE_BUFFER = 4 << 20;
+
+        // Запись куска: строка в отображенном файле и положение ключа в ней
+        struct Entry {
+            const char* text;
+            std::uint32_t size;
+            std::uint32_t keyOffset;
+            std::uint32_t keySize;
+        };
+
+        // Заголовок записи в серии, за ним - строка
+        struct RunHeader {
+            std::uint32_t size;
+            std::uint32_t keyOffset;
+            std::uint32_t keySize;
+        };
+
+        int CompareKeys(std::string_view a, std::string_view b, bool numeric) {
+            return numeric ? CompareIds(a, b) : a.compare(b);
+        }
+
+        // Временные файлы удаляются, даже если сортировка прервана исключением
+        class TempFiles {
+        public:
+            explicit TempFiles(std::filesystem::path dir) : dir_(std::move(dir)) {
+                std::random_device random;
+                prefix_ = "mcsort-" + std::to_string(random()) + "-";
+            }
+
+            ~TempFiles() {
+                for (const std::filesystem::path& path : paths_) {
+                    std::error_code ignored;
+                    std::filesystem::remove(path, ignored);
+                }
+            }
+
+            TempFiles(const TempFiles&) = delete;
+            TempFiles& operator=(const TempFiles&) = delete;
+
+            std::filesystem::path Create() {
+                std::lock_guard<std::mutex> lock(mutex_);
+                paths_.push_back(dir_ / (prefix_ + std::to_string(paths_.size()) + ".tmp"));
+                return paths_.back();
+            }
+
+            void Remove(const std::filesystem::path& path) {
+                std::error_code ignored;
+                std::filesystem::remove(path, ignored);
+            }
+
+        private:
+            std::filesystem::path dir_;
+            std::string prefix_;
+            std::mutex mutex_;
+            std::vector<std::filesystem::path> paths_;
+        };
+
+        // Записи копятся в буфере и уходят в файл блоками, как разделы DuplicateDetector
+        class RunWriter {
+        public:
+            explicit RunWriter(const std::filesystem::path& path) : path_(path), out_(path, std::ios::binary | std::ios::trunc) {
+                if (!out_.is_open()) throw std::runtime_error("Ошибка создания файла: " + path.string());
+                buffer_.reserve(RUN_BUFFER);
+            }
+
+            void Add(std::string_view text, std::uint32_t keyOffset, std::uint32_t keySize) {
+                const RunHeader header{ static_cast<std::uint32_t>(text.size()), keyOffset, keySize };
+                buffer_.append(reinterpret_cast<const char*>(&header), sizeof(header));
+                buffer_.append(text);
+                bytes_ += sizeof(header) + text.size();
+                if (buffer_.size() >= RUN_BUFFER) Flush();
+            }
+
+            void Close() {
+                Flush();
+                out_.close();
+                if (!out_) throw std::runtime_error("Ошибка записи в файл: " + path_.string());
+            }
+
+            std::uint64_t Bytes() const { return bytes_; }
+
+        private:
+            void Flush() {
+                out_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+                buffer_.clear();
+            }
+
+            std::filesystem::path path_;
+            std::ofstream out_;
+            std::string buffer_;
+            std::uint64_t bytes_ = 0;
+        };
+
+        class RunReader {
+        public:
+            RunReader(const std::filesystem::path& path, std::size_t bufferBytes)
+                : path_(path), in_(path, std::ios::binary), bufferBytes_(bufferBytes) {
+                if (!in_.is_open()) throw std::runtime_error("Ошибка открытия файла: " + path.string());
+            }
+
+            // Строки действительны до следующего вызова
+            bool Next() {
+                RunHeader header;
+                if (!Ensure(sizeof(header))) return false;
+                std::memcpy(&header, buffer_.data() + pos_, sizeof(header));
+                pos_ += sizeof(header);
+                if (!Ensure(header.size)) throw std::runtime_error("Временный файл обрезан: " + path_.string());
+                text_ = std::string_view(buffer_.data() + pos_, header.size);
+                key_ = text_.substr(header.keyOffset, header.keySize);
+                keyOffset_ = header.keyOffset;
+                pos_ += header.size;
+                return true;
+            }
+
+            std::string_view Text() const { return text_; }
+            std::string_view Key() const { return key_; }
+            std::uint32_t KeyOffset() const { return keyOffset_; }
+
+        private:
+            // В буфере не меньше bytes непрочитанных байт; false, если файл кончился
+            bool Ensure(std::size_t bytes) {
+                if (buffer_.size() - pos_ >= bytes) return true;
+                buffer_.erase(0, pos_);
+                pos_ = 0;
+                const std::size_t have = buffer_.size();
+                buffer_.resize(std::max(bufferBytes_, bytes));
+                in_.read(buffer_.data() + have, static_cast<std::streamsize>(buffer_.size() - have));
+                buffer_.resize(have + static_cast<std::size_t>(in_.gcount()));
+                return buffer_.size() >= bytes;
+            }
+
+            std::filesystem::path path_;
+            std::ifstream in_;
+            std::size_t bufferBytes_;
+            std::string buffer_;
+            std::size_t pos_ = 0;
+            std::string_view text_;
+            std::string_view key_;
+            std::uint32_t keyOffset_ = 0;
+        };
+
+        // Дерево проигравших над k сериями: листья - k..2k-1, во внутренних узлах 1..k-1 -
+        // проигравшие своих поддеревьев, победитель - отдельно. После того как победитель
+        // продвинулся, переигрывается только путь от его листа к корню: log2(k) сравнений
+        // вместо k - 1 у простого выбора минимума
+        template <class Less>
+        class LoserTree {
+        public:
+            LoserTree(std::size_t k, Less less) : k_(k), less_(less), losers_(k) {
+                winner_ = Build(1);
+            }
+
+            std::size_t Winner() const { return winner_; }
+
+            void Replay() {
+                std::size_t winner = winner_;
+                for (std::size_t node = (winner + k_) / 2; node > 0; node /= 2) {
+                    if (less_(losers_[node], winner)) std::swap(losers_[node], winner);
+                }
+                winner_ = winner;
+            }
+
+        private:
+            std::size_t Build(std::size_t node) {
+                if (node >= k_) return node - k_;
+                const std::size_t left = Build(2 * node);
+                const std::size_t right = Build(2 * node + 1);
+                const bool leftWins = less_(left, right);
+                losers_[node] = leftWins ? right : left;
+                return leftWins ? left : right;
+            }
+
+            std::size_t k_;
+            Less less_;
+            std::vector<std::size_t> losers_;
+            std::size_t winner_ = 0;
+        };
+
+        // Слияние серий по возрастанию ключа; при равных ключах первой идет серия с меньшим
+        // номером, а серии пронумерованы в порядке файла - поэтому слияние устойчивое
+        template <class Sink>
+        void MergeRuns(const std::vector<std::filesystem::path>& runs, std::size_t memoryBytes, bool numeric, Sink&& sink) {
+            if (runs.empty()) return;
+            const std::size_t bufferBytes = std::clamp(memoryBytes / (runs.size() + 1), MIN_MERGE_BUFFER, MAX_MERGE_BUFFER);
+            std::vector<RunReader> readers;
+            std::vector<char> valid(runs.size());
+            readers.reserve(runs.size());
+            for (std::size_t i = 0; i < runs.size(); ++i) {
+                readers.emplace_back(runs[i], bufferBytes);
+                valid[i] = readers[i].Next();
+            }
+            const auto less = [&](std::size_t a, std::size_t b) {
+                if (!valid[a]) return false;
+                if (!valid[b]) return true;
+                const int order = CompareKeys(readers[a].Key(), readers[b].Key(), numeric);
+                return order != 0 ? order < 0 : a < b;
+            };
+            LoserTree<decltype(less)> tree(runs.size(), less);
+            for (std::size_t winner; valid[winner = tree.Winner()];) {
+                const RunReader& reader = readers[winner];
+                sink(reader.Text(), reader.KeyOffset(), static_cast<std::uint32_t>(reader.Key().size()));
+                valid[winner] = readers[winner].Next();
+                tree.Replay();
+            }
+        }
+    }
+
+    SortStats SortMigration(std::string_view data, const std::filesystem::path& outPath, const SortOptions& options) {
+        SortStats stats;
+        constexpr std::string_view BOM = "\xEF\xBB\xBF";
+        stats.bom = data.substr(0, BOM.size()) == BOM;
+        const bool numeric = options.column == 0;
+        const std::size_t memoryBytes = std::max(options.memoryBytes, 4 * MIN_CHUNK);
+
+        // Куски - по половине доли потока: вторая половина - под индекс записей
+        // и буфер устойчивой сортировки (половина индекса)
+        unsigned threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+        std::size_t chunkBytes = std::max(MIN_CHUNK, memoryBytes / threads / 2);
+        const std::size_t chunkCount = std::max<std::size_t>(1, (data.size() + chunkBytes - 1) / chunkBytes);
+        threads = static_cast<unsigned>(std::min<std::size_t>(threads, chunkCount));
+        const std::size_t maxEntries = std::max<std::size_t>(1024, memoryBytes / threads / 2 / (sizeof(Entry) * 3 / 2));
+
+        TempFiles temp(options.spillDir.empty() ? std::filesystem::temp_directory_path() : options.spillDir);
+        std::vector<std::vector<std::filesystem::path>> chunkRuns(chunkCount);
+        std::atomic<std::size_t> nextChunk{ 0 };
+        std::atomic<std::uint64_t> records{ 0 };
+        std::atomic<std::uint64_t> tempBytes{ 0 };
+        std::atomic<bool> failed{ false };
+        std::exception_ptr error;
+        std::mutex errorMutex;
+
+        const auto work = [&] {
+            try {
+                std::vector<Entry> entries;
+                const auto flush = [&](std::vector<std::filesystem::path>& runs) {
+                    std::stable_sort(entries.begin(), entries.end(), [numeric](const Entry& a, const Entry& b) {
+                        return CompareKeys(std::string_view(a.text + a.keyOffset, a.keySize),
+                            std::string_view(b.text + b.keyOffset, b.keySize), numeric) < 0;
+                    });
+                    runs.push_back(temp.Create());
+                    RunWriter writer(runs.back());
+                    for (const Entry& entry : entries) writer.Add(std::string_view(entry.text, entry.size), entry.keyOffset, entry.keySize);
+                    writer.Close();
+                    tempBytes += writer.Bytes();
+                    records += entries.size();
+                    entries.clear();
+                };
+                for (std::size_t chunk; !failed && (chunk = nextChunk++) < chunkCount;) {
+                    const std::size_t begin = LineStart(data, chunk * chunkBytes);
+                    const std::size_t end = LineStart(data, (chunk + 1) * chunkBytes);
+                    RecordReader reader(data.substr(begin, end - begin));
+                    Record record;
+                    while (reader.Next(record)) {
+                        if (record.text.size() > std::numeric_limits<std::uint32_t>::max()) {
+                            throw std::runtime_error("Строка файла миграции длиннее 4 ГБ");
+                        }
+                        const std::string_view key = record.Field(options.column);
+                        const std::size_t keyOffset = key.empty() ? 0 : static_cast<std::size_t>(key.data() - record.text.data());
+                        entries.push_back(Entry{ record.text.data(), static_cast<std::uint32_t>(record.text.size()),
+                            static_cast<std::uint32_t>(keyOffset), static_cast<std::uint32_t>(key.size()) });
+                        if (entries.size() == maxEntries) flush(chunkRuns[chunk]);
+                    }
+                    if (!entries.empty()) flush(chunkRuns[chunk]);
+                }
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!error) error = std::current_exception();
+                failed = true;
+            }
+        };
+        std::vector<std::thread> workers;
+        for (unsigned i = 1; i < threads; ++i) workers.emplace_back(work);
+        work();
+        for (std::thread& worker : workers) worker.join();
+        if (error) std::rethrow_exception(error);
+
+        std::vector<std::filesystem::path> runs;
+        for (std::vector<std::filesystem::path>& chunk : chunkRuns) {
+            runs.insert(runs.end(), chunk.begin(), chunk.end());
+        }
+        stats.records = records;
+        stats.runs = runs.size();
+
+        // Серий больше, чем можно открыть (или чем помещается буферов) - соседние группы
+        // сливаются в новые серии; порядок групп сохраняется, устойчивость тоже
+        const std::size_t fanIn = std::max<std::size_t>(2, std::min(options.maxFanIn, memoryBytes / MIN_MERGE_BUFFER - 1));
+        while (runs.size() > fanIn) {
+            std::vector<std::filesystem::path> merged;
+            for (std::size_t first = 0; first < runs.size(); first += fanIn) {
+                const std::vector<std::filesystem::path> group(runs.begin() + first,
+                    runs.begin() + std::min(first + fanIn, runs.size()));
+                if (group.size() == 1) {
+                    merged.push_back(group.front());
+                    continue;
+                }
+                merged.push_back(temp.Create());
+                RunWriter writer(merged.back());
+                MergeRuns(group, memoryBytes, numeric, [&](std::string_view text, std::uint32_t keyOffset, std::uint32_t keySize) {
+                    writer.Add(text, keyOffset, keySize);
+                });
+                writer.Close();
+                stats.spillBytes += writer.Bytes();
+                for (const std::filesystem::path& path : group) temp.Remove(path);
+            }
+            runs = std::move(merged);
+            ++stats.mergePasses;
+        }
+
+        WriterOptions writerOptions;
+        writerOptions.truncate = true;
+        writerOptions.bom = stats.bom;
+        MigrationWriter out(outPath, writerOptions);
+        MergeRuns(runs, memoryBytes, numeric, [&](std::string_view text, std::uint32_t, std::uint32_t) {
+            out.Write(text);
+            out.Write("\r\n");
+        });
+        out.Close();
+        stats.spillBytes += tempBytes;
+        return stats;
+    }
+}
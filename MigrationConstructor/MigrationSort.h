@@ -0,0 +1,32 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+
+// Внешняя сортировка файла миграции по одной колонке. Файл режется на куски в пределах
+// лимита памяти, куски сортируются в нескольких потоках и пишутся во временные файлы (серии),
+// серии сливаются деревом проигравших. Сортировка устойчивая: записи с равными ключами
+// остаются в порядке исходного файла
+namespace mc {
+    struct SortOptions {
+        std::size_t column = 0;                             // поле 0 (id) - как CompareIds, остальные - побайтно
+        std::size_t memoryBytes = std::size_t(256) << 20;   // на все потоки: куски, индексы и буферы слияния
+        unsigned threads = 0;                               // 0 - по числу ядер
+        std::size_t maxFanIn = 256;                         // серий (открытых файлов) на одно слияние
+        std::filesystem::path spillDir;                     // пусто - временный каталог
+    };
+
+    struct SortStats {
+        std::uint64_t records = 0;
+        std::size_t runs = 0;
+        std::size_t mergePasses = 0;        // промежуточных слияний серий; 0 - серии сразу сливаются в результат
+        std::uint64_t spillBytes = 0;       // записано во временные файлы
+        bool bom = false;                   // исходный файл начинался с BOM, результат - тоже
+    };
+
+    // Результат пишется заново (строки через "\r\n"); outPath не должен совпадать с файлом data.
+    // Ошибки записи и строки длиннее 4 ГБ - std::runtime_error, временные файлы удаляются
+    SortStats SortMigration(std::string_view data, const std::filesystem::path& outPath, const SortOptions& options = {});
+}
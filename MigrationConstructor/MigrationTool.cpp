@@ -0,0 +1,746 @@
+﻿// mctool: консольные режимы MigrationConstructor для больших файлов миграции
+#include "CartesianProduct.h"
+#include "CommandArgs.h"
+#include "CsvReader.h"
+#include "Dictionary.h"
+#include "DictionaryLoader.h"
+#include "DuplicateDetector.h"
+#include "Encoding.h"
+#include "LoginAllocator.h"
+#include "MappedFile.h"
+#include "MigrationDiff.h"
+#include "MigrationParser.h"
+#include "MigrationRow.h"
+#include "MigrationSort.h"
+#include "MigrationValidator.h"
+#include "MigrationWriter.h"
+#include "RowGenerator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+    // Файл миграции в UTF-8: отображается как есть. Выгрузка в UTF-16 или CP1251 перекодируется
+    // блоками, как в CsvReader, во временный файл в tempDir (пусто - временный каталог), и
+    // отображается он: память не зависит от размера файла. Временный файл удаляется вместе с объектом
+    class MigrationText {
+    public:
+        explicit MigrationText(const std::string& path, const std::filesystem::path& tempDir = {}) : file_(path) {
+            const std::string_view bytes = file_.View();
+            const mc::DetectedEncoding detected = mc::DetectEncoding(bytes.substr(0, 1 << 16), bytes.size() <= (1 << 16));
+            encoding_ = detected.encoding;
+            if (encoding_ == mc::TextEncoding::Utf8) return;
+
+            std::random_device random;
+            temp_ = (tempDir.empty() ? std::filesystem::temp_directory_path() : tempDir) /
+                ("mctool_" + std::to_string(random()) + ".utf8.tmp");
+            try {
+                Convert(bytes.substr(detected.bomBytes));
+                converted_ = mc::MappedFile(temp_);
+            }
+            catch (...) {
+                std::error_code ignored;
+                std::filesystem::remove(temp_, ignored);
+                throw;
+            }
+            std::fprintf(stderr, "Файл в %s перекодирован в UTF-8\n", mc::EncodingName(encoding_));
+        }
+
+        ~MigrationText() {
+            if (temp_.empty()) return;
+            converted_ = mc::MappedFile();      // Windows не удаляет отображенный файл
+            std::error_code ignored;
+            std::filesystem::remove(temp_, ignored);
+        }
+
+        MigrationText(const MigrationText&) = delete;
+        MigrationText& operator=(const MigrationText&) = delete;
+
+        std::string_view View() const {
+            return encoding_ == mc::TextEncoding::Utf8 ? file_.View() : converted_.View();
+        }
+
+        mc::TextEncoding Encoding() const { return encoding_; }
+
+    private:
+        void Convert(std::string_view bytes) {
+            std::ofstream out(temp_, std::ios::binary | std::ios::trunc);
+            if (!out.is_open()) throw std::runtime_error("Ошибка создания временного файла: " + temp_.u8string());
+            constexpr std::size_t BLOCK = std::size_t(1) << 20;
+            std::string utf8;
+            while (!bytes.empty()) {
+                std::size_t take = std::min(bytes.size(), BLOCK);
+                if (take < bytes.size()) take = mc::CompleteTextLength(bytes.substr(0, take), encoding_);
+                utf8.clear();
+                mc::AppendTextAsUtf8(bytes.substr(0, take), encoding_, utf8);
+                out.write(utf8.data(), static_cast<std::streamsize>(utf8.size()));
+                bytes.remove_prefix(take);
+            }
+            if (!out.flush()) throw std::runtime_error("Ошибка записи во временный файл: " + temp_.u8string());
+        }
+
+        mc::MappedFile file_;
+        mc::TextEncoding encoding_;
+        std::filesystem::path temp_;
+        mc::MappedFile converted_;
+    };
+
+    // --memory-mb в байтах. 0 и отрицательные не принимаются: с нулевым лимитом выгрузка
+    // на диск делила бы каждый раздел до предела
+    size_t ParseMemoryMb(mc::Args& args, std::string_view option) {
+        const long long megabytes = mc::ParseInt(args.Value(option), option);
+        if (megabytes < 1) throw std::runtime_error("Лимит памяти должен быть не меньше 1 МБ: " + std::to_string(megabytes));
+        return static_cast<size_t>(megabytes) << 20;
+    }
+
+    void PrintUsage() {
+        std::fprintf(stderr,
+            "Использование: mctool <режим> [параметры]\n"
+            "\n"
+            "generate  - пакетная генерация записей (как \"Добавить запись\")\n"
+            "  --out FILE            файл результата (по умолчанию stdout)\n"
+            "  --count N             количество записей (по умолчанию по записи на каждое сочетание)\n"
+            "  --start-id N          первый ID (по умолчанию 1)\n"
+            "  --login BASE          основа логина, суффикс _NN отбрасывается (по умолчанию user)\n"
+            "  --login-counter N     первый суффикс логина (по умолчанию 1)\n"
+            "  --existing FILE       занятые логины (по одному в строке): их суффиксы пропускаются\n"
+            "  --set COLUMN=VALUE    значение колонки, COLUMN - имя файла словаря без .txt.\n"
+            "                        Несколько --set одной колонки - перебор всех сочетаний\n"
+            "  --all COLUMN          все строки словаря COLUMN.txt в перебор\n"
+            "  --dict-dir DIR        каталог словарей для --all (по умолчанию текущий)\n"
+            "  --extra VALUE         доп. поле (до %d)\n"
+            "  --threads N           число потоков (по умолчанию по числу ядер)\n"
+            "  --eol lf|crlf         разделитель строк (по умолчанию crlf)\n"
+            "\n"
+            "join INPUT - записи по выгрузке людей (CSV/TSV, \"-\" - stdin): по записи на человека\n"
+            "  --out FILE            файл результата\n"
+            "  --map COLUMN=FIELD    колонка из поля выгрузки: имя из заголовка или номер с 1\n"
+            "  --set COLUMN=VALUE    значение колонки для всех записей\n"
+            "  --extra VALUE         доп. поле (до %d)\n"
+            "  --start-id N, --login BASE, --login-counter N, --eol lf|crlf - как в generate\n"
+            "  --delimiter C         разделитель выгрузки: , ; tab (по умолчанию по первой строке)\n"
+            "  --no-header           первая строка - уже запись, а не заголовок\n"
+            "\n"
+            "build-dict FILE...  - собрать или обновить кэш <FILE>.mcdict для словарей\n"
+            "\n"
+            "validate FILE - проверка файла миграции по словарям (код возврата 1 при ошибках)\n"
+            "  --dict-dir DIR        каталог словарей <колонка>.txt (по умолчанию текущий)\n"
+            "  --threads N           потоков (по умолчанию по числу ядер)\n"
+            "  --max-errors N        сколько ошибок выводить (по умолчанию 100)\n"
+            "  --no-empty            пустое значение колонки - ошибка\n"
+            "\n"
+            "duplicates FILE - повторяющиеся id и логины со всеми номерами строк (код возврата 1, если есть)\n"
+            "  --memory-mb N         лимит памяти таблицы ключей (по умолчанию 256)\n"
+            "  --spill-dir DIR       каталог для разделов сверх лимита (по умолчанию временный)\n"
+            "  --max N               сколько повторов выводить по каждой колонке (по умолчанию 100)\n"
+            "\n"
+            "diff OLD NEW - добавленные (+), удаленные (-) и измененные (~) записи по id с измененными полями\n"
+            "  (код возврата 1, если файлы различаются)\n"
+            "  --method auto|hash|merge  hash - id меньшего файла в памяти, merge - слияние файлов,\n"
+            "                        упорядоченных по id (по умолчанию auto: hash, если хватает памяти)\n"
+            "  --memory-mb N         лимит памяти таблицы id (по умолчанию 256)\n"
+            "  --max N               сколько записей выводить (по умолчанию 100)\n"
+            "\n"
+            "sort FILE --out OUT - внешняя сортировка по колонке, устойчивая (равные ключи - в порядке файла)\n"
+            "  --by COLUMN           имя колонки (id, login, role, ...) или номер поля с 1; id - как числа,\n"
+            "                        остальные - побайтно (по умолчанию id)\n"
+            "  --memory-mb N         лимит памяти на все потоки (по умолчанию 256)\n"
+            "  --threads N           потоков сортировки серий (по умолчанию по числу ядер)\n"
+            "  --spill-dir DIR       каталог для серий и перекодированного файла (по умолчанию временный).\n"
+            "                        Файл в UTF-16 или CP1251 сортируется через UTF-8, результат - в UTF-8\n"
+            "\n"
+            "renumber FILE --out OUT - новые id и суффиксы логинов подряд, как при добавлении записей\n"
+            "  --start-id N          первый ID (по умолчанию 1)\n"
+            "  --login-counter N     первый суффикс логина (по умолчанию 1)\n"
+            "  --threads N           число потоков (по умолчанию по числу ядер)\n"
+            "  --eol lf|crlf         разделитель строк (по умолчанию crlf)\n"
+            "\n"
+            "logins - свободные логины основы: занятые суффиксы пропускаются, суффикс любой длины\n"
+            "  --existing FILE       занятые логины, по одному в строке\n"
+            "  --login BASE          основа логина (по умолчанию user)\n"
+            "  --login-counter N     первый суффикс (по умолчанию 1)\n"
+            "  --count N             сколько логинов выдать (по умолчанию 1)\n"
+            "\n"
+            "Колонки:",
+            mc::MAX_EXTRA_FIELDS, mc::MAX_EXTRA_FIELDS);
+        for (size_t i = 0; i < mc::COLUMN_COUNT; ++i) {
+            std::fprintf(stderr, " %s", mc::DictionaryColumnName(i));
+        }
+        std::fprintf(stderr, "\n");
+    }
+
+    int RunGenerate(mc::Args& args) {
+        mc::RowTemplate tmpl;
+        mc::GenerateOptions options;
+        std::vector<std::vector<std::string>> columns(mc::COLUMN_COUNT);
+        std::vector<std::string> extras;
+        std::string outPath;
+        std::filesystem::path dictDir = ".";
+        std::vector<int> allColumns;
+        std::string existingPath;
+
+        std::string_view option;
+        while (args.Next(option)) {
+            if (option == "--out") outPath = args.Value(option);
+            else if (option == "--count") options.rowCount = mc::ParseInt(args.Value(option), option);
+            else if (option == "--start-id") tmpl.startId = mc::ParseInt(args.Value(option), option);
+            else if (option == "--login") tmpl.loginBase = mc::StripLoginSuffix(args.Value(option));
+            else if (option == "--login-counter") tmpl.loginCounter = mc::ParseInt(args.Value(option), option);
+            else if (option == "--existing") existingPath = args.Value(option);
+            else if (option == "--threads") options.threads = static_cast<unsigned>(mc::ParseInt(args.Value(option), option));
+            else if (option == "--extra") {
+                if (static_cast<int>(extras.size()) >= mc::MAX_EXTRA_FIELDS) {
+                    throw std::runtime_error("Слишком много доп. полей");
+                }
+                extras.emplace_back(args.Value(option));
+            }
+            else if (option == "--set") {
+                const std::string_view assignment = args.Value(option);
+                const size_t eq = assignment.find('=');
+                const int column = eq == std::string_view::npos ? -1 : mc::ColumnIndex(assignment.substr(0, eq));
+                if (column < 0) {
+                    throw std::runtime_error("Неизвестная колонка: " + std::string(assignment));
+                }
+                columns[column].emplace_back(assignment.substr(eq + 1));
+            }
+            else if (option == "--all") {
+                const std::string_view name = args.Value(option);
+                const int column = mc::ColumnIndex(name);
+                if (column < 0) throw std::runtime_error("Неизвестная колонка: " + std::string(name));
+                allColumns.push_back(column);
+            }
+            else if (option == "--dict-dir") dictDir = std::string(args.Value(option));
+            else if (option == "--eol") {
+                const std::string_view eol = args.Value(option);
+                if (eol == "lf") options.lineEnd = "\n";
+                else if (eol == "crlf") options.lineEnd = "\r\n";
+                else throw std::runtime_error("Неизвестный разделитель строк: " + std::string(eol));
+            }
+            else {
+                throw std::runtime_error("Неизвестный параметр: " + std::string(option));
+            }
+        }
+
+        tmpl.startId = mc::FirstRowId(tmpl.startId);
+        // --all: все строки словаря колонки, как если бы каждая была задана через --set
+        for (const int column : allColumns) {
+            const std::filesystem::path file = dictDir / (std::string(mc::DictionaryColumnName(column)) + ".txt");
+            mc::Dictionary dictionary;
+            if (!dictionary.Load(file)) throw std::runtime_error("Ошибка открытия файла: " + file.string());
+            for (std::size_t i = 0; i < dictionary.Size(); ++i) columns[column].push_back(mc::WideToUtf8(dictionary[i]));
+        }
+        tmpl.fields = std::move(columns);
+        for (const std::string& extra : extras) tmpl.fields.push_back({ extra });
+        if (options.rowCount == 0) options.rowCount = mc::CartesianProduct(tmpl.fields).Size();
+        // --existing: суффиксы занятых логинов пропускаются, аллокатор выдает их по ходу генерации.
+        // Счетчик только растет, поэтому выданные логины не запоминаются
+        mc::LoginSet taken;
+        mc::LoginAllocator allocator(taken, false);
+        size_t existing = 0;
+        if (!existingPath.empty()) {
+            taken.Assign(MigrationText(existingPath).View());
+            existing = taken.Size();
+            tmpl.loginAllocator = &allocator;
+        }
+
+        std::FILE* out = stdout;
+        if (!outPath.empty()) {
+            out = std::fopen(outPath.c_str(), "wb");
+            if (!out) throw std::runtime_error("Ошибка открытия файла: " + outPath);
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        std::uint64_t bytes = 0;
+        try {
+            bytes = mc::GenerateRows(out, tmpl, options);
+        }
+        catch (...) {
+            if (out != stdout) std::fclose(out);
+            throw;
+        }
+        if (out != stdout && std::fclose(out) != 0) {
+            throw std::runtime_error("Ошибка записи в файл: " + outPath);
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (tmpl.loginAllocator) {
+            std::fprintf(stderr, "Занятых логинов: %zu, пропущено суффиксов: %llu\n", existing,
+                static_cast<unsigned long long>(allocator.Skipped()));
+        }
+        std::fprintf(stderr, "Записей: %llu, байт: %llu, %.2f с, %.1f МБ/с\n",
+            static_cast<unsigned long long>(options.rowCount), static_cast<unsigned long long>(bytes),
+            seconds, seconds > 0 ? bytes / seconds / (1 << 20) : 0.0);
+        return 0;
+    }
+
+    int RunBuildDict(mc::Args& args) {
+        std::string_view file;
+        int failed = 0;
+        while (args.Next(file)) {
+            const std::filesystem::path path(file);
+            const auto start = std::chrono::steady_clock::now();
+            mc::LoadedDictionary dictionary;
+            dictionary.Load(path);
+            if (!dictionary.fromCache && !dictionary.opened) {
+                std::fprintf(stderr, "%s: файл не открылся\n", std::string(file).c_str());
+                ++failed;
+                continue;
+            }
+            mc::LoadedDictionary check;
+            if (!dictionary.fromCache && (check.Load(path), !check.fromCache)) {
+                std::fprintf(stderr, "%s: не удалось записать кэш\n", std::string(file).c_str());
+                ++failed;
+                continue;
+            }
+            std::printf("%s: %zu строк, %s, %.1f мс\n", std::string(file).c_str(), dictionary.items.Size(),
+                dictionary.fromCache ? "кэш актуален" : "кэш собран", mc::ElapsedMicros(start) / 1000);
+        }
+        return failed ? 1 : 0;
+    }
+
+    void PrintValidationError(const mc::ValidationError& error) {
+        const unsigned long long line = error.line;
+        const char* column = mc::ROW_COLUMNS[std::min(error.column, mc::ROW_COLUMN_COUNT - 1)].name;
+        switch (error.kind) {
+        case mc::ValidationErrorKind::FieldCount:
+            std::printf("строка %llu: полей %zu, ожидается от %zu до %zu\n", line, error.column,
+                mc::ROW_COLUMN_COUNT, mc::MAX_ROW_FIELDS);
+            break;
+        case mc::ValidationErrorKind::BadId:
+            std::printf("строка %llu: id: не положительное число \"%s\"\n", line, error.value.c_str());
+            break;
+        case mc::ValidationErrorKind::EmptyLogin:
+            std::printf("строка %llu: login: пустой логин\n", line);
+            break;
+        case mc::ValidationErrorKind::EmptyValue:
+            std::printf("строка %llu: %s: пустое значение\n", line, column);
+            break;
+        case mc::ValidationErrorKind::UnknownValue:
+            std::printf("строка %llu: %s: нет в словаре \"%s\"\n", line, column, error.value.c_str());
+            break;
+        }
+    }
+
+    int RunValidate(mc::Args& args) {
+        std::string path;
+        std::filesystem::path dictDir = ".";
+        mc::ValidationOptions options;
+        options.maxErrors = 100;
+
+        std::string_view option;
+        while (args.Next(option)) {
+            if (option == "--dict-dir") dictDir = std::string(args.Value(option));
+            else if (option == "--threads") options.threads = static_cast<unsigned>(mc::ParseInt(args.Value(option), option));
+            else if (option == "--max-errors") options.maxErrors = static_cast<size_t>(mc::ParseInt(args.Value(option), option));
+            else if (option == "--no-empty") options.allowEmpty = false;
+            else if (path.empty() && option.substr(0, 2) != "--") path = option;
+            else throw std::runtime_error("Неизвестный параметр: " + std::string(option));
+        }
+        if (path.empty()) throw std::runtime_error("Не указан файл");
+
+        mc::MigrationValidator validator;
+        for (const std::string& file : validator.LoadDictionaries(dictDir)) {
+            std::fprintf(stderr, "Нет словаря %s, колонка не проверяется\n", (dictDir / file).string().c_str());
+        }
+
+        const MigrationText file(path);
+        const auto start = std::chrono::steady_clock::now();
+        const mc::ValidationResult result = validator.Validate(file.View(), options);
+        const double seconds = mc::ElapsedMicros(start) / 1e6;
+
+        for (const mc::ValidationError& error : result.errors) PrintValidationError(error);
+        if (result.errorCount > result.errors.size()) {
+            std::printf("... и еще %llu\n", static_cast<unsigned long long>(result.errorCount - result.errors.size()));
+        }
+        std::fprintf(stderr, "Записей: %llu, ошибок: %llu, %.2f с\n", static_cast<unsigned long long>(result.records),
+            static_cast<unsigned long long>(result.errorCount), seconds);
+        return result.errorCount == 0 ? 0 : 1;
+    }
+
+    void PrintDuplicates(const char* column, const std::vector<mc::DuplicateGroup>& groups, size_t max) {
+        for (size_t i = 0; i < groups.size() && i < max; ++i) {
+            std::printf("%s \"%s\": строки", column, groups[i].key.c_str());
+            for (size_t j = 0; j < groups[i].lines.size(); ++j) {
+                std::printf("%s %llu", j ? "," : "", static_cast<unsigned long long>(groups[i].lines[j]));
+            }
+            std::printf("\n");
+        }
+        if (groups.size() > max) std::printf("%s: ... и еще %zu\n", column, groups.size() - max);
+    }
+
+    int RunDuplicates(mc::Args& args) {
+        std::string path;
+        mc::DuplicateOptions options;
+        size_t max = 100;
+
+        std::string_view option;
+        while (args.Next(option)) {
+            if (option == "--memory-mb") options.memoryBytes = ParseMemoryMb(args, option);
+            else if (option == "--spill-dir") options.spillDir = std::string(args.Value(option));
+            else if (option == "--max") max = static_cast<size_t>(mc::ParseInt(args.Value(option), option));
+            else if (path.empty() && option.substr(0, 2) != "--") path = option;
+            else throw std::runtime_error("Неизвестный параметр: " + std::string(option));
+        }
+        if (path.empty()) throw std::runtime_error("Не указан файл");
+
+        const MigrationText file(path);
+        const auto start = std::chrono::steady_clock::now();
+        const mc::DuplicateReport report = mc::FindDuplicates(file.View(), options);
+        const double seconds = mc::ElapsedMicros(start) / 1e6;
+
+        PrintDuplicates("id", report.ids, max);
+        PrintDuplicates("login", report.logins, max);
+        std::fprintf(stderr, "Записей: %llu, повторов id: %zu, логинов: %zu, %.2f с%s\n",
+            static_cast<unsigned long long>(report.records), report.ids.size(), report.logins.size(), seconds,
+            report.spilled ? ", с выгрузкой на диск" : "");
+        return report.ids.empty() && report.logins.empty() ? 0 : 1;
+    }
+
+    const char* DiffFieldName(size_t field, std::string& buffer) {
+        if (field < mc::ROW_COLUMN_COUNT) return mc::ROW_COLUMNS[field].name;
+        buffer = "extra" + std::to_string(field - mc::ROW_COLUMN_COUNT + 1);
+        return buffer.c_str();
+    }
+
+    // Одна строка на запись: "+" добавлена, "-" удалена, "~" изменена (поля: было -> стало)
+    void PrintDiffEntry(const mc::DiffEntry& entry) {
+        const auto id = static_cast<int>(entry.id.size());
+        if (entry.kind == mc::DiffKind::Added) {
+            std::printf("+ %.*s, строка %llu: %.*s\n", id, entry.id.data(), static_cast<unsigned long long>(entry.newLine),
+                static_cast<int>(entry.newText.size()), entry.newText.data());
+            return;
+        }
+        if (entry.kind == mc::DiffKind::Removed) {
+            std::printf("- %.*s, строка %llu: %.*s\n", id, entry.id.data(), static_cast<unsigned long long>(entry.oldLine),
+                static_cast<int>(entry.oldText.size()), entry.oldText.data());
+            return;
+        }
+        std::string line = "~ " + std::string(entry.id) + ", строки " + std::to_string(entry.oldLine) + "/" + std::to_string(entry.newLine) + ":";
+        std::string name;
+        const char* separator = " ";
+        for (size_t field = 0; field < mc::MAX_RECORD_FIELDS; ++field) {
+            if (!(entry.changedFields >> field & 1)) continue;
+            line += separator;
+            separator = ", ";
+            line += DiffFieldName(field, name);
+            line += " \"" + std::string(mc::RecordField(entry.oldText, field)) + "\" -> \"" +
+                std::string(mc::RecordField(entry.newText, field)) + "\"";
+        }
+        std::printf("%s\n", line.c_str());
+    }
+
+    int RunDiff(mc::Args& args) {
+        std::string oldPath, newPath;
+        mc::DiffOptions options;
+        size_t max = 100;
+
+        std::string_view option;
+        while (args.Next(option)) {
+            if (option == "--memory-mb") options.memoryBytes = ParseMemoryMb(args, option);
+            else if (option == "--max") max = static_cast<size_t>(mc::ParseInt(args.Value(option), option));
+            else if (option == "--method") {
+                const std::string_view method = args.Value(option);
+                if (method == "auto") options.method = mc::DiffMethod::Auto;
+                else if (method == "hash") options.method = mc::DiffMethod::Hash;
+                else if (method == "merge") options.method = mc::DiffMethod::Merge;
+                else throw std::runtime_error("Неизвестный способ сравнения: " + std::string(method));
+            }
+            else if (oldPath.empty() && option.substr(0, 2) != "--") oldPath = option;
+            else if (newPath.empty() && option.substr(0, 2) != "--") newPath = option;
+            else throw std::runtime_error("Неизвестный параметр: " + std::string(option));
+        }
+        if (newPath.empty()) throw std::runtime_error("Нужны два файла: прежний и новый");
+
+        const MigrationText oldFile(oldPath);
+        const MigrationText newFile(newPath);
+        size_t printed = 0;
+        const auto start = std::chrono::steady_clock::now();
+        const mc::DiffStats stats = mc::DiffMigrations(oldFile.View(), newFile.View(), [&](const mc::DiffEntry& entry) {
+            if (printed++ < max) PrintDiffEntry(entry);
+        }, options);
+        const double seconds = mc::ElapsedMicros(start) / 1e6;
+
+        const std::uint64_t differences = stats.added + stats.removed + stats.changed;
+        if (differences > max) std::printf("... и еще %llu\n", static_cast<unsigned long long>(differences - max));
+        std::string name;
+        for (size_t field = 0; field < stats.fieldChanges.size(); ++field) {
+            if (stats.fieldChanges[field] == 0) continue;
+            std::fprintf(stderr, "  %-26s изменено в %llu\n", DiffFieldName(field, name), static_cast<unsigned long long>(stats.fieldChanges[field]));
+        }
+        std::fprintf(stderr, "Было: %llu, стало: %llu, добавлено: %llu, удалено: %llu, изменено: %llu, без изменений: %llu (%s, %.2f с)\n",
+            static_cast<unsigned long long>(stats.oldRecords), static_cast<unsigned long long>(stats.newRecords),
+            static_cast<unsigned long long>(stats.added), static_cast<unsigned long long>(stats.removed),
+            static_cast<unsigned long long>(stats.changed), static_cast<unsigned long long>(stats.unchanged),
+            mc::DiffMethodName(stats.method), seconds);
+        return differences == 0 ? 0 : 1;
+    }
+
+    // Колонка сортировки: имя из ROW_COLUMNS или номер поля с 1
+    size_t SortColumn(std::string_view spec) {
+        for (size_t i = 0; i < mc::ROW_COLUMN_COUNT; ++i) {
+            if (spec == mc::ROW_COLUMNS[i].name) return i;
+        }
+        if (spec.empty() || !std::all_of(spec.begin(), spec.end(), [](char ch) { return ch >= '0' && ch <= '9'; })) {
+            throw std::runtime_error("Неизвестная колонка: " + std::string(spec));
+        }
+        const long long number = mc::ParseInt(spec, "--by");
+        if (number < 1 || number > static_cast<long long>(mc::MAX_RECORD_FIELDS)) {
+            throw std::runtime_error("Номер поля - от 1 до " + std::to_string(mc::MAX_RECORD_FIELDS) + ": " + std::string(spec));
+        }
+        return static_cast<size_t>(number - 1);
+    }
+
+    int RunSort(mc::Args& args) {
+        std::string path;
+        std::filesystem::path outPath;
+        mc::SortOptions options;
+
+        std::string_view option;
+        while (args.Next(option)) {
+            if (option == "--out") outPath = std::string(args.Value(option));
+            else if (option == "--by") options.column = SortColumn(args.Value(option));
+            else if (option == "--memory-mb") options.memoryBytes = ParseMemoryMb(args, option);
+            else if (option == "--threads") options.threads = static_cast<unsigned>(mc::ParseInt(args.Value(option), option));
+            else if (option == "--spill-dir") options.spillDir = std::string(args.Value(option));
+            else if (path.empty() && option.substr(0, 2) != "--") path = option;
+            else throw std::runtime_error("Неизвестный параметр: " + std::string(option));
+        }
+        if (path.empty()) throw std::runtime_error("Не указан файл");
+        if (outPath.empty()) throw std::runtime_error("Не указан файл результата (--out)");
+        std::error_code ignored;
+        if (std::filesystem::equivalent(path, outPath, ignored)) throw std::runtime_error("Результат нельзя записать в исходный файл");
+
+        const MigrationText file(path, options.spillDir);
+        const auto start = std::chrono::steady_clock::now();
+        const mc::SortStats stats = mc::SortMigration(file.View(), outPath, options);
+        const double seconds = mc::ElapsedMicros(start) / 1e6;
+        if (file.Encoding() != mc::TextEncoding::Utf8) {
+            std::fprintf(stderr, "Результат записан в UTF-8 (исходный файл в %s)\n", mc::EncodingName(file.Encoding()));
+        }
+        std::fprintf(stderr, "Записей: %llu, серий: %zu, промежуточных слияний: %zu, на диск %.1f МБ, %.2f с\n",
+            static_cast<unsigned long long>(stats.records), stats.runs, stats.mergePasses, stats.spillBytes / 1048576.0, seconds);
+        return 0;
+    }
+
+    int RunRenumber(mc::Args& args) {
+        std::string path;
+        std::filesystem::path outPath;
+        mc::RenumberOptions options;
+
+        std::string_view option;
+        while (args.Next(option)) {
+            if (option == "--out") outPath = std::string(args.Value(option));
+            else if (option == "--start-id") options.startId = mc::ParseInt(args.Value(option), option);
+            else if (option == "--login-counter") options.loginCounter = mc::ParseInt(args.Value(option), option);
+            else if (option == "--threads") options.threads = static_cast<unsigned>(mc::ParseInt(args.Value(option), option));
+            else if (option == "--eol") {
+                const std::string_view eol = args.Value(option);
+                if (eol == "lf") options.lineEnd = "\n";
+                else if (eol == "crlf") options.lineEnd = "\r\n";
+                else throw std::runtime_error("Неизвестный разделитель строк: " + std::string(eol));
+            }
+            else if (path.empty() && option.substr(0, 2) != "--") path = option;
+            else throw std::runtime_error("Неизвестный параметр: " + std::string(option));
+        }
+        if (path.empty()) throw std::runtime_error("Не указан файл");
+        if (outPath.empty()) throw std::runtime_error("Не указан файл результата (--out)");
+        std::error_code ignored;
+        if (std::filesystem::equivalent(path, outPath, ignored)) throw std::runtime_error("Результат нельзя записать в исходный файл");
+
+        options.startId = mc::FirstRowId(options.startId);
+        const MigrationText file(path);
+        const auto start = std::chrono::steady_clock::now();
+        const mc::RenumberStats stats = mc::RenumberMigration(file.View(), outPath, options);
+        std::fprintf(stderr, "Записей: %llu, id %lld-%lld, %.2f с\n", static_cast<unsigned long long>(stats.records),
+            options.startId, options.startId + static_cast<long long>(stats.records) - 1, mc::ElapsedMicros(start) / 1e6);
+        return 0;
+    }
+
+    int RunLogins(mc::Args& args) {
+        std::string existingPath;
+        std::string base = "user";
+        long long counter = 1;
+        std::uint64_t count = 1;
+
+        std::string_view option;
+        while (args.Next(option)) {
+            if (option == "--existing") existingPath = args.Value(option);
+            else if (option == "--login") base = mc::StripLoginSuffix(args.Value(option));
+            else if (option == "--login-counter") counter = mc::ParseInt(args.Value(option), option);
+            else if (option == "--count") count = static_cast<std::uint64_t>(mc::ParseInt(args.Value(option), option));
+            else throw std::runtime_error("Неизвестный параметр: " + std::string(option));
+        }
+
+        mc::LoginSet taken;
+        if (!existingPath.empty()) taken.Assign(MigrationText(existingPath).View());
+        const size_t existing = taken.Size();
+        mc::LoginAllocator allocator(taken);
+        for (std::uint64_t i = 0; i < count; ++i) {
+            const std::string_view login = allocator.Next(base, counter);
+            std::printf("%.*s\n", static_cast<int>(login.size()), login.data());
+        }
+        std::fprintf(stderr, "Занятых логинов: %zu, пропущено: %llu, следующий суффикс: %lld\n", existing,
+            static_cast<unsigned long long>(allocator.Skipped()), counter);
+        return 0;
+    }
+
+    // Поле выгрузки: номер с 1 или имя из заголовка
+    int ResolveField(std::string_view spec, const std::vector<std::string>& header) {
+        if (!spec.empty() && std::all_of(spec.begin(), spec.end(), [](char ch) { return ch >= '0' && ch <= '9'; })) {
+            const long long number = mc::ParseInt(spec, "--map");
+            if (number < 1) throw std::runtime_error("Номер поля начинается с 1: " + std::string(spec));
+            return static_cast<int>(number - 1);
+        }
+        const auto it = std::find(header.begin(), header.end(), spec);
+        if (it == header.end()) throw std::runtime_error("Нет поля в заголовке выгрузки: " + std::string(spec));
+        return static_cast<int>(it - header.begin());
+    }
+
+    int RunJoin(mc::Args& args) {
+        mc::RowTemplate tmpl;
+        std::vector<std::vector<std::string>> columns(mc::COLUMN_COUNT);
+        std::vector<std::string> extras;
+        std::vector<std::pair<int, std::string>> maps;
+        std::string inPath;
+        std::string outPath;
+        std::string lineEnd = "\r\n";
+        char delimiter = 0;
+        bool header = true;
+
+        std::string_view option;
+        while (args.Next(option)) {
+            if (option == "--out") outPath = args.Value(option);
+            else if (option == "--start-id") tmpl.startId = mc::ParseInt(args.Value(option), option);
+            else if (option == "--login") tmpl.loginBase = mc::StripLoginSuffix(args.Value(option));
+            else if (option == "--login-counter") tmpl.loginCounter = mc::ParseInt(args.Value(option), option);
+            else if (option == "--no-header") header = false;
+            else if (option == "--extra") {
+                if (static_cast<int>(extras.size()) >= mc::MAX_EXTRA_FIELDS) {
+                    throw std::runtime_error("Слишком много доп. полей");
+                }
+                extras.emplace_back(args.Value(option));
+            }
+            else if (option == "--set" || option == "--map") {
+                const std::string_view assignment = args.Value(option);
+                const size_t eq = assignment.find('=');
+                const int column = eq == std::string_view::npos ? -1 : mc::ColumnIndex(assignment.substr(0, eq));
+                if (column < 0) {
+                    throw std::runtime_error("Неизвестная колонка: " + std::string(assignment));
+                }
+                if (option == "--set") columns[column] = { std::string(assignment.substr(eq + 1)) };
+                else maps.emplace_back(column, std::string(assignment.substr(eq + 1)));
+            }
+            else if (option == "--delimiter") {
+                const std::string_view value = args.Value(option);
+                if (value == "tab" || value == "\\t") delimiter = '\t';
+                else if (value.size() == 1) delimiter = value[0];
+                else throw std::runtime_error("Неизвестный разделитель: " + std::string(value));
+            }
+            else if (option == "--eol") {
+                const std::string_view eol = args.Value(option);
+                if (eol == "lf") lineEnd = "\n";
+                else if (eol == "crlf") lineEnd = "\r\n";
+                else throw std::runtime_error("Неизвестный разделитель строк: " + std::string(eol));
+            }
+            else if (inPath.empty() && option.substr(0, 2) != "--") inPath = option;
+            else throw std::runtime_error("Неизвестный параметр: " + std::string(option));
+        }
+        if (inPath.empty()) throw std::runtime_error("Не указана выгрузка");
+        if (outPath.empty()) throw std::runtime_error("Не указан файл результата (--out)");
+        if (maps.empty()) throw std::runtime_error("Не задано ни одного --map");
+
+        tmpl.startId = mc::FirstRowId(tmpl.startId);
+        tmpl.fields = std::move(columns);
+        for (const std::string& extra : extras) tmpl.fields.push_back({ extra });
+
+        std::FILE* in = inPath == "-" ? stdin : std::fopen(inPath.c_str(), "rb");
+        if (!in) throw std::runtime_error("Ошибка открытия файла: " + inPath);
+        std::uint64_t count = 0;
+        std::uint64_t bytes = 0;
+        const auto start = std::chrono::steady_clock::now();
+        mc::TextEncoding encoding = mc::TextEncoding::Utf8;
+        // Писатель тоже внутри try: ошибка открытия файла результата не оставляет выгрузку открытой
+        try {
+            mc::WriterOptions options;
+            options.truncate = true;
+            mc::MigrationWriter writer(outPath, options);
+            mc::CsvReader reader(in, delimiter);
+            encoding = reader.Encoding();
+            std::vector<std::string> names;
+            std::vector<std::string_view> fields;
+            if (header && reader.Next(fields)) names.assign(fields.begin(), fields.end());
+
+            std::vector<int> sources(tmpl.fields.size(), -1);
+            for (const auto& [column, spec] : maps) sources[column] = ResolveField(spec, names);
+            count = mc::JoinRows(reader, tmpl, sources, writer, lineEnd);
+            writer.Close();
+            bytes = writer.BytesWritten();
+        }
+        catch (...) {
+            if (in != stdin) std::fclose(in);
+            throw;
+        }
+        if (in != stdin) std::fclose(in);
+        const double seconds = mc::ElapsedMicros(start) / 1e6;
+
+        if (encoding != mc::TextEncoding::Utf8) std::fprintf(stderr, "Выгрузка в %s перекодирована в UTF-8\n", mc::EncodingName(encoding));
+        std::fprintf(stderr, "Записей: %llu, байт: %llu, %.2f с, %.1f МБ/с\n",
+            static_cast<unsigned long long>(count), static_cast<unsigned long long>(bytes),
+            seconds, seconds > 0 ? bytes / seconds / (1 << 20) : 0.0);
+        return 0;
+    }
+
+    struct Command {
+        const char* name;
+        int (*run)(mc::Args&);
+    };
+
+    constexpr Command commands[] = {
+        { "generate", RunGenerate },
+        { "join", RunJoin },
+        { "build-dict", RunBuildDict },
+        { "validate", RunValidate },
+        { "duplicates", RunDuplicates },
+        { "diff", RunDiff },
+        { "sort", RunSort },
+        { "renumber", RunRenumber },
+        { "logins", RunLogins },
+    };
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        PrintUsage();
+        return 2;
+    }
+
+    mc::Args args;
+    for (int i = 2; i < argc; ++i) {
+        args.items.emplace_back(argv[i]);
+    }
+
+    for (const Command& command : commands) {
+        if (std::strcmp(argv[1], command.name) == 0) {
+            try {
+                return command.run(args);
+            }
+            catch (const std::exception& e) {
+                std::fprintf(stderr, "Ошибка: %s\n", e.what());
+                return 1;
+            }
+        }
+    }
+
+    PrintUsage();
+    return 2;
+}
@@ -0,0 +1,126 @@
+﻿#include "MigrationValidator.h"
+#include "Dictionary.h"
+#include "Encoding.h"
+#include "MigrationParser.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+namespace mc {
+    namespace {
+        struct ChunkResult {
+            std::uint64_t lines = 0;
+            std::uint64_t records = 0;
+            std::uint64_t errorCount = 0;
+            std::vector<ValidationError> errors;   // номера строк внутри куска
+        };
+
+        bool IsPositiveId(std::string_view text) {
+            if (text.empty() || text.size() > 18) return false;
+            bool nonZero = false;
+            for (const char ch : text) {
+                if (ch < '0' || ch > '9') return false;
+                nonZero |= ch != '0';
+            }
+            return nonZero;
+        }
+
+        // Куски по chunkBytes, каждый заканчивается переводом строки (кроме последнего)
+        std::vector<std::string_view> SplitChunks(std::string_view data, std::size_t chunkBytes) {
+            std::vector<std::string_view> chunks;
+            chunkBytes = std::max<std::size_t>(1, chunkBytes);
+            while (!data.empty()) {
+                std::size_t end = data.size();
+                if (chunkBytes < data.size()) {
+                    const std::size_t lineBreak = data.find('\n', chunkBytes - 1);
+                    if (lineBreak != std::string_view::npos) end = lineBreak + 1;
+                }
+                chunks.push_back(data.substr(0, end));
+                data.remove_prefix(end);
+            }
+            return chunks;
+        }
+    }
+
+    std::vector<std::string> MigrationValidator::LoadDictionaries(const std::filesystem::path& dir) {
+        std::vector<std::string> missing;
+        std::string bytes;
+        for (std::size_t i = 0; i < COLUMN_COUNT; ++i) {
+            const std::string file = std::string(DictionaryColumnName(i)) + ".txt";
+            if (!ReadWholeFile(dir / file, bytes)) {
+                columns_[i].Clear();
+                missing.push_back(file);
+                continue;
+            }
+            // Столбцы сравниваются с файлом миграции в UTF-8
+            ConvertToUtf8(bytes);
+            columns_[i].Assign(bytes);
+        }
+        return missing;
+    }
+
+    ValidationResult MigrationValidator::Validate(std::string_view data, const ValidationOptions& options) const {
+        const std::vector<std::string_view> chunks = SplitChunks(data, options.chunkBytes);
+        std::vector<ChunkResult> results(chunks.size());
+
+        const auto check = [&](std::size_t index) {
+            ChunkResult& result = results[index];
+            const auto fail = [&](std::uint64_t line, ValidationErrorKind kind, std::size_t column, std::string_view value) {
+                if (result.errorCount++ < options.maxErrors) {
+                    result.errors.push_back(ValidationError{ line, kind, column, std::string(value) });
+                }
+            };
+
+            RecordReader reader(chunks[index]);
+            Record record;
+            while (reader.Next(record)) {
+                ++result.records;
+                if (record.fieldCount < ROW_COLUMN_COUNT || record.fieldCount > MAX_ROW_FIELDS) {
+                    fail(record.line, ValidationErrorKind::FieldCount, record.fieldCount, record.text);
+                    continue;
+                }
+                if (!IsPositiveId(record.fields[0])) fail(record.line, ValidationErrorKind::BadId, 0, record.fields[0]);
+                if (record.fields[1].empty()) fail(record.line, ValidationErrorKind::EmptyLogin, 1, {});
+
+                for (std::size_t i = 0; i < COLUMN_COUNT; ++i) {
+                    const std::size_t column = FIRST_DICTIONARY_COLUMN + i;
+                    const std::string_view value = record.fields[column];
+                    if (value.empty()) {
+                        if (!options.allowEmpty) fail(record.line, ValidationErrorKind::EmptyValue, column, value);
+                    }
+                    else if (!columns_[i].Empty() && !columns_[i].Contains(value)) {
+                        fail(record.line, ValidationErrorKind::UnknownValue, column, value);
+                    }
+                }
+            }
+            result.lines = reader.Line();
+        };
+
+        const unsigned threads = static_cast<unsigned>(std::min<std::size_t>(chunks.size(),
+            options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency())));
+        std::atomic<std::size_t> next{ 0 };
+        const auto worker = [&] {
+            for (std::size_t index; (index = next.fetch_add(1)) < chunks.size();) check(index);
+        };
+        std::vector<std::thread> pool;
+        for (unsigned i = 1; i < threads; ++i) pool.emplace_back(worker);
+        worker();
+        for (std::thread& t : pool) t.join();
+
+        // Номера строк внутри кусков переводятся в номера строк файла
+        ValidationResult total;
+        std::uint64_t firstLine = 0;
+        for (ChunkResult& result : results) {
+            total.records += result.records;
+            total.errorCount += result.errorCount;
+            for (ValidationError& error : result.errors) {
+                if (total.errors.size() >= options.maxErrors) break;
+                error.line += firstLine;
+                total.errors.push_back(std::move(error));
+            }
+            firstLine += result.lines;
+        }
+        return total;
+    }
+}
@@ -0,0 +1,58 @@
+﻿#pragma once
+
+#include "MigrationRow.h"
+#include "StringSet.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Проверка файла миграции по словарям: каждое значение колонки должно быть строкой
+// ее словаря. Файл делится на куски по границам строк, куски проверяются параллельно
+namespace mc {
+    enum class ValidationErrorKind {
+        FieldCount,     // меньше колонок схемы или больше MAX_EXTRA_FIELDS доп. полей
+        BadId,          // id не положительное число
+        EmptyLogin,
+        EmptyValue,     // пустое значение при allowEmpty = false
+        UnknownValue    // значения нет в словаре колонки
+    };
+
+    struct ValidationError {
+        std::uint64_t line = 0;                  // номер строки файла с 1
+        ValidationErrorKind kind = ValidationErrorKind::FieldCount;
+        std::size_t column = 0;                  // индекс в ROW_COLUMNS; для FieldCount - число полей
+        std::string value;
+    };
+
+    struct ValidationOptions {
+        unsigned threads = 0;                    // 0 - по числу ядер
+        std::size_t chunkBytes = 4 << 20;
+        bool allowEmpty = true;                  // пустая колонка - комбобокс не заполнен
+        std::size_t maxErrors = 1000;            // сколько ошибок сохранять (считаются все)
+    };
+
+    struct ValidationResult {
+        std::uint64_t records = 0;
+        std::uint64_t errorCount = 0;
+        std::vector<ValidationError> errors;     // первые maxErrors по порядку строк
+    };
+
+    class MigrationValidator {
+    public:
+        // Словарь колонки i в порядке comboBoxFiles. Пустой словарь - колонка не проверяется
+        StringSet& Column(std::size_t i) { return columns_[i]; }
+        const StringSet& Column(std::size_t i) const { return columns_[i]; }
+
+        // <dir>/<колонка>.txt для всех колонок; возвращает имена файлов, которых нет
+        std::vector<std::string> LoadDictionaries(const std::filesystem::path& dir);
+
+        ValidationResult Validate(std::string_view data, const ValidationOptions& options = {}) const;
+
+    private:
+        StringSet columns_[COLUMN_COUNT];
+    };
+}
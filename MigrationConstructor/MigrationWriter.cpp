@@ -0,0 +1,423 @@
+﻿#include "MigrationWriter.h"
+#include "Encoding.h"
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define MC_HAS_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+namespace mc {
+    namespace {
+        constexpr char UTF8_BOM[] = "\xEF\xBB\xBF";
+        constexpr std::size_t WIDE_PIECE = 1 << 16;
+
+#ifdef MC_HAS_IO_URING
+        // Минимальное кольцо io_uring на системных вызовах: одна операция за раз из потока записи
+        class IoUring {
+        public:
+            IoUring() = default;
+            IoUring(const IoUring&) = delete;
+            IoUring& operator=(const IoUring&) = delete;
+            ~IoUring() { Close(); }
+
+            // false, если ядро не поддерживает io_uring или он запрещен
+            bool Open(unsigned entries) {
+                io_uring_params params;
+                std::memset(&params, 0, sizeof(params));
+                fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+                if (fd_ < 0) return false;
+
+                sqSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+                cqSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+                const bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+                if (single) sqSize_ = cqSize_ = std::max(sqSize_, cqSize_);
+
+                sq_ = mmap(nullptr, sqSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+                if (sq_ == MAP_FAILED) { sq_ = nullptr; Close(); return false; }
+                if (single) {
+                    cq_ = sq_;
+                }
+                else {
+                    cq_ = mmap(nullptr, cqSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+                    if (cq_ == MAP_FAILED) { cq_ = nullptr; Close(); return false; }
+                }
+                sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+                void* sqes = mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+                if (sqes == MAP_FAILED) { Close(); return false; }
+                sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+                char* sq = static_cast<char*>(sq_);
+                char* cq = static_cast<char*>(cq_);
+                sqHead_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+                sqTail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+                sqMask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+                sqArray_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+                cqHead_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+                cqTail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+                cqMask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+                cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+                // IORING_OP_WRITE есть только с ядра 5.6: на более старом запись шла бы с -EINVAL
+                if (!Supports(IORING_OP_WRITE) || !Supports(IORING_OP_FSYNC)) {
+                    Close();
+                    return false;
+                }
+                return true;
+            }
+
+            // Результат операции как у pwrite/fsync: байты или -errno
+            int Run(std::uint8_t opcode, int fd, const void* data, unsigned length, std::uint64_t offset, unsigned flags) {
+                const unsigned tail = *sqTail_;
+                const unsigned index = tail & sqMask_;
+                io_uring_sqe& sqe = sqes_[index];
+                std::memset(&sqe, 0, sizeof(sqe));
+                sqe.opcode = opcode;
+                sqe.fd = fd;
+                sqe.addr = reinterpret_cast<std::uint64_t>(data);
+                sqe.len = length;
+                sqe.off = offset;
+                sqe.fsync_flags = flags;
+                sqArray_[index] = index;
+                __atomic_store_n(sqTail_, tail + 1, __ATOMIC_RELEASE);
+
+                // Повтор после EINTR: досылается только то, что ядро еще не забрало
+                unsigned head = *cqHead_;
+                while (__atomic_load_n(cqTail_, __ATOMIC_ACQUIRE) == head) {
+                    const unsigned unsent = *sqTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+                    if (syscall(__NR_io_uring_enter, fd_, unsent, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 && errno != EINTR) {
+                        return -errno;
+                    }
+                }
+                const int result = cqes_[head & cqMask_].res;
+                __atomic_store_n(cqHead_, head + 1, __ATOMIC_RELEASE);
+                return result;
+            }
+
+        private:
+            // Опрос операций ядра (IORING_REGISTER_PROBE, тоже с 5.6); без него - не поддерживается
+            bool Supports(std::uint8_t opcode) const {
+                constexpr unsigned OPS = 256;
+                std::vector<unsigned char> buffer(sizeof(io_uring_probe) + OPS * sizeof(io_uring_probe_op), 0);
+                io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(buffer.data());
+                if (syscall(__NR_io_uring_register, fd_, IORING_REGISTER_PROBE, probe, OPS) < 0) return false;
+                return opcode <= probe->last_op && (probe->ops[opcode].flags & IO_URING_OP_SUPPORTED) != 0;
+            }
+
+            void Close() {
+                if (sqes_) munmap(sqes_, sqesSize_);
+                if (cq_ && cq_ != sq_) munmap(cq_, cqSize_);
+                if (sq_) munmap(sq_, sqSize_);
+                if (fd_ >= 0) close(fd_);
+                sqes_ = nullptr;
+                sq_ = cq_ = nullptr;
+                fd_ = -1;
+            }
+
+            int fd_ = -1;
+            void* sq_ = nullptr;
+            void* cq_ = nullptr;
+            std::size_t sqSize_ = 0;
+            std::size_t cqSize_ = 0;
+            std::size_t sqesSize_ = 0;
+            io_uring_sqe* sqes_ = nullptr;
+            unsigned* sqHead_ = nullptr;
+            unsigned* sqTail_ = nullptr;
+            unsigned* sqArray_ = nullptr;
+            unsigned sqMask_ = 0;
+            unsigned* cqHead_ = nullptr;
+            unsigned* cqTail_ = nullptr;
+            unsigned cqMask_ = 0;
+            io_uring_cqe* cqes_ = nullptr;
+        };
+#endif
+    }
+
+    // Файл результата; Write и Sync вызываются только из потока записи
+    class MigrationWriter::File {
+    public:
+#ifdef _WIN32
+        File(const std::filesystem::path& path, bool truncate, bool) : path_(path) {
+            handle_ = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL,
+                truncate ? CREATE_ALWAYS : OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+            if (handle_ == INVALID_HANDLE_VALUE) {
+                throw std::runtime_error("Ошибка открытия файла: " + path.u8string());
+            }
+            LARGE_INTEGER size;
+            LARGE_INTEGER end = {};
+            if (!GetFileSizeEx(handle_, &size) || !SetFilePointerEx(handle_, end, NULL, FILE_END)) {
+                CloseHandle(handle_);
+                throw std::runtime_error("Ошибка открытия файла: " + path.u8string());
+            }
+            size_ = static_cast<std::uint64_t>(size.QuadPart);
+        }
+
+        ~File() { CloseHandle(handle_); }
+
+        char LastByte() const {
+            char last = 0;
+            OVERLAPPED at = {};
+            const std::uint64_t offset = size_ - 1;
+            at.Offset = static_cast<DWORD>(offset);
+            at.OffsetHigh = static_cast<DWORD>(offset >> 32);
+            DWORD read = 0;
+            ReadFile(handle_, &last, 1, &read, &at);
+            return last;
+        }
+
+        void Write(const char* data, std::size_t size) {
+            while (size > 0) {
+                DWORD written = 0;
+                const DWORD piece = static_cast<DWORD>(std::min<std::size_t>(size, 1u << 30));
+                if (!WriteFile(handle_, data, piece, &written, NULL)) Fail("Ошибка записи в файл: ");
+                data += written;
+                size -= written;
+            }
+        }
+
+        void Sync() {
+            if (!FlushFileBuffers(handle_)) Fail("Ошибка сброса на диск: ");
+        }
+
+        const char* Backend() const { return "WriteFile"; }
+#else
+        File(const std::filesystem::path& path, bool truncate, bool useIoUring) : path_(path) {
+            fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC | (truncate ? O_TRUNC : 0), 0644);
+            struct stat st;
+            if (fd_ < 0 || fstat(fd_, &st) != 0) {
+                if (fd_ >= 0) close(fd_);
+                throw std::runtime_error("Ошибка открытия файла: " + path.u8string());
+            }
+            size_ = static_cast<std::uint64_t>(st.st_size);
+            offset_ = size_;
+#ifdef MC_HAS_IO_URING
+            if (useIoUring) {
+                ring_ = std::make_unique<IoUring>();
+                if (!ring_->Open(4)) ring_.reset();
+            }
+#else
+            (void)useIoUring;
+#endif
+        }
+
+        ~File() { close(fd_); }
+
+        char LastByte() const {
+            char last = 0;
+            (void)!pread(fd_, &last, 1, static_cast<off_t>(size_ - 1));
+            return last;
+        }
+
+        void Write(const char* data, std::size_t size) {
+            while (size > 0) {
+                const std::size_t piece = std::min<std::size_t>(size, 1u << 30);
+                long long written;
+#ifdef MC_HAS_IO_URING
+                if (ring_) {
+                    written = ring_->Run(IORING_OP_WRITE, fd_, data, static_cast<unsigned>(piece), offset_, 0);
+                    if (written < 0) errno = static_cast<int>(-written);
+                }
+                else
+#endif
+                {
+                    written = pwrite(fd_, data, piece, static_cast<off_t>(offset_));
+                }
+                if (written < 0) {
+                    if (errno == EINTR) continue;
+                    Fail("Ошибка записи в файл: ");
+                }
+                if (written == 0) {
+                    errno = ENOSPC;
+                    Fail("Ошибка записи в файл: ");
+                }
+                data += written;
+                size -= static_cast<std::size_t>(written);
+                offset_ += static_cast<std::uint64_t>(written);
+            }
+        }
+
+        void Sync() {
+            int result;
+#ifdef MC_HAS_IO_URING
+            if (ring_) {
+                result = ring_->Run(IORING_OP_FSYNC, fd_, nullptr, 0, 0, IORING_FSYNC_DATASYNC);
+                if (result < 0) errno = -result;
+            }
+            else
+#endif
+            {
+                result = fdatasync(fd_);
+            }
+            if (result < 0) Fail("Ошибка сброса на диск: ");
+        }
+
+        const char* Backend() const {
+#ifdef MC_HAS_IO_URING
+            if (ring_) return "io_uring";
+#endif
+            return "pwrite";
+        }
+#endif
+
+        std::uint64_t InitialSize() const { return size_; }
+
+    private:
+        [[noreturn]] void Fail(const char* what) const {
+#ifdef _WIN32
+            throw std::runtime_error(what + path_.u8string() + " (код " + std::to_string(GetLastError()) + ")");
+#else
+            throw std::runtime_error(what + path_.u8string() + ": " + std::strerror(errno));
+#endif
+        }
+
+        std::filesystem::path path_;
+        std::uint64_t size_ = 0;
+#ifdef _WIN32
+        HANDLE handle_ = INVALID_HANDLE_VALUE;
+#else
+        int fd_ = -1;
+        std::uint64_t offset_ = 0;
+#ifdef MC_HAS_IO_URING
+        std::unique_ptr<IoUring> ring_;
+#endif
+#endif
+    };
+
+    MigrationWriter::MigrationWriter(const std::filesystem::path& path, const WriterOptions& options)
+        : file_(std::make_unique<File>(path, options.truncate, options.useIoUring)), options_(options) {
+        options_.bufferBytes = std::max<std::size_t>(options_.bufferBytes, 4096);
+        active_.reserve(options_.bufferBytes);
+        pending_.reserve(options_.bufferBytes);
+
+        if (file_->InitialSize() == 0) {
+            if (options_.bom) active_ = UTF8_BOM;
+        }
+        else if (file_->LastByte() != '\n') {
+            active_ = "\r\n";
+        }
+        bytes_ = unsynced_ = active_.size();
+
+        thread_ = std::thread(&MigrationWriter::WriterLoop, this);
+    }
+
+    MigrationWriter::~MigrationWriter() {
+        try {
+            Close();
+        }
+        catch (const std::exception&) {
+            // Ошибку можно получить только явным Close()
+        }
+    }
+
+    const char* MigrationWriter::Backend() const {
+        return file_->Backend();
+    }
+
+    void MigrationWriter::Write(std::string_view utf8) {
+        while (!utf8.empty()) {
+            if (active_.size() == options_.bufferBytes) {
+                const bool sync = options_.sync == SyncPolicy::EveryBytes && unsynced_ >= options_.syncBytes;
+                Submit(sync);
+            }
+            const std::size_t piece = std::min(utf8.size(), options_.bufferBytes - active_.size());
+            active_.append(utf8.data(), piece);
+            utf8.remove_prefix(piece);
+            bytes_ += piece;
+            unsynced_ += piece;
+        }
+    }
+
+    void MigrationWriter::WriteWide(std::wstring_view text) {
+        while (!text.empty()) {
+            std::size_t piece = std::min(text.size(), WIDE_PIECE);
+            // Суррогатная пара UTF-16 не разрывается между частями
+            if (sizeof(wchar_t) == 2 && piece < text.size() && text[piece - 1] >= 0xD800 && text[piece - 1] <= 0xDBFF) {
+                --piece;
+            }
+            wide_.clear();
+            AppendWideAsUtf8(text.substr(0, piece), wide_);
+            Write(wide_);
+            text.remove_prefix(piece);
+        }
+    }
+
+    void MigrationWriter::EndBatch() {
+        Submit(options_.sync == SyncPolicy::EveryBatch && unsynced_ > 0);
+    }
+
+    void MigrationWriter::Close() {
+        if (closed_) return;
+        closed_ = true;
+
+        std::string error;
+        try {
+            Submit(unsynced_ > 0);
+        }
+        catch (const std::exception& e) {
+            error = e.what();
+        }
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            changed_.wait(lock, [&] { return !busy_; });
+            if (error.empty()) error = error_;
+            stop_ = true;
+            changed_.notify_all();
+        }
+        thread_.join();
+        if (!error.empty()) throw std::runtime_error(error);
+    }
+
+    void MigrationWriter::Submit(bool sync) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        changed_.wait(lock, [&] { return !busy_; });
+        if (!error_.empty()) throw std::runtime_error(error_);
+        if (active_.empty() && !sync) return;
+
+        active_.swap(pending_);
+        busy_ = true;
+        syncPending_ = sync;
+        if (sync) unsynced_ = 0;
+        changed_.notify_all();
+    }
+
+    void MigrationWriter::WriterLoop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            changed_.wait(lock, [&] { return busy_ || stop_; });
+            if (!busy_) return;
+            const bool sync = syncPending_;
+            lock.unlock();
+
+            std::string failure;
+            try {
+                if (!pending_.empty()) file_->Write(pending_.data(), pending_.size());
+                if (sync) file_->Sync();
+            }
+            catch (const std::exception& e) {
+                failure = e.what();
+            }
+            pending_.clear();
+
+            lock.lock();
+            if (error_.empty()) error_ = failure;
+            busy_ = false;
+            changed_.notify_all();
+        }
+    }
+}
@@ -0,0 +1,77 @@
+﻿#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+// Запись в файл миграции: два буфера, пока один заполняется, второй пишет фоновый поток
+// (io_uring на Linux, если доступен, иначе pwrite / WriteFile)
+namespace mc {
+    // Когда данные сбрасываются на диск (fsync); при закрытии - всегда
+    enum class SyncPolicy {
+        OnClose,
+        EveryBatch,     // после каждого EndBatch
+        EveryBytes,     // после каждых syncBytes записанных байт
+    };
+
+    struct WriterOptions {
+        std::size_t bufferBytes = std::size_t(1) << 20;    // размер каждого из двух буферов
+        SyncPolicy sync = SyncPolicy::OnClose;
+        std::uint64_t syncBytes = std::uint64_t(64) << 20;
+        bool bom = false;           // BOM UTF-8 в начале нового или пустого файла
+        bool truncate = false;      // иначе файл дописывается
+        bool useIoUring = true;
+    };
+
+    class MigrationWriter {
+    public:
+        // Бросает std::runtime_error, если файл не открывается.
+        // Дописывание в непустой файл начинается с новой строки
+        explicit MigrationWriter(const std::filesystem::path& path, const WriterOptions& options = WriterOptions());
+        ~MigrationWriter();
+
+        MigrationWriter(const MigrationWriter&) = delete;
+        MigrationWriter& operator=(const MigrationWriter&) = delete;
+
+        // Ошибки фоновой записи бросаются как std::runtime_error из следующего вызова
+        void Write(std::string_view utf8);
+        void WriteWide(std::wstring_view text);
+
+        // Отдает накопленное на запись; с SyncPolicy::EveryBatch - и на диск
+        void EndBatch();
+
+        // Дописывает остаток, сбрасывает на диск и ждет окончания записи
+        void Close();
+
+        std::uint64_t BytesWritten() const { return bytes_; }
+        const char* Backend() const;
+
+    private:
+        class File;
+
+        void Submit(bool sync);
+        void WriterLoop();
+
+        std::unique_ptr<File> file_;
+        WriterOptions options_;
+        std::string active_;            // заполняется вызывающим
+        std::string pending_;           // пишется фоновым потоком
+        std::string wide_;              // перекодированный WriteWide
+        std::uint64_t bytes_ = 0;
+        std::uint64_t unsynced_ = 0;
+        bool closed_ = false;
+
+        std::mutex mutex_;
+        std::condition_variable changed_;
+        bool busy_ = false;             // pending_ отдан потоку
+        bool syncPending_ = false;
+        bool stop_ = false;
+        std::string error_;
+        std::thread thread_;
+    };
+}
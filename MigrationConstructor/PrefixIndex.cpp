@@ -0,0 +1,138 @@
+﻿#include "PrefixIndex.h"
+#include "CaseFold.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace mc {
+    namespace {
+        constexpr std::size_t BITMAP_MIN_ITEMS = 4096;
+
+        // Номер младшего единичного бита (word != 0): умножение на последовательность де Брейна
+        constexpr std::uint64_t DE_BRUIJN = 0x03F79D71B4CB0A89ull;
+
+        struct BitTable {
+            std::uint8_t index[64] = {};
+            constexpr BitTable() {
+                for (int bit = 0; bit < 64; ++bit) index[((std::uint64_t(1) << bit) * DE_BRUIJN) >> 58] = static_cast<std::uint8_t>(bit);
+            }
+        };
+        constexpr BitTable BIT_TABLE;
+
+        unsigned LowestBit(std::uint64_t word) {
+            return BIT_TABLE.index[((word & (~word + 1)) * DE_BRUIJN) >> 58];
+        }
+    }
+
+    void PrefixIndex::Build(const std::vector<std::wstring_view>& items) {
+        std::wstring folded;
+        std::vector<std::uint32_t> foldedOffsets;
+        foldedOffsets.reserve(items.size() + 1);
+        size_t total = 0;
+        for (const auto& item : items) total += item.size();
+        folded.reserve(total);
+
+        for (const auto& item : items) {
+            foldedOffsets.push_back(static_cast<std::uint32_t>(folded.size()));
+            AppendFolded(folded, item);
+        }
+        foldedOffsets.push_back(static_cast<std::uint32_t>(folded.size()));
+
+        auto keyOf = [&](std::uint32_t item) {
+            return std::wstring_view(folded).substr(foldedOffsets[item], foldedOffsets[item + 1] - foldedOffsets[item]);
+        };
+
+        std::vector<std::uint32_t>& order = order_.Owned();
+        order.resize(items.size());
+        std::iota(order.begin(), order.end(), 0u);
+        std::stable_sort(order.begin(), order.end(), [&](std::uint32_t a, std::uint32_t b) {
+            return keyOf(a) < keyOf(b);
+        });
+
+        // Ключи в порядке сортировки, чтобы двоичный поиск шел по соседней памяти
+        std::vector<wchar_t>& keys = keys_.Owned();
+        std::vector<std::uint32_t>& offsets = offsets_.Owned();
+        keys.clear();
+        keys.reserve(folded.size());
+        offsets.clear();
+        offsets.reserve(items.size() + 1);
+        for (std::uint32_t item : order) {
+            offsets.push_back(static_cast<std::uint32_t>(keys.size()));
+            const std::wstring_view key = keyOf(item);
+            keys.insert(keys.end(), key.begin(), key.end());
+        }
+        offsets.push_back(static_cast<std::uint32_t>(keys.size()));
+    }
+
+    std::wstring_view PrefixIndex::KeyAt(std::uint32_t sortedPos) const {
+        return std::wstring_view(keys_.Data() + offsets_[sortedPos], offsets_[sortedPos + 1] - offsets_[sortedPos]);
+    }
+
+    PrefixRange PrefixIndex::Find(std::wstring_view foldedPrefix, PrefixRange within) const {
+        if (foldedPrefix.empty()) return within;
+
+        std::uint32_t lo = within.first;
+        std::uint32_t hi = within.last;
+        // Первый ключ >= префикса
+        while (lo < hi) {
+            const std::uint32_t mid = lo + (hi - lo) / 2;
+            if (KeyAt(mid) < foldedPrefix) lo = mid + 1;
+            else hi = mid;
+        }
+        const std::uint32_t first = lo;
+
+        // Первый ключ, не начинающийся с префикса
+        hi = within.last;
+        while (lo < hi) {
+            const std::uint32_t mid = lo + (hi - lo) / 2;
+            if (KeyAt(mid).substr(0, foldedPrefix.size()) == foldedPrefix) lo = mid + 1;
+            else hi = mid;
+        }
+        return { first, lo };
+    }
+
+    bool PrefixIndex::CollectItems(PrefixRange range, std::vector<std::uint32_t>& out, const CancelToken& cancel) const {
+        out.clear();
+        if (cancel.Cancelled()) return false;
+
+        // Небольшой диапазон сортируется; большой (короткий префикс) раскладывается по битовой
+        // карте всего словаря и читается из нее уже по порядку, с точками отмены по пути
+        if (range.Size() < BITMAP_MIN_ITEMS || range.Size() < Size() / 64) {
+            out.assign(order_.begin() + range.first, order_.begin() + range.last);
+            std::sort(out.begin(), out.end());
+            return true;
+        }
+
+        std::vector<std::uint64_t> bits((Size() + 63) / 64);
+        for (std::uint32_t pos = range.first; pos < range.last; ++pos) {
+            if ((pos - range.first) % CANCEL_CHECK_STEP == 0 && cancel.Cancelled()) return false;
+            const std::uint32_t item = order_[pos];
+            bits[item >> 6] |= std::uint64_t(1) << (item & 63);
+        }
+        out.reserve(range.Size());
+        for (std::size_t word = 0; word < bits.size(); ++word) {
+            if (word % CANCEL_CHECK_STEP == 0 && cancel.Cancelled()) {
+                out.clear();
+                return false;
+            }
+            for (std::uint64_t rest = bits[word]; rest != 0; rest &= rest - 1) {
+                out.push_back(static_cast<std::uint32_t>(word * 64 + LowestBit(rest)));
+            }
+        }
+        return true;
+    }
+
+    PrefixRange PrefixCursor::Update(const PrefixIndex& index, std::wstring_view prefix) {
+        const std::wstring folded = FoldCase(prefix);
+
+        PrefixRange within = index.All();
+        if (valid_ && folded.size() >= folded_.size() && folded.compare(0, folded_.size(), folded_) == 0) {
+            within = range_;
+        }
+
+        range_ = index.Find(folded, within);
+        folded_ = folded;
+        valid_ = true;
+        return range_;
+    }
+}
@@ -0,0 +1,71 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "CancelToken.h"
+#include "MappedArray.h"
+
+// Отсортированный индекс по приведенным к верхнему регистру строкам словаря.
+// Поиск по префиксу - двоичный поиск диапазона, O(log n)
+namespace mc {
+    struct PrefixRange {
+        std::uint32_t first = 0;   // позиции в отсортированном порядке, [first, last)
+        std::uint32_t last = 0;
+
+        std::size_t Size() const { return last - first; }
+        bool Empty() const { return first == last; }
+    };
+
+    class PrefixIndex {
+    public:
+        void Build(const std::vector<std::wstring_view>& items);
+
+        std::size_t Size() const { return order_.Size(); }
+        PrefixRange All() const { return { 0, static_cast<std::uint32_t>(order_.Size()) }; }
+
+        // Диапазон ключей, начинающихся с foldedPrefix, внутри within
+        PrefixRange Find(std::wstring_view foldedPrefix, PrefixRange within) const;
+        PrefixRange Find(std::wstring_view foldedPrefix) const { return Find(foldedPrefix, All()); }
+
+        // Индекс исходной строки для позиции в отсортированном порядке
+        std::uint32_t ItemAt(std::uint32_t sortedPos) const { return order_[sortedPos]; }
+
+        // Индексы исходных строк диапазона в порядке словаря.
+        // false (out пуст), если запрос отменен по cancel
+        bool CollectItems(PrefixRange range, std::vector<std::uint32_t>& out, const CancelToken& cancel = CancelToken()) const;
+
+        // Доступ к массивам для кэша .mcdict
+        const MappedArray<wchar_t>& Keys() const { return keys_; }
+        const MappedArray<std::uint32_t>& KeyOffsets() const { return offsets_; }
+        const MappedArray<std::uint32_t>& Order() const { return order_; }
+        void Map(const wchar_t* keys, std::size_t keyCount, const std::uint32_t* offsets, const std::uint32_t* order, std::size_t count) {
+            keys_.Map(keys, keyCount);
+            offsets_.Map(offsets, count + 1);
+            order_.Map(order, count);
+        }
+
+    private:
+        std::wstring_view KeyAt(std::uint32_t sortedPos) const;
+
+        MappedArray<wchar_t> keys_;            // ключи подряд в отсортированном порядке
+        MappedArray<std::uint32_t> offsets_;   // начало ключа в keys_, offsets_[n] = размер keys_
+        MappedArray<std::uint32_t> order_;     // отсортированная позиция -> индекс строки
+    };
+
+    // Состояние фильтра одного списка: при дописывании символа поиск
+    // сужает предыдущий диапазон, а не начинается заново
+    class PrefixCursor {
+    public:
+        PrefixRange Update(const PrefixIndex& index, std::wstring_view prefix);
+        void Reset() { valid_ = false; }
+
+    private:
+        std::wstring folded_;
+        PrefixRange range_;
+        bool valid_ = false;
+    };
+}
@@ -0,0 +1,310 @@
+﻿#include "RowGenerator.h"
+#include "CartesianProduct.h"
+#include "CsvReader.h"
+#include "LoginAllocator.h"
+#include "MigrationParser.h"
+#include "MigrationRow.h"
+#include "MigrationWriter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+
+namespace mc {
+    namespace {
+        // Хвост записи после "id;login_NN;"
+        void AppendRowTail(std::string& out, const std::vector<std::string_view>& values) {
+            for (size_t i = 0; i < values.size(); ++i) {
+                if (i > 0) out += ';';
+                out += values[i];
+            }
+        }
+
+        // Непустые строки без '\r\n', как их отдает RecordReader
+        template <class Visit>
+        void ForEachLine(std::string_view data, const Visit& visit) {
+            while (!data.empty()) {
+                const std::size_t end = data.find('\n');
+                std::string_view line = data.substr(0, end);
+                data.remove_prefix(end == std::string_view::npos ? data.size() : end + 1);
+                if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+                if (!line.empty()) visit(line);
+            }
+        }
+
+        // Блоки формируются в threads потоках, write получает их строго по порядку: воркеры
+        // заполняют кольцо из 2 * threads блоков, текущий поток забирает их и пишет.
+        // false из write останавливает воркеров, тогда возвращается false
+        template <class Format, class Write>
+        bool WriteBlocksInOrder(std::uint64_t blockCount, unsigned threads, const Format& format, const Write& write) {
+            const std::uint64_t window = threads * 2ull;
+            std::vector<std::string> slots(window);
+            std::vector<char> ready(window, 0);
+            std::mutex mutex;
+            std::condition_variable slotReady;
+            std::condition_variable slotFree;
+            std::uint64_t written = 0;
+            std::atomic<std::uint64_t> nextBlock{ 0 };
+            std::atomic<bool> failed{ false };
+
+            auto worker = [&]() {
+                std::string buffer;
+                for (;;) {
+                    const std::uint64_t block = nextBlock.fetch_add(1);
+                    if (block >= blockCount) return;
+
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        slotFree.wait(lock, [&] { return failed || block < written + window; });
+                        if (failed) return;
+                    }
+
+                    buffer.clear();
+                    format(block, buffer);
+
+                    std::lock_guard<std::mutex> lock(mutex);
+                    slots[block % window].swap(buffer);
+                    ready[block % window] = 1;
+                    slotReady.notify_all();
+                }
+            };
+
+            std::vector<std::thread> pool;
+            pool.reserve(threads);
+            for (unsigned i = 0; i < threads; ++i) {
+                pool.emplace_back(worker);
+            }
+
+            std::exception_ptr error;
+            std::string current;
+            for (std::uint64_t block = 0; block < blockCount; ++block) {
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    slotReady.wait(lock, [&] { return ready[block % window] != 0; });
+                    current.swap(slots[block % window]);
+                    ready[block % window] = 0;
+                }
+
+                bool ok = false;
+                try {
+                    ok = write(current);
+                }
+                catch (...) {
+                    error = std::current_exception();
+                }
+
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!ok) {
+                    failed = true;
+                    slotFree.notify_all();
+                    break;
+                }
+                ++written;
+                slotFree.notify_all();
+            }
+
+            for (std::thread& t : pool) {
+                t.join();
+            }
+            if (error) std::rethrow_exception(error);
+            return !failed;
+        }
+    }
+
+    void FormatRows(std::string& out, const RowTemplate& tmpl,
+        std::uint64_t firstRow, std::uint64_t count, const std::string& lineEnd, const long long* loginCounters) {
+        const std::string_view loginBase(tmpl.loginBase);
+        const CartesianProduct product(tmpl.fields);
+        CartesianProduct::Iterator values = product.At(firstRow);
+
+        // Одно сочетание - хвост общий для всех записей
+        std::string tail;
+        if (product.Size() == 1) AppendRowTail(tail, *values);
+
+        for (std::uint64_t row = firstRow; row < firstRow + count; ++row, ++values) {
+            const long long id = tmpl.startId + static_cast<long long>(row);
+            const long long loginCounter = loginCounters ?
+                loginCounters[row - firstRow] : tmpl.loginCounter + static_cast<long long>(row);
+            const size_t start = out.size();
+            out.resize(start + RowHeadLength(id, loginBase, loginCounter));
+            WriteRowHead(&out[start], id, loginBase, loginCounter);
+            if (product.Size() == 1) out += tail;
+            else AppendRowTail(out, *values);
+            out += lineEnd;
+        }
+    }
+
+    std::uint64_t GenerateRows(std::FILE* out, const RowTemplate& tmpl, const GenerateOptions& options) {
+        const std::uint64_t rowCount = options.rowCount ? options.rowCount : CartesianProduct(tmpl.fields).Size();
+        const std::uint64_t rowsPerBlock = std::max<std::uint64_t>(1, options.rowsPerBlock);
+        const std::uint64_t blockCount = (rowCount + rowsPerBlock - 1) / rowsPerBlock;
+        const unsigned threads = static_cast<unsigned>(std::min<std::uint64_t>(blockCount,
+            options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency())));
+
+        // Суффиксы от аллокатора зависят от всех предыдущих: блок получает свои, когда их
+        // получили все блоки до него, а форматируется уже параллельно с остальными
+        std::mutex allocation;
+        std::condition_variable allocated;
+        std::uint64_t allocatedBlocks = 0;
+        bool stopped = false;
+        long long nextCounter = tmpl.loginCounter;
+
+        std::uint64_t bytes = 0;
+        const bool ok = WriteBlocksInOrder(blockCount, threads, [&](std::uint64_t block, std::string& buffer) {
+            const std::uint64_t firstRow = block * rowsPerBlock;
+            const std::uint64_t count = std::min(rowsPerBlock, rowCount - firstRow);
+            if (!tmpl.loginAllocator) {
+                FormatRows(buffer, tmpl, firstRow, count, options.lineEnd);
+                return;
+            }
+
+            std::vector<long long> counters(count);
+            {
+                std::unique_lock<std::mutex> lock(allocation);
+                allocated.wait(lock, [&] { return stopped || allocatedBlocks == block; });
+                if (stopped) return;
+                for (long long& counter : counters) {
+                    tmpl.loginAllocator->Next(tmpl.loginBase, nextCounter);
+                    counter = nextCounter - 1;
+                }
+                ++allocatedBlocks;
+            }
+            allocated.notify_all();
+            FormatRows(buffer, tmpl, firstRow, count, options.lineEnd, counters.data());
+        }, [&](const std::string& current) {
+            bytes += current.size();
+            if (std::fwrite(current.data(), 1, current.size(), out) == current.size()) return true;
+            // После ошибки записи блоки, которых ждут, уже не форматируются
+            std::lock_guard<std::mutex> lock(allocation);
+            stopped = true;
+            allocated.notify_all();
+            return false;
+        });
+        if (!ok || std::fflush(out) != 0) {
+            throw std::runtime_error("Ошибка записи в файл миграции");
+        }
+        return bytes;
+    }
+
+    long long FirstRowId(long long startId) {
+        return startId < 1 ? 1 : startId;
+    }
+
+    std::uint64_t RenumberRows(std::string& out, std::string_view data, long long startId, long long loginCounter,
+        const std::string& lineEnd) {
+        std::uint64_t row = 0;
+        ForEachLine(data, [&](std::string_view line) {
+            const long long id = startId + static_cast<long long>(row);
+            const long long counter = loginCounter + static_cast<long long>(row);
+            ++row;
+            // Логин - второе поле, хвост - с ';' перед третьим
+            std::string_view login, tail;
+            const std::size_t idEnd = line.find(';');
+            if (idEnd != std::string_view::npos) {
+                const std::string_view rest = line.substr(idEnd + 1);
+                const std::size_t loginEnd = rest.find(';');
+                login = rest.substr(0, loginEnd);
+                if (loginEnd != std::string_view::npos) tail = rest.substr(loginEnd);
+            }
+            const std::string_view loginBase = StripLoginSuffix(login);
+            const size_t start = out.size();
+            out.resize(start + RowHeadLength(id, loginBase, counter));
+            WriteRowHead(&out[start], id, loginBase, counter);
+            if (tail.empty()) out.pop_back();
+            else out += tail.substr(1);
+            out += lineEnd;
+        });
+        return row;
+    }
+
+    RenumberStats RenumberMigration(std::string_view data, const std::filesystem::path& outPath, const RenumberOptions& options) {
+        WriterOptions writerOptions;
+        writerOptions.truncate = true;
+        writerOptions.bom = data.size() >= 3 && data.compare(0, 3, "\xEF\xBB\xBF") == 0;
+        if (writerOptions.bom) data.remove_prefix(3);
+
+        const std::size_t chunkBytes = std::max<std::size_t>(1, options.chunkBytes);
+        const std::size_t chunkCount = (data.size() + chunkBytes - 1) / chunkBytes;
+        std::vector<std::size_t> bounds(chunkCount + 1);
+        for (std::size_t i = 0; i <= chunkCount; ++i) bounds[i] = LineStart(data, i * chunkBytes);
+        const auto chunk = [&](std::size_t i) { return data.substr(bounds[i], bounds[i + 1] - bounds[i]); };
+        const unsigned threads = static_cast<unsigned>(std::min<std::uint64_t>(chunkCount,
+            options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency())));
+
+        // Записи в кусках, затем префиксная сумма: firstRow[i] - номер первой записи куска i
+        std::vector<std::uint64_t> firstRow(chunkCount + 1, 0);
+        std::atomic<std::size_t> nextChunk{ 0 };
+        const auto count = [&] {
+            for (std::size_t i; (i = nextChunk++) < chunkCount;) {
+                std::uint64_t records = 0;
+                ForEachLine(chunk(i), [&](std::string_view) { ++records; });
+                firstRow[i + 1] = records;
+            }
+        };
+        std::vector<std::thread> pool;
+        for (unsigned i = 1; i < threads; ++i) pool.emplace_back(count);
+        count();
+        for (std::thread& t : pool) t.join();
+        std::partial_sum(firstRow.begin(), firstRow.end(), firstRow.begin());
+
+        RenumberStats stats;
+        stats.records = firstRow[chunkCount];
+        stats.chunks = chunkCount;
+        MigrationWriter out(outPath, writerOptions);
+        WriteBlocksInOrder(chunkCount, threads, [&](std::uint64_t block, std::string& buffer) {
+            const long long row = static_cast<long long>(firstRow[block]);
+            RenumberRows(buffer, chunk(block), options.startId + row, options.loginCounter + row, options.lineEnd);
+        }, [&](const std::string& current) {
+            out.Write(current);
+            stats.bytes += current.size();
+            return true;
+        });
+        out.Close();
+        return stats;
+    }
+
+    std::uint64_t JoinRows(CsvReader& people, const RowTemplate& tmpl, const std::vector<int>& sources,
+        MigrationWriter& out, const std::string& lineEnd) {
+        const auto trim = [](std::string_view value) {
+            while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) value.remove_prefix(1);
+            while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) value.remove_suffix(1);
+            return value;
+        };
+
+        const std::string_view loginBase(tmpl.loginBase);
+        std::vector<std::string_view> fields;
+        std::string row;
+        std::uint64_t count = 0;
+        while (people.Next(fields)) {
+            const long long id = tmpl.startId + static_cast<long long>(count);
+            const long long loginCounter = tmpl.loginCounter + static_cast<long long>(count);
+            row.resize(RowHeadLength(id, loginBase, loginCounter));
+            WriteRowHead(&row[0], id, loginBase, loginCounter);
+
+            for (size_t i = 0; i < tmpl.fields.size(); ++i) {
+                if (i > 0) row += ';';
+                const int source = i < sources.size() ? sources[i] : -1;
+                if (source < 0) {
+                    if (!tmpl.fields[i].empty()) row += tmpl.fields[i].front();
+                    continue;
+                }
+                const std::string_view value = static_cast<size_t>(source) < fields.size() ? trim(fields[source]) : std::string_view();
+                if (value.find_first_of(";\r\n") != std::string_view::npos) {
+                    throw std::runtime_error("Строка " + std::to_string(people.Line()) +
+                        ": значение содержит ';' или перевод строки: " + std::string(value));
+                }
+                row += value;
+            }
+            row += lineEnd;
+            out.Write(row);
+            ++count;
+        }
+        return count;
+    }
+}
@@ -0,0 +1,84 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Пакетная генерация записей без окна (по правилам UpdateTextBox)
+namespace mc {
+    class CsvReader;
+    class LoginAllocator;
+    class MigrationWriter;
+
+    struct RowTemplate {
+        long long startId = 1;
+        long long loginCounter = 1;
+        std::string loginBase = "user";
+        // Не nullptr - суффиксы логинов выдает аллокатор (занятые пропускаются), начиная
+        // с loginCounter, вместо loginCounter + номер записи. GenerateRows берет их по блоку
+        // в порядке блоков, поэтому в памяти только суффиксы блоков в работе
+        LoginAllocator* loginAllocator = nullptr;
+        // Значения колонок после логина: комбобоксы, затем доп. поля. У поля может быть
+        // несколько значений - тогда записи перебирают все сочетания (CartesianProduct)
+        std::vector<std::vector<std::string>> fields;
+    };
+
+    struct GenerateOptions {
+        std::uint64_t rowCount = 0;         // 0 - по записи на каждое сочетание значений
+        unsigned threads = 0;               // 0 - по числу ядер
+        std::uint64_t rowsPerBlock = 1 << 16;
+        std::string lineEnd = "\r\n";
+    };
+
+    struct RenumberOptions {
+        long long startId = 1;
+        long long loginCounter = 1;
+        unsigned threads = 0;               // 0 - по числу ядер
+        std::size_t chunkBytes = 4 << 20;   // кусок исходного файла на один блок результата
+        std::string lineEnd = "\r\n";
+    };
+
+    struct RenumberStats {
+        std::uint64_t records = 0;
+        std::uint64_t bytes = 0;            // записано, без BOM
+        std::size_t chunks = 0;
+    };
+
+    // Собирает записи [firstRow, firstRow + count) в out. Запись row получает сочетание
+    // с номером row (по кругу, если записей больше), id и суффикс логина - по правилам UpdateTextBox.
+    // loginCounters не nullptr - суффиксы этих count записей (tmpl.loginAllocator не используется)
+    void FormatRows(std::string& out, const RowTemplate& tmpl,
+        std::uint64_t firstRow, std::uint64_t count, const std::string& lineEnd,
+        const long long* loginCounters = nullptr);
+
+    // Пишет rowCount записей в out, блоки форматируются параллельно; сочетания значений
+    // перебираются внутри блока, все сразу в памяти не строятся.
+    // Возвращает количество записанных байт, при ошибке записи бросает std::runtime_error
+    std::uint64_t GenerateRows(std::FILE* out, const RowTemplate& tmpl, const GenerateOptions& options);
+
+    // Записи по выгрузке людей: по одной на каждую запись people. sources[i] - номер поля входной
+    // записи для tmpl.fields[i] или -1 (берется первое значение из шаблона); пробелы по краям отбрасываются.
+    // Значение с ';' или переводом строки - std::runtime_error с номером строки выгрузки.
+    // Возвращает число записей
+    std::uint64_t JoinRows(CsvReader& people, const RowTemplate& tmpl, const std::vector<int>& sources,
+        MigrationWriter& out, const std::string& lineEnd = "\r\n");
+
+    // Первый id записи, заданный пользователем: как в UpdateTextBox, id не меньше 1
+    long long FirstRowId(long long startId);
+
+    // Перенумерация записей data (без BOM) по правилам UpdateTextBox: запись с номером row получает
+    // id startId + row и логин без прежнего суффикса с суффиксом loginCounter + row; остальные поля
+    // не меняются, пустые строки пропускаются. Возвращает число записей
+    std::uint64_t RenumberRows(std::string& out, std::string_view data, long long startId, long long loginCounter,
+        const std::string& lineEnd);
+
+    // Перенумерация всего файла в outPath (BOM сохраняется). Записи в кусках файла считаются
+    // параллельно, номера первых записей кусков - префиксная сумма, затем куски переписываются
+    // параллельно и пишутся по порядку. Результат совпадает с RenumberRows по всему файлу.
+    // Ошибка записи - std::runtime_error
+    RenumberStats RenumberMigration(std::string_view data, const std::filesystem::path& outPath,
+        const RenumberOptions& options = {});
+}
@@ -0,0 +1,62 @@
+﻿#include "StringSet.h"
+
+#include <algorithm>
+
+namespace mc {
+    void StringSet::Assign(std::string_view utf8) {
+        Clear();
+        if (utf8.size() >= 3 && utf8.compare(0, 3, "\xEF\xBB\xBF") == 0) {
+            utf8.remove_prefix(3);
+        }
+        Rehash(static_cast<std::size_t>(std::count(utf8.begin(), utf8.end(), '\n')) + 1);
+
+        while (!utf8.empty()) {
+            std::size_t end = utf8.find('\n');
+            if (end == std::string_view::npos) end = utf8.size();
+            std::string_view line = utf8.substr(0, end);
+            if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+            if (!line.empty()) Insert(line);
+            utf8.remove_prefix(std::min(end + 1, utf8.size()));
+        }
+    }
+
+    void StringSet::Insert(std::string_view value, std::uint64_t hash) {
+        if (Contains(value, hash)) return;
+        if ((Size() + 1) * 2 > slots_.size()) Rehash(Size() + 1);
+
+        const std::uint32_t item = static_cast<std::uint32_t>(arena_.size());
+        const std::uint32_t length = static_cast<std::uint32_t>(value.size());
+        arena_.append(reinterpret_cast<const char*>(&length), sizeof(length));
+        arena_.append(value);
+        ++size_;
+        Place(hash, item + 1);
+    }
+
+    void StringSet::Clear() {
+        arena_.clear();
+        size_ = 0;
+        slots_.clear();
+        mask_ = 0;
+    }
+
+    // Таблица заполнена не больше чем наполовину, размер - степень двойки
+    void StringSet::Rehash(std::size_t count) {
+        std::size_t capacity = 16;
+        while (capacity < count * 2) capacity *= 2;
+        if (capacity <= slots_.size()) return;
+
+        slots_.assign(capacity, Slot{ 0, 0 });
+        mask_ = capacity - 1;
+        for (std::size_t offset = 0; offset < arena_.size();) {
+            const std::string_view item = Item(offset);
+            Place(HashString(item), static_cast<std::uint32_t>(offset + 1));
+            offset += sizeof(std::uint32_t) + item.size();
+        }
+    }
+
+    void StringSet::Place(std::uint64_t hash, std::uint32_t item) {
+        std::size_t i = hash & mask_;
+        while (slots_[i].item != 0) i = (i + 1) & mask_;
+        slots_[i] = Slot{ static_cast<std::uint32_t>(hash >> 32), item };
+    }
+}
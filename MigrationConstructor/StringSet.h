@@ -0,0 +1,96 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Множество строк словаря для проверки значений: строки подряд в одном буфере
+// (перед каждой - ее длина), открытая адресация с линейным пробированием в плоской таблице.
+// Слот ссылается прямо на строку, поэтому проверка значения - два обращения к памяти
+namespace mc {
+    inline std::uint64_t HashString(std::string_view text) {
+        std::uint64_t hash = 0x9E3779B97F4A7C15ull ^ text.size();
+        const char* p = text.data();
+        std::size_t n = text.size();
+        for (; n >= 8; p += 8, n -= 8) {
+            std::uint64_t word;
+            std::memcpy(&word, p, 8);
+            hash = (hash ^ word) * 0xFF51AFD7ED558CCDull;
+            hash ^= hash >> 32;
+        }
+        // Хвост короче 8 байт - двумя перекрывающимися чтениями фиксированной длины, без побайтового цикла
+        if (n >= 4) {
+            std::uint32_t low, high;
+            std::memcpy(&low, p, 4);
+            std::memcpy(&high, p + n - 4, 4);
+            hash = (hash ^ (low | std::uint64_t(high) << 32)) * 0xC4CEB9FE1A85EC53ull;
+        }
+        else if (n > 0) {
+            const auto byte = [&](std::size_t i) { return std::uint64_t(static_cast<unsigned char>(p[i])); };
+            hash = (hash ^ (byte(0) | byte(n / 2) << 8 | byte(n - 1) << 16)) * 0xC4CEB9FE1A85EC53ull;
+        }
+        return hash ^ (hash >> 29);
+    }
+
+    class StringSet {
+    public:
+        // Строки словаря: UTF-8 с необязательным BOM, '\r' отбрасывается, пустые строки пропускаются
+        void Assign(std::string_view utf8);
+        void Insert(std::string_view value) { Insert(value, HashString(value)); }
+        void Insert(std::string_view value, std::uint64_t hash);
+        void Clear();
+        // Отдает запас буфера строк после загрузки
+        void ShrinkToFit() { arena_.shrink_to_fit(); }
+
+        bool Contains(std::string_view value) const {
+            return Contains(value, HashString(value));
+        }
+
+        // hash - уже посчитанный HashString(value)
+        bool Contains(std::string_view value, std::uint64_t hash) const {
+            if (slots_.empty()) return false;
+            const std::uint32_t tag = static_cast<std::uint32_t>(hash >> 32);
+            for (std::size_t i = hash & mask_;; i = (i + 1) & mask_) {
+                const Slot& slot = slots_[i];
+                if (slot.item == 0) return false;
+                if (slot.tag == tag && Item(slot.item - 1) == value) return true;
+            }
+        }
+
+        std::size_t Size() const { return size_; }
+        bool Empty() const { return Size() == 0; }
+        std::size_t MemoryBytes() const { return arena_.capacity() + slots_.capacity() * sizeof(Slot); }
+
+        // Строки в порядке добавления
+        template <class Visit>
+        void ForEach(const Visit& visit) const {
+            for (std::size_t offset = 0; offset < arena_.size();) {
+                const std::string_view item = Item(offset);
+                visit(item);
+                offset += sizeof(std::uint32_t) + item.size();
+            }
+        }
+
+    private:
+        struct Slot {
+            std::uint32_t tag;    // старшие биты хеша
+            std::uint32_t item;   // смещение строки в arena_ + 1, 0 - пусто
+        };
+
+        std::string_view Item(std::size_t offset) const {
+            std::uint32_t length;
+            std::memcpy(&length, arena_.data() + offset, sizeof(length));
+            return std::string_view(arena_.data() + offset + sizeof(length), length);
+        }
+        void Rehash(std::size_t capacity);
+        void Place(std::uint64_t hash, std::uint32_t item);
+
+        std::string arena_;
+        std::size_t size_ = 0;
+        std::vector<Slot> slots_;
+        std::size_t mask_ = 0;
+    };
+}
@@ -0,0 +1,52 @@
+﻿#include "TextRope.h"
+
+namespace mc {
+    void TextRope::Append(std::wstring_view text) {
+        for (std::size_t pos = text.find(L'\n'); pos != std::wstring_view::npos; pos = text.find(L'\n', pos + 1)) {
+            breaks_.push_back(size_ + pos);
+        }
+
+        while (!text.empty()) {
+            const std::size_t inChunk = size_ % CHUNK_CHARS;
+            if (inChunk == 0 && size_ / CHUNK_CHARS == chunks_.size()) {
+                chunks_.emplace_back(new wchar_t[CHUNK_CHARS]);
+            }
+            const std::size_t piece = std::min(text.size(), CHUNK_CHARS - inChunk);
+            std::copy(text.begin(), text.begin() + piece, chunks_[size_ / CHUNK_CHARS].get() + inChunk);
+            size_ += piece;
+            text.remove_prefix(piece);
+        }
+    }
+
+    void TextRope::Clear() {
+        chunks_.clear();
+        breaks_.clear();
+        size_ = 0;
+    }
+
+    void TextRope::Truncate(std::size_t size) {
+        if (size >= size_) return;
+        size_ = size;
+        breaks_.erase(std::lower_bound(breaks_.begin(), breaks_.end(), size), breaks_.end());
+        chunks_.resize((size_ + CHUNK_CHARS - 1) / CHUNK_CHARS);
+    }
+
+    std::size_t TextRope::LineCount() const {
+        // Последняя строка без '\n' тоже считается
+        const bool tail = breaks_.empty() ? size_ > 0 : breaks_.back() + 1 < size_;
+        return breaks_.size() + (tail ? 1 : 0);
+    }
+
+    void TextRope::Copy(std::size_t offset, std::size_t count, wchar_t* out) const {
+        ForEachPiece(offset, count, [&](std::wstring_view piece) {
+            out = std::copy(piece.begin(), piece.end(), out);
+        });
+    }
+
+    std::wstring TextRope::Substr(std::size_t offset, std::size_t count) const {
+        std::wstring result;
+        result.reserve(std::min(count, size_ - std::min(offset, size_)));
+        ForEachPiece(offset, count, [&](std::wstring_view piece) { result.append(piece); });
+        return result;
+    }
+}
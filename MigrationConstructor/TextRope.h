@@ -0,0 +1,57 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Текст из блоков фиксированного размера: добавление в конец без перекопирования
+// уже записанного, быстрый доступ к любой позиции и любой строке
+namespace mc {
+    class TextRope {
+    public:
+        static constexpr std::size_t CHUNK_CHARS = std::size_t(1) << 16;
+
+        void Append(std::wstring_view text);
+        void Clear();
+
+        // Отбрасывает все после первых size символов
+        void Truncate(std::size_t size);
+
+        std::size_t Size() const { return size_; }
+        bool Empty() const { return size_ == 0; }
+
+        // Строки разделяются '\n' (перед ним может стоять '\r')
+        std::size_t LineCount() const;
+        std::size_t LineStart(std::size_t line) const { return line == 0 ? 0 : breaks_[line - 1] + 1; }
+
+        // Копия диапазона [offset, offset + count) в out
+        void Copy(std::size_t offset, std::size_t count, wchar_t* out) const;
+        std::wstring Substr(std::size_t offset, std::size_t count) const;
+
+        // Диапазон частями по блокам без копирования: visit(std::wstring_view)
+        template <class Visit>
+        void ForEachPiece(std::size_t offset, std::size_t count, Visit&& visit) const {
+            count = std::min(count, size_ - std::min(offset, size_));
+            while (count > 0) {
+                const std::size_t inChunk = offset % CHUNK_CHARS;
+                const std::size_t piece = std::min(count, CHUNK_CHARS - inChunk);
+                visit(std::wstring_view(chunks_[offset / CHUNK_CHARS].get() + inChunk, piece));
+                offset += piece;
+                count -= piece;
+            }
+        }
+
+        std::size_t MemoryBytes() const {
+            return chunks_.size() * CHUNK_CHARS * sizeof(wchar_t) + breaks_.capacity() * sizeof(std::uint64_t);
+        }
+
+    private:
+        std::vector<std::unique_ptr<wchar_t[]>> chunks_;
+        std::size_t size_ = 0;
+        std::vector<std::uint64_t> breaks_;   // позиции '\n'
+    };
+}
@@ -0,0 +1,240 @@
+﻿#include "Trace.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+namespace mc {
+    namespace detail {
+        std::atomic<bool> traceEnabled{ false };
+    }
+
+    namespace {
+        // Гистограмма: до 16 нс - по наносекунде, дальше 16 корзин на каждую степень двойки
+        constexpr std::size_t EXACT_BUCKETS = 16;
+        constexpr std::size_t SUB_BUCKETS = 16;
+        constexpr int MAX_EXPONENT = 47;        // ~39 часов; все, что дольше, - в последнюю корзину
+        constexpr std::size_t HISTOGRAM_BUCKETS = EXACT_BUCKETS + (MAX_EXPONENT - 3) * SUB_BUCKETS;
+
+        std::size_t BucketOf(std::uint64_t nanos) {
+            if (nanos < EXACT_BUCKETS) return static_cast<std::size_t>(nanos);
+            // Старший бит двоичным поиском: шесть сравнений вместо цикла по битам
+            int exponent = 0;
+            for (int step = 32; step > 0; step /= 2) {
+                if (nanos >> (exponent + step)) exponent += step;
+            }
+            if (exponent > MAX_EXPONENT) return HISTOGRAM_BUCKETS - 1;
+            const std::size_t sub = static_cast<std::size_t>(nanos >> (exponent - 4)) & (SUB_BUCKETS - 1);
+            return EXACT_BUCKETS + static_cast<std::size_t>(exponent - 4) * SUB_BUCKETS + sub;
+        }
+
+        // Середина корзины
+        double BucketValue(std::size_t bucket) {
+            if (bucket < EXACT_BUCKETS) return static_cast<double>(bucket);
+            const int shift = static_cast<int>((bucket - EXACT_BUCKETS) / SUB_BUCKETS);
+            const std::uint64_t sub = (bucket - EXACT_BUCKETS) % SUB_BUCKETS;
+            const double width = static_cast<double>(std::uint64_t(1) << shift);
+            return static_cast<double>((SUB_BUCKETS + sub) << shift) + width / 2;
+        }
+
+        // Поля - атомарные, чтобы выгрузка могла читать кольцо, пока поток в него пишет
+        struct Event {
+            std::atomic<std::uint64_t> start;
+            std::atomic<std::uint64_t> duration;
+            std::atomic<std::uint32_t> span;
+        };
+
+        // Кольцо потока. Пишет только владелец: reserved увеличивается до записи события,
+        // committed - после. Читатель копирует события до committed и отбрасывает те,
+        // которые владелец мог начать перезаписывать (индекс меньше reserved - емкость)
+        struct ThreadRing {
+            std::uint32_t tid = 0;
+            std::atomic<bool> owned{ true };
+            std::atomic<std::uint64_t> reserved{ 0 };
+            std::atomic<std::uint64_t> committed{ 0 };
+            Event events[TRACE_RING_EVENTS];
+            std::atomic<std::uint32_t> histogram[MAX_TRACE_SPANS][HISTOGRAM_BUCKETS];
+            std::atomic<std::uint64_t> maxNanos[MAX_TRACE_SPANS];
+        };
+
+        struct Registry {
+            std::mutex mutex;
+            std::vector<const char*> names;
+            // Кольца не удаляются: кольцо завершившегося потока достается следующему новому
+            std::vector<std::unique_ptr<ThreadRing>> rings;
+        };
+
+        Registry& GetRegistry() {
+            static Registry registry;
+            return registry;
+        }
+
+        struct RingOwner {
+            ThreadRing* ring = nullptr;
+            ~RingOwner() {
+                if (ring) ring->owned.store(false, std::memory_order_release);
+            }
+        };
+
+        thread_local RingOwner ringOwner;
+
+        ThreadRing* AcquireRing() {
+            Registry& registry = GetRegistry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            for (const auto& ring : registry.rings) {
+                bool owned = false;
+                if (ring->owned.compare_exchange_strong(owned, true, std::memory_order_acquire)) {
+                    return ringOwner.ring = ring.get();
+                }
+            }
+            // Значение с () обнуляет массивы атомиков
+            registry.rings.push_back(std::make_unique<ThreadRing>());
+            registry.rings.back()->tid = static_cast<std::uint32_t>(registry.rings.size());
+            return ringOwner.ring = registry.rings.back().get();
+        }
+
+        struct SnapshotEvent {
+            std::uint64_t start;
+            std::uint64_t duration;
+            std::uint32_t span;
+        };
+
+        void SnapshotRing(const ThreadRing& ring, std::vector<SnapshotEvent>& out) {
+            const std::uint64_t end = ring.committed.load(std::memory_order_acquire);
+            const std::uint64_t begin = end > TRACE_RING_EVENTS ? end - TRACE_RING_EVENTS : 0;
+            const std::size_t first = out.size();
+            for (std::uint64_t i = begin; i < end; ++i) {
+                const Event& event = ring.events[i & (TRACE_RING_EVENTS - 1)];
+                out.push_back({ event.start.load(std::memory_order_relaxed),
+                    event.duration.load(std::memory_order_relaxed),
+                    event.span.load(std::memory_order_relaxed) });
+            }
+            // Все, что владелец успел начать перезаписывать за время копирования, отбрасывается
+            std::atomic_thread_fence(std::memory_order_acquire);
+            const std::uint64_t reserved = ring.reserved.load(std::memory_order_relaxed);
+            const std::uint64_t valid = reserved > TRACE_RING_EVENTS ? reserved - TRACE_RING_EVENTS : 0;
+            if (valid > begin) {
+                const std::size_t stale = static_cast<std::size_t>(std::min(valid, end) - begin);
+                out.erase(out.begin() + first, out.begin() + first + stale);
+            }
+        }
+
+        void AppendEscaped(std::string& out, const char* text) {
+            for (; *text; ++text) {
+                if (*text == '"' || *text == '\\') out += '\\';
+                out += *text;
+            }
+        }
+    }
+
+    TraceSpan::TraceSpan(const char* name) {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        if (registry.names.size() >= MAX_TRACE_SPANS) {
+            throw std::runtime_error("Слишком много участков трассировки");
+        }
+        id_ = static_cast<std::uint32_t>(registry.names.size());
+        registry.names.push_back(name);
+    }
+
+    void EnableTracing(bool enabled) {
+        TraceNow();     // начало отсчета - не позже первого события
+        detail::traceEnabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    void RecordTraceEvent(const TraceSpan& span, std::uint64_t startNanos, std::uint64_t endNanos) {
+        ThreadRing* ring = ringOwner.ring ? ringOwner.ring : AcquireRing();
+        const std::uint64_t duration = endNanos > startNanos ? endNanos - startNanos : 0;
+
+        const std::uint64_t index = ring->reserved.load(std::memory_order_relaxed);
+        ring->reserved.store(index + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        Event& event = ring->events[index & (TRACE_RING_EVENTS - 1)];
+        event.start.store(startNanos, std::memory_order_relaxed);
+        event.duration.store(duration, std::memory_order_relaxed);
+        event.span.store(span.Id(), std::memory_order_relaxed);
+        ring->committed.store(index + 1, std::memory_order_release);
+
+        // Счетчики меняет только владелец кольца, поэтому без атомарного сложения
+        std::atomic<std::uint32_t>& bucket = ring->histogram[span.Id()][BucketOf(duration)];
+        bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic<std::uint64_t>& max = ring->maxNanos[span.Id()];
+        if (duration > max.load(std::memory_order_relaxed)) max.store(duration, std::memory_order_relaxed);
+    }
+
+    std::vector<TraceSpanStats> TraceSummary() {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+
+        std::vector<TraceSpanStats> result;
+        std::vector<std::uint64_t> merged(HISTOGRAM_BUCKETS);
+        for (std::size_t span = 0; span < registry.names.size(); ++span) {
+            std::fill(merged.begin(), merged.end(), 0);
+            TraceSpanStats stats;
+            stats.name = registry.names[span];
+            std::uint64_t max = 0;
+            for (const auto& ring : registry.rings) {
+                for (std::size_t b = 0; b < HISTOGRAM_BUCKETS; ++b) {
+                    const std::uint32_t count = ring->histogram[span][b].load(std::memory_order_relaxed);
+                    merged[b] += count;
+                    stats.count += count;
+                }
+                max = std::max(max, ring->maxNanos[span].load(std::memory_order_relaxed));
+            }
+            if (stats.count == 0) continue;
+
+            // Перцентиль q - корзина, в которую попадает событие с номером ceil(q * count)
+            const auto percentile = [&](std::uint64_t per1000) {
+                const std::uint64_t rank = std::max<std::uint64_t>(1, (stats.count * per1000 + 999) / 1000);
+                std::uint64_t seen = 0;
+                for (std::size_t b = 0; b < HISTOGRAM_BUCKETS; ++b) {
+                    seen += merged[b];
+                    if (seen >= rank) return std::min(BucketValue(b), static_cast<double>(max)) / 1000;
+                }
+                return static_cast<double>(max) / 1000;
+            };
+            stats.p50Micros = percentile(500);
+            stats.p99Micros = percentile(990);
+            stats.maxMicros = static_cast<double>(max) / 1000;
+            result.push_back(std::move(stats));
+        }
+        return result;
+    }
+
+    std::string ChromeTraceJson() {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+
+        std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        bool first = true;
+        char number[96];
+        std::vector<SnapshotEvent> events;
+        for (const auto& ring : registry.rings) {
+            events.clear();
+            SnapshotRing(*ring, events);
+            for (const SnapshotEvent& event : events) {
+                if (event.span >= registry.names.size()) continue;
+                if (!first) json += ",\n";
+                first = false;
+                json += "{\"name\":\"";
+                AppendEscaped(json, registry.names[event.span]);
+                std::snprintf(number, sizeof(number), "\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                    ring->tid, event.start / 1000.0, event.duration / 1000.0);
+                json += number;
+            }
+        }
+        json += "\n]}\n";
+        return json;
+    }
+
+    void WriteChromeTrace(const std::filesystem::path& path) {
+        const std::string json = ChromeTraceJson();
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) throw std::runtime_error("Ошибка открытия файла: " + path.string());
+        out.write(json.data(), static_cast<std::streamsize>(json.size()));
+        if (!out.flush()) throw std::runtime_error("Ошибка записи в файл: " + path.string());
+    }
+}
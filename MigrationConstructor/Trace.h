@@ -0,0 +1,84 @@
+﻿#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Замеры горячих путей окна (набор в комбобоксе, загрузка словарей, сборка записей).
+// Включаются явно; выключенный участок стоит одной проверки флага. Каждый поток пишет
+// в свое кольцо без блокировок, гистограммы и трасса Chrome собираются по запросу
+namespace mc {
+    constexpr std::size_t MAX_TRACE_SPANS = 32;
+    constexpr std::size_t TRACE_RING_EVENTS = std::size_t(1) << 14;    // последних событий на поток
+
+    // Именованный участок. Объявляется один раз (static или в пространстве имен):
+    //     static const mc::TraceSpan span("FilterComboBox");
+    // name должна жить до конца программы (строковый литерал)
+    class TraceSpan {
+    public:
+        explicit TraceSpan(const char* name);
+        std::uint32_t Id() const { return id_; }
+
+    private:
+        std::uint32_t id_;
+    };
+
+    namespace detail {
+        extern std::atomic<bool> traceEnabled;
+    }
+
+    void EnableTracing(bool enabled);
+    inline bool TracingEnabled() { return detail::traceEnabled.load(std::memory_order_relaxed); }
+
+    // Наносекунды от запуска программы
+    inline std::uint64_t TraceNow() {
+        static const auto origin = std::chrono::steady_clock::now();
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - origin).count());
+    }
+
+    // Событие в кольцо текущего потока и в гистограмму участка
+    void RecordTraceEvent(const TraceSpan& span, std::uint64_t startNanos, std::uint64_t endNanos);
+
+    // Замер участка от конструктора до деструктора
+    class TraceScope {
+    public:
+        explicit TraceScope(const TraceSpan& span)
+            : span_(span), enabled_(TracingEnabled()), start_(enabled_ ? TraceNow() : 0) {}
+        ~TraceScope() {
+            if (enabled_) RecordTraceEvent(span_, start_, TraceNow());
+        }
+
+        TraceScope(const TraceScope&) = delete;
+        TraceScope& operator=(const TraceScope&) = delete;
+
+    private:
+        const TraceSpan& span_;
+        bool enabled_;
+        std::uint64_t start_;
+    };
+
+    // Распределение времени участка по всем потокам. Перцентили - по корзинам гистограммы,
+    // погрешность не больше 1/16 значения
+    struct TraceSpanStats {
+        std::string name;
+        std::uint64_t count = 0;
+        double p50Micros = 0;
+        double p99Micros = 0;
+        double maxMicros = 0;
+    };
+
+    // Участки, у которых есть события, в порядке объявления
+    std::vector<TraceSpanStats> TraceSummary();
+
+    // Последние события всех потоков в формате Chrome trace (chrome://tracing, Perfetto).
+    // Можно вызывать, пока потоки пишут: события, перезаписанные во время чтения, пропускаются
+    std::string ChromeTraceJson();
+
+    // Бросает std::runtime_error при ошибке записи
+    void WriteChromeTrace(const std::filesystem::path& path);
+}
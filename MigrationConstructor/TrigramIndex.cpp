@@ -0,0 +1,371 @@
+﻿#include "TrigramIndex.h"
+#include "CaseFold.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace mc {
+    namespace {
+        constexpr std::size_t TRIGRAM = 3;
+
+        std::uint64_t TrigramKey(const wchar_t* p) {
+            const auto code = [](wchar_t ch) { return static_cast<std::uint64_t>(ch) & 0x1FFFFF; };
+            return (code(p[0]) << 42) | (code(p[1]) << 21) | code(p[2]);
+        }
+
+        // Символ или пара символов; длина в старших битах, чтобы символ не совпал с парой
+        std::uint64_t ShortKey(std::wstring_view text) {
+            const auto code = [](wchar_t ch) { return static_cast<std::uint64_t>(ch) & 0x1FFFFF; };
+            return text.size() == 1 ? (1ull << 42) | code(text[0]) : (2ull << 42) | (code(text[0]) << 21) | code(text[1]);
+        }
+
+        // Номера ключей ShortKey: открытая адресация, ключ 0 - пустая ячейка (у ShortKey длина
+        // в старших битах, нуля не бывает). Символов и пар - тысячи, таблица остается в кэше
+        class ShortIds {
+        public:
+            ShortIds() : keys_(1024, 0), ids_(1024, 0) {}
+
+            // Номер ключа; новый ключ получает номер next, inserted = true
+            std::uint32_t Find(std::uint64_t key, std::uint32_t next, bool& inserted) {
+                const std::size_t mask = keys_.size() - 1;
+                for (std::size_t i = Slot(key) & mask;; i = (i + 1) & mask) {
+                    if (keys_[i] == key) {
+                        inserted = false;
+                        return ids_[i];
+                    }
+                    if (keys_[i] == 0) {
+                        keys_[i] = key;
+                        ids_[i] = next;
+                        inserted = true;
+                        if (++size_ * 2 > keys_.size()) Grow();
+                        return next;
+                    }
+                }
+            }
+
+        private:
+            static std::size_t Slot(std::uint64_t key) { return static_cast<std::size_t>((key * 0x9E3779B97F4A7C15ull) >> 20); }
+
+            void Grow() {
+                std::vector<std::uint64_t> keys(keys_.size() * 2, 0);
+                std::vector<std::uint32_t> ids(keys.size(), 0);
+                const std::size_t mask = keys.size() - 1;
+                for (std::size_t j = 0; j < keys_.size(); ++j) {
+                    if (keys_[j] == 0) continue;
+                    std::size_t i = Slot(keys_[j]) & mask;
+                    while (keys[i] != 0) i = (i + 1) & mask;
+                    keys[i] = keys_[j];
+                    ids[i] = ids_[j];
+                }
+                keys_.swap(keys);
+                ids_.swap(ids);
+            }
+
+            std::vector<std::uint64_t> keys_;
+            std::vector<std::uint32_t> ids_;
+            std::size_t size_ = 0;
+        };
+
+        void CollectTrigrams(std::wstring_view text, std::vector<std::uint64_t>& out) {
+            out.clear();
+            for (std::size_t i = 0; i + TRIGRAM <= text.size(); ++i) {
+                out.push_back(TrigramKey(text.data() + i));
+            }
+            std::sort(out.begin(), out.end());
+            out.erase(std::unique(out.begin(), out.end()), out.end());
+        }
+
+        // Начало строки, начало слова, середина слова; затем короче - лучше
+        std::uint32_t SubstringScore(std::wstring_view text, std::size_t pos) {
+            const std::uint32_t place = pos == 0 ? 0
+                : (text[pos - 1] == L' ' || text[pos - 1] == L'_' || text[pos - 1] == L'-') ? 1 : 2;
+            return (place << 24) | static_cast<std::uint32_t>(std::min<std::size_t>(text.size(), 0xFFFFFF));
+        }
+
+        bool Better(const Match& a, const Match& b) {
+            return a.score != b.score ? a.score < b.score : a.item < b.item;
+        }
+
+        void KeepBest(std::vector<Match>& matches, std::size_t topK) {
+            if (matches.size() > topK) {
+                std::partial_sort(matches.begin(), matches.begin() + topK, matches.end(), Better);
+                matches.resize(topK);
+            }
+            else {
+                std::sort(matches.begin(), matches.end(), Better);
+            }
+        }
+
+        // Куча из topK лучших (в вершине - худший из них): память не зависит от числа совпадений
+        void PushBounded(std::vector<Match>& heap, const Match& match, std::size_t topK) {
+            if (heap.size() < topK) {
+                heap.push_back(match);
+                std::push_heap(heap.begin(), heap.end(), Better);
+            }
+            else if (Better(match, heap.front())) {
+                std::pop_heap(heap.begin(), heap.end(), Better);
+                heap.back() = match;
+                std::push_heap(heap.begin(), heap.end(), Better);
+            }
+        }
+    }
+
+    void TrigramIndex::Build(const std::vector<std::wstring_view>& items) {
+        std::vector<wchar_t>& folded = folded_.Owned();
+        std::vector<std::uint32_t>& offsets = offsets_.Owned();
+        folded.clear();
+        offsets.clear();
+
+        std::size_t total = 0;
+        for (const auto& item : items) total += item.size();
+        folded.resize(total);
+        offsets.reserve(items.size() + 1);
+        std::size_t used = 0;
+        for (const auto& item : items) {
+            offsets.push_back(static_cast<std::uint32_t>(used));
+            FoldCaseTo(folded.data() + used, item);
+            used += item.size();
+        }
+        offsets.push_back(static_cast<std::uint32_t>(used));
+
+        // Первый проход: номера триграмм и длины списков
+        std::unordered_map<std::uint64_t, std::uint32_t> trigramIds;
+        std::vector<std::uint64_t> trigrams;
+        std::vector<std::uint32_t> counts;
+        for (std::uint32_t item = 0; item < items.size(); ++item) {
+            CollectTrigrams(FoldedAt(item), trigrams);
+            for (std::uint64_t trigram : trigrams) {
+                const auto inserted = trigramIds.emplace(trigram, static_cast<std::uint32_t>(counts.size()));
+                if (inserted.second) counts.push_back(0);
+                ++counts[inserted.first->second];
+            }
+        }
+
+        // Триграммы по возрастанию: поиск списка - двоичный поиск, без хеш-таблицы в кэше
+        std::vector<std::uint64_t>& keys = trigramKeys_.Owned();
+        keys.clear();
+        keys.reserve(trigramIds.size());
+        for (const auto& entry : trigramIds) keys.push_back(entry.first);
+        std::sort(keys.begin(), keys.end());
+
+        std::vector<std::uint32_t> remap(counts.size());
+        std::vector<std::uint32_t>& postingOffsets = postingOffsets_.Owned();
+        postingOffsets.assign(keys.size() + 1, 0);
+        for (std::size_t rank = 0; rank < keys.size(); ++rank) {
+            const std::uint32_t id = trigramIds[keys[rank]];
+            remap[id] = static_cast<std::uint32_t>(rank);
+            postingOffsets[rank + 1] = postingOffsets[rank] + counts[id];
+        }
+
+        // Второй проход: строки добавляются по возрастанию, списки уже отсортированы
+        std::vector<std::uint32_t>& postings = postings_.Owned();
+        postings.assign(postingOffsets.back(), 0);
+        std::vector<std::uint32_t> fill(postingOffsets.begin(), postingOffsets.end() - 1);
+        for (std::uint32_t item = 0; item < items.size(); ++item) {
+            CollectTrigrams(FoldedAt(item), trigrams);
+            for (std::uint64_t trigram : trigrams) {
+                postings[fill[remap[trigramIds[trigram]]]++] = item;
+            }
+        }
+
+        BuildShort(items);
+        hits_.clear();
+    }
+
+    void TrigramIndex::BuildShort(const std::vector<std::wstring_view>& items) {
+        // Для каждого символа и пары - куча из SHORT_POSTINGS лучших строк с оценкой по первому
+        // вхождению, как у SearchShort. Память - по числу разных символов и пар, а не по словарю
+        ShortIds shortIds;
+        std::vector<std::uint64_t> shortKeys;  // ключ по номеру
+        std::vector<std::vector<Match>> heaps;
+        std::vector<std::uint32_t> lastItem;   // строка, в которой ключ встретился последним
+        for (std::uint32_t item = 0; item < items.size(); ++item) {
+            const std::wstring_view text = FoldedAt(item);
+            for (std::size_t i = 0; i < text.size(); ++i) {
+                for (std::size_t length = 1; length <= 2 && i + length <= text.size(); ++length) {
+                    const std::uint64_t key = ShortKey(text.substr(i, length));
+                    bool inserted;
+                    const std::uint32_t id = shortIds.Find(key, static_cast<std::uint32_t>(heaps.size()), inserted);
+                    if (inserted) {
+                        shortKeys.push_back(key);
+                        heaps.emplace_back();
+                        lastItem.push_back(item);
+                    }
+                    else if (lastItem[id] == item) {
+                        continue;   // не первое вхождение
+                    }
+                    lastItem[id] = item;
+                    PushBounded(heaps[id], { item, SubstringScore(text, i) }, SHORT_POSTINGS);
+                }
+            }
+        }
+
+        // Ключи по возрастанию, как триграммы
+        std::vector<std::uint32_t> order(shortKeys.size());
+        for (std::uint32_t id = 0; id < order.size(); ++id) order[id] = id;
+        std::sort(order.begin(), order.end(), [&](std::uint32_t a, std::uint32_t b) { return shortKeys[a] < shortKeys[b]; });
+
+        std::vector<std::uint64_t>& keys = shortKeys_.Owned();
+        std::vector<std::uint32_t>& offsets = shortOffsets_.Owned();
+        std::vector<std::uint32_t>& postings = shortPostings_.Owned();
+        keys.clear();
+        offsets.clear();
+        postings.clear();
+        keys.reserve(order.size());
+        offsets.reserve(order.size() + 1);
+        for (const std::uint32_t id : order) {
+            keys.push_back(shortKeys[id]);
+            offsets.push_back(static_cast<std::uint32_t>(postings.size()));
+            std::sort_heap(heaps[id].begin(), heaps[id].end(), Better);
+            for (const Match& match : heaps[id]) postings.push_back(match.item);
+        }
+        offsets.push_back(static_cast<std::uint32_t>(postings.size()));
+    }
+
+    std::wstring_view TrigramIndex::FoldedAt(std::uint32_t item) const {
+        return std::wstring_view(folded_.Data() + offsets_[item], offsets_[item + 1] - offsets_[item]);
+    }
+
+    const std::uint32_t* TrigramIndex::FindPostings(std::uint64_t trigram, std::size_t& count) const {
+        const auto it = std::lower_bound(trigramKeys_.begin(), trigramKeys_.end(), trigram);
+        if (it == trigramKeys_.end() || *it != trigram) {
+            count = 0;
+            return nullptr;
+        }
+        const std::size_t rank = static_cast<std::size_t>(it - trigramKeys_.begin());
+        count = postingOffsets_[rank + 1] - postingOffsets_[rank];
+        return postings_.Data() + postingOffsets_[rank];
+    }
+
+    bool TrigramIndex::Search(std::wstring_view query, MatchMode mode, std::size_t topK, std::vector<Match>& out,
+        const CancelToken& cancel) const {
+        out.clear();
+        if (cancel.Cancelled()) return false;
+        if (topK == 0 || Size() == 0) return true;
+
+        const std::wstring folded = FoldCase(query);
+        bool done;
+        if (folded.size() < TRIGRAM) {
+            done = SearchShort(folded, topK, out, cancel);
+        }
+        else if (mode == MatchMode::Substring) {
+            done = SearchSubstring(folded, topK, out, cancel);
+        }
+        else {
+            done = SearchFuzzy(folded, topK, out, cancel);
+        }
+        if (!done) out.clear();
+        return done;
+    }
+
+    bool TrigramIndex::SearchShort(std::wstring_view folded, std::size_t topK, std::vector<Match>& out, const CancelToken& cancel) const {
+        // Для одного-двух символов триграмм нет: лучшие строки уже отобраны при построении.
+        // В списке все строки с символом, если их не больше SHORT_POSTINGS, иначе - лучшие SHORT_POSTINGS
+        if (topK > SHORT_POSTINGS) return ScanShort(folded, topK, out, cancel);
+        const auto it = std::lower_bound(shortKeys_.begin(), shortKeys_.end(), ShortKey(folded));
+        if (it == shortKeys_.end() || *it != ShortKey(folded)) return true;
+        const std::size_t rank = static_cast<std::size_t>(it - shortKeys_.begin());
+        const std::uint32_t* postings = shortPostings_.Data() + shortOffsets_[rank];
+        const std::size_t count = std::min<std::size_t>(shortOffsets_[rank + 1] - shortOffsets_[rank], topK);
+        for (std::size_t i = 0; i < count; ++i) {
+            const std::wstring_view text = FoldedAt(postings[i]);
+            out.push_back({ postings[i], SubstringScore(text, text.find(folded)) });
+        }
+        return true;
+    }
+
+    bool TrigramIndex::ScanShort(std::wstring_view folded, std::size_t topK, std::vector<Match>& out, const CancelToken& cancel) const {
+        // Больше лучших, чем хранится в списках: просмотр всех строк. Совпадения в начале
+        // строки могут быть в конце словаря, поэтому ранжируются все, а хранятся только topK лучших
+        for (std::uint32_t item = 0; item < Size(); ++item) {
+            if (item % CANCEL_CHECK_STEP == 0 && cancel.Cancelled()) return false;
+            const std::wstring_view text = FoldedAt(item);
+            const std::size_t pos = text.find(folded);
+            if (pos != std::wstring_view::npos) {
+                PushBounded(out, { item, SubstringScore(text, pos) }, topK);
+            }
+        }
+        std::sort_heap(out.begin(), out.end(), Better);
+        return true;
+    }
+
+    bool TrigramIndex::SearchSubstring(std::wstring_view folded, std::size_t topK, std::vector<Match>& out, const CancelToken& cancel) const {
+        std::vector<std::uint64_t> trigrams;
+        CollectTrigrams(folded, trigrams);
+
+        // Пересечение списков, начиная с самого короткого
+        std::vector<std::pair<const std::uint32_t*, std::size_t>> lists;
+        for (std::uint64_t trigram : trigrams) {
+            std::size_t count = 0;
+            const std::uint32_t* postings = FindPostings(trigram, count);
+            if (count == 0) return true;
+            lists.emplace_back(postings, count);
+        }
+        std::sort(lists.begin(), lists.end(), [](const auto& a, const auto& b) { return a.second < b.second; });
+
+        std::vector<std::uint32_t> candidates(lists[0].first, lists[0].first + lists[0].second);
+        for (std::size_t i = 1; i < lists.size() && !candidates.empty(); ++i) {
+            if (cancel.Cancelled()) return false;
+            const std::uint32_t* begin = lists[i].first;
+            const std::uint32_t* end = begin + lists[i].second;
+            auto keep = candidates.begin();
+            for (std::uint32_t item : candidates) {
+                begin = std::lower_bound(begin, end, item);
+                if (begin == end) break;
+                if (*begin == item) *keep++ = item;
+            }
+            candidates.erase(keep, candidates.end());
+        }
+
+        // Триграммы необходимы, но не достаточны: проверка самой подстроки
+        for (std::size_t i = 0; i < candidates.size(); ++i) {
+            if (i % CANCEL_CHECK_STEP == 0 && cancel.Cancelled()) return false;
+            const std::wstring_view text = FoldedAt(candidates[i]);
+            const std::size_t pos = text.find(folded);
+            if (pos != std::wstring_view::npos) {
+                out.push_back({ candidates[i], SubstringScore(text, pos) });
+            }
+        }
+        KeepBest(out, topK);
+        return true;
+    }
+
+    bool TrigramIndex::SearchFuzzy(std::wstring_view folded, std::size_t topK, std::vector<Match>& out, const CancelToken& cancel) const {
+        std::vector<std::uint64_t> trigrams;
+        CollectTrigrams(folded, trigrams);
+        // Счетчики hits_ восьмибитные
+        if (trigrams.size() > 0xFF) trigrams.resize(0xFF);
+
+        if (hits_.size() != Size()) hits_.assign(Size(), 0);
+
+        // Подсчет общих триграмм; строка нужна хотя бы с половиной триграмм запроса
+        std::vector<std::uint32_t> touched;
+        for (std::uint64_t trigram : trigrams) {
+            // Отмена до подсчета следующего списка; счетчики обнуляются, как после обычного поиска
+            if (cancel.Cancelled()) {
+                for (std::uint32_t item : touched) hits_[item] = 0;
+                return false;
+            }
+            std::size_t count = 0;
+            const std::uint32_t* postings = FindPostings(trigram, count);
+            for (std::size_t i = 0; i < count; ++i) {
+                if (hits_[postings[i]]++ == 0) touched.push_back(postings[i]);
+            }
+        }
+
+        const std::size_t queryCount = trigrams.size();
+        const std::size_t required = (queryCount + 1) / 2;
+        for (std::uint32_t item : touched) {
+            const std::size_t shared = std::min<std::size_t>(hits_[item], queryCount);
+            hits_[item] = 0;
+            if (shared < required) continue;
+
+            // Меньше пропущенных триграмм и ближе длина - лучше
+            const std::wstring_view text = FoldedAt(item);
+            const std::size_t lengthDiff = text.size() > folded.size() ? text.size() - folded.size() : folded.size() - text.size();
+            out.push_back({ item, static_cast<std::uint32_t>(((queryCount - shared) << 16) | std::min<std::size_t>(lengthDiff, 0xFFFF)) });
+        }
+        KeepBest(out, topK);
+        return true;
+    }
+}
@@ -0,0 +1,85 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "CancelToken.h"
+#include "MappedArray.h"
+
+// Индекс триграмм для поиска по части строки и нечеткого поиска в словаре.
+// Строится при загрузке словаря, списки вхождений хранятся подряд (CSR).
+// Для запросов из одного-двух символов - свои списки лучших строк по каждому символу и паре
+namespace mc {
+    enum class MatchMode {
+        Substring,   // запрос входит в строку целиком
+        Fuzzy        // общие триграммы с запросом, допускаются опечатки
+    };
+
+    struct Match {
+        std::uint32_t item;    // индекс строки словаря
+        std::uint32_t score;   // меньше - лучше
+    };
+
+    class TrigramIndex {
+    public:
+        // Сколько лучших строк хранится для одного символа или пары. Короткий запрос с topK
+        // не больше этого читает только начало списка, с большим - просматривает весь словарь
+        static constexpr std::size_t SHORT_POSTINGS = 256;
+
+        void Build(const std::vector<std::wstring_view>& items);
+
+        std::size_t Size() const { return offsets_.Empty() ? 0 : offsets_.Size() - 1; }
+
+        // Лучшие topK совпадений по возрастанию score; false (out пуст), если запрос отменен по cancel.
+        // Нечеткий поиск пользуется общими счетчиками: один индекс не ищет в двух потоках сразу
+        bool Search(std::wstring_view query, MatchMode mode, std::size_t topK, std::vector<Match>& out,
+            const CancelToken& cancel = CancelToken()) const;
+
+        // Доступ к массивам для кэша .mcdict
+        const MappedArray<wchar_t>& Folded() const { return folded_; }
+        const MappedArray<std::uint32_t>& Offsets() const { return offsets_; }
+        const MappedArray<std::uint64_t>& TrigramKeys() const { return trigramKeys_; }
+        const MappedArray<std::uint32_t>& PostingOffsets() const { return postingOffsets_; }
+        const MappedArray<std::uint32_t>& Postings() const { return postings_; }
+        const MappedArray<std::uint64_t>& ShortKeys() const { return shortKeys_; }
+        const MappedArray<std::uint32_t>& ShortOffsets() const { return shortOffsets_; }
+        const MappedArray<std::uint32_t>& ShortPostings() const { return shortPostings_; }
+        void Map(const wchar_t* folded, std::size_t foldedSize, const std::uint32_t* offsets, std::size_t count,
+            const std::uint64_t* trigramKeys, const std::uint32_t* postingOffsets, std::size_t trigramCount,
+            const std::uint32_t* postings, std::size_t postingCount) {
+            folded_.Map(folded, foldedSize);
+            offsets_.Map(offsets, count + 1);
+            trigramKeys_.Map(trigramKeys, trigramCount);
+            postingOffsets_.Map(postingOffsets, trigramCount + 1);
+            postings_.Map(postings, postingCount);
+        }
+        void MapShort(const std::uint64_t* keys, const std::uint32_t* offsets, std::size_t keyCount,
+            const std::uint32_t* postings, std::size_t postingCount) {
+            shortKeys_.Map(keys, keyCount);
+            shortOffsets_.Map(offsets, keyCount + 1);
+            shortPostings_.Map(postings, postingCount);
+        }
+
+    private:
+        std::wstring_view FoldedAt(std::uint32_t item) const;
+        const std::uint32_t* FindPostings(std::uint64_t trigram, std::size_t& count) const;
+        void BuildShort(const std::vector<std::wstring_view>& items);
+        bool SearchShort(std::wstring_view folded, std::size_t topK, std::vector<Match>& out, const CancelToken& cancel) const;
+        bool ScanShort(std::wstring_view folded, std::size_t topK, std::vector<Match>& out, const CancelToken& cancel) const;
+        bool SearchSubstring(std::wstring_view folded, std::size_t topK, std::vector<Match>& out, const CancelToken& cancel) const;
+        bool SearchFuzzy(std::wstring_view folded, std::size_t topK, std::vector<Match>& out, const CancelToken& cancel) const;
+
+        MappedArray<wchar_t> folded_;                // строки словаря в верхнем регистре подряд
+        MappedArray<std::uint32_t> offsets_;         // начало строки в folded_
+        MappedArray<std::uint64_t> trigramKeys_;     // триграммы по возрастанию
+        MappedArray<std::uint32_t> postingOffsets_;  // начало списка триграммы в postings_
+        MappedArray<std::uint32_t> postings_;        // индексы строк по возрастанию
+        MappedArray<std::uint64_t> shortKeys_;       // символы и пары символов по возрастанию
+        MappedArray<std::uint32_t> shortOffsets_;    // начало списка в shortPostings_
+        MappedArray<std::uint32_t> shortPostings_;   // до SHORT_POSTINGS лучших строк, от лучшей
+        mutable std::vector<std::uint8_t> hits_;     // счетчики для нечеткого поиска
+    };
+}